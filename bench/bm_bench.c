@@ -0,0 +1,532 @@
+// bm_bench.c — микробенчмарки Burymetal
+//
+//   bm_bench [--filter подстрока] [--reps N] [--warmup N] [--min-time-ms N]
+//            [--threads N] [--max-size байт] [--json файл]
+//            [--baseline файл] [--threshold проценты]
+//   bm_bench --compare базовый.json новый.json [--threshold проценты]
+//
+// Каждый замер — пачка итераций, подобранная так, чтобы она шла не меньше
+// --min-time-ms; первые --warmup замеров отбрасываются. По --reps замерам
+// считаются min/p50/p90/p99/среднее в нс на операцию (стенные часы).
+// С --baseline (или в режиме --compare) p50 сравнивается с сохранённым
+// прогоном; рост больше --threshold процентов — регрессия, код выхода 1.
+#define _POSIX_C_SOURCE 200809L
+
+#include "burymetal.h"
+#include "bm_utils.h"
+#include "bm_mem_pool.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_MAX_RESULTS 64
+#define BENCH_MAX_REPS    1000
+#define BENCH_NAME_MAX    64
+
+typedef void (*BenchFn)(void* ctx, uint64_t iters);
+
+typedef struct {
+    char name[BENCH_NAME_MAX];
+    int threads;
+    uint64_t iters;             // итераций в одном замере
+    int samples;
+    double min_ns, p50_ns, p90_ns, p99_ns, mean_ns, stddev_ns; // на операцию
+    double bytes_per_op;        // 0 — не передача данных
+} BenchResult;
+
+static struct {
+    const char* filter;
+    int reps;
+    int warmup;
+    uint64_t min_sample_ns;
+    int max_threads;
+    size_t max_size;
+    const char* json_path;
+    const char* baseline_path;
+    double threshold;           // доля, 0.10 = 10%
+} opt = {NULL, 15, 3, 10 * 1000000ull, 0, 16u << 20, NULL, NULL, 0.10};
+
+static BenchResult results[BENCH_MAX_RESULTS];
+static size_t result_count = 0;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void check(BMResult res, const char* what) {
+    if (res == BM_OK) return;
+    fprintf(stderr, "bm_bench: %s: %s (%s)\n", what, bm_result_string(res), bm_get_last_error());
+    exit(2);
+}
+
+static void format_size(size_t bytes, char* out, size_t cap) {
+    if (bytes >= (1u << 20) && bytes % (1u << 20) == 0) snprintf(out, cap, "%zuMiB", bytes >> 20);
+    else if (bytes >= 1024 && bytes % 1024 == 0) snprintf(out, cap, "%zuKiB", bytes >> 10);
+    else snprintf(out, cap, "%zuB", bytes);
+}
+
+static void format_ns(double ns, char* out, size_t cap) {
+    if (ns < 1e3) snprintf(out, cap, "%.1f ns", ns);
+    else if (ns < 1e6) snprintf(out, cap, "%.2f us", ns / 1e3);
+    else snprintf(out, cap, "%.2f ms", ns / 1e6);
+}
+
+// ----------------------------------------
+// Замеры
+// ----------------------------------------
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Ближайший ранг по отсортированной выборке
+static double percentile(const double* sorted, int n, double p) {
+    int rank = (int)ceil(p / 100.0 * n);
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+static uint64_t time_iters(BenchFn fn, void* ctx, uint64_t iters) {
+    uint64_t start = now_ns();
+    fn(ctx, iters);
+    return now_ns() - start;
+}
+
+static void bench_run(const char* name, int threads, double bytes_per_op, BenchFn fn, void* ctx) {
+    if (opt.filter && !strstr(name, opt.filter)) return;
+    if (result_count == BENCH_MAX_RESULTS) {
+        fprintf(stderr, "bm_bench: слишком много бенчмарков, %s пропущен\n", name);
+        return;
+    }
+
+    // Калибровка: растим пачку, пока замер не займёт min_sample_ns
+    uint64_t iters = 1;
+    for (;;) {
+        uint64_t elapsed = time_iters(fn, ctx, iters);
+        if (elapsed >= opt.min_sample_ns || iters >= (1ull << 32)) break;
+        uint64_t scale = elapsed ? opt.min_sample_ns / elapsed + 1 : 16;
+        iters *= scale < 2 ? 2 : scale > 16 ? 16 : scale;
+    }
+
+    for (int i = 0; i < opt.warmup; i++) time_iters(fn, ctx, iters);
+
+    static double samples[BENCH_MAX_REPS];
+    double sum = 0;
+    for (int i = 0; i < opt.reps; i++) {
+        samples[i] = (double)time_iters(fn, ctx, iters) / (double)iters;
+        sum += samples[i];
+    }
+    qsort(samples, (size_t)opt.reps, sizeof(double), compare_double);
+
+    BenchResult* r = &results[result_count++];
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->threads = threads;
+    r->iters = iters;
+    r->samples = opt.reps;
+    r->min_ns = samples[0];
+    r->p50_ns = percentile(samples, opt.reps, 50);
+    r->p90_ns = percentile(samples, opt.reps, 90);
+    r->p99_ns = percentile(samples, opt.reps, 99);
+    r->mean_ns = sum / opt.reps;
+    double var = 0;
+    for (int i = 0; i < opt.reps; i++) var += (samples[i] - r->mean_ns) * (samples[i] - r->mean_ns);
+    r->stddev_ns = opt.reps > 1 ? sqrt(var / (opt.reps - 1)) : 0;
+    r->bytes_per_op = bytes_per_op;
+
+    char p50[32], p99[32];
+    format_ns(r->p50_ns, p50, sizeof(p50));
+    format_ns(r->p99_ns, p99, sizeof(p99));
+    printf("%-40s %12s %12s  ±%5.1f%%", r->name, p50, p99, r->mean_ns > 0 ? 100.0 * r->stddev_ns / r->mean_ns : 0.0);
+    if (bytes_per_op > 0) printf("  %9.2f GiB/s", bytes_per_op / r->p50_ns * 1e9 / (1u << 30));
+    else if (threads > 1) printf("  %9.2f Mop/s", threads * 1e3 / r->p50_ns);
+    printf("\n");
+    fflush(stdout);
+}
+
+// ----------------------------------------
+// Бенчмарки
+// ----------------------------------------
+static void bench_device(void* ctx, uint64_t iters) {
+    (void)ctx;
+    for (uint64_t i = 0; i < iters; i++) {
+        BMDevice* dev = NULL;
+        check(bm_create_device(BM_CPU, &dev), "bm_create_device");
+        bm_destroy_device(dev);
+    }
+}
+
+typedef struct {
+    BMDevice* dev;
+    BMBuffer* buffer;
+    BMKernel* kernel;
+    void* host;
+    size_t size;
+} BufferBench;
+
+static void bench_alloc(void* ctx, uint64_t iters) {
+    BufferBench* b = (BufferBench*)ctx;
+    for (uint64_t i = 0; i < iters; i++) {
+        BMBuffer* buffer = NULL;
+        check(bm_alloc_buffer(b->dev, b->size, &buffer), "bm_alloc_buffer");
+        bm_free_buffer(buffer);
+    }
+}
+
+static void bench_upload(void* ctx, uint64_t iters) {
+    BufferBench* b = (BufferBench*)ctx;
+    for (uint64_t i = 0; i < iters; i++) check(bm_write_buffer(b->buffer, b->host, b->size, 0), "bm_write_buffer");
+}
+
+static void bench_download(void* ctx, uint64_t iters) {
+    BufferBench* b = (BufferBench*)ctx;
+    for (uint64_t i = 0; i < iters; i++) check(bm_read_buffer(b->buffer, b->host, b->size, 0), "bm_read_buffer");
+}
+
+static void empty_kernel(void* data, size_t count) {
+    (void)data;
+    (void)count;
+}
+
+static void bench_launch(void* ctx, uint64_t iters) {
+    BufferBench* b = (BufferBench*)ctx;
+    for (uint64_t i = 0; i < iters; i++) check(bm_launch_kernel(b->kernel, b->buffer, 1), "bm_launch_kernel");
+}
+
+// Пул: главный поток — участник 0, остальные ждут на барьере между замерами
+typedef struct {
+    BMBufferPool* pool;
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+    uint64_t iters;
+    int stop;
+} PoolBench;
+
+static void pool_loop(PoolBench* p, uint64_t iters) {
+    for (uint64_t i = 0; i < iters; i++) {
+        BMBuffer* buffer = NULL;
+        check(bm_pool_acquire(p->pool, &buffer), "bm_pool_acquire");
+        check(bm_pool_release(p->pool, buffer), "bm_pool_release");
+    }
+}
+
+static void* pool_worker(void* arg) {
+    PoolBench* p = (PoolBench*)arg;
+    for (;;) {
+        pthread_barrier_wait(&p->start);
+        if (p->stop) return NULL;
+        pool_loop(p, p->iters);
+        pthread_barrier_wait(&p->done);
+    }
+}
+
+static void bench_pool(void* ctx, uint64_t iters) {
+    PoolBench* p = (PoolBench*)ctx;
+    p->iters = iters;
+    pthread_barrier_wait(&p->start);
+    pool_loop(p, iters);
+    pthread_barrier_wait(&p->done);
+}
+
+static void run_pool(BMDevice* dev, int threads) {
+    char name[BENCH_NAME_MAX];
+    snprintf(name, sizeof(name), "pool/acquire_release/threads:%d", threads);
+    if (opt.filter && !strstr(name, opt.filter)) return;
+
+    PoolBench p;
+    memset(&p, 0, sizeof(p));
+    // По буферу на поток: меряем синхронизацию пула, а не ожидание
+    p.pool = bm_pool_create(dev, 4096, (size_t)threads);
+    if (!p.pool) check(BM_ERROR_NOMEM, "bm_pool_create");
+    pthread_barrier_init(&p.start, NULL, (unsigned)threads);
+    pthread_barrier_init(&p.done, NULL, (unsigned)threads);
+    pthread_t tids[threads > 1 ? threads - 1 : 1];
+    for (int i = 0; i < threads - 1; i++) pthread_create(&tids[i], NULL, pool_worker, &p);
+
+    bench_run(name, threads, 0, bench_pool, &p);
+
+    p.stop = 1;
+    pthread_barrier_wait(&p.start);
+    for (int i = 0; i < threads - 1; i++) pthread_join(tids[i], NULL);
+    pthread_barrier_destroy(&p.start);
+    pthread_barrier_destroy(&p.done);
+    bm_pool_destroy(p.pool);
+}
+
+// Логирование: stderr уходит в /dev/null. С BM_LOG_OVERFLOW_BLOCK после
+// прогрева кольцо заполнено, и замер упирается в фоновый поток записи
+static void bench_log_info(void* ctx, uint64_t iters) {
+    (void)ctx;
+    for (uint64_t i = 0; i < iters; i++) bm_log_info("bench message %llu size=%zu", (unsigned long long)i, (size_t)4096);
+}
+
+static void bench_log_filtered(void* ctx, uint64_t iters) {
+    (void)ctx;
+    for (uint64_t i = 0; i < iters; i++) bm_log_debug("bench message %llu size=%zu", (unsigned long long)i, (size_t)4096);
+}
+
+static void run_logging(void) {
+    if (opt.filter && !strstr("log/info", opt.filter) && !strstr("log/debug_filtered", opt.filter)) return;
+    fflush(stderr);
+    int saved = dup(STDERR_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (saved < 0 || null_fd < 0) {
+        fprintf(stderr, "bm_bench: не удалось перенаправить stderr, логирование пропущено\n");
+        if (saved >= 0) close(saved);
+        if (null_fd >= 0) close(null_fd);
+        return;
+    }
+    dup2(null_fd, STDERR_FILENO);
+    close(null_fd);
+
+    bm_log_set_level(BM_LOG_INFO);
+    bm_log_set_overflow(BM_LOG_OVERFLOW_BLOCK);
+    bench_run("log/info", 1, 0, bench_log_info, NULL);
+    bench_run("log/debug_filtered", 1, 0, bench_log_filtered, NULL);
+    bm_log_set_overflow(BM_LOG_OVERFLOW_DROP);
+    bm_log_set_level(BM_LOG_ERROR);
+
+    bm_log_flush();
+    fflush(stderr);
+    dup2(saved, STDERR_FILENO);
+    close(saved);
+}
+
+static void run_all(void) {
+    // Остальные бенчмарки не должны мерить логирование запусков и выделений
+    bm_log_set_level(BM_LOG_ERROR);
+
+    printf("%-40s %12s %12s  %7s\n", "benchmark", "p50", "p99", "cv");
+    bench_run("device/create_destroy", 1, 0, bench_device, NULL);
+
+    BMDevice* dev = NULL;
+    check(bm_create_device(BM_CPU, &dev), "bm_create_device");
+
+    char name[BENCH_NAME_MAX], size_name[24];
+    static const size_t alloc_sizes[] = {256, 64u << 10, 4u << 20};
+    for (size_t i = 0; i < sizeof(alloc_sizes) / sizeof(alloc_sizes[0]); i++) {
+        BufferBench b = {dev, NULL, NULL, NULL, alloc_sizes[i]};
+        format_size(b.size, size_name, sizeof(size_name));
+        snprintf(name, sizeof(name), "buffer/alloc_free/%s", size_name);
+        bench_run(name, 1, 0, bench_alloc, &b);
+    }
+
+    int max_threads = opt.max_threads;
+    if (max_threads <= 0) {
+        // Сколько CPU реально доступно: маска affinity и квота cgroup
+        BMDeviceInfo info;
+        check(bm_query_device(dev, &info), "bm_query_device");
+        max_threads = info.compute_units < 1 ? 1 : info.compute_units > 8 ? 8 : info.compute_units;
+    }
+    for (int t = 1; t <= max_threads; t = t * 2 > max_threads && t != max_threads ? max_threads : t * 2)
+        run_pool(dev, t);
+
+    static const size_t transfer_sizes[] = {4u << 10, 64u << 10, 1u << 20, 16u << 20, 64u << 20};
+    for (size_t i = 0; i < sizeof(transfer_sizes) / sizeof(transfer_sizes[0]); i++) {
+        size_t size = transfer_sizes[i];
+        if (size > opt.max_size) break;
+        BufferBench b = {dev, NULL, NULL, malloc(size), size};
+        if (!b.host) check(BM_ERROR_NOMEM, "malloc");
+        memset(b.host, 0x5a, size);
+        check(bm_alloc_buffer(dev, size, &b.buffer), "bm_alloc_buffer");
+        format_size(size, size_name, sizeof(size_name));
+        snprintf(name, sizeof(name), "transfer/upload/%s", size_name);
+        bench_run(name, 1, (double)size, bench_upload, &b);
+        snprintf(name, sizeof(name), "transfer/download/%s", size_name);
+        bench_run(name, 1, (double)size, bench_download, &b);
+        bm_free_buffer(b.buffer);
+        free(b.host);
+    }
+
+    BufferBench launch = {dev, NULL, NULL, NULL, 64};
+    check(bm_alloc_buffer(dev, launch.size, &launch.buffer), "bm_alloc_buffer");
+    launch.kernel = bm_register_kernel(dev, "bench_empty", empty_kernel);
+    if (!launch.kernel) check(BM_ERROR_INVALID_ARG, "bm_register_kernel");
+    bench_run("kernel/launch_empty", 1, 0, bench_launch, &launch);
+    bm_unregister_kernel(launch.kernel);
+    bm_free_buffer(launch.buffer);
+
+    bm_destroy_device(dev);
+    run_logging();
+}
+
+// ----------------------------------------
+// JSON
+// ----------------------------------------
+static int write_json(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "bm_bench: не удалось открыть %s\n", path);
+        return 0;
+    }
+    fprintf(f, "{\n  \"version\": 1,\n  \"reps\": %d,\n  \"warmup\": %d,\n  \"min_time_ms\": %llu,\n"
+               "  \"timestamp\": %lld,\n  \"benchmarks\": [\n",
+            opt.reps, opt.warmup, (unsigned long long)(opt.min_sample_ns / 1000000), (long long)time(NULL));
+    for (size_t i = 0; i < result_count; i++) {
+        const BenchResult* r = &results[i];
+        fprintf(f, "    {\"name\": \"%s\", \"threads\": %d, \"iterations\": %llu, \"samples\": %d, "
+                   "\"min_ns\": %.3f, \"p50_ns\": %.3f, \"p90_ns\": %.3f, \"p99_ns\": %.3f, "
+                   "\"mean_ns\": %.3f, \"stddev_ns\": %.3f, \"ops_per_sec\": %.1f, \"bytes_per_sec\": %.1f}%s\n",
+                r->name, r->threads, (unsigned long long)r->iters, r->samples, r->min_ns, r->p50_ns, r->p90_ns,
+                r->p99_ns, r->mean_ns, r->stddev_ns, r->threads * 1e9 / r->p50_ns,
+                r->bytes_per_op > 0 ? r->bytes_per_op * 1e9 / r->p50_ns : 0.0, i + 1 < result_count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    int ok = ferror(f) == 0;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) fprintf(stderr, "bm_bench: ошибка записи %s\n", path);
+    return ok;
+}
+
+static double json_number(const char* obj, const char* end, const char* key) {
+    char pattern[32];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char* p = strstr(obj, pattern);
+    if (!p || (end && p > end)) return -1;
+    return strtod(p + strlen(pattern), NULL);
+}
+
+// Читает только то, что пишет write_json: имя и p50/p90 каждого бенчмарка
+static size_t read_json(const char* path, BenchResult* out, size_t capacity) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "bm_bench: не удалось открыть %s\n", path);
+        exit(2);
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* text = (char*)malloc((size_t)size + 1);
+    if (!text || fread(text, 1, (size_t)size, f) != (size_t)size) {
+        fprintf(stderr, "bm_bench: не удалось прочитать %s\n", path);
+        exit(2);
+    }
+    text[size] = '\0';
+    fclose(f);
+
+    size_t count = 0;
+    for (const char* p = strstr(text, "\"name\": \""); p && count < capacity; ) {
+        p += strlen("\"name\": \"");
+        const char* quote = strchr(p, '"');
+        if (!quote) break;
+        const char* next = strstr(quote, "\"name\": \"");
+        BenchResult* r = &out[count];
+        memset(r, 0, sizeof(*r));
+        snprintf(r->name, sizeof(r->name), "%.*s", (int)(quote - p), p);
+        r->p50_ns = json_number(quote, next, "p50_ns");
+        r->p90_ns = json_number(quote, next, "p90_ns");
+        if (r->p50_ns > 0) count++;
+        p = next;
+    }
+    free(text);
+    if (count == 0) {
+        fprintf(stderr, "bm_bench: в %s нет результатов\n", path);
+        exit(2);
+    }
+    return count;
+}
+
+// ----------------------------------------
+// Сравнение с базой
+// ----------------------------------------
+static int compare(const BenchResult* base, size_t base_count, const BenchResult* cur, size_t cur_count) {
+    int regressions = 0;
+    printf("\n%-40s %12s %12s %9s\n", "benchmark", "baseline", "current", "change");
+    for (size_t i = 0; i < cur_count; i++) {
+        const BenchResult* b = NULL;
+        for (size_t j = 0; j < base_count && !b; j++)
+            if (strcmp(base[j].name, cur[i].name) == 0) b = &base[j];
+        char was[32], now[32];
+        format_ns(cur[i].p50_ns, now, sizeof(now));
+        if (!b) {
+            printf("%-40s %12s %12s %9s\n", cur[i].name, "-", now, "new");
+            continue;
+        }
+        format_ns(b->p50_ns, was, sizeof(was));
+        double change = cur[i].p50_ns / b->p50_ns - 1.0;
+        const char* verdict = "";
+        if (change > opt.threshold) {
+            verdict = "  REGRESSION";
+            regressions++;
+        } else if (change < -opt.threshold) {
+            verdict = "  faster";
+        }
+        printf("%-40s %12s %12s %+8.1f%%%s\n", cur[i].name, was, now, change * 100.0, verdict);
+    }
+    for (size_t j = 0; j < base_count; j++) {
+        int found = 0;
+        for (size_t i = 0; i < cur_count && !found; i++) found = strcmp(base[j].name, cur[i].name) == 0;
+        if (!found && (!opt.filter || strstr(base[j].name, opt.filter)))
+            printf("%-40s %12s %12s %9s\n", base[j].name, "", "-", "missing");
+    }
+    printf("\n%d regression(s) over %.0f%% threshold\n", regressions, opt.threshold * 100.0);
+    return regressions;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--filter S] [--reps N] [--warmup N] [--min-time-ms N] [--threads N]\n"
+            "          [--max-size BYTES] [--json FILE] [--baseline FILE] [--threshold PCT]\n"
+            "       %s --compare BASE.json NEW.json [--threshold PCT]\n",
+            argv0, argv0);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    const char* compare_paths[2] = {NULL, NULL};
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        int has_value = i + 1 < argc;
+        if (strcmp(arg, "--compare") == 0 && i + 2 < argc) {
+            compare_paths[0] = argv[++i];
+            compare_paths[1] = argv[++i];
+        } else if (!has_value) {
+            usage(argv[0]);
+        } else if (strcmp(arg, "--filter") == 0) {
+            opt.filter = argv[++i];
+        } else if (strcmp(arg, "--reps") == 0) {
+            opt.reps = atoi(argv[++i]);
+        } else if (strcmp(arg, "--warmup") == 0) {
+            opt.warmup = atoi(argv[++i]);
+        } else if (strcmp(arg, "--min-time-ms") == 0) {
+            opt.min_sample_ns = strtoull(argv[++i], NULL, 10) * 1000000ull;
+        } else if (strcmp(arg, "--threads") == 0) {
+            opt.max_threads = atoi(argv[++i]);
+        } else if (strcmp(arg, "--max-size") == 0) {
+            opt.max_size = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--json") == 0) {
+            opt.json_path = argv[++i];
+        } else if (strcmp(arg, "--baseline") == 0) {
+            opt.baseline_path = argv[++i];
+        } else if (strcmp(arg, "--threshold") == 0) {
+            opt.threshold = atof(argv[++i]) / 100.0;
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (opt.reps < 1 || opt.reps > BENCH_MAX_REPS || opt.warmup < 0 || opt.threshold < 0) usage(argv[0]);
+    if (opt.min_sample_ns == 0) opt.min_sample_ns = 1;
+
+    static BenchResult base[BENCH_MAX_RESULTS];
+    if (compare_paths[0]) {
+        size_t base_count = read_json(compare_paths[0], base, BENCH_MAX_RESULTS);
+        result_count = read_json(compare_paths[1], results, BENCH_MAX_RESULTS);
+        return compare(base, base_count, results, result_count) ? 1 : 0;
+    }
+
+    run_all();
+
+    if (opt.json_path && !write_json(opt.json_path)) return 2;
+    if (opt.baseline_path) {
+        size_t base_count = read_json(opt.baseline_path, base, BENCH_MAX_RESULTS);
+        return compare(base, base_count, results, result_count) ? 1 : 0;
+    }
+    return 0;
+}
@@ -10,15 +10,15 @@ int main() {
     printf("=== Пример buffer_test ===\n");
 
     // Создаем устройство
-    BMDevice* dev = bm_create_device();
-    if (!dev) {
+    BMDevice* dev = NULL;
+    if (bm_create_device(BM_AUTO, &dev) != BM_OK) {
         fprintf(stderr, "Ошибка: не удалось создать устройство!\n");
         return 1;
     }
 
     // Создаем буфер
-    BMBuffer* buf = bm_alloc_buffer(dev, BUF_SIZE);
-    if (!buf) {
+    BMBuffer* buf = NULL;
+    if (bm_alloc_buffer(dev, BUF_SIZE, &buf) != BM_OK) {
         fprintf(stderr, "Ошибка: не удалось выделить буфер!\n");
         bm_destroy_device(dev);
         return 1;
@@ -35,7 +35,7 @@ int main() {
     }
 
     // Записываем в буфер
-    if (bm_write_buffer(buf, msg, msg_len, 0) != BM_STATUS_OK) {
+    if (bm_write_buffer(buf, msg, msg_len, 0) != BM_OK) {
         fprintf(stderr, "Ошибка записи в буфер!\n");
         bm_free_buffer(buf);
         bm_destroy_device(dev);
@@ -44,7 +44,7 @@ int main() {
 
     // Читаем из буфера
     char out[BUF_SIZE] = {0};
-    if (bm_read_buffer(buf, out, msg_len, 0) != BM_STATUS_OK) {
+    if (bm_read_buffer(buf, out, msg_len, 0) != BM_OK) {
         fprintf(stderr, "Ошибка чтения из буфера!\n");
         bm_free_buffer(buf);
         bm_destroy_device(dev);
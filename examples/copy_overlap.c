@@ -0,0 +1,103 @@
+// copy_overlap.c — пропускная способность upload→kernel→download
+// последовательно и с очередью копирования (передачи перекрываются с ядром)
+#define _POSIX_C_SOURCE 200809L
+#include "burymetal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BATCH_BYTES   (8u * 1024u * 1024u)
+#define BATCH_COUNT   32
+#define STAGING_BYTES (1u * 1024u * 1024u)
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// "Ядро": несколько проходов по данным, чтобы вычисление было сравнимо с копированием
+static void kernel(BMBuffer* buf) {
+    float* data = NULL;
+    if (bm_map_buffer(buf, 0, BATCH_BYTES, BM_MAP_READ | BM_MAP_WRITE, (void**)&data) != BM_OK) return;
+    size_t count = BATCH_BYTES / sizeof(float);
+    for (int pass = 0; pass < 4; ++pass)
+        for (size_t i = 0; i < count; ++i) data[i] = data[i] * 1.0001f + 0.5f;
+    bm_unmap_buffer(buf, data);
+}
+
+// Те же передачи через очередь, но каждая сразу дожидается: копирование
+// одно и то же, разница только в перекрытии с ядром
+static double run_serial(BMCopyQueue* queue, BMBuffer* buf, char* input, char* output) {
+    BMTransfer* t = NULL;
+    double start = now_sec();
+    for (int b = 0; b < BATCH_COUNT; ++b) {
+        bm_upload_async(queue, buf, input + (size_t)b * BATCH_BYTES, BATCH_BYTES, 0, &t);
+        bm_transfer_wait(queue, t);
+        kernel(buf);
+        bm_download_async(queue, buf, output + (size_t)b * BATCH_BYTES, BATCH_BYTES, 0, &t);
+        bm_transfer_wait(queue, t);
+    }
+    return now_sec() - start;
+}
+
+// Два буфера по очереди: пока ядро считает порцию b, поток копирования
+// скачивает b-1 и загружает b+1
+static double run_overlap(BMCopyQueue* queue, BMBuffer* bufs[2], char* input, char* output) {
+    BMTransfer* upload[2] = {NULL, NULL};
+    BMTransfer* download[2] = {NULL, NULL};
+
+    double start = now_sec();
+    bm_upload_async(queue, bufs[0], input, BATCH_BYTES, 0, &upload[0]);
+    for (int b = 0; b < BATCH_COUNT; ++b) {
+        int cur = b & 1, next = cur ^ 1;
+        if (b + 1 < BATCH_COUNT) {
+            if (download[next]) { bm_transfer_wait(queue, download[next]); download[next] = NULL; }
+            bm_upload_async(queue, bufs[next], input + (size_t)(b + 1) * BATCH_BYTES, BATCH_BYTES, 0, &upload[next]);
+        }
+        bm_transfer_wait(queue, upload[cur]);
+        kernel(bufs[cur]);
+        bm_download_async(queue, bufs[cur], output + (size_t)b * BATCH_BYTES, BATCH_BYTES, 0, &download[cur]);
+    }
+    for (int i = 0; i < 2; ++i)
+        if (download[i]) bm_transfer_wait(queue, download[i]);
+    return now_sec() - start;
+}
+
+int main(void) {
+    BMDevice* dev = NULL;
+    if (bm_create_device(BM_CPU, &dev) != BM_OK) {
+        fprintf(stderr, "Ошибка создания устройства: %s\n", bm_get_last_error());
+        return 1;
+    }
+
+    size_t total = (size_t)BATCH_BYTES * BATCH_COUNT;
+    char* input = (char*)malloc(total);
+    char* output = (char*)malloc(total);
+    BMBuffer* bufs[2] = {NULL, NULL};
+    BMCopyQueue* queue = NULL;
+    if (!input || !output ||
+        bm_alloc_buffer(dev, BATCH_BYTES, &bufs[0]) != BM_OK ||
+        bm_alloc_buffer(dev, BATCH_BYTES, &bufs[1]) != BM_OK ||
+        bm_copy_queue_create(dev, STAGING_BYTES, &queue) != BM_OK) {
+        fprintf(stderr, "Ошибка инициализации: %s\n", bm_get_last_error());
+        return 1;
+    }
+    memset(input, 0, total);
+
+    double serial = run_serial(queue, bufs[0], input, output);
+    double overlap = run_overlap(queue, bufs, input, output);
+
+    double gb = (double)total / 1e9;
+    printf("serial : %.3f s, %.2f GB/s\n", serial, gb / serial);
+    printf("overlap: %.3f s, %.2f GB/s (x%.2f)\n", overlap, gb / overlap, serial / overlap);
+
+    bm_copy_queue_destroy(queue);
+    bm_free_buffer(bufs[0]);
+    bm_free_buffer(bufs[1]);
+    bm_destroy_device(dev);
+    free(input);
+    free(output);
+    return 0;
+}
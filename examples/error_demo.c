@@ -13,9 +13,7 @@ int main() {
     bm_log_warn("Это предупреждение");
 
     // Симулируем ошибку
-    if (bm_set_last_error("Не удалось выделить память (%d байт)", 1024) != BM_STATUS_OK) {
-        bm_log_error("Ошибка установки последней ошибки");
-    }
+    bm_set_last_error("Не удалось выделить память (%d байт)", 1024);
 
     // Получение последней ошибки
     const char* last_err = bm_get_last_error();
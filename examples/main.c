@@ -18,8 +18,8 @@ int main() {
     bm_log_info("=== Burymetal Unified Example ===");
 
     // --- Создание устройства (CPU для примера) ---
-    BMDevice* dev = bm_create_device(BM_CPU);
-    if (!dev) {
+    BMDevice* dev = NULL;
+    if (bm_create_device(BM_CPU, &dev) != BM_OK) {
         bm_log_error("Ошибка создания устройства: %s", bm_get_last_error());
         return 1;
     }
@@ -27,15 +27,15 @@ int main() {
     // --- Создание буфера ---
     float input[N] = {1, 2, 3, 4};
     float output[N] = {0};
-    BMBuffer* buf = bm_alloc_buffer(dev, sizeof(input));
-    if (!buf) {
+    BMBuffer* buf = NULL;
+    if (bm_alloc_buffer(dev, sizeof(input), &buf) != BM_OK) {
         bm_log_error("Ошибка выделения буфера: %s", bm_get_last_error());
         bm_destroy_device(dev);
         return 1;
     }
 
     // --- Загрузка данных в буфер ---
-    if (bm_upload_data(buf, input) != BM_SUCCESS) {
+    if (bm_upload_data(buf, input, sizeof(input)) != BM_SUCCESS) {
         bm_log_error("Ошибка загрузки данных: %s", bm_get_last_error());
         bm_free_buffer(buf);
         bm_destroy_device(dev);
@@ -60,7 +60,7 @@ int main() {
     }
 
     // --- Скачивание данных обратно ---
-    if (bm_download_data(buf, output) != BM_SUCCESS) {
+    if (bm_download_data(buf, output, sizeof(output)) != BM_SUCCESS) {
         bm_log_error("Ошибка скачивания данных: %s", bm_get_last_error());
         bm_destroy_kernel(kernel);
         bm_free_buffer(buf);
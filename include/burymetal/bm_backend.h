@@ -7,23 +7,46 @@
 extern "C" {
 #endif
 
+// --- Результат операций backend'а (подробности — в bm_get_last_error()) ---
+typedef enum {
+    BM_STATUS_OK = 0,
+    BM_STATUS_ERROR
+} BMStatus;
+
 // --- Backend-интерфейс ---
 // Эти функции реализуют CPU / NVIDIA / AMD / Intel backends.
 // Они не должны быть видны приложению (только внутренним *.c файлам).
 
 BMDevice* bm_backend_create_device(BMComputeTarget type);
 void bm_backend_destroy_device(BMDevice* device);
-void bm_backend_query_device(BMDevice* device, BMDeviceInfo* info);
+BMStatus bm_backend_query_device(BMDevice* device, BMDeviceInfo* info);
 
 BMBuffer* bm_backend_alloc_buffer(BMDevice* device, size_t size);
+BMBuffer* bm_backend_wrap_host(BMDevice* device, void* ptr, size_t size, unsigned flags);
 void bm_backend_free_buffer(BMBuffer* buffer);
-BMStatus bm_backend_upload(BMBuffer* buffer, const void* data);
-BMStatus bm_backend_download(BMBuffer* buffer, void* data);
+BMStatus bm_backend_upload_data(BMBuffer* buffer, const void* data);
+BMStatus bm_backend_download_data(BMBuffer* buffer, void* data);
+// Передача диапазона [offset, offset + size) буфера
+BMStatus bm_backend_upload_range(BMBuffer* buffer, const void* data, size_t offset, size_t size);
+BMStatus bm_backend_download_range(BMBuffer* buffer, void* data, size_t offset, size_t size);
+// Scatter/gather: много фрагментов за одну передачу
+BMStatus bm_backend_upload_regions(BMBuffer* buffer, const BMTransferRegion* regions, size_t count);
+BMStatus bm_backend_download_regions(BMBuffer* buffer, const BMTransferRegion* regions, size_t count);
+void* bm_backend_host_ptr(BMBuffer* buffer); // NULL — память не видна с host
+// Закрепление host-памяти для DMA (staging очереди копирования)
+BMStatus bm_backend_pin_host(BMDevice* device, void* ptr, size_t size);
+void bm_backend_unpin_host(BMDevice* device, void* ptr, size_t size);
 
 BMKernel* bm_backend_load_kernel(BMDevice* device, const char* kernel_path);
-BMStatus bm_backend_launch_kernel(BMKernel* kernel, BMBuffer* buffer, size_t count);
+BMStatus bm_backend_run_kernel(BMKernel* kernel, BMBuffer* buffer, size_t count);
+BMStatus bm_backend_sync(BMDevice* device);
 void bm_backend_destroy_kernel(BMKernel* kernel);
 
+// --- Эмулируемые backend'ы (cpu, amd, intel) ---
+// Память их устройств лежит в RAM: wrap_host, free_buffer, host_ptr, pin/unpin
+// и все передачи общие (bm_backend_host.c). Backend задаёт тип своих буферов.
+extern const BMComputeTarget bm_backend_host_target;
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -1,42 +1,216 @@
-#ifndef BM_UTILS_H
-#define BM_UTILS_H
+#ifndef BM_TYPES_H
+#define BM_TYPES_H
 
-#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// --- Коды ошибок ---
+// --- Размер кэш-линии (для выравнивания горячих структур) ---
+#define BM_CACHE_LINE_SIZE 64
+
+#ifdef __cplusplus
+#define BM_ALIGNAS(n) alignas(n)
+#else
+#define BM_ALIGNAS(n) _Alignas(n)
+#endif
+
+// --- Стандартные коды ошибок ---
 typedef enum {
     BM_OK = 0,
     BM_ERROR_NOMEM,
     BM_ERROR_INVALID_ARG,
+    BM_ERROR_UNSUPPORTED,
+    BM_ERROR_DEVICE_LOST,
     BM_ERROR_INTERNAL,
+    BM_ERROR_TIMEOUT,
 } BMResult;
 
-const char* bm_result_string(BMResult code);
+// Коды модуля memory/: успех или ошибка, подробности — в bm_get_last_error()
+#define BM_SUCCESS BM_OK
+#define BM_ERROR   BM_ERROR_INTERNAL
+
+#define BM_DEVICE_NAME_MAX 64
+#define BM_KERNEL_NAME_MAX 64
+
+// --- Целевое устройство ---
+typedef enum {
+    BM_AUTO = 0,
+    BM_CPU,
+    BM_NVIDIA,
+    BM_AMD,
+    BM_INTEL
+} BMComputeTarget;
+
+// --- Размещение памяти CPU-устройства по NUMA-узлам ---
+typedef enum {
+    BM_NUMA_DEFAULT = 0,    // политика ОС (first-touch вызывающего потока)
+    BM_NUMA_BIND,           // память и потоки на узле numa_node
+    BM_NUMA_INTERLEAVE      // страницы чередуются по всем узлам
+} BMNumaPolicy;
 
-// --- Логирование ---
+// --- Вид выделения для учёта (bm_alloc_track_start) ---
 typedef enum {
-    BM_LOG_ERROR = 0,
-    BM_LOG_WARN,
-    BM_LOG_INFO,
-    BM_LOG_DEBUG
-} BMLogLevel;
+    BM_ALLOC_KIND_HOST = 0,     // bm_cpu_alloc / bm_cpu_alloc_ex
+    BM_ALLOC_KIND_DEVICE,       // bm_gpu_alloc / bm_gpu_alloc_ex
+    BM_ALLOC_KIND_BUFFER,       // bm_alloc_buffer
+    BM_ALLOC_KIND_POOL          // буфер пула (при создании и росте)
+} BMAllocKind;
+
+// --- CPU-ядро: обрабатывает count элементов буфера ---
+typedef void (*BMKernelFunc)(void* data, size_t count);
+
+// --- Калибровка CPU-устройства (bm_set_calibration / bm_device_calibrate) ---
+// Измеренные пики для оценок по roofline; нули — калибровка не проводилась
+typedef struct BMCalibration {
+    double triad_gbps;      // STREAM triad всеми потоками, ГБ/с (3 массива на элемент)
+    double memcpy_gbps;     // memcpy одним потоком, ГБ/с (чтение + запись)
+    double launch_ns;       // bm_launch_kernel пустого ядра
+    double peak_gflops;     // FMA double на самом широком SIMD, всеми потоками
+    int threads;            // сколько потоков использовано (бюджет CPU)
+    int64_t measured_unix;  // когда измерено, секунды Unix
+    int from_cache;         // 1 — взято из кэша процесса или с диска
+} BMCalibration;
+
+// --- Устройство ---
+typedef struct BMDevice {
+    BMComputeTarget type;
+    int id;
+    void* handle;           // дескриптор драйвера (CUDA/ROCm/Level Zero)
+    void* backend_context;  // состояние backend'а
+    BMNumaPolicy numa_policy;
+    int numa_node;          // для BM_NUMA_BIND
+    char name[BM_DEVICE_NAME_MAX];
+    struct BMDeviceStats* stats; // метрики (bm_get_stats)
+    BMCalibration calibration;
+} BMDevice;
+
+// --- Флаги BMBuffer::flags ---
+#define BM_BUFFER_WRAPPED 0x1u  // память предоставлена вызывающим (bm_buffer_wrap_host)
+#define BM_BUFFER_ADOPTED 0x2u  // ... и передана во владение библиотеке
+#define BM_BUFFER_READONLY 0x4u // запись запрещена (файл, отображённый только на чтение)
+#define BM_BUFFER_SHARED  0x8u  // память memfd/shm, видна другим процессам
+#define BM_BUFFER_COUNTED 0x10u // обёртка над памятью библиотеки, учтена в bm_get_stats
+
+// --- Флаги bm_buffer_wrap_host ---
+#define BM_WRAP_BORROW 0x0u     // память остаётся у вызывающего и должна пережить буфер
+#define BM_WRAP_ADOPT  0x1u     // библиотека освободит память в bm_free_buffer (bm_cpu_free)
+
+// --- Флаги bm_map_buffer ---
+#define BM_MAP_READ    0x1u     // содержимое диапазона нужно прочитать
+#define BM_MAP_WRITE   0x2u     // изменения записываются обратно при bm_unmap_buffer
+#define BM_MAP_DISCARD 0x4u     // старое содержимое диапазона не нужно (без чтения)
+
+// --- Флаги bm_buffer_map_file ---
+#define BM_FILE_READ_ONLY     0x0u  // MAP_SHARED, только чтение (по умолчанию)
+#define BM_FILE_COPY_ON_WRITE 0x1u  // MAP_PRIVATE: запись видна только процессу
+#define BM_FILE_POPULATE      0x2u  // MAP_POPULATE: прочитать всё сразу при отображении
+#define BM_FILE_WILLNEED      0x4u  // madvise(MADV_WILLNEED): фоновый readahead
+#define BM_FILE_SEQUENTIAL    0x8u  // madvise(MADV_SEQUENTIAL)
+#define BM_FILE_RANDOM        0x10u // madvise(MADV_RANDOM)
+
+// --- Флаги bm_buffer_import_shared ---
+#define BM_SHARED_READ_WRITE  0x0u
+#define BM_SHARED_READ_ONLY   0x1u  // данные только для чтения (fence'ы по-прежнему доступны)
+
+// --- Флаги bm_buffer_clone ---
+#define BM_CLONE_COPY 0x0u      // независимая полная копия
+#define BM_CLONE_COW  0x1u      // общие страницы до первой записи (host-видимые backend'ы)
+
+// Минимальное выравнивание памяти для bm_buffer_wrap_host
+#define BM_HOST_WRAP_ALIGNMENT BM_CACHE_LINE_SIZE
+
+// --- Буфер ---
+// Вся структура — горячие поля, которые читаются на каждом запуске ядра;
+// выравнена по кэш-линии, чтобы заголовок буфера занимал ровно одну линию.
+typedef struct BMBuffer {
+    BM_ALIGNAS(BM_CACHE_LINE_SIZE) union {
+        void* data;         // host-указатель (CPU и эмулируемые backend'ы)
+        void* gpu_ptr;      // указатель/handle памяти устройства
+    };
+    size_t size;
+    BMComputeTarget backend;
+    uint32_t flags;
+    BMDevice* device;
+    void* backend_ptr;
+    void* mapping;          // активная staging-копия bm_map_buffer (NULL — нет)
+} BMBuffer;
+
+// --- Фрагмент scatter/gather-передачи (аналог iovec) ---
+// host — память на стороне host, offset/size — диапазон внутри буфера
+typedef struct BMTransferRegion {
+    void* host;
+    size_t offset;
+    size_t size;
+} BMTransferRegion;
+
+// --- Холодные данные ядра: имя и отладочная информация ---
+// Хранятся в отдельной таблице и не трогаются на пути запуска.
+typedef struct BMKernelCold {
+    char name[BM_KERNEL_NAME_MAX];
+} BMKernelCold;
+
+// --- Ядро ---
+// Горячая часть: всё, что нужно bm_launch_kernel, в одной кэш-линии.
+typedef struct BMKernel {
+    BM_ALIGNAS(BM_CACHE_LINE_SIZE) BMKernelFunc cpu_func;
+    union {
+        void* backend_kernel;
+        void* kernel_ptr;
+    };
+    BMComputeTarget type;   // копия device->type, чтобы не ходить в BMDevice
+    int stats_slot;         // 1 + номер ядра в метриках устройства (0 — ещё не назначен)
+    BMDevice* device;
+    BMKernelCold* cold;
+} BMKernel;
 
-// Устанавливает уровень логирования
-BMResult bm_log_set_level(BMLogLevel level);
+// --- Информация о буфере ---
+typedef struct BMBufferInfo {
+    BMComputeTarget type;
+    size_t size;
+    size_t page_size;       // размер страницы, реально использованный под буфер (0 — неизвестно)
+    int huge_pages;         // 1, если буфер отображён huge-страницами (THP или hugetlbfs)
+} BMBufferInfo;
 
-// Логирование сообщений (потокобезопасно)
-BMResult bm_log(BMLogLevel level, const char* fmt, ...);
+// --- SIMD-расширения CPU (BMDeviceInfo::simd) ---
+// x86 — по CPUID с проверкой, что ОС сохраняет регистры (XGETBV), ARM — по HWCAP
+#define BM_SIMD_SSE2     (1u << 0)
+#define BM_SIMD_SSE4_2   (1u << 1)
+#define BM_SIMD_AVX      (1u << 2)
+#define BM_SIMD_AVX2     (1u << 3)
+#define BM_SIMD_FMA      (1u << 4)
+#define BM_SIMD_AVX512F  (1u << 5)
+#define BM_SIMD_AVX512BW (1u << 6)
+#define BM_SIMD_NEON     (1u << 8)
+#define BM_SIMD_SVE      (1u << 9)
 
-// --- Потокобезопасный last_error ---
-BMResult bm_set_last_error(const char* fmt, ...);
-const char* bm_get_last_error(void); // возвращает thread-local строку
+// --- Информация об устройстве ---
+// Для CPU память и число потоков учитывают лимиты cgroup (v1 и v2) и маску affinity
+typedef struct BMDeviceInfo {
+    BMComputeTarget type;
+    char name[BM_DEVICE_NAME_MAX];
+    uint32_t memory_total;  // МБ
+    uint32_t memory_free;   // МБ
+    int compute_units;      // CPU: сколько потоков запускать (affinity и квота cgroup)
+    size_t memory_size;     // байт
+    int numa_node;          // узел устройства (-1 — не привязано к узлу)
+    int numa_node_count;    // число NUMA-узлов в системе
+    size_t memory_available; // байт: MemAvailable или остаток до лимита cgroup
+    int cpus_online;        // CPU: онлайн в системе
+    int cpus_allowed;       // CPU: доступны процессу по маске affinity
+    double cpu_quota;       // CPU: квота cgroup в CPU (0 — без лимита)
+    size_t cache_line;      // байт (0 — неизвестно)
+    size_t cache_l1d;       // байт на ядро
+    size_t cache_l2;
+    size_t cache_l3;
+    unsigned simd;          // BM_SIMD_*
+    BMCalibration calibration; // CPU: измеренные пики (нули — не калибровалось)
+} BMDeviceInfo;
 
 #ifdef __cplusplus
 } // extern "C"
 #endif
 
-#endif // BM_UTILS_H
+#endif // BM_TYPES_H
@@ -1,24 +1,96 @@
-bm_utils.h
 #ifndef BM_UTILS_H
 #define BM_UTILS_H
 
+#include <stdint.h>
+#include "bm_types.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// --- Флаги включения ---
+// Relaxed-чтение int-флага из inline-функций этого заголовка: его включают и
+// программы, собранные MSVC, где нет __atomic. __iso_volatile_load32 — то же
+// обычное чтение без барьеров, что и в <atomic> MSVC для memory_order_relaxed.
+#ifdef _MSC_VER
+#define BM_ATOMIC_LOAD_RELAXED(ptr) ((int)__iso_volatile_load32((const volatile __int32*)(ptr)))
+#else
+#define BM_ATOMIC_LOAD_RELAXED(ptr) __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#endif
+
 // --- Логирование ---
 #define BM_LOG_LEVEL_ERROR 0
 #define BM_LOG_LEVEL_WARN  1
 #define BM_LOG_LEVEL_INFO  2
 #define BM_LOG_LEVEL_DEBUG 3
 
+typedef enum {
+    BM_LOG_ERROR = BM_LOG_LEVEL_ERROR,
+    BM_LOG_WARN  = BM_LOG_LEVEL_WARN,
+    BM_LOG_INFO  = BM_LOG_LEVEL_INFO,
+    BM_LOG_DEBUG = BM_LOG_LEVEL_DEBUG
+} BMLogLevel;
+
+// Сообщения форматируются в потоке-источнике и кладутся в его кольцевой
+// буфер без блокировок; на stderr и в файл их пачками пишет фоновый поток.
+// Что делать, если кольцо потока заполнено:
+typedef enum {
+    BM_LOG_OVERFLOW_DROP = 0,   // отбросить сообщение и учесть в dropped (по умолчанию)
+    BM_LOG_OVERFLOW_BLOCK       // ждать, пока фоновый поток освободит место
+} BMLogOverflow;
+
+typedef struct BMLogStats {
+    uint64_t written;           // строк записано фоновым потоком
+    uint64_t dropped;           // сообщений отброшено при переполнении
+} BMLogStats;
+
+// Уровень, выше которого вызовы вырезаются при компиляции вместе с вычислением
+// аргументов: -DBM_LOG_COMPILE_LEVEL=BM_LOG_LEVEL_WARN убирает info и debug.
+#ifndef BM_LOG_COMPILE_LEVEL
+#define BM_LOG_COMPILE_LEVEL BM_LOG_LEVEL_DEBUG
+#endif
+
+extern int bm_log_current_level; // менять только через bm_log_set_level
+
+// Дешёвая проверка до форматирования: константный level сворачивается при компиляции
+static inline int bm_log_enabled(int level) {
+    return level <= BM_LOG_COMPILE_LEVEL &&
+           level <= BM_ATOMIC_LOAD_RELAXED(&bm_log_current_level);
+}
+
+void bm_log(BMLogLevel level, const char* fmt, ...);
 void bm_log_set_level(int level);
+// Потолок уровня только для текущего потока поверх общего (-1 — снять);
+// возвращает прежний. Сообщения выше потолка отбрасываются до форматирования.
+int bm_log_set_thread_level(int level);
+void bm_log_set_file(const char* path);     // NULL — только stderr
+void bm_log_set_overflow(BMLogOverflow policy);
+// Сообщений в кольце потока (до степени двойки, 0 — 1024); действует на кольца,
+// которые потоки получат после вызова
+void bm_log_set_ring_slots(size_t slots);
+void bm_log_flush(void);                    // дождаться записи всего, что уже залогировано
+void bm_log_get_stats(BMLogStats* stats);
 void bm_log_error(const char* fmt, ...);
 void bm_log_warn(const char* fmt, ...);
 void bm_log_info(const char* fmt, ...);
 void bm_log_debug(const char* fmt, ...);
 
+// Вызовы через макросы: отфильтрованное сообщение не стоит ни вызова функции,
+// ни вычисления аргументов. Сами функции доступны как (bm_log)(...).
+#define BM_LOG_CALL_(level, fn, ...) \
+    ((void)(bm_log_enabled(level) ? ((fn)(__VA_ARGS__), 0) : 0))
+#define bm_log(level, ...)  BM_LOG_CALL_((level), bm_log, (level), __VA_ARGS__)
+#define bm_log_error(...)   BM_LOG_CALL_(BM_LOG_LEVEL_ERROR, bm_log_error, __VA_ARGS__)
+#define bm_log_warn(...)    BM_LOG_CALL_(BM_LOG_LEVEL_WARN, bm_log_warn, __VA_ARGS__)
+#define bm_log_info(...)    BM_LOG_CALL_(BM_LOG_LEVEL_INFO, bm_log_info, __VA_ARGS__)
+#define bm_log_debug(...)   BM_LOG_CALL_(BM_LOG_LEVEL_DEBUG, bm_log_debug, __VA_ARGS__)
+
 // --- Ошибки ---
+// Текст форматируется сразу; в лог ошибка попадает только на уровне DEBUG
 void bm_set_last_error(const char* fmt, ...);
 const char* bm_get_last_error(void);
 
@@ -3,21 +3,13 @@
 
 #include <stddef.h>
 #include "bm_types.h"
+#include "bm_utils.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// --- Стандартные коды ошибок ---
-typedef enum {
-    BM_OK = 0,
-    BM_ERROR_NOMEM,
-    BM_ERROR_INVALID_ARG,
-    BM_ERROR_UNSUPPORTED,
-    BM_ERROR_DEVICE_LOST,
-    BM_ERROR_INTERNAL,
-} BMResult;
-
+// --- Стандартные коды ошибок (BMResult — в bm_types.h) ---
 const char* bm_result_string(BMResult code);
 
 // --- Устройство ---
@@ -25,16 +17,318 @@ BMResult bm_create_device(BMComputeTarget type, BMDevice** out_device);
 BMResult bm_destroy_device(BMDevice* device); // безопасно для NULL
 BMResult bm_query_device(BMDevice* device, BMDeviceInfo* info);
 
+// --- NUMA (CPU-устройство) ---
+// BM_NUMA_BIND: устройство на узле node; BM_NUMA_INTERLEAVE: node игнорируется
+BMResult bm_create_device_numa(BMNumaPolicy policy, int node, BMDevice** out_device);
+BMResult bm_device_bind_thread(BMDevice* device); // закрепить текущий поток на CPU устройства
+
+// --- Калибровка (roofline) ---
+// При включённой калибровке bm_create_device(BM_CPU) измеряет пропускную
+// способность памяти (STREAM triad, memcpy), цену запуска ядра и пик FLOP/s
+// и кладёт их в BMDeviceInfo::calibration. Результат кэшируется в процессе и
+// на диске в cache_dir (файл на хост, модель CPU и число потоков); замер
+// занимает доли секунды. Неудачная калибровка не мешает созданию устройства.
+typedef enum {
+    BM_CALIBRATION_OFF = 0,     // по умолчанию
+    BM_CALIBRATION_CACHED,      // взять из кэша, замерить, если его нет
+    BM_CALIBRATION_FORCE        // замерить заново и обновить кэш
+} BMCalibrationMode;
+
+// cache_dir == NULL — $XDG_CACHE_HOME/burymetal, иначе ~/.cache/burymetal
+BMResult bm_set_calibration(BMCalibrationMode mode, const char* cache_dir);
+BMResult bm_device_calibrate(BMDevice* device, BMCalibrationMode mode); // только CPU
+
 // --- Буферы ---
 BMResult bm_alloc_buffer(BMDevice* device, size_t size, BMBuffer** out_buffer);
 BMResult bm_free_buffer(BMBuffer* buffer); // безопасно для NULL
+// Zero-copy обёртка над host-памятью (ptr выровнен по BM_HOST_WRAP_ALIGNMENT;
+// flags: BM_WRAP_BORROW — память должна пережить буфер, BM_WRAP_ADOPT — её освободит библиотека)
+BMResult bm_buffer_wrap_host(BMDevice* device, void* ptr, size_t size, unsigned flags, BMBuffer** out_buffer);
+// CPU-буфер прямо поверх mmap файла (length 0 — до конца файла; flags: BM_FILE_*).
+// Без BM_FILE_COPY_ON_WRITE буфер только для чтения (запись и запуск ядра отклоняются),
+// страницы page cache общие между процессами. Отказ open/fstat/mmap — BM_ERROR_INTERNAL
+// (BM_ERROR_NOMEM при нехватке памяти) с текстом errno в bm_get_last_error().
+BMResult bm_buffer_map_file(BMDevice* device, const char* path, uint64_t offset, size_t length,
+                            unsigned flags, BMBuffer** out_buffer);
+// Новый буфер того же устройства с тем же содержимым. BM_CLONE_COW на host-видимых
+// backend'ах делит с исходным страницы до первой записи любой из сторон
+// (memfd + MAP_PRIVATE); в исходный буфер нельзя писать во время клонирования.
+BMResult bm_buffer_clone(BMBuffer* buffer, unsigned flags, BMBuffer** out_clone);
 BMResult bm_upload_data(BMBuffer* buffer, const void* data, size_t length);
 BMResult bm_download_data(BMBuffer* buffer, void* data, size_t length);
+BMResult bm_query_buffer(BMBuffer* buffer, BMBufferInfo* info);
+
+// --- Частичные и scatter/gather-передачи ---
+// Копируется только диапазон [offset, offset + size); data указывает на начало данных
+BMResult bm_write_buffer(BMBuffer* buffer, const void* data, size_t size, size_t offset);
+BMResult bm_read_buffer(BMBuffer* buffer, void* data, size_t size, size_t offset);
+// Много фрагментов одного буфера за одну передачу backend'а
+BMResult bm_write_buffer_regions(BMBuffer* buffer, const BMTransferRegion* regions, size_t count);
+BMResult bm_read_buffer_regions(BMBuffer* buffer, const BMTransferRegion* regions, size_t count);
+BMResult bm_write_buffers(BMBuffer** buffers, size_t num_buffers, const void** data, const size_t* sizes, const size_t* offsets);
+BMResult bm_read_buffers(BMBuffer** buffers, size_t num_buffers, void** data, const size_t* sizes, const size_t* offsets);
+
+// --- Прямой доступ к буферу ---
+// Host-видимые backend'ы (CPU, эмулируемые AMD/Intel) возвращают указатель прямо
+// в буфер; остальные — staging-копию, которая записывается обратно в bm_unmap_buffer.
+BMResult bm_map_buffer(BMBuffer* buffer, size_t offset, size_t length, unsigned flags, void** out_ptr);
+BMResult bm_unmap_buffer(BMBuffer* buffer, void* mapped_ptr);
+void* bm_get_host_ptr(BMBuffer* buffer); // NULL, если память не видна с host
+
+// --- Асинхронная очередь копирования ---
+// Отдельный поток на устройство; передачи идут через pinned staging-буфер
+// порциями по staging_size и перекрываются с ядрами вызывающего потока.
+// Буфер, память которого видна с host, копируется напрямую без staging.
+// Host-память передачи должна оставаться живой до её завершения.
+// Upload в буфер только для чтения отклоняется сразу (BM_ERROR_INVALID_ARG).
+typedef struct BMCopyQueue BMCopyQueue;
+typedef struct BMTransfer BMTransfer;
+
+#define BM_COPY_QUEUE_STAGED 0x1u   // всегда через staging, даже если память видна с host
+
+BMResult bm_copy_queue_create(BMDevice* device, size_t staging_size, BMCopyQueue** out_queue);
+BMResult bm_copy_queue_create_ex(BMDevice* device, size_t staging_size, unsigned flags, BMCopyQueue** out_queue);
+BMResult bm_copy_queue_destroy(BMCopyQueue* queue); // дожидается поставленных передач
+// out_transfer == NULL — передача без билета, дождаться можно через bm_copy_queue_flush
+BMResult bm_upload_async(BMCopyQueue* queue, BMBuffer* buffer, const void* data, size_t size, size_t offset, BMTransfer** out_transfer);
+BMResult bm_download_async(BMCopyQueue* queue, BMBuffer* buffer, void* data, size_t size, size_t offset, BMTransfer** out_transfer);
+BMResult bm_transfer_wait(BMCopyQueue* queue, BMTransfer* transfer); // освобождает билет
+BMResult bm_copy_queue_flush(BMCopyQueue* queue);
+
+// --- Асинхронная загрузка файлов в буферы ---
+// Много чтений в полёте через io_uring (без него — pread в фоновом потоке);
+// direct_io — O_DIRECT в обход page cache (если FS его поддерживает).
+typedef struct BMLoader BMLoader;
+typedef struct BMLoadEvent BMLoadEvent;
+
+typedef struct BMLoaderConfig {
+    unsigned queue_depth;       // чтений в полёте (0 — 64)
+    size_t block_size;          // размер одного чтения (0 — 1 МиБ)
+    int direct_io;
+} BMLoaderConfig;
+
+typedef struct BMLoadRequest {
+    BMBuffer* buffer;
+    size_t buffer_offset;
+    const char* path;           // нужен только на время bm_loader_submit
+    uint64_t file_offset;
+    size_t length;
+} BMLoadRequest;
+
+BMResult bm_loader_create(BMDevice* device, const BMLoaderConfig* config, BMLoader** out_loader); // config может быть NULL
+BMResult bm_loader_destroy(BMLoader* loader); // дожидается поставленных загрузок и освобождает их события
+BMResult bm_loader_submit(BMLoader* loader, const BMLoadRequest* requests, size_t count, BMLoadEvent** out_event);
+int bm_load_event_done(BMLoader* loader, BMLoadEvent* event); // 1 — загрузка завершена
+BMResult bm_load_event_wait(BMLoader* loader, BMLoadEvent* event); // освобождает событие
+
+// --- Разделяемые между процессами буферы (CPU-устройство) ---
+// Память memfd (name == NULL) или shm_open ("/имя") отображается MAP_SHARED:
+// процессы работают с одними страницами без копий. Перед данными лежит
+// служебная страница с BM_SHARED_FENCES счётчиками-fence'ами на futex.
+// Именованный объект удаляется, когда создатель освобождает буфер;
+// уже импортированные буферы продолжают работать.
+#define BM_SHARED_FENCES 8
+
+BMResult bm_buffer_create_shared(BMDevice* device, const char* name, size_t size, BMBuffer** out_buffer);
+// Дескриптор для передачи другому процессу (SCM_RIGHTS, fork); действителен, пока жив буфер
+BMResult bm_buffer_export_fd(BMBuffer* buffer, int* out_fd);
+// По имени, а если name == NULL — по fd (дескриптор дублируется и остаётся у вызывающего)
+BMResult bm_buffer_import_shared(BMDevice* device, const char* name, int fd, unsigned flags, BMBuffer** out_buffer);
+// Fence — монотонный счётчик: signal публикует value, wait ждёт, пока счётчик
+// не дойдёт до value (timeout_ms < 0 — без ограничения, иначе BM_ERROR_TIMEOUT)
+BMResult bm_shared_fence_signal(BMBuffer* buffer, unsigned fence, uint32_t value);
+BMResult bm_shared_fence_wait(BMBuffer* buffer, unsigned fence, uint32_t value, int timeout_ms);
+
+// --- Снапшоты наборов буферов ---
+// Файл: заголовок, индекс имён и payload'ы, выровненные по странице.
+// На CPU-устройстве bm_snapshot_open отображает файл и оборачивает payload'ы
+// без копирования (flags: BM_FILE_*, как у bm_buffer_map_file); на остальных
+// выделяет буферы и загружает их параллельно через BMLoader.
+#define BM_SNAPSHOT_NAME_MAX 48 // с завершающим нулём
+
+typedef struct BMSnapshot BMSnapshot;
+
+typedef struct BMSnapshotEntry {
+    const char* name;
+    BMBuffer* buffer;
+} BMSnapshotEntry;
+
+BMResult bm_snapshot_save(const char* path, const BMSnapshotEntry* entries, size_t count);
+BMResult bm_snapshot_open(BMDevice* device, const char* path, unsigned flags, BMSnapshot** out_snapshot);
+BMResult bm_snapshot_close(BMSnapshot* snapshot); // освобождает буферы снапшота
+size_t bm_snapshot_count(const BMSnapshot* snapshot);
+BMResult bm_snapshot_entry(const BMSnapshot* snapshot, size_t index, BMSnapshotEntry* out_entry);
+BMBuffer* bm_snapshot_find(const BMSnapshot* snapshot, const char* name); // NULL — нет такого имени
 
 // --- Ядра (Kernel) ---
 BMResult bm_load_kernel(BMDevice* device, const char* kernel_path, BMKernel** out_kernel);
 BMResult bm_launch_kernel(BMKernel* kernel, BMBuffer* buffer, size_t count);
 BMResult bm_destroy_kernel(BMKernel* kernel); // безопасно для NULL
+BMKernel* bm_register_kernel(BMDevice* device, const char* name, BMKernelFunc func);
+void bm_unregister_kernel(BMKernel* kernel);
+
+// --- Потоковая обработка данных больше памяти ---
+// Конвейер read → upload → launch → download → sink над кольцом из depth
+// буферов устройства (BMBufferPool); стадии работают параллельно, память
+// ограничена depth * chunk_size на host и на устройстве. Каждая прочитанная
+// порция должна быть кратна element_size: порция с неполным элементом (обычно
+// хвост входа) останавливает конвейер с BM_ERROR_INVALID_ARG, а порции до неё
+// к этому моменту уже отданы sink.
+#define BM_STREAM_DEFAULT_DEPTH 3
+#define BM_STREAM_READ_ERROR ((size_t)-1)
+
+// Возвращает число прочитанных байт (0 — конец данных, BM_STREAM_READ_ERROR — ошибка)
+typedef size_t (*BMStreamReadFunc)(void* user, void* dst, size_t max_bytes);
+// Возвращает 0 при успехе
+typedef int (*BMStreamSinkFunc)(void* user, const void* data, size_t bytes);
+
+typedef struct BMStreamConfig {
+    int fd;                     // источник, если read == NULL
+    BMStreamReadFunc read;
+    void* read_user;
+    BMStreamSinkFunc sink;      // NULL — результат отбрасывается
+    void* sink_user;
+    size_t chunk_size;          // байт на порцию
+    size_t element_size;        // count ядра = байты / element_size (0 — count в байтах)
+    size_t depth;               // буферов в кольце (0 — BM_STREAM_DEFAULT_DEPTH)
+} BMStreamConfig;
+
+typedef struct BMStreamStats {
+    size_t chunks;
+    uint64_t bytes;
+    double elapsed_sec;
+    double read_busy_sec;       // чтение + upload
+    double kernel_busy_sec;
+    double sink_busy_sec;       // download + sink
+} BMStreamStats;
+
+BMResult bm_stream_run(BMDevice* device, BMKernel* kernel, const BMStreamConfig* config, BMStreamStats* out_stats);
+
+// --- Метрики ---
+// Всегда включены: счётчики устройства разнесены по шардам на кэш-линиях,
+// поток пишет в свой шард, bm_get_stats суммирует. Гистограммы логарифмические:
+// корзина i — до (1024 << i) нс, последняя — всё, что дольше.
+#define BM_STATS_BUCKETS 24
+
+typedef struct BMStats {
+    uint64_t launches;
+    uint64_t launch_ns;                     // суммарное время запусков
+    uint64_t launch_latency[BM_STATS_BUCKETS];
+    uint64_t bytes_uploaded;
+    uint64_t bytes_downloaded;
+    uint64_t allocations;                   // bm_alloc_buffer и буферы пулов
+    uint64_t frees;
+    uint64_t bytes_live;
+    uint64_t bytes_high_water;
+    uint64_t pool_hits;                     // свободный буфер нашёлся сразу
+    uint64_t pool_misses;                   // пришлось расти, ждать или отказать
+    uint64_t pool_wait_ns;
+    uint64_t pool_wait[BM_STATS_BUCKETS];
+} BMStats;
+
+BMResult bm_get_stats(BMDevice* device, BMStats* stats);
+// Метрики устройства (и запуски по ядрам) в текстовом формате Prometheus.
+// Возвращает длину всего текста; как snprintf, при нехватке capacity обрезает.
+size_t bm_stats_prometheus(BMDevice* device, char* out, size_t capacity);
+
+// --- Профилирование ядер ---
+// Пока профилирование включено, каждый bm_launch_kernel окружается группой
+// аппаратных счётчиков perf_event_open вызывающего потока (только user-space).
+// Итоги копятся по паре (имя ядра, поток). Если счётчики недоступны
+// (perf_event_paranoid, контейнер, не Linux), остаётся только время.
+#define BM_PROFILE_CYCLES         (1u << 0)
+#define BM_PROFILE_INSTRUCTIONS   (1u << 1)
+#define BM_PROFILE_LLC_MISSES     (1u << 2)
+#define BM_PROFILE_BRANCH_MISSES  (1u << 3)
+#define BM_PROFILE_STALLED_CYCLES (1u << 4)   // backend stalls
+
+typedef struct BMKernelProfile {
+    char kernel[BM_KERNEL_NAME_MAX];
+    unsigned thread;            // TID на Linux
+    unsigned counters;          // какие счётчики измерены (BM_PROFILE_*), 0 — не измерены, только время
+    uint64_t launches;
+    uint64_t counted_launches;  // запусков, в которые счётчики шли; значения — сумма только по ним
+    double wall_sec;
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t llc_misses;
+    uint64_t branch_misses;
+    uint64_t stalled_cycles;
+} BMKernelProfile;
+
+BMResult bm_profile_enable(int enable); // накопленное сохраняется при выключении
+void bm_profile_reset(void);
+// Заполняет до capacity записей (out может быть NULL), возвращает их общее число
+size_t bm_profile_query(BMKernelProfile* out, size_t capacity);
+BMResult bm_profile_dump(const char* path); // таблица; NULL — stdout
+
+// --- Трассировка ---
+// Пока трассировка включена, библиотека записывает интервалы (создание
+// устройств, выделение, передачи, запуски ядер, ожидание пула и синхронизацию)
+// в буферы потоков. bm_trace_stop пишет их в path в формате Chrome trace JSON
+// (chrome://tracing, ui.perfetto.dev) и выключает запись.
+BMResult bm_trace_start(const char* path);
+BMResult bm_trace_stop(void);
+
+// --- Запись вызовов API ---
+// Пока запись включена, каждый вызов создания/уничтожения устройств, буферов
+// (включая обёртки host-памяти, клоны, отображённые файлы и разделяемые
+// буферы), ядер и пулов, передачи (и scatter/gather), map/unmap, запуски и
+// acquire/release пула пишется в path компактными двоичными записями (поток,
+// время, длительность, размеры). Не записываются bm_buffer_export_fd, fence'ы
+// разделяемых буферов, передачи BMCopyQueue и BMLoader и буферы
+// bm_snapshot_open на CPU-устройстве. tools/bm_replay повторяет запись на
+// текущей сборке с той же конкуренцией; содержимое памяти, файлов и
+// разделяемых объектов не записывается — повтор подставляет память того же
+// размера. Запись стоит включать до создания устройств: вызовы с объектами,
+// созданными раньше или незаписанными вызовами, повтор пропускает.
+BMResult bm_record_start(const char* path);
+BMResult bm_record_stop(void);
+
+// --- Учёт выделений ---
+// Пока учёт включён, bm_alloc_buffer, bm_cpu_alloc, bm_gpu_alloc и буферы пулов
+// заносятся в таблицу живых выделений: живые байты и пик по устройствам и в
+// целом, места выделения (метка потока и стек вызова) со своим пиком.
+// bm_destroy_device предупреждает в лог о выделениях устройства, оставшихся
+// живыми; дальше они учитываются только в leaked_*. Каждое выделение берёт
+// мьютекс (и backtrace, если stack_frames > 0) — это режим диагностики.
+#define BM_ALLOC_TRACK_MAX_FRAMES 16
+
+typedef struct BMAllocUsage {
+    uint64_t allocations;       // выделений с начала учёта
+    uint64_t live_count;
+    uint64_t live_bytes;
+    uint64_t peak_bytes;        // максимум live_bytes
+    uint64_t leaked_count;      // осталось живыми при bm_destroy_device
+    uint64_t leaked_bytes;
+} BMAllocUsage;
+
+typedef struct BMAllocSite {
+    BMAllocKind kind;
+    const char* tag;            // метка потока (bm_alloc_set_tag) или NULL
+    unsigned frame_count;       // 0 — стек не собирался
+    void* frames[BM_ALLOC_TRACK_MAX_FRAMES]; // адреса возврата, от функции выделения наружу
+    uint64_t allocations;
+    uint64_t total_bytes;
+    uint64_t live_count;
+    uint64_t live_bytes;
+    uint64_t peak_bytes;        // максимум живых байт этого места
+} BMAllocSite;
+
+// Сбрасывает накопленное; stack_frames — глубина стека места (0 — только метки,
+// больше BM_ALLOC_TRACK_MAX_FRAMES — обрезается)
+BMResult bm_alloc_track_start(unsigned stack_frames);
+BMResult bm_alloc_track_stop(void);         // накопленное остаётся доступным
+// Метка места для выделений текущего потока (должна жить, пока идёт учёт:
+// строковый литерал). Возвращает прежнюю метку.
+const char* bm_alloc_set_tag(const char* tag);
+// device == NULL — по всем устройствам вместе с host-памятью
+BMResult bm_alloc_track_usage(const BMDevice* device, BMAllocUsage* usage);
+// Места по убыванию peak_bytes: заполняет до capacity записей (out может быть
+// NULL), возвращает их общее число
+size_t bm_alloc_track_sites(BMAllocSite* out, size_t capacity);
+// Итоги, устройства и top мест с символами стека; path == NULL — stdout
+BMResult bm_alloc_track_report(const char* path, size_t top);
 
 #ifdef __cplusplus
 } // extern "C"
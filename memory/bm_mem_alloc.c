@@ -1,51 +1,726 @@
+#ifndef _WIN32
+#define _GNU_SOURCE     // memfd_create
+#endif
+
 #include "bm_mem_alloc.h"
+#include "bm_internal.h"
+#include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #ifdef _WIN32
 #include <windows.h>
 #else
+#include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Размер huge-страницы, если его не удалось узнать у ядра
+#define BM_DEFAULT_HUGE_PAGE_SIZE (2u * 1024u * 1024u)
+
+// Политика больших выделений (меняется через bm_mem_set_huge_pages)
+static BMHugePageMode huge_mode = BM_HUGE_PAGES_THP;
+static size_t huge_threshold = BM_ALLOC_HUGE_THRESHOLD;
+
+// -----------------------------
+// Реестр блоков, выделенных в обход malloc
+// -----------------------------
+
+// bm_cpu_free должен отличать mmap-блоки от malloc-блоков и знать их длину.
+// Таких блоков немного (все >= BM_ALLOC_MMAP_THRESHOLD), поэтому хватает
+// линейного массива под мьютексом.
+typedef struct BMMemRegion {
+    void* ptr;
+    void* base;         // начало отображения (для файлов ptr может быть внутри первой страницы)
+    size_t length;      // длина отображения от base
+    size_t page_size;
+    BMMemKind kind;
+    int fd;             // дескриптор разделяемого объекта (BM_MEM_SHARED), иначе -1
+    char* shm_name;     // имя shm_open, которое удаляется при освобождении (создатель)
+} BMMemRegion;
+
+static BMMemRegion* regions = NULL;
+static size_t region_count = 0;
+static size_t region_capacity = 0;
+
+#ifdef _WIN32
+static SRWLOCK region_lock = SRWLOCK_INIT;
+#define region_lock_acquire() AcquireSRWLockExclusive(&region_lock)
+#define region_lock_release() ReleaseSRWLockExclusive(&region_lock)
+#else
+static pthread_mutex_t region_lock = PTHREAD_MUTEX_INITIALIZER;
+#define region_lock_acquire() pthread_mutex_lock(&region_lock)
+#define region_lock_release() pthread_mutex_unlock(&region_lock)
+#endif
+
+static int region_add(const BMMemRegion* region) {
+    region_lock_acquire();
+    if (region_count == region_capacity) {
+        size_t new_capacity = region_capacity ? region_capacity * 2 : 16;
+        BMMemRegion* grown = (BMMemRegion*)realloc(regions, sizeof(BMMemRegion) * new_capacity);
+        if (!grown) {
+            region_lock_release();
+            return 0;
+        }
+        regions = grown;
+        region_capacity = new_capacity;
+    }
+    regions[region_count++] = *region;
+    region_lock_release();
+    return 1;
+}
+
+// Удаляет блок из реестра; возвращает длину отображения (и копию записи
+// в removed) или 0, если блока нет
+static size_t region_remove(void* ptr, BMMemRegion* removed) {
+    size_t length = 0;
+    region_lock_acquire();
+    for (size_t i = 0; i < region_count; ++i) {
+        if (regions[i].ptr == ptr) {
+            length = regions[i].length;
+            *removed = regions[i];
+            regions[i] = regions[--region_count];
+            break;
+        }
+    }
+    region_lock_release();
+    return length;
+}
+
+// -----------------------------
+// Страницы
+// -----------------------------
+
+static size_t system_page_size(void) {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (size_t)si.dwPageSize;
+#else
+    long page = sysconf(_SC_PAGESIZE);
+    return page > 0 ? (size_t)page : 4096u;
+#endif
+}
+
+#ifdef __linux__
+// Читает одно число из файла sysfs; 0 — если файла нет
+static size_t read_sysfs_size(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    unsigned long long value = 0;
+    if (fscanf(f, "%llu", &value) != 1) value = 0;
+    fclose(f);
+    return (size_t)value;
+}
+
+// THP выключен, если в .../enabled выбрано [never]
+static int thp_enabled(void) {
+    FILE* f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (!f) return 0;
+    char line[128] = {0};
+    int enabled = fgets(line, sizeof(line), f) && !strstr(line, "[never]");
+    fclose(f);
+    return enabled;
+}
+#endif
+
+static size_t huge_page_size(void) {
+    static size_t cached = 0;
+    if (!cached) {
+        size_t size = 0;
+#ifdef __linux__
+        size = read_sysfs_size("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size");
+#endif
+        cached = size ? size : BM_DEFAULT_HUGE_PAGE_SIZE;
+    }
+    return cached;
+}
+
+// Свежие анонимные страницы: уже нулевые, физически выделяются при первом касании
+static void* map_zero_pages(size_t size) {
+#ifdef _WIN32
+    return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ptr == MAP_FAILED ? NULL : ptr;
+#endif
+}
+
+static void unmap_pages(void* ptr, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+    munmap(ptr, size);
+#endif
+}
+
+// Большой блок на huge-страницах: сначала MAP_HUGETLB (если включён),
+// затем выровненный по huge-странице mmap + MADV_HUGEPAGE, затем обычные
+// страницы. Заполняет region (длина, фактический размер страницы, вид).
+static void* map_large_pages(size_t size, BMMemRegion* region) {
+    size_t page = system_page_size();
+#ifdef __linux__
+    size_t huge = huge_page_size();
+    size_t length = (size + huge - 1) & ~(huge - 1);
+
+#ifdef MAP_HUGETLB
+    if (huge_mode == BM_HUGE_PAGES_HUGETLB) {
+        void* ptr = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) {
+            region->length = length;
+            region->page_size = huge;
+            region->kind = BM_MEM_HUGE_TLB;
+            return ptr;
+        }
+        // Пул hugetlbfs пуст или не настроен — откатываемся на THP
+    }
+#endif
+
+    // Берём с запасом в одну huge-страницу и обрезаем края, чтобы начало
+    // блока было выровнено и ядро могло подставить PMD-страницы
+    size_t span = length + huge;
+    char* raw = (char*)mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+
+    char* aligned = (char*)(((uintptr_t)raw + huge - 1) & ~(uintptr_t)(huge - 1));
+    if (aligned > raw) munmap(raw, (size_t)(aligned - raw));
+    size_t tail = (size_t)((raw + span) - (aligned + length));
+    if (tail) munmap(aligned + length, tail);
+
+    region->length = length;
+    region->page_size = page;
+    region->kind = BM_MEM_MAPPED;
+#ifdef MADV_HUGEPAGE
+    if (thp_enabled() && madvise(aligned, length, MADV_HUGEPAGE) == 0) {
+        region->page_size = huge;
+        region->kind = BM_MEM_HUGE_THP;
+    }
+#endif
+    return aligned;
+#else
+    void* ptr = map_zero_pages(size);
+    region->length = size;
+    region->page_size = page;
+    region->kind = BM_MEM_MAPPED;
+    return ptr;
 #endif
+}
+
+// -----------------------------
+// Политика больших выделений
+// -----------------------------
+
+BMResult bm_mem_set_huge_pages(BMHugePageMode mode, size_t threshold) {
+    if (mode > BM_HUGE_PAGES_HUGETLB) {
+        BM_SET_ERROR("bm_mem_set_huge_pages: invalid mode");
+        return BM_ERROR;
+    }
+    huge_mode = mode;
+    huge_threshold = threshold ? threshold : BM_ALLOC_HUGE_THRESHOLD;
+    return BM_SUCCESS;
+}
+
+BMResult bm_mem_query(const void* ptr, BMMemInfo* info) {
+    if (!ptr || !info) {
+        BM_SET_ERROR("bm_mem_query: invalid arguments");
+        return BM_ERROR;
+    }
+
+    info->kind = BM_MEM_HEAP;
+    info->length = 0;
+    info->page_size = system_page_size();
+
+    region_lock_acquire();
+    for (size_t i = 0; i < region_count; ++i) {
+        if (regions[i].ptr == ptr) {
+            info->kind = regions[i].kind;
+            info->length = regions[i].length;
+            info->page_size = regions[i].page_size;
+            break;
+        }
+    }
+    region_lock_release();
+    return BM_SUCCESS;
+}
 
 // --- CPU память ---
 BMResult bm_cpu_alloc(size_t size, void** out_ptr) {
-    if (!out_ptr || size == 0) {
-        bm_set_last_error("bm_cpu_alloc: invalid arguments");
+    return bm_cpu_alloc_ex(size, BM_ALLOC_ZERO, out_ptr);
+}
+
+BMResult bm_cpu_alloc_ex(size_t size, unsigned flags, void** out_ptr) {
+    if (!out_ptr || size == 0 || ((flags & BM_ALLOC_ZERO) && (flags & BM_ALLOC_UNINIT))) {
+        BM_SET_ERROR("bm_cpu_alloc: invalid arguments");
         return BM_ERROR;
     }
 
-    void* ptr = malloc(size);
+    void* ptr = NULL;
+    int mapped = 0;
+    int track = bm_alloc_track_begin();
+    BMMemRegion region = { NULL, NULL, size, system_page_size(), BM_MEM_MAPPED, -1, NULL };
+
+    if (huge_mode != BM_HUGE_PAGES_OFF && size >= huge_threshold) {
+        // mmap-страницы нулевые, так что путь подходит для обоих флагов
+        ptr = map_large_pages(size, &region);
+        mapped = 1;
+    } else if (size >= BM_ALLOC_MMAP_THRESHOLD) {
+        // И для UNINIT: нули mmap ленивые и ничего не стоят, а целые страницы
+        // bm_numa_place привяжет к узлу устройства (блок кучи он пропускает)
+        ptr = map_zero_pages(size);
+        mapped = 1;
+    } else if (flags & BM_ALLOC_UNINIT) {
+        ptr = malloc(size);
+    } else {
+        ptr = calloc(1, size);
+    }
+
+    if (ptr && mapped) {
+        region.ptr = ptr;
+        region.base = ptr;
+        if (!region_add(&region)) {
+            unmap_pages(ptr, region.length);
+            ptr = NULL;
+        }
+    }
+
+    bm_alloc_track_end(track, ptr, size, NULL, BM_ALLOC_KIND_HOST);
     if (!ptr) {
-        bm_set_last_error("bm_cpu_alloc: out of memory");
+        BM_SET_ERROR("bm_cpu_alloc: out of memory");
         return BM_ERROR;
     }
 
-    memset(ptr, 0, size);
     *out_ptr = ptr;
     return BM_SUCCESS;
 }
 
 BMResult bm_cpu_free(void* ptr) {
     if (!ptr) return BM_ERROR;
-    free(ptr);
+
+    bm_alloc_track_free(ptr);
+    BMMemRegion region;
+    size_t mapped = region_remove(ptr, &region);
+    if (!mapped) {
+        free(ptr);
+        return BM_SUCCESS;
+    }
+
+    unmap_pages(region.base, mapped);
+#ifndef _WIN32
+    if (region.fd >= 0) close(region.fd);
+    if (region.shm_name) {
+        shm_unlink(region.shm_name);
+        free(region.shm_name);
+    }
+#endif
+    return BM_SUCCESS;
+}
+
+// --- Файлы, отображённые в память ---
+BMResult bm_mem_map_file(const char* path, uint64_t offset, size_t length, unsigned flags,
+                         void** out_ptr, size_t* out_length) {
+    if (!path || !out_ptr || !out_length ||
+        ((flags & BM_FILE_SEQUENTIAL) && (flags & BM_FILE_RANDOM))) {
+        BM_SET_ERROR("bm_mem_map_file: invalid arguments");
+        return BM_ERROR_INVALID_ARG;
+    }
+
+#ifdef _WIN32
+    (void)offset;
+    (void)length;
+    BM_SET_ERROR("bm_mem_map_file: not supported on this platform");
+    return BM_ERROR;
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        BM_SET_ERROR("bm_mem_map_file: cannot open '%s': %s", path, strerror(errno));
+        return BM_ERROR;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        BM_SET_ERROR("bm_mem_map_file: cannot stat '%s': %s", path, strerror(errno));
+        close(fd);
+        return BM_ERROR;
+    }
+    if ((uint64_t)st.st_size <= offset) {
+        close(fd);
+        BM_SET_ERROR("bm_mem_map_file: offset %llu is beyond the end of '%s'",
+                     (unsigned long long)offset, path);
+        return BM_ERROR_INVALID_ARG;
+    }
+    uint64_t available = (uint64_t)st.st_size - offset;
+    if (length == 0) length = (size_t)available;  // до конца файла
+    if ((uint64_t)length > available) {
+        close(fd);
+        BM_SET_ERROR("bm_mem_map_file: range exceeds the size of '%s'", path);
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    // mmap принимает только смещения, кратные странице
+    size_t page = system_page_size();
+    size_t delta = (size_t)(offset % page);
+    size_t map_length = length + delta;
+
+    int prot = PROT_READ;
+    // Только чтение — MAP_SHARED: страницы page cache общие для всех процессов.
+    // COW — MAP_PRIVATE: запись копирует страницу, файл не меняется.
+    int map_flags = MAP_SHARED;
+    if (flags & BM_FILE_COPY_ON_WRITE) {
+        prot |= PROT_WRITE;
+        map_flags = MAP_PRIVATE;
+    }
+#ifdef MAP_POPULATE
+    if (flags & BM_FILE_POPULATE) map_flags |= MAP_POPULATE;
+#endif
+
+    char* base = (char*)mmap(NULL, map_length, prot, map_flags, fd, (off_t)(offset - delta));
+    int map_errno = errno;
+    close(fd); // отображение держит файл само
+    if (base == MAP_FAILED) {
+        BM_SET_ERROR("bm_mem_map_file: mmap of '%s' failed: %s", path, strerror(map_errno));
+        return map_errno == ENOMEM ? BM_ERROR_NOMEM : BM_ERROR;
+    }
+
+    // Подсказки ядру; их отказ не мешает работе с отображением
+    if (flags & BM_FILE_SEQUENTIAL) madvise(base, map_length, MADV_SEQUENTIAL);
+    if (flags & BM_FILE_RANDOM) madvise(base, map_length, MADV_RANDOM);
+    if (flags & BM_FILE_WILLNEED) madvise(base, map_length, MADV_WILLNEED);
+
+    BMMemRegion region = { base + delta, base, map_length, page, BM_MEM_FILE, -1, NULL };
+    if (!region_add(&region)) {
+        munmap(base, map_length);
+        BM_SET_ERROR("bm_mem_map_file: out of memory");
+        return BM_ERROR_NOMEM;
+    }
+
+    *out_ptr = base + delta;
+    *out_length = length;
+    return BM_SUCCESS;
+#endif
+}
+
+// --- Копии блоков (copy-on-write) ---
+#ifdef __linux__
+// Биты записи /proc/self/pagemap
+#define BM_PAGEMAP_PRESENT (1ull << 63)
+#define BM_PAGEMAP_SWAPPED (1ull << 62)
+#define BM_PAGEMAP_FILE    (1ull << 61)    // страница из memfd, а не анонимная копия
+#define BM_PAGEMAP_BATCH   512
+
+// Замораживание одного блока двумя потоками сразу исключает этот lock;
+// region_lock на время копирования не держится
+static pthread_mutex_t cow_freeze_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Смотрит блок src в реестре. Для BM_MEM_COW возвращает копию дескриптора
+// memfd; для блока, который можно заморозить, — -1 и *freeze = 1.
+static int cow_source(void* src, size_t size, void** base, size_t* length, int* freeze) {
+    int fd = -1;
+    *freeze = 0;
+    region_lock_acquire();
+    for (size_t i = 0; i < region_count; ++i) {
+        BMMemRegion* r = &regions[i];
+        if (r->ptr != src || r->length < size) continue;
+        if (r->kind == BM_MEM_COW) fd = fcntl(r->fd, F_DUPFD_CLOEXEC, 0);
+        *freeze = r->kind == BM_MEM_MAPPED || r->kind == BM_MEM_HUGE_THP;
+        *base = r->base;
+        *length = r->length;
+        break;
+    }
+    region_lock_release();
+    return fd;
+}
+
+// Переносит анонимный блок в memfd и отображает его на тот же адрес
+// MAP_PRIVATE; возвращает копию дескриптора memfd или -1. Копирование идёт
+// без region_lock: гигабайтный блок не задерживает bm_cpu_alloc/bm_cpu_free
+// в других потоках. Источник должен быть неподвижен: запись в него между
+// копированием и MAP_FIXED потеряется и в самом блоке.
+static int cow_freeze(void* src, size_t size, size_t* out_length) {
+#ifdef MFD_CLOEXEC
+    pthread_mutex_lock(&cow_freeze_lock);
+    void* base = NULL;
+    size_t length = 0;
+    int freeze = 0;
+    int fd = cow_source(src, size, &base, &length, &freeze);
+    if (fd >= 0 || !freeze) { // заморожен другим потоком или не подходит
+        pthread_mutex_unlock(&cow_freeze_lock);
+        *out_length = length;
+        return fd;
+    }
+
+    fd = memfd_create("burymetal-cow", MFD_CLOEXEC);
+    int ok = fd >= 0 && ftruncate(fd, (off_t)length) == 0;
+    // Единственное полное копирование: дальше страницы делятся до записи
+    const char* from = (const char*)base;
+    for (size_t done = 0; ok && done < length;) {
+        ssize_t n = pwrite(fd, from + done, length - done, (off_t)done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) ok = 0;
+        else done += (size_t)n;
+    }
+    ok = ok && mmap(base, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED;
+
+    int dup_fd = -1;
+    if (ok) {
+        region_lock_acquire();
+        for (size_t i = 0; i < region_count; ++i) {
+            BMMemRegion* r = &regions[i];
+            if (r->base != base) continue;
+            // memfd не наследует THP и NUMA-размещение исходных страниц
+            r->kind = BM_MEM_COW;
+            r->page_size = system_page_size();
+            r->fd = fd;
+            dup_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+            fd = -1;
+            break;
+        }
+        region_lock_release();
+    }
+    if (fd >= 0) close(fd);
+    pthread_mutex_unlock(&cow_freeze_lock);
+    *out_length = length;
+    return dup_fd;
+#else
+    (void)src;
+    (void)size;
+    *out_length = 0;
+    return -1;
+#endif
+}
+
+// Переносит в dst страницы src, которые разошлись с memfd (анонимные после записи)
+static void cow_patch(const char* src, char* dst, size_t length) {
+    size_t page = system_page_size();
+    size_t pages = (length + page - 1) / page;
+    int pagemap = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+
+    uint64_t entries[BM_PAGEMAP_BATCH];
+    for (size_t first = 0; first < pages; first += BM_PAGEMAP_BATCH) {
+        size_t count = pages - first < BM_PAGEMAP_BATCH ? pages - first : BM_PAGEMAP_BATCH;
+        off_t at = (off_t)(((uintptr_t)src / page + first) * sizeof(uint64_t));
+        if (pagemap < 0 || pread(pagemap, entries, count * sizeof(uint64_t), at) != (ssize_t)(count * sizeof(uint64_t))) {
+            // Без pagemap изменённые страницы не отличить — копируем остаток
+            memcpy(dst + first * page, src + first * page, length - first * page);
+            break;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t e = entries[i];
+            if ((e & BM_PAGEMAP_SWAPPED) || ((e & BM_PAGEMAP_PRESENT) && !(e & BM_PAGEMAP_FILE))) {
+                size_t at_byte = (first + i) * page;
+                size_t n = length - at_byte < page ? length - at_byte : page;
+                memcpy(dst + at_byte, src + at_byte, n);
+            }
+        }
+    }
+    if (pagemap >= 0) close(pagemap);
+}
+
+static void* cow_clone(void* src, size_t size) {
+    void* base = NULL;
+    size_t length = 0;
+    int freeze = 0;
+    int fd = cow_source(src, size, &base, &length, &freeze);
+    if (fd < 0 && freeze) fd = cow_freeze(src, size, &length);
+    if (fd < 0) return NULL;
+
+    char* clone = (char*)mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (clone == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    cow_patch((const char*)src, clone, length);
+
+    BMMemRegion region = { clone, clone, length, system_page_size(), BM_MEM_COW, fd, NULL };
+    if (!region_add(&region)) {
+        munmap(clone, length);
+        close(fd);
+        return NULL;
+    }
+    return clone;
+}
+#endif
+
+BMResult bm_mem_clone(void* src, size_t size, void** out_ptr) {
+    if (!src || size == 0 || !out_ptr) {
+        BM_SET_ERROR("bm_mem_clone: invalid arguments");
+        return BM_ERROR;
+    }
+
+#ifdef __linux__
+    void* clone = cow_clone(src, size);
+    if (clone) {
+        *out_ptr = clone;
+        return BM_SUCCESS;
+    }
+#endif
+    // Блок из кучи, чужая память или memfd недоступен — обычная копия
+    if (bm_cpu_alloc_ex(size, BM_ALLOC_UNINIT, out_ptr) != BM_SUCCESS) return BM_ERROR;
+    memcpy(*out_ptr, src, size);
+    return BM_SUCCESS;
+}
+
+// --- Разделяемая память (memfd / shm_open) ---
+#ifndef _WIN32
+// Отображает весь объект fd; первые header байт — служебная область перед ptr
+static BMResult map_shared(int fd, size_t header, size_t length, int read_only,
+                           char* shm_name, void** out_ptr) {
+    char* base = (char*)mmap(NULL, header + length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        BM_SET_ERROR("bm_mem_shared: mmap failed: %s", strerror(errno));
+        return BM_ERROR;
+    }
+    // Служебная область остаётся доступной на запись (в ней лежат fence'ы)
+    if (read_only && mprotect(base + header, length, PROT_READ) != 0) {
+        munmap(base, header + length);
+        BM_SET_ERROR("bm_mem_shared: mprotect failed: %s", strerror(errno));
+        return BM_ERROR;
+    }
+
+    BMMemRegion region = { base + header, base, header + length, system_page_size(), BM_MEM_SHARED, fd, shm_name };
+    if (!region_add(&region)) {
+        munmap(base, header + length);
+        BM_SET_ERROR("bm_mem_shared: out of memory");
+        return BM_ERROR;
+    }
+    *out_ptr = base + header;
+    return BM_SUCCESS;
+}
+#endif
+
+BMResult bm_mem_shared_create(const char* name, size_t header, size_t length, void** out_ptr) {
+    if (length == 0 || !out_ptr || header % system_page_size() != 0 || (name && name[0] != '/')) {
+        BM_SET_ERROR("bm_mem_shared_create: invalid arguments");
+        return BM_ERROR;
+    }
+
+#ifdef _WIN32
+    (void)header;
+    BM_SET_ERROR("bm_mem_shared_create: not supported on this platform");
+    return BM_ERROR;
+#else
+    int fd = -1;
+    char* shm_name = NULL;
+    if (name) {
+        shm_name = (char*)malloc(strlen(name) + 1);
+        if (!shm_name) {
+            BM_SET_ERROR("bm_mem_shared_create: out of memory");
+            return BM_ERROR;
+        }
+        strcpy(shm_name, name);
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    } else {
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+        fd = memfd_create("burymetal", MFD_CLOEXEC);
+#else
+        errno = ENOSYS;
+#endif
+    }
+    if (fd < 0) {
+        BM_SET_ERROR("bm_mem_shared_create: cannot create '%s': %s", name ? name : "memfd", strerror(errno));
+        free(shm_name);
+        return BM_ERROR;
+    }
+
+    // Новый объект заполнен нулями; страницы выделяются при первом касании
+    if (ftruncate(fd, (off_t)(header + length)) != 0)
+        BM_SET_ERROR("bm_mem_shared_create: cannot size '%s': %s", name ? name : "memfd", strerror(errno));
+    else if (map_shared(fd, header, length, 0, shm_name, out_ptr) == BM_SUCCESS)
+        return BM_SUCCESS;
+
+    close(fd);
+    if (shm_name) shm_unlink(shm_name);
+    free(shm_name);
+    return BM_ERROR;
+#endif
+}
+
+BMResult bm_mem_shared_open(const char* name, int fd, size_t header, int read_only,
+                            void** out_ptr, size_t* out_length) {
+    if ((!name && fd < 0) || !out_ptr || !out_length || header % system_page_size() != 0) {
+        BM_SET_ERROR("bm_mem_shared_open: invalid arguments");
+        return BM_ERROR;
+    }
+
+#ifdef _WIN32
+    (void)read_only;
+    BM_SET_ERROR("bm_mem_shared_open: not supported on this platform");
+    return BM_ERROR;
+#else
+    // Собственная копия дескриптора: переданный остаётся у вызывающего
+    int own = name ? shm_open(name, O_RDWR, 0) : fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (own < 0) {
+        BM_SET_ERROR("bm_mem_shared_open: cannot open '%s': %s", name ? name : "fd", strerror(errno));
+        return BM_ERROR;
+    }
+
+    struct stat st;
+    if (fstat(own, &st) != 0 || (uint64_t)st.st_size <= header) {
+        close(own);
+        BM_SET_ERROR("bm_mem_shared_open: '%s' is not a shared buffer", name ? name : "fd");
+        return BM_ERROR;
+    }
+    size_t length = (size_t)st.st_size - header;
+    if (map_shared(own, header, length, read_only, NULL, out_ptr) != BM_SUCCESS) {
+        close(own);
+        return BM_ERROR;
+    }
+    *out_length = length;
+    return BM_SUCCESS;
+#endif
+}
+
+BMResult bm_mem_shared_fd(const void* ptr, int* out_fd) {
+    if (!ptr || !out_fd) {
+        BM_SET_ERROR("bm_mem_shared_fd: invalid arguments");
+        return BM_ERROR;
+    }
+
+    int fd = -1;
+    region_lock_acquire();
+    for (size_t i = 0; i < region_count; ++i) {
+        if (regions[i].ptr == ptr) {
+            fd = regions[i].fd;
+            break;
+        }
+    }
+    region_lock_release();
+
+    if (fd < 0) {
+        BM_SET_ERROR("bm_mem_shared_fd: block is not shared memory");
+        return BM_ERROR;
+    }
+    *out_fd = fd;
     return BM_SUCCESS;
 }
 
 // --- GPU память (stub для CPU-only, интегрировать backend позже) ---
 BMResult bm_gpu_alloc(BMDevice* device, size_t size, void** out_ptr) {
+    return bm_gpu_alloc_ex(device, size, BM_ALLOC_ZERO, out_ptr);
+}
+
+BMResult bm_gpu_alloc_ex(BMDevice* device, size_t size, unsigned flags, void** out_ptr) {
     if (!device || !out_ptr || size == 0) {
-        bm_set_last_error("bm_gpu_alloc: invalid arguments");
+        BM_SET_ERROR("bm_gpu_alloc: invalid arguments");
         return BM_ERROR;
     }
 
     if (device->type == BM_CPU) {
-        // для CPU выделяем обычный RAM
-        return bm_cpu_alloc(size, out_ptr);
+        // для CPU выделяем обычный RAM (в учёте — как память устройства)
+        int track = bm_alloc_track_begin();
+        BMResult res = bm_cpu_alloc_ex(size, flags, out_ptr);
+        bm_alloc_track_end(track, res == BM_SUCCESS ? *out_ptr : NULL, size, device, BM_ALLOC_KIND_DEVICE);
+        return res;
     }
 
     // TODO: заменить на вызовы CUDA/ROCm/OneAPI
-    bm_set_last_error("bm_gpu_alloc: GPU backend not implemented yet");
+    BM_SET_ERROR("bm_gpu_alloc: GPU backend not implemented yet");
     *out_ptr = NULL;
     return BM_ERROR;
 }
@@ -58,46 +733,46 @@ BMResult bm_gpu_free(BMDevice* device, void* ptr) {
     }
 
     // TODO: GPU free
-    bm_set_last_error("bm_gpu_free: GPU backend not implemented yet");
+    BM_SET_ERROR("bm_gpu_free: GPU backend not implemented yet");
     return BM_ERROR;
 }
 
 // --- Копирование данных ---
 BMResult bm_memcpy_host_to_device(BMBuffer* buffer, const void* src, size_t size) {
     if (!buffer || !src || size > buffer->size) {
-        bm_set_last_error("bm_memcpy_host_to_device: invalid arguments");
+        BM_SET_ERROR("bm_memcpy_host_to_device: invalid arguments");
         return BM_ERROR;
     }
 
     if (buffer->device->type == BM_CPU) {
-        memcpy(buffer->data, src, size);
+        if (buffer->data != src) memcpy(buffer->data, src, size);
         return BM_SUCCESS;
     }
 
     // TODO: GPU upload через backend
-    bm_set_last_error("bm_memcpy_host_to_device: GPU upload not implemented");
+    BM_SET_ERROR("bm_memcpy_host_to_device: GPU upload not implemented");
     return BM_ERROR;
 }
 
 BMResult bm_memcpy_device_to_host(BMBuffer* buffer, void* dst, size_t size) {
     if (!buffer || !dst || size > buffer->size) {
-        bm_set_last_error("bm_memcpy_device_to_host: invalid arguments");
+        BM_SET_ERROR("bm_memcpy_device_to_host: invalid arguments");
         return BM_ERROR;
     }
 
     if (buffer->device->type == BM_CPU) {
-        memcpy(dst, buffer->data, size);
+        if (buffer->data != dst) memcpy(dst, buffer->data, size);
         return BM_SUCCESS;
     }
 
     // TODO: GPU download через backend
-    bm_set_last_error("bm_memcpy_device_to_host: GPU download not implemented");
+    BM_SET_ERROR("bm_memcpy_device_to_host: GPU download not implemented");
     return BM_ERROR;
 }
 
 BMResult bm_memcpy_device_to_device(BMBuffer* dst, BMBuffer* src, size_t size) {
     if (!dst || !src || size > dst->size || size > src->size) {
-        bm_set_last_error("bm_memcpy_device_to_device: invalid arguments");
+        BM_SET_ERROR("bm_memcpy_device_to_device: invalid arguments");
         return BM_ERROR;
     }
 
@@ -107,6 +782,6 @@ BMResult bm_memcpy_device_to_device(BMBuffer* dst, BMBuffer* src, size_t size) {
     }
 
     // TODO: GPU ↔ GPU copy через backend
-    bm_set_last_error("bm_memcpy_device_to_device: GPU copy not implemented");
+    BM_SET_ERROR("bm_memcpy_device_to_device: GPU copy not implemented");
     return BM_ERROR;
 }
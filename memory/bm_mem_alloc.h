@@ -2,6 +2,7 @@
 #define BM_MEM_ALLOC_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include "bm_types.h"
 #include "bm_utils.h"
 
@@ -9,18 +10,88 @@
 extern "C" {
 #endif
 
+// -----------------------------
+// Флаги выделения
+// -----------------------------
+
+// Память обнулена (по умолчанию). Большие блоки берутся из свежих
+// анонимных страниц mmap, которые ядро обнуляет лениво при первом касании.
+#define BM_ALLOC_ZERO   0x1u
+// Содержимое не определено: без memset (буфер всё равно перезапишется upload'ом).
+// Большие блоки — те же страницы mmap, что и у BM_ALLOC_ZERO, малые — malloc.
+#define BM_ALLOC_UNINIT 0x2u
+
+// Начиная с этого размера память (с любым флагом) выделяется через mmap:
+// блок из целых страниц bm_numa_place может привязать к узлу, а меньшие
+// блоки кучи делят страницы с соседями и остаются там, где их коснулись
+#define BM_ALLOC_MMAP_THRESHOLD (256u * 1024u)
+
+// Начиная с этого размера память выделяется на huge-страницах (по умолчанию)
+#define BM_ALLOC_HUGE_THRESHOLD (4u * 1024u * 1024u)
+
+// -----------------------------
+// Huge-страницы и сведения о блоке
+// -----------------------------
+
+typedef enum {
+    BM_HUGE_PAGES_OFF = 0,  // только обычные страницы
+    BM_HUGE_PAGES_THP,      // mmap + madvise(MADV_HUGEPAGE) (по умолчанию)
+    BM_HUGE_PAGES_HUGETLB   // MAP_HUGETLB с откатом на THP при нехватке
+} BMHugePageMode;
+
+typedef enum {
+    BM_MEM_HEAP = 0,        // malloc/calloc
+    BM_MEM_MAPPED,          // анонимный mmap, обычные страницы
+    BM_MEM_HUGE_THP,        // THP (ядро подставит huge-страницы, если сможет)
+    BM_MEM_HUGE_TLB,        // явные huge-страницы hugetlbfs
+    BM_MEM_FILE,            // отображение файла (bm_mem_map_file)
+    BM_MEM_SHARED,          // memfd / shm_open, MAP_SHARED (bm_mem_shared_*)
+    BM_MEM_COW              // MAP_PRIVATE поверх замороженного memfd (bm_mem_clone)
+} BMMemKind;
+
+typedef struct BMMemInfo {
+    BMMemKind kind;
+    size_t length;          // длина отображения (0 для BM_MEM_HEAP)
+    size_t page_size;       // размер страницы, которым отображён блок
+} BMMemInfo;
+
+/**
+ * Настройка пути больших выделений (вызывать до выделения буферов)
+ * @param mode Режим huge-страниц
+ * @param threshold Минимальный размер блока для huge-страниц (0 — по умолчанию)
+ * @return BM_SUCCESS или BM_ERROR
+ */
+BMResult bm_mem_set_huge_pages(BMHugePageMode mode, size_t threshold);
+
+/**
+ * Сведения о блоке, выделенном bm_cpu_alloc/bm_cpu_alloc_ex
+ * @param ptr Начало блока
+ * @param info Результат
+ * @return BM_SUCCESS или BM_ERROR
+ */
+BMResult bm_mem_query(const void* ptr, BMMemInfo* info);
+
 // -----------------------------
 // CPU память
 // -----------------------------
 
 /**
- * Выделение CPU буфера
+ * Выделение обнулённого CPU буфера
  * @param size Размер буфера в байтах
  * @param out_ptr Указатель для возврата адреса выделенной памяти
  * @return BM_SUCCESS или BM_ERROR
  */
 BMResult bm_cpu_alloc(size_t size, void** out_ptr);
 
+/**
+ * Выделение CPU буфера с флагами
+ * @param size Размер буфера в байтах
+ * @param flags BM_ALLOC_ZERO или BM_ALLOC_UNINIT (0 — как BM_ALLOC_ZERO)
+ * @param out_ptr Указатель для возврата адреса выделенной памяти
+ * @return BM_SUCCESS или BM_ERROR
+ */
+BMResult bm_cpu_alloc_ex(size_t size, unsigned flags, void** out_ptr);
+
 /**
  * Освобождение CPU буфера
  * @param ptr Указатель на память
@@ -28,6 +99,70 @@ BMResult bm_cpu_alloc(size_t size, void** out_ptr);
  */
 BMResult bm_cpu_free(void* ptr);
 
+/**
+ * Отображение файла в память (освобождается через bm_cpu_free)
+ * @param path Путь к файлу
+ * @param offset Смещение в файле (любое — выравнивание по странице делается внутри)
+ * @param length Длина (0 — до конца файла)
+ * @param flags BM_FILE_* (0 — только чтение, MAP_SHARED)
+ * @param out_ptr Адрес байта offset
+ * @param out_length Фактическая длина
+ * @return BM_SUCCESS; BM_ERROR_INVALID_ARG — аргументы или диапазон вне файла;
+ *         BM_ERROR_NOMEM — нет памяти; BM_ERROR — ошибка open/fstat/mmap (errno в тексте ошибки)
+ */
+BMResult bm_mem_map_file(const char* path, uint64_t offset, size_t length, unsigned flags,
+                         void** out_ptr, size_t* out_length);
+
+/**
+ * Копия блока (освобождается через bm_cpu_free).
+ * Для mmap-блоков bm_cpu_alloc (Linux) копия делит страницы с исходным блоком
+ * до первой записи: при первом клонировании содержимое один раз переносится
+ * в memfd, а исходный блок и все копии отображаются на него MAP_PRIVATE.
+ * Страницы, изменённые после этого, находятся по /proc/self/pagemap и
+ * копируются поштучно. Остальные блоки копируются целиком.
+ * Исходный блок должен быть неподвижен, пока bm_mem_clone не вернёт управление:
+ * при первом клонировании запись в него из другого потока может потеряться
+ * и в копии, и в самом блоке (он заново отображается на memfd).
+ * @param src Начало блока
+ * @param size Размер блока
+ * @param out_ptr Копия
+ * @return BM_SUCCESS или BM_ERROR
+ */
+BMResult bm_mem_clone(void* src, size_t size, void** out_ptr);
+
+/**
+ * Разделяемая между процессами память (освобождается через bm_cpu_free).
+ * Объект длиной header + length отображается MAP_SHARED; первые header байт
+ * (кратно странице) — служебная область перед *out_ptr.
+ * @param name Имя shm_open ("/имя"; удаляется при освобождении) или NULL — анонимный memfd
+ * @param header Размер служебной области
+ * @param length Размер данных
+ * @param out_ptr Начало данных
+ * @return BM_SUCCESS или BM_ERROR
+ */
+BMResult bm_mem_shared_create(const char* name, size_t header, size_t length, void** out_ptr);
+
+/**
+ * Отображение разделяемой памяти, созданной другим процессом
+ * @param name Имя shm_open или NULL — тогда используется fd (дублируется, остаётся у вызывающего)
+ * @param fd Дескриптор memfd/shm, полученный от создателя
+ * @param header Размер служебной области (как при создании)
+ * @param read_only Данные только для чтения (служебная область остаётся доступной на запись)
+ * @param out_ptr Начало данных
+ * @param out_length Размер данных
+ * @return BM_SUCCESS или BM_ERROR
+ */
+BMResult bm_mem_shared_open(const char* name, int fd, size_t header, int read_only,
+                            void** out_ptr, size_t* out_length);
+
+/**
+ * Дескриптор разделяемой памяти (действителен, пока блок не освобождён)
+ * @param ptr Начало данных (из bm_mem_shared_create/bm_mem_shared_open)
+ * @param out_fd Дескриптор
+ * @return BM_SUCCESS или BM_ERROR
+ */
+BMResult bm_mem_shared_fd(const void* ptr, int* out_fd);
+
 // -----------------------------
 // GPU память
 // -----------------------------
@@ -41,6 +176,11 @@ BMResult bm_cpu_free(void* ptr);
  */
 BMResult bm_gpu_alloc(BMDevice* device, size_t size, void** out_ptr);
 
+/**
+ * Выделение GPU буфера с флагами (BM_ALLOC_ZERO / BM_ALLOC_UNINIT)
+ */
+BMResult bm_gpu_alloc_ex(BMDevice* device, size_t size, unsigned flags, void** out_ptr);
+
 /**
  * Освобождение GPU буфера
  * @param device Устройство GPU
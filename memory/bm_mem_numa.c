@@ -0,0 +1,302 @@
+#ifndef _WIN32
+#define _GNU_SOURCE
+#endif
+
+#include "bm_mem_numa.h"
+#include "bm_internal.h"
+#include "bm_mem_alloc.h"
+#include "bm_mem_sysinfo.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+// Режимы mbind из <linux/mempolicy.h> (заголовок есть не везде)
+#define BM_MPOL_BIND       2
+#define BM_MPOL_INTERLEAVE 3
+
+// Потоков на узел для first-touch
+#define BM_NUMA_TOUCH_THREADS 4
+
+#ifdef __linux__
+
+// -----------------------------
+// Топология (читается из sysfs один раз)
+// -----------------------------
+
+typedef struct BMNumaNode {
+    int present;
+    cpu_set_t cpus;
+    int cpu_count;
+    size_t memory;
+} BMNumaNode;
+
+static BMNumaNode nodes[BM_NUMA_MAX_NODES];
+static int node_count = 0;       // max id + 1
+static cpu_set_t all_cpus;
+static pthread_once_t topology_once = PTHREAD_ONCE_INIT;
+
+// Разбор списков вида "0-3,8-11"
+static void parse_cpulist(const char* list, cpu_set_t* set) {
+    CPU_ZERO(set);
+    const char* p = list;
+    while (*p) {
+        char* end = NULL;
+        long first = strtol(p, &end, 10);
+        if (end == p) break;
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            p = end;
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+            CPU_SET((int)cpu, set);
+        if (*p == ',') ++p;
+        else break;
+    }
+}
+
+static int read_line(const char* path, char* line, size_t size) {
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    int ok = fgets(line, (int)size, f) != NULL;
+    fclose(f);
+    return ok;
+}
+
+static size_t read_node_memory(int node) {
+    char path[96];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/meminfo", node);
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+
+    char line[160];
+    unsigned long long kb = 0;
+    while (fgets(line, sizeof(line), f)) {
+        const char* field = strstr(line, "MemTotal:");
+        if (field && sscanf(field, "MemTotal: %llu", &kb) == 1) break;
+    }
+    fclose(f);
+    return (size_t)kb * 1024u;
+}
+
+static void load_topology(void) {
+    CPU_ZERO(&all_cpus);
+    sched_getaffinity(0, sizeof(all_cpus), &all_cpus);
+
+    char line[1024];
+    cpu_set_t online;
+    if (read_line("/sys/devices/system/node/online", line, sizeof(line))) {
+        parse_cpulist(line, &online);   // тот же формат, что и у списка CPU
+        for (int node = 0; node < BM_NUMA_MAX_NODES; ++node) {
+            if (!CPU_ISSET(node, &online)) continue;
+            char path[96];
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+            if (!read_line(path, line, sizeof(line))) continue;
+            nodes[node].present = 1;
+            parse_cpulist(line, &nodes[node].cpus);
+            // Только CPU, на которых процессу разрешено работать
+            CPU_AND(&nodes[node].cpus, &nodes[node].cpus, &all_cpus);
+            nodes[node].cpu_count = CPU_COUNT(&nodes[node].cpus);
+            nodes[node].memory = read_node_memory(node);
+            node_count = node + 1;
+        }
+    }
+
+    // Не-NUMA система (или sysfs недоступен): один узел со всеми CPU
+    if (node_count == 0) {
+        nodes[0].present = 1;
+        nodes[0].cpus = all_cpus;
+        nodes[0].cpu_count = CPU_COUNT(&all_cpus);
+        node_count = 1;
+    }
+}
+
+static void ensure_topology(void) {
+    pthread_once(&topology_once, load_topology);
+}
+
+// -----------------------------
+// First-touch
+// -----------------------------
+
+typedef struct BMTouchTask {
+    char* base;
+    size_t pages;
+    size_t page_size;
+    size_t first;      // первая страница
+    size_t step;       // шаг по страницам
+    cpu_set_t cpus;
+} BMTouchTask;
+
+static void* touch_pages(void* arg) {
+    BMTouchTask* task = (BMTouchTask*)arg;
+    pthread_setaffinity_np(pthread_self(), sizeof(task->cpus), &task->cpus);
+    for (size_t page = task->first; page < task->pages; page += task->step)
+        ((volatile char*)task->base)[page * task->page_size] = 0;
+    return NULL;
+}
+
+// Касается страниц потоками, закреплёнными на узлах: при bind — все потоки
+// на одном узле, при interleave — страницы раздаются узлам по кругу.
+static BMResult first_touch(const BMDevice* device, char* base, size_t size, size_t page_size) {
+    int target_nodes[BM_NUMA_MAX_NODES];
+    int target_count = 0;
+    if (device->numa_policy == BM_NUMA_BIND) {
+        target_nodes[target_count++] = device->numa_node;
+    } else {
+        for (int node = 0; node < node_count; ++node)
+            if (nodes[node].present) target_nodes[target_count++] = node;
+    }
+
+    // До BM_NUMA_TOUCH_THREADS потоков на узел, но не больше квоты CPU процесса;
+    // хотя бы один на узел, иначе interleave не разложит страницы
+    size_t pages = (size + page_size - 1) / page_size;
+    size_t per_node = (size_t)bm_sysinfo_cpu_budget() / (size_t)target_count;
+    if (per_node > BM_NUMA_TOUCH_THREADS) per_node = BM_NUMA_TOUCH_THREADS;
+    if (per_node == 0) per_node = 1;
+    size_t thread_count = (size_t)target_count * per_node;
+    BMTouchTask* tasks = (BMTouchTask*)calloc(thread_count, sizeof(BMTouchTask));
+    pthread_t* threads = (pthread_t*)calloc(thread_count, sizeof(pthread_t));
+    if (!tasks || !threads) {
+        free(tasks);
+        free(threads);
+        BM_SET_ERROR("bm_numa_place: out of memory");
+        return BM_ERROR;
+    }
+
+    // Поток t касается страниц t, t + thread_count, ...; узел потока = t % target_count,
+    // поэтому при interleave страница i попадает на узел i % target_count
+    for (size_t t = 0; t < thread_count; ++t) {
+        tasks[t].base = base;
+        tasks[t].pages = pages;
+        tasks[t].page_size = page_size;
+        tasks[t].first = t;
+        tasks[t].step = thread_count;
+        tasks[t].cpus = nodes[target_nodes[t % (size_t)target_count]].cpus;
+    }
+
+    size_t started = 0;
+    for (; started < thread_count; ++started)
+        if (pthread_create(&threads[started], NULL, touch_pages, &tasks[started]) != 0) break;
+    // Если поток не стартовал — его страницы коснёмся сами
+    for (size_t t = started; t < thread_count; ++t)
+        touch_pages(&tasks[t]);
+    for (size_t t = 0; t < started; ++t)
+        pthread_join(threads[t], NULL);
+
+    free(tasks);
+    free(threads);
+    return BM_SUCCESS;
+}
+
+#endif // __linux__
+
+// -----------------------------
+// Топология
+// -----------------------------
+
+int bm_numa_node_count(void) {
+#ifdef __linux__
+    ensure_topology();
+    return node_count;
+#else
+    return 1;
+#endif
+}
+
+int bm_numa_node_cpu_count(int node) {
+#ifdef __linux__
+    ensure_topology();
+    if (node < 0 || node >= node_count || !nodes[node].present) return 0;
+    return nodes[node].cpu_count;
+#else
+    (void)node;
+    return 0;
+#endif
+}
+
+size_t bm_numa_node_memory(int node) {
+#ifdef __linux__
+    ensure_topology();
+    if (node < 0 || node >= node_count || !nodes[node].present) return 0;
+    return nodes[node].memory;
+#else
+    (void)node;
+    return 0;
+#endif
+}
+
+// -----------------------------
+// Размещение памяти и потоков
+// -----------------------------
+
+BMResult bm_numa_place(const BMDevice* device, void* ptr, size_t size) {
+    if (!device || !ptr || size == 0) {
+        BM_SET_ERROR("bm_numa_place: invalid arguments");
+        return BM_ERROR;
+    }
+    if (device->numa_policy == BM_NUMA_DEFAULT) return BM_SUCCESS;
+
+#ifdef __linux__
+    ensure_topology();
+    if (node_count < 2) return BM_SUCCESS;
+
+    // mbind работает с целыми страницами: блоки из кучи делят страницы с соседями
+    BMMemInfo mem;
+    if (bm_mem_query(ptr, &mem) != BM_SUCCESS || mem.kind == BM_MEM_HEAP)
+        return BM_SUCCESS;
+
+    unsigned long mask = 0;
+    int mode = BM_MPOL_INTERLEAVE;
+    if (device->numa_policy == BM_NUMA_BIND) {
+        mask = 1ul << device->numa_node;
+        mode = BM_MPOL_BIND;
+    } else {
+        for (int node = 0; node < node_count; ++node)
+            if (nodes[node].present) mask |= 1ul << node;
+    }
+
+#ifdef SYS_mbind
+    if (syscall(SYS_mbind, ptr, mem.length, mode, &mask,
+                (unsigned long)BM_NUMA_MAX_NODES + 1, 0ul) == 0)
+        return BM_SUCCESS;
+#else
+    (void)mode;
+#endif
+
+    // mbind запрещён (seccomp в контейнере) или не поддержан — first-touch
+    return first_touch(device, (char*)ptr, mem.length, mem.page_size);
+#else
+    (void)ptr;
+    (void)size;
+    return BM_SUCCESS;
+#endif
+}
+
+BMResult bm_numa_bind_thread(const BMDevice* device) {
+    if (!device) {
+        BM_SET_ERROR("bm_numa_bind_thread: invalid arguments");
+        return BM_ERROR;
+    }
+
+#ifdef __linux__
+    ensure_topology();
+    const cpu_set_t* cpus = &all_cpus;
+    if (device->numa_policy == BM_NUMA_BIND)
+        cpus = &nodes[device->numa_node].cpus;
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(*cpus), cpus) != 0) {
+        BM_SET_ERROR("bm_numa_bind_thread: pthread_setaffinity_np failed");
+        return BM_ERROR;
+    }
+#endif
+    return BM_SUCCESS;
+}
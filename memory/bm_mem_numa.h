@@ -0,0 +1,61 @@
+#ifndef BM_MEM_NUMA_H
+#define BM_MEM_NUMA_H
+
+#include <stddef.h>
+#include "bm_types.h"
+#include "bm_utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// -----------------------------
+// NUMA-топология и размещение памяти CPU-устройства
+// -----------------------------
+
+// Максимум узлов, которые учитываются (ширина маски mbind)
+#define BM_NUMA_MAX_NODES 64
+
+/**
+ * Количество NUMA-узлов (из /sys/devices/system/node; 1 на не-NUMA системах)
+ */
+int bm_numa_node_count(void);
+
+/**
+ * Количество CPU узла
+ * @param node Номер узла
+ * @return Число CPU или 0, если узла нет
+ */
+int bm_numa_node_cpu_count(int node);
+
+/**
+ * Объём памяти узла в байтах (0 — неизвестно)
+ */
+size_t bm_numa_node_memory(int node);
+
+/**
+ * Размещение диапазона памяти по политике устройства:
+ * mbind(MPOL_BIND / MPOL_INTERLEAVE), а если он недоступен — параллельное
+ * first-touch касание страниц потоками, закреплёнными на CPU узла.
+ * Малые блоки из кучи (BM_MEM_HEAP, меньше BM_ALLOC_MMAP_THRESHOLD при любых
+ * флагах выделения) не трогаются: их страницы общие с соседними блоками.
+ * @param device CPU-устройство
+ * @param ptr Начало блока (от bm_cpu_alloc/bm_cpu_alloc_ex)
+ * @param size Размер блока
+ * @return BM_SUCCESS или BM_ERROR
+ */
+BMResult bm_numa_place(const BMDevice* device, void* ptr, size_t size);
+
+/**
+ * Закрепление текущего потока на CPU узла устройства
+ * (для interleave-устройства и устройства без узла — на всех CPU)
+ * @param device CPU-устройство
+ * @return BM_SUCCESS или BM_ERROR
+ */
+BMResult bm_numa_bind_thread(const BMDevice* device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BM_MEM_NUMA_H
@@ -1,5 +1,12 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "bm_mem_pool.h"
+#include "bm_internal.h"
 #include "bm_mem_alloc.h"
+#include "bm_mem_slab.h"
+#include "bm_mem_numa.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -7,19 +14,38 @@
 #include <windows.h>
 #else
 #include <pthread.h>
+#include <time.h>
+#include <errno.h>
 #endif
 
+// Слот пула: буфер (NULL — слот пуст после сжатия), флаг занятости и время возврата
+typedef struct BMPoolSlot {
+    BMBuffer* buffer;
+    int used;
+    uint64_t released_ms;
+} BMPoolSlot;
+
 // Структура пула
 struct BMBufferPool {
     BMDevice* device;
     size_t buffer_size;
-    size_t count;
-    BMBuffer** buffers;
-    int* used; // флаг занятости буфера
+    size_t initial_count;
+    size_t grow_chunk;
+    size_t max_count;
+    uint32_t idle_shrink_ms;
+    unsigned alloc_flags;
+
+    size_t capacity;  // число слотов
+    size_t count;     // число живых буферов
+    size_t growing;   // буферов, которые сейчас выделяются без lock
+    size_t in_use;    // число выданных буферов
+    BMPoolSlot* slots;
 #ifdef _WIN32
     CRITICAL_SECTION lock;
+    CONDITION_VARIABLE released;
 #else
     pthread_mutex_t lock;
+    pthread_cond_t released;
 #endif
 };
 
@@ -43,97 +69,264 @@ static void pool_unlock(BMBufferPool* pool) {
 #endif
 }
 
+static uint64_t pool_now_ms(void) {
+#ifdef _WIN32
+    return (uint64_t)GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+#endif
+}
+
+// Ожидание bm_pool_release до deadline_ms (0 — бесконечно).
+// Возвращает 0, если истёк таймаут.
+static int pool_wait(BMBufferPool* pool, uint64_t deadline_ms) {
+#ifdef _WIN32
+    DWORD wait_ms = INFINITE;
+    if (deadline_ms) {
+        uint64_t now = pool_now_ms();
+        if (now >= deadline_ms) return 0;
+        wait_ms = (DWORD)(deadline_ms - now);
+    }
+    return SleepConditionVariableCS(&pool->released, &pool->lock, wait_ms) ? 1 : 0;
+#else
+    if (!deadline_ms) {
+        pthread_cond_wait(&pool->released, &pool->lock);
+        return 1;
+    }
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline_ms / 1000u);
+    ts.tv_nsec = (long)(deadline_ms % 1000u) * 1000000L;
+    return pthread_cond_timedwait(&pool->released, &pool->lock, &ts) == ETIMEDOUT ? 0 : 1;
+#endif
+}
+
+static BMBuffer* pool_alloc_buffer(BMBufferPool* pool) {
+    void* data_ptr = NULL;
+    int track = bm_alloc_track_begin();
+    BMResult res = (pool->device->type == BM_CPU)
+        ? bm_cpu_alloc_ex(pool->buffer_size, pool->alloc_flags, &data_ptr)
+        : bm_gpu_alloc_ex(pool->device, pool->buffer_size, pool->alloc_flags, &data_ptr);
+    if (res != BM_SUCCESS) {
+        bm_alloc_track_end(track, NULL, 0, pool->device, BM_ALLOC_KIND_POOL);
+        return NULL;
+    }
+    if (pool->device->type == BM_CPU)
+        bm_numa_place(pool->device, data_ptr, pool->buffer_size);
+
+    BMBuffer* buf = bm_handle_alloc_buffer();
+    bm_alloc_track_end(track, buf, pool->buffer_size, pool->device, BM_ALLOC_KIND_POOL);
+    if (!buf) {
+        if (pool->device->type == BM_CPU)
+            bm_cpu_free(data_ptr);
+        else
+            bm_gpu_free(pool->device, data_ptr);
+        return NULL;
+    }
+
+    buf->device = pool->device;
+    buf->backend = pool->device->type;
+    buf->size = pool->buffer_size;
+    buf->data = data_ptr;
+    bm_stats_alloc(pool->device, pool->buffer_size);
+    return buf;
+}
+
+static void pool_free_buffer(BMBufferPool* pool, BMBuffer* buf) {
+    bm_alloc_track_free(buf);
+    bm_stats_free(pool->device, buf->size);
+    if (pool->device->type == BM_CPU)
+        bm_cpu_free(buf->data);
+    else
+        bm_gpu_free(pool->device, buf->data);
+    bm_handle_free_buffer(buf);
+}
+
+// Выделяет до n буферов в bufs; возвращает, сколько удалось. Без lock.
+static size_t pool_alloc_chunk(BMBufferPool* pool, BMBuffer** bufs, size_t n) {
+    size_t done = 0;
+    while (done < n && (bufs[done] = pool_alloc_buffer(pool)) != NULL) ++done;
+    return done;
+}
+
+// Раскладывает готовые буферы по пустым слотам; не поместившиеся (нет памяти
+// под слоты) освобождает. Вызывается под lock, возвращает число добавленных.
+static size_t pool_publish_locked(BMBufferPool* pool, BMBuffer** bufs, size_t n) {
+    size_t empty = pool->capacity - pool->count;
+    if (empty < n) {
+        size_t new_capacity = pool->count + n;
+        BMPoolSlot* slots = (BMPoolSlot*)realloc(pool->slots, sizeof(BMPoolSlot) * new_capacity);
+        if (slots) {
+            memset(slots + pool->capacity, 0, sizeof(BMPoolSlot) * (new_capacity - pool->capacity));
+            pool->slots = slots;
+            pool->capacity = new_capacity;
+        } else {
+            BM_SET_ERROR("bm_pool: out of memory");
+            for (size_t i = empty; i < n; ++i) pool_free_buffer(pool, bufs[i]);
+            n = empty;
+        }
+    }
+
+    uint64_t now = pool_now_ms();
+    size_t added = 0;
+    for (size_t i = 0; i < pool->capacity && added < n; ++i) {
+        if (pool->slots[i].buffer) continue;
+        pool->slots[i].buffer = bufs[added++];
+        pool->slots[i].used = 0;
+        pool->slots[i].released_ms = now;
+    }
+    pool->count += added;
+    return added;
+}
+
+// Рост на до grow_chunk буферов (не выходя за max_count). Вызывается под lock;
+// место резервируется в growing, память выделяется с отпущенным lock — acquire
+// и release других потоков не ждут mmap/memset. Возвращает число добавленных.
+static size_t pool_grow(BMBufferPool* pool) {
+    size_t chunk = pool->grow_chunk;
+    if (pool->count + pool->growing + chunk > pool->max_count)
+        chunk = pool->max_count - pool->count - pool->growing;
+    if (chunk == 0) return 0;
+
+    BMBuffer** bufs = (BMBuffer**)malloc(sizeof(BMBuffer*) * chunk);
+    if (!bufs) {
+        BM_SET_ERROR("bm_pool: out of memory");
+        return 0;
+    }
+    pool->growing += chunk;
+    pool_unlock(pool);
+    size_t allocated = pool_alloc_chunk(pool, bufs, chunk);
+    pool_lock(pool);
+    pool->growing -= chunk;
+    size_t added = pool_publish_locked(pool, bufs, allocated);
+    free(bufs);
+
+    // Ждавшие во время роста берут новые буферы или, если рост не удался,
+    // пробуют вырасти сами (единственный новый буфер заберёт этот поток)
+    if (added != 1) {
+#ifdef _WIN32
+        WakeAllConditionVariable(&pool->released);
+#else
+        pthread_cond_broadcast(&pool->released);
+#endif
+    }
+    return added;
+}
+
+// Освобождает простаивающие буферы сверх initial_count. Вызывается под lock.
+static size_t pool_shrink_locked(BMBufferPool* pool, uint64_t now) {
+    if (!pool->idle_shrink_ms || pool->count <= pool->initial_count) return 0;
+
+    size_t freed = 0;
+    for (size_t i = 0; i < pool->capacity && pool->count > pool->initial_count; ++i) {
+        BMPoolSlot* slot = &pool->slots[i];
+        if (!slot->buffer || slot->used) continue;
+        if (now - slot->released_ms < pool->idle_shrink_ms) continue;
+        pool_free_buffer(pool, slot->buffer);
+        slot->buffer = NULL;
+        --pool->count;
+        ++freed;
+    }
+    return freed;
+}
+
 // -----------------------------
 // Создание/удаление пула
 // -----------------------------
 
 BMBufferPool* bm_pool_create(BMDevice* device, size_t buffer_size, size_t count) {
-    if (!device || buffer_size == 0 || count == 0) {
-        bm_set_last_error("bm_pool_create: invalid arguments");
+    BMPoolConfig config;
+    memset(&config, 0, sizeof(config));
+    config.buffer_size = buffer_size;
+    config.initial_count = count;
+    config.max_count = count;
+    return bm_pool_create_ex(device, &config);
+}
+
+BMBufferPool* bm_pool_create_ex(BMDevice* device, const BMPoolConfig* config) {
+    if (!device || !config || config->buffer_size == 0 ||
+        (config->initial_count == 0 && config->grow_chunk == 0) ||
+        (config->max_count && config->max_count < config->initial_count)) {
+        BM_SET_ERROR("bm_pool_create: invalid arguments");
         return NULL;
     }
 
+    BMRecordCall rec;
+    bm_record_begin(&rec);
     BMBufferPool* pool = (BMBufferPool*)malloc(sizeof(BMBufferPool));
     if (!pool) {
-        bm_set_last_error("bm_pool_create: out of memory");
+        BM_SET_ERROR("bm_pool_create: out of memory");
         return NULL;
     }
 
+    memset(pool, 0, sizeof(*pool));
     pool->device = device;
-    pool->buffer_size = buffer_size;
-    pool->count = count;
-    pool->buffers = (BMBuffer**)malloc(sizeof(BMBuffer*) * count);
-    pool->used = (int*)malloc(sizeof(int) * count);
-    if (!pool->buffers || !pool->used) {
-        free(pool->buffers);
-        free(pool->used);
+    pool->buffer_size = config->buffer_size;
+    pool->initial_count = config->initial_count;
+    pool->grow_chunk = config->grow_chunk;
+    // max_count 0: растущий пул не ограничен, фиксированный — равен initial_count
+    pool->max_count = config->max_count ? config->max_count
+                    : config->grow_chunk ? SIZE_MAX : config->initial_count;
+    pool->idle_shrink_ms = config->idle_shrink_ms;
+    pool->alloc_flags = config->alloc_flags;
+
+    // Пул ещё никому не виден: начальные буферы раскладываются без lock
+    size_t published = 0;
+    if (pool->initial_count) {
+        BMBuffer** bufs = (BMBuffer**)malloc(sizeof(BMBuffer*) * pool->initial_count);
+        if (!bufs) BM_SET_ERROR("bm_pool_create: out of memory");
+        else published = pool_publish_locked(pool, bufs, pool_alloc_chunk(pool, bufs, pool->initial_count));
+        free(bufs);
+    }
+    if (published != pool->initial_count) {
+        for (size_t i = 0; i < pool->capacity; ++i)
+            if (pool->slots[i].buffer) pool_free_buffer(pool, pool->slots[i].buffer);
+        free(pool->slots);
         free(pool);
-        bm_set_last_error("bm_pool_create: out of memory");
         return NULL;
     }
 
-    memset(pool->used, 0, sizeof(int) * count);
-
-    for (size_t i = 0; i < count; ++i) {
-        void* data_ptr = NULL;
-        if (device->type == BM_CPU) {
-            if (bm_cpu_alloc(buffer_size, &data_ptr) != BM_SUCCESS) {
-                // Очистка уже выделенных буферов
-                for (size_t j = 0; j < i; ++j)
-                    bm_cpu_free(pool->buffers[j]->data);
-                free(pool->buffers);
-                free(pool->used);
-                free(pool);
-                return NULL;
-            }
-        } else {
-            if (bm_gpu_alloc(device, buffer_size, &data_ptr) != BM_SUCCESS) {
-                for (size_t j = 0; j < i; ++j)
-                    bm_gpu_free(device, pool->buffers[j]->data);
-                free(pool->buffers);
-                free(pool->used);
-                free(pool);
-                return NULL;
-            }
-        }
-
-        BMBuffer* buf = (BMBuffer*)malloc(sizeof(BMBuffer));
-        buf->device = device;
-        buf->size = buffer_size;
-        buf->data = data_ptr;
-        pool->buffers[i] = buf;
-    }
-
 #ifdef _WIN32
     InitializeCriticalSection(&pool->lock);
+    InitializeConditionVariable(&pool->released);
 #else
     pthread_mutex_init(&pool->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&pool->released, &attr);
+    pthread_condattr_destroy(&attr);
 #endif
 
+    if (rec.start_ns) {
+        uint64_t params[4] = {config->grow_chunk, config->max_count, config->idle_shrink_ms, config->alloc_flags};
+        bm_record_call(&rec, BM_RECORD_POOL_CREATE, device, pool, config->buffer_size, config->initial_count,
+                       BM_SUCCESS, params, sizeof(params));
+    }
     return pool;
 }
 
 BMResult bm_pool_destroy(BMBufferPool* pool) {
     if (!pool) return BM_ERROR;
 
+    BMRecordCall rec;
+    bm_record_begin_destroy(&rec);
+    BMDevice* device = pool->device;
 #ifdef _WIN32
     DeleteCriticalSection(&pool->lock);
 #else
+    pthread_cond_destroy(&pool->released);
     pthread_mutex_destroy(&pool->lock);
 #endif
 
-    for (size_t i = 0; i < pool->count; ++i) {
-        if (pool->buffers[i]) {
-            if (pool->device->type == BM_CPU)
-                bm_cpu_free(pool->buffers[i]->data);
-            else
-                bm_gpu_free(pool->device, pool->buffers[i]->data);
-            free(pool->buffers[i]);
-        }
+    for (size_t i = 0; i < pool->capacity; ++i) {
+        if (pool->slots[i].buffer)
+            pool_free_buffer(pool, pool->slots[i].buffer);
     }
 
-    free(pool->buffers);
-    free(pool->used);
+    bm_record_end(&rec, BM_RECORD_POOL_DESTROY, pool, device, 0, 0, BM_SUCCESS);
+    free(pool->slots);
     free(pool);
     return BM_SUCCESS;
 }
@@ -142,45 +335,110 @@ BMResult bm_pool_destroy(BMBufferPool* pool) {
 // Получение/возврат буфера
 // -----------------------------
 
+// Метрики и трасса одного acquire; wait_start — начало ожидания (0 — не ждали)
+static void pool_account(BMBufferPool* pool, int hit, uint64_t wait_start) {
+    uint64_t waited = wait_start ? bm_now_ns() - wait_start : 0;
+    bm_stats_pool_acquire(pool->device, hit, waited);
+    if (wait_start && BM_ATOMIC_LOAD_RELAXED(&bm_trace_active))
+        bm_trace_record(wait_start, "pool", "bm_pool_acquire wait", NULL, 0);
+}
+
 BMResult bm_pool_acquire(BMBufferPool* pool, BMBuffer** out_buffer) {
-    if (!pool || !out_buffer) {
-        bm_set_last_error("bm_pool_acquire: invalid arguments");
+    return bm_pool_acquire_timeout(pool, out_buffer, 0);
+}
+
+BMResult bm_pool_acquire_timeout(BMBufferPool* pool, BMBuffer** out_buffer, int64_t timeout_ms) {
+    if (!pool || !out_buffer || timeout_ms < BM_POOL_WAIT_FOREVER) {
+        BM_SET_ERROR("bm_pool_acquire: invalid arguments");
         return BM_ERROR;
     }
 
+    uint64_t deadline_ms = 0;
+    if (timeout_ms > 0) deadline_ms = pool_now_ms() + (uint64_t)timeout_ms;
+
+    BMRecordCall rec;
+    bm_record_begin(&rec);
+    int hit = 1;
+    uint64_t wait_start = 0; // начало первого ожидания
     pool_lock(pool);
 
-    for (size_t i = 0; i < pool->count; ++i) {
-        if (!pool->used[i]) {
-            pool->used[i] = 1;
-            *out_buffer = pool->buffers[i];
-            pool_unlock(pool);
-            return BM_SUCCESS;
+    for (;;) {
+        for (size_t i = 0; i < pool->capacity; ++i) {
+            if (pool->slots[i].buffer && !pool->slots[i].used) {
+                pool->slots[i].used = 1;
+                ++pool->in_use;
+                *out_buffer = pool->slots[i].buffer;
+                // Выданный буфер занят — сжатие заберёт только простаивающие
+                pool_shrink_locked(pool, pool_now_ms());
+                pool_unlock(pool);
+                pool_account(pool, hit, wait_start);
+                bm_record_end(&rec, BM_RECORD_POOL_ACQUIRE, pool, *out_buffer, (uint64_t)timeout_ms, 0, BM_SUCCESS);
+                return BM_SUCCESS;
+            }
         }
+        hit = 0;
+
+        // Свободных нет — пробуем вырасти
+        if (pool->grow_chunk && pool->count + pool->growing < pool->max_count && pool_grow(pool) > 0)
+            continue;
+
+        if (timeout_ms == 0) break;
+        if (!wait_start) wait_start = bm_now_ns();
+        if (!pool_wait(pool, deadline_ms)) break;
     }
 
     pool_unlock(pool);
-    bm_set_last_error("bm_pool_acquire: no free buffers");
+    pool_account(pool, 0, wait_start);
+    bm_record_end(&rec, BM_RECORD_POOL_ACQUIRE, pool, NULL, (uint64_t)timeout_ms, 0, BM_ERROR);
+    if (timeout_ms == 0)
+        BM_SET_ERROR("bm_pool_acquire: no free buffers");
+    else
+        BM_SET_ERROR("bm_pool_acquire: timed out waiting for a free buffer");
     return BM_ERROR;
 }
 
 BMResult bm_pool_release(BMBufferPool* pool, BMBuffer* buffer) {
     if (!pool || !buffer) {
-        bm_set_last_error("bm_pool_release: invalid arguments");
+        BM_SET_ERROR("bm_pool_release: invalid arguments");
         return BM_ERROR;
     }
 
+    BMRecordCall rec;
+    bm_record_begin_destroy(&rec);
     pool_lock(pool);
 
-    for (size_t i = 0; i < pool->count; ++i) {
-        if (pool->buffers[i] == buffer) {
-            pool->used[i] = 0;
+    for (size_t i = 0; i < pool->capacity; ++i) {
+        if (pool->slots[i].buffer == buffer) {
+            if (!pool->slots[i].used) {
+                pool_unlock(pool);
+                BM_SET_ERROR("bm_pool_release: buffer is not acquired (double release)");
+                return BM_ERROR_INVALID_ARG;
+            }
+            uint64_t now = pool_now_ms();
+            pool->slots[i].used = 0;
+            pool->slots[i].released_ms = now;
+            --pool->in_use;
+            pool_shrink_locked(pool, now);
+#ifdef _WIN32
+            WakeConditionVariable(&pool->released);
+#else
+            pthread_cond_signal(&pool->released);
+#endif
             pool_unlock(pool);
+            bm_record_end(&rec, BM_RECORD_POOL_RELEASE, pool, buffer, 0, 0, BM_SUCCESS);
             return BM_SUCCESS;
         }
     }
 
     pool_unlock(pool);
-    bm_set_last_error("bm_pool_release: buffer not found in pool");
+    BM_SET_ERROR("bm_pool_release: buffer not found in pool");
     return BM_ERROR;
 }
+
+size_t bm_pool_trim(BMBufferPool* pool) {
+    if (!pool) return 0;
+    pool_lock(pool);
+    size_t freed = pool_shrink_locked(pool, pool_now_ms());
+    pool_unlock(pool);
+    return freed;
+}
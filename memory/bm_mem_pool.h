@@ -2,6 +2,7 @@
 #define BM_MEM_POOL_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include "bm_types.h"
 #include "bm_utils.h"
 
@@ -14,6 +15,29 @@ extern "C" {
 // -----------------------------
 typedef struct BMBufferPool BMBufferPool;
 
+// Бесконечное ожидание для bm_pool_acquire_timeout
+#define BM_POOL_WAIT_FOREVER (-1)
+
+/**
+ * Параметры эластичного пула
+ * buffer_size    — размер каждого буфера
+ * initial_count  — сколько буферов выделить сразу (нижняя граница при сжатии)
+ * grow_chunk     — сколько буферов добавлять при исчерпании (0 — пул не растёт)
+ * max_count      — верхняя граница числа буферов (0 — без ограничения при
+ *                  grow_chunk > 0, иначе равна initial_count)
+ * idle_shrink_ms — через сколько мс простоя свободный буфер сверх initial_count
+ *                  возвращается системе (0 — никогда)
+ * alloc_flags    — BM_ALLOC_ZERO / BM_ALLOC_UNINIT для памяти буферов (0 — обнулять)
+ */
+typedef struct BMPoolConfig {
+    size_t buffer_size;
+    size_t initial_count;
+    size_t grow_chunk;
+    size_t max_count;
+    uint32_t idle_shrink_ms;
+    unsigned alloc_flags;
+} BMPoolConfig;
+
 /**
  * Создание пула буферов для устройства
  * @param device Устройство CPU/GPU
@@ -23,6 +47,14 @@ typedef struct BMBufferPool BMBufferPool;
  */
 BMBufferPool* bm_pool_create(BMDevice* device, size_t buffer_size, size_t count);
 
+/**
+ * Создание эластичного пула (рост чанками до max_count, сжатие после простоя)
+ * @param device Устройство CPU/GPU
+ * @param config Параметры пула
+ * @return Указатель на пул или NULL при ошибке
+ */
+BMBufferPool* bm_pool_create_ex(BMDevice* device, const BMPoolConfig* config);
+
 /**
  * Уничтожение пула и освобождение всех буферов
  * @param pool Пул буферов
@@ -38,14 +70,32 @@ BMResult bm_pool_destroy(BMBufferPool* pool);
  */
 BMResult bm_pool_acquire(BMBufferPool* pool, BMBuffer** out_buffer);
 
+/**
+ * Получение буфера с ожиданием: если пул исчерпан и расти некуда,
+ * поток блокируется до bm_pool_release или истечения таймаута
+ * @param pool Пул буферов
+ * @param out_buffer Указатель для возврата буфера
+ * @param timeout_ms Таймаут в мс (0 — не ждать, BM_POOL_WAIT_FOREVER — ждать бесконечно)
+ * @return BM_SUCCESS или BM_ERROR (таймаут или ошибка выделения)
+ */
+BMResult bm_pool_acquire_timeout(BMBufferPool* pool, BMBuffer** out_buffer, int64_t timeout_ms);
+
 /**
  * Возврат буфера в пул
  * @param pool Пул буферов
  * @param buffer Буфер для возврата
- * @return BM_SUCCESS или BM_ERROR (если буфер не найден)
+ * @return BM_SUCCESS, BM_ERROR_INVALID_ARG (буфер уже возвращён) или BM_ERROR (буфер не из пула)
  */
 BMResult bm_pool_release(BMBufferPool* pool, BMBuffer* buffer);
 
+/**
+ * Освобождение простаивающих буферов сверх initial_count
+ * (вызывается автоматически при успешном acquire и при release, но можно дёргать периодически)
+ * @param pool Пул буферов
+ * @return Количество освобождённых буферов
+ */
+size_t bm_pool_trim(BMBufferPool* pool);
+
 #ifdef __cplusplus
 }
 #endif
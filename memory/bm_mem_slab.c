@@ -0,0 +1,265 @@
+#include "bm_mem_slab.h"
+#include "bm_internal.h"
+#include "bm_mem_utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+// Объектов на чанк для дескрипторов
+#define BM_HANDLE_CHUNK 64
+// Дескрипторов в одном обмене кэша потока с общим slab
+#define BM_HANDLE_BATCH 16
+
+// -----------------------------
+// Вспомогательные функции
+// -----------------------------
+
+static void slab_lock(BMSlab* slab) {
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&slab->lock);
+#else
+    pthread_mutex_lock(&slab->lock);
+#endif
+}
+
+static void slab_unlock(BMSlab* slab) {
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&slab->lock);
+#else
+    pthread_mutex_unlock(&slab->lock);
+#endif
+}
+
+static size_t slab_stride(const BMSlab* slab) {
+    size_t size = slab->object_size < sizeof(void*) ? sizeof(void*) : slab->object_size;
+    return (size + BM_CACHE_LINE_SIZE - 1) & ~(size_t)(BM_CACHE_LINE_SIZE - 1);
+}
+
+// Новый чанк: объекты связываются во free-list. Вызывается под lock.
+static int slab_grow_locked(BMSlab* slab) {
+    if (slab->chunk_count == slab->chunk_capacity) {
+        size_t new_capacity = slab->chunk_capacity ? slab->chunk_capacity * 2 : 8;
+        void** chunks = (void**)realloc(slab->chunks, sizeof(void*) * new_capacity);
+        if (!chunks) return 0;
+        slab->chunks = chunks;
+        slab->chunk_capacity = new_capacity;
+    }
+
+    size_t stride = slab_stride(slab);
+    void* chunk = NULL;
+    if (bm_mem_align(&chunk, BM_CACHE_LINE_SIZE, stride * slab->objects_per_chunk) != BM_SUCCESS)
+        return 0;
+
+    char* base = (char*)chunk;
+    for (size_t i = slab->objects_per_chunk; i-- > 0;) {
+        void* obj = base + i * stride;
+        *(void**)obj = slab->free_list;
+        slab->free_list = obj;
+    }
+    slab->chunks[slab->chunk_count++] = chunk;
+    return 1;
+}
+
+// -----------------------------
+// Slab
+// -----------------------------
+
+void* bm_slab_alloc(BMSlab* slab) {
+    if (!slab) return NULL;
+
+    slab_lock(slab);
+    if (!slab->free_list && !slab_grow_locked(slab)) {
+        slab_unlock(slab);
+        BM_SET_ERROR("bm_slab_alloc: out of memory");
+        return NULL;
+    }
+    void* obj = slab->free_list;
+    slab->free_list = *(void**)obj;
+    slab_unlock(slab);
+    return obj;
+}
+
+void bm_slab_free(BMSlab* slab, void* obj) {
+    if (!slab || !obj) return;
+
+    slab_lock(slab);
+    *(void**)obj = slab->free_list;
+    slab->free_list = obj;
+    slab_unlock(slab);
+}
+
+// До n объектов одним захватом lock: цепочка через первое слово объекта,
+// число — в *got (0 — нет памяти)
+static void* slab_take(BMSlab* slab, unsigned n, unsigned* got) {
+    void* list = NULL;
+    unsigned count = 0;
+    slab_lock(slab);
+    while (count < n && (slab->free_list || slab_grow_locked(slab))) {
+        void* obj = slab->free_list;
+        slab->free_list = *(void**)obj;
+        *(void**)obj = list;
+        list = obj;
+        ++count;
+    }
+    slab_unlock(slab);
+    *got = count;
+    return list;
+}
+
+// Возврат готовой цепочки first..last одним захватом lock
+static void slab_give(BMSlab* slab, void* first, void* last) {
+    slab_lock(slab);
+    *(void**)last = slab->free_list;
+    slab->free_list = first;
+    slab_unlock(slab);
+}
+
+void bm_slab_destroy(BMSlab* slab) {
+    if (!slab) return;
+
+    slab_lock(slab);
+    for (size_t i = 0; i < slab->chunk_count; ++i)
+        bm_mem_align_free(slab->chunks[i]);
+    free(slab->chunks);
+    slab->chunks = NULL;
+    slab->chunk_count = 0;
+    slab->chunk_capacity = 0;
+    slab->free_list = NULL;
+    slab_unlock(slab);
+}
+
+// -----------------------------
+// Пулы дескрипторов
+// -----------------------------
+
+static BMSlab buffer_slab = BM_SLAB_INITIALIZER(sizeof(BMBuffer), BM_HANDLE_CHUNK);
+static BMSlab kernel_slab = BM_SLAB_INITIALIZER(sizeof(BMKernel), BM_HANDLE_CHUNK);
+static BMSlab kernel_cold_slab = BM_SLAB_INITIALIZER(sizeof(BMKernelCold), BM_HANDLE_CHUNK);
+static BMSlab device_slab = BM_SLAB_INITIALIZER(sizeof(BMDevice), 8);
+
+// Кэш потока: дескрипторы берутся и возвращаются без lock, с общим slab поток
+// обменивается пачками до BM_HANDLE_BATCH. Slab'ы дескрипторов живут до конца
+// процесса; кэш завершившегося потока возвращается в slab (на Windows остаётся
+// в чанках без переиспользования).
+enum { HANDLE_BUFFER, HANDLE_KERNEL, HANDLE_KERNEL_COLD, HANDLE_DEVICE, HANDLE_KINDS };
+
+typedef struct BMHandleCache {
+    void* list;
+    unsigned count;
+} BMHandleCache;
+
+static BMSlab* const handle_slabs[HANDLE_KINDS] = {&buffer_slab, &kernel_slab, &kernel_cold_slab, &device_slab};
+static THREAD_LOCAL BMHandleCache handle_cache[HANDLE_KINDS];
+
+static unsigned handle_batch(int kind) {
+    size_t per_chunk = handle_slabs[kind]->objects_per_chunk;
+    return per_chunk < BM_HANDLE_BATCH ? (unsigned)per_chunk : BM_HANDLE_BATCH;
+}
+
+// Отдаёт slab'у первые n объектов кэша
+static void handle_cache_flush(BMHandleCache* cache, int kind, unsigned n) {
+    if (!n) return;
+    void* first = cache->list;
+    void* last = first;
+    for (unsigned i = 1; i < n; ++i) last = *(void**)last;
+    cache->list = *(void**)last;
+    cache->count -= n;
+    slab_give(handle_slabs[kind], first, last);
+}
+
+#ifdef _WIN32
+static void handle_cache_attach(void) {}
+#else
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t cache_key;
+static THREAD_LOCAL int cache_attached = 0;
+
+static void handle_cache_exit(void* arg) {
+    BMHandleCache* caches = (BMHandleCache*)arg;
+    for (int kind = 0; kind < HANDLE_KINDS; ++kind)
+        handle_cache_flush(&caches[kind], kind, caches[kind].count);
+}
+
+static void cache_key_init(void) { pthread_key_create(&cache_key, handle_cache_exit); }
+
+static void handle_cache_attach(void) {
+    if (cache_attached) return;
+    pthread_once(&cache_key_once, cache_key_init);
+    pthread_setspecific(cache_key, handle_cache);
+    cache_attached = 1;
+}
+#endif
+
+static void* handle_alloc(int kind) {
+    BMHandleCache* cache = &handle_cache[kind];
+    if (!cache->list) {
+        cache->list = slab_take(handle_slabs[kind], handle_batch(kind), &cache->count);
+        if (!cache->list) {
+            BM_SET_ERROR("bm_slab_alloc: out of memory");
+            return NULL;
+        }
+        handle_cache_attach();
+    }
+    void* obj = cache->list;
+    cache->list = *(void**)obj;
+    --cache->count;
+    return obj;
+}
+
+static void handle_free(int kind, void* obj) {
+    if (!obj) return;
+    BMHandleCache* cache = &handle_cache[kind];
+    handle_cache_attach();
+    *(void**)obj = cache->list;
+    cache->list = obj;
+    // Поток освобождает больше, чем выделял (дескрипторы других потоков): излишек — в slab
+    unsigned batch = handle_batch(kind);
+    if (++cache->count >= 2 * batch) handle_cache_flush(cache, kind, batch);
+}
+
+BMBuffer* bm_handle_alloc_buffer(void) {
+    BMBuffer* buffer = (BMBuffer*)handle_alloc(HANDLE_BUFFER);
+    if (buffer) memset(buffer, 0, sizeof(*buffer));
+    return buffer;
+}
+
+void bm_handle_free_buffer(BMBuffer* buffer) {
+    handle_free(HANDLE_BUFFER, buffer);
+}
+
+BMKernel* bm_handle_alloc_kernel(void) {
+    BMKernel* kernel = (BMKernel*)handle_alloc(HANDLE_KERNEL);
+    if (!kernel) return NULL;
+
+    BMKernelCold* cold = (BMKernelCold*)handle_alloc(HANDLE_KERNEL_COLD);
+    if (!cold) {
+        handle_free(HANDLE_KERNEL, kernel);
+        return NULL;
+    }
+
+    memset(kernel, 0, sizeof(*kernel));
+    memset(cold, 0, sizeof(*cold));
+    kernel->cold = cold;
+    return kernel;
+}
+
+void bm_handle_free_kernel(BMKernel* kernel) {
+    if (!kernel) return;
+    handle_free(HANDLE_KERNEL_COLD, kernel->cold);
+    handle_free(HANDLE_KERNEL, kernel);
+}
+
+BMDevice* bm_handle_alloc_device(void) {
+    BMDevice* device = (BMDevice*)handle_alloc(HANDLE_DEVICE);
+    if (device) memset(device, 0, sizeof(*device));
+    return device;
+}
+
+void bm_handle_free_device(BMDevice* device) {
+    handle_free(HANDLE_DEVICE, device);
+}
@@ -0,0 +1,102 @@
+#ifndef BM_MEM_SLAB_H
+#define BM_MEM_SLAB_H
+
+#include <stddef.h>
+#include "bm_types.h"
+#include "bm_utils.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// -----------------------------
+// Slab-аллокатор объектов фиксированного размера
+// -----------------------------
+
+/**
+ * Объекты нарезаются из чанков, выровненных по кэш-линии; шаг объекта
+ * округляется до BM_CACHE_LINE_SIZE, поэтому соседние объекты не делят линию.
+ * Освобождённые объекты попадают в free-list и переиспользуются без malloc.
+ */
+typedef struct BMSlab {
+    size_t object_size;
+    size_t objects_per_chunk;
+    void* free_list;
+    void** chunks;
+    size_t chunk_count;
+    size_t chunk_capacity;
+#ifdef _WIN32
+    SRWLOCK lock;
+#else
+    pthread_mutex_t lock;
+#endif
+} BMSlab;
+
+#ifdef _WIN32
+#define BM_SLAB_LOCK_INIT SRWLOCK_INIT
+#else
+#define BM_SLAB_LOCK_INIT PTHREAD_MUTEX_INITIALIZER
+#endif
+
+// Статическая инициализация: static BMSlab s = BM_SLAB_INITIALIZER(sizeof(T), 64);
+#define BM_SLAB_INITIALIZER(size, per_chunk) \
+    { (size), (per_chunk), NULL, NULL, 0, 0, BM_SLAB_LOCK_INIT }
+
+/**
+ * Выделение объекта из slab (память не обнуляется)
+ * @param slab Slab
+ * @return Указатель на объект или NULL при нехватке памяти
+ */
+void* bm_slab_alloc(BMSlab* slab);
+
+/**
+ * Возврат объекта в slab
+ * @param slab Slab
+ * @param obj Объект, выделенный из этого slab
+ */
+void bm_slab_free(BMSlab* slab, void* obj);
+
+/**
+ * Освобождение всех чанков slab (все объекты становятся невалидными)
+ * @param slab Slab
+ */
+void bm_slab_destroy(BMSlab* slab);
+
+// -----------------------------
+// Пулы дескрипторов BMDevice / BMBuffer / BMKernel
+// -----------------------------
+// У каждого потока свой кэш дескрипторов: выделение и освобождение обычно
+// обходятся без lock, общий slab трогается раз на пачку.
+
+/**
+ * Выделение обнулённого заголовка буфера
+ * @return BMBuffer* или NULL (last_error установлен)
+ */
+BMBuffer* bm_handle_alloc_buffer(void);
+void bm_handle_free_buffer(BMBuffer* buffer);
+
+/**
+ * Выделение обнулённого ядра вместе с его холодной записью (kernel->cold)
+ * @return BMKernel* или NULL (last_error установлен)
+ */
+BMKernel* bm_handle_alloc_kernel(void);
+void bm_handle_free_kernel(BMKernel* kernel);
+
+/**
+ * Выделение обнулённого дескриптора устройства
+ * @return BMDevice* или NULL (last_error установлен)
+ */
+BMDevice* bm_handle_alloc_device(void);
+void bm_handle_free_device(BMDevice* device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BM_MEM_SLAB_H
@@ -0,0 +1,471 @@
+#ifndef _WIN32
+#define _GNU_SOURCE
+#endif
+
+#include "bm_mem_sysinfo.h"
+#include "bm_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <cpuid.h>
+#define BM_HAVE_CPUID 1
+#endif
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#define BM_HAVE_HWCAP 1
+#endif
+
+// Пути: группа cgroup (до 1 КБ) поверх точки монтирования, плюс имя файла
+#define BM_SYSINFO_GROUP_MAX 1024
+#define BM_SYSINFO_MOUNT_MAX 512
+#define BM_SYSINFO_DIR_MAX   (BM_SYSINFO_MOUNT_MAX + BM_SYSINFO_GROUP_MAX)
+#define BM_SYSINFO_PATH_MAX  (BM_SYSINFO_DIR_MAX + 64)
+
+// cgroup v1 пишет «без лимита» как огромное число, близкое к 2^63
+#define BM_CGROUP_V1_UNLIMITED (1ull << 60)
+
+// -----------------------------
+// SIMD
+// -----------------------------
+
+static unsigned detect_simd(void) {
+    unsigned simd = 0;
+#ifdef BM_HAVE_CPUID
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return 0;
+    if (edx & (1u << 26)) simd |= BM_SIMD_SSE2;
+    if (ecx & (1u << 20)) simd |= BM_SIMD_SSE4_2;
+
+    // AVX и AVX-512 годятся, только если ОС сохраняет их регистры (XCR0)
+    int os_avx = 0, os_avx512 = 0;
+    if ((ecx & (1u << 27)) && (ecx & (1u << 28))) {    // OSXSAVE и AVX
+        unsigned xcr0_lo, xcr0_hi;
+        __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+        (void)xcr0_hi;
+        os_avx = (xcr0_lo & 0x6u) == 0x6u;              // XMM и YMM
+        os_avx512 = (xcr0_lo & 0xE6u) == 0xE6u;         // ... и opmask/ZMM
+    }
+    if (os_avx) {
+        simd |= BM_SIMD_AVX;
+        if (ecx & (1u << 12)) simd |= BM_SIMD_FMA;
+    }
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        if (os_avx && (ebx & (1u << 5))) simd |= BM_SIMD_AVX2;
+        if (os_avx512 && (ebx & (1u << 16))) simd |= BM_SIMD_AVX512F;
+        if (os_avx512 && (ebx & (1u << 30))) simd |= BM_SIMD_AVX512BW;
+    }
+#elif defined(BM_HAVE_HWCAP)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    if (hwcap & (1ul << 1)) simd |= BM_SIMD_NEON;      // HWCAP_ASIMD
+    if (hwcap & (1ul << 22)) simd |= BM_SIMD_SVE;      // HWCAP_SVE
+#elif defined(__ARM_NEON)
+    simd |= BM_SIMD_NEON;
+#endif
+    return simd;
+}
+
+#ifdef __linux__
+
+// -----------------------------
+// Чтение /proc и /sys
+// -----------------------------
+
+static int read_text(const char* root, const char* path, char* buf, size_t size) {
+    char full[BM_SYSINFO_PATH_MAX];
+    snprintf(full, sizeof(full), "%s%s", root, path);
+    FILE* f = fopen(full, "r");
+    if (!f) return 0;
+    size_t n = fread(buf, 1, size - 1, f);
+    fclose(f);
+    while (n && (buf[n - 1] == '\n' || buf[n - 1] == ' ')) --n;
+    buf[n] = '\0';
+    return 1;
+}
+
+static int read_u64(const char* root, const char* path, uint64_t* value) {
+    char buf[64];
+    if (!read_text(root, path, buf, sizeof(buf))) return 0;
+    char* end = NULL;
+    unsigned long long v = strtoull(buf, &end, 10);
+    if (end == buf) return 0;
+    *value = v;
+    return 1;
+}
+
+// Число CPU в списке вида "0-3,8-11"
+static int count_cpulist(const char* list) {
+    int count = 0;
+    const char* p = list;
+    while (*p) {
+        char* end = NULL;
+        long first = strtol(p, &end, 10);
+        if (end == p) break;
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            p = end;
+        }
+        if (last >= first) count += (int)(last - first + 1);
+        if (*p == ',') ++p;
+        else break;
+    }
+    return count;
+}
+
+// Значение поля "Name: value" из /proc (meminfo, status, cpuinfo)
+static const char* find_field(const char* text, const char* name) {
+    size_t len = strlen(name);
+    for (const char* line = text; line && *line;) {
+        if (strncmp(line, name, len) == 0) {
+            const char* value = line + len;
+            while (*value == ' ' || *value == '\t' || *value == ':') ++value;
+            return value;
+        }
+        line = strchr(line, '\n');
+        if (line) ++line;
+    }
+    return NULL;
+}
+
+// "32K", "1024K", "8M" — размер кэша из sysfs
+static size_t parse_size(const char* text) {
+    char* end = NULL;
+    unsigned long long v = strtoull(text, &end, 10);
+    if (*end == 'K') v <<= 10;
+    else if (*end == 'M') v <<= 20;
+    else if (*end == 'G') v <<= 30;
+    return (size_t)v;
+}
+
+static void load_caches(const char* root, BMSysInfo* info) {
+    for (int index = 0; index < 16; ++index) {
+        char path[128], level[16], type[32], size[32];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", index);
+        if (!read_text(root, path, level, sizeof(level))) break;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", index);
+        if (!read_text(root, path, type, sizeof(type)) || strcmp(type, "Instruction") == 0) continue;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", index);
+        if (!read_text(root, path, size, sizeof(size))) continue;
+
+        size_t bytes = parse_size(size);
+        switch (atoi(level)) {
+            case 1: info->cache_l1d = bytes; break;
+            case 2: info->cache_l2 = bytes; break;
+            case 3: info->cache_l3 = bytes; break;
+            default: break;
+        }
+        uint64_t line = 0;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/coherency_line_size", index);
+        if (!info->cache_line && read_u64(root, path, &line)) info->cache_line = (size_t)line;
+    }
+}
+
+// -----------------------------
+// cgroup
+// -----------------------------
+// Лимиты берутся минимальные по пути от группы процесса до корня иерархии.
+// Если пути группы нет (другое пространство имён cgroup), подъём всё равно
+// доходит до точки монтирования — в контейнере это его собственная группа.
+
+typedef struct BMCgroupLimits {
+    double cpu_quota;               // 0 — без лимита
+    uint64_t memory_max;            // 0 — без лимита
+    uint64_t memory_left;           // минимум (лимит − занято) по уровням
+} BMCgroupLimits;
+
+typedef void (*BMCgroupVisit)(const char* dir, BMCgroupLimits* limits);
+
+static void limit_cpu(BMCgroupLimits* limits, double quota, double period) {
+    if (quota <= 0 || period <= 0) return;
+    double cpus = quota / period;
+    if (limits->cpu_quota == 0 || cpus < limits->cpu_quota) limits->cpu_quota = cpus;
+}
+
+static void limit_memory(BMCgroupLimits* limits, const char* dir, uint64_t max, const char* usage_file) {
+    char path[BM_SYSINFO_PATH_MAX];
+    uint64_t used = 0;
+    snprintf(path, sizeof(path), "%s/%s", dir, usage_file);
+    read_u64("", path, &used);
+    uint64_t left = max > used ? max - used : 0;
+    if (limits->memory_max == 0 || left < limits->memory_left) limits->memory_left = left;
+    if (limits->memory_max == 0 || max < limits->memory_max) limits->memory_max = max;
+}
+
+static void visit_v2(const char* dir, BMCgroupLimits* limits) {
+    char path[BM_SYSINFO_PATH_MAX], buf[128];
+    snprintf(path, sizeof(path), "%s/cpu.max", dir);
+    if (read_text("", path, buf, sizeof(buf)) && strncmp(buf, "max", 3) != 0) {
+        char* end = NULL;
+        double quota = strtod(buf, &end);
+        limit_cpu(limits, quota, strtod(end, NULL));
+    }
+    uint64_t max = 0;
+    snprintf(path, sizeof(path), "%s/memory.max", dir);
+    if (read_u64("", path, &max)) limit_memory(limits, dir, max, "memory.current");
+}
+
+static void visit_v1_cpu(const char* dir, BMCgroupLimits* limits) {
+    char path[BM_SYSINFO_PATH_MAX], buf[64];
+    snprintf(path, sizeof(path), "%s/cpu.cfs_quota_us", dir);
+    if (!read_text("", path, buf, sizeof(buf))) return;
+    double quota = strtod(buf, NULL);     // -1 — без лимита
+    uint64_t period = 0;
+    snprintf(path, sizeof(path), "%s/cpu.cfs_period_us", dir);
+    if (read_u64("", path, &period)) limit_cpu(limits, quota, (double)period);
+}
+
+static void visit_v1_memory(const char* dir, BMCgroupLimits* limits) {
+    char path[BM_SYSINFO_PATH_MAX];
+    uint64_t max = 0;
+    snprintf(path, sizeof(path), "%s/memory.limit_in_bytes", dir);
+    if (read_u64("", path, &max) && max < BM_CGROUP_V1_UNLIMITED)
+        limit_memory(limits, dir, max, "memory.usage_in_bytes");
+}
+
+static void cgroup_walk(const char* mount, const char* group, BMCgroupVisit visit, BMCgroupLimits* limits) {
+    char rel[BM_SYSINFO_GROUP_MAX];
+    snprintf(rel, sizeof(rel), "%s", strcmp(group, "/") == 0 ? "" : group);
+    for (;;) {
+        char dir[BM_SYSINFO_DIR_MAX];
+        snprintf(dir, sizeof(dir), "%s%s", mount, rel);
+        visit(dir, limits);
+        char* slash = strrchr(rel, '/');
+        if (!slash) break;
+        *slash = '\0';
+    }
+}
+
+// Путь группы для контроллера из /proc/self/cgroup ("" — строка v2 "0::")
+static int cgroup_path(const char* table, const char* controller, char* out, size_t size) {
+    for (const char* line = table; line && *line;) {
+        const char* first = strchr(line, ':');
+        const char* second = first ? strchr(first + 1, ':') : NULL;
+        const char* eol = strchr(line, '\n');
+        if (!eol) eol = line + strlen(line);
+        if (second && second < eol) {
+            size_t list_len = (size_t)(second - first - 1);
+            int match = 0;
+            if (!*controller) {
+                match = list_len == 0 && strncmp(line, "0:", 2) == 0;
+            } else {
+                // Список контроллеров через запятую: "cpu,cpuacct"
+                size_t len = strlen(controller);
+                for (const char* c = first + 1; c < second;) {
+                    const char* comma = memchr(c, ',', (size_t)(second - c));
+                    const char* stop = comma ? comma : second;
+                    if ((size_t)(stop - c) == len && strncmp(c, controller, len) == 0) match = 1;
+                    c = stop + 1;
+                }
+            }
+            if (match) {
+                size_t len = (size_t)(eol - second - 1);
+                if (len >= size) len = size - 1;
+                memcpy(out, second + 1, len);
+                out[len] = '\0';
+                return 1;
+            }
+        }
+        line = *eol ? eol + 1 : NULL;
+    }
+    return 0;
+}
+
+static void cgroup_limits(const char* root, BMCgroupLimits* limits) {
+    memset(limits, 0, sizeof(*limits));
+    char table[4096];
+    if (!read_text(root, "/proc/self/cgroup", table, sizeof(table))) return;
+
+    // Чистый v2 — единая иерархия с cgroup.controllers в корне; в гибридном
+    // режиме строка "0::" тоже есть, но лимиты живут в иерархиях v1
+    char group[BM_SYSINFO_GROUP_MAX], mount[BM_SYSINFO_MOUNT_MAX], probe[64];
+    if (read_text(root, "/sys/fs/cgroup/cgroup.controllers", probe, sizeof(probe)) &&
+        cgroup_path(table, "", group, sizeof(group))) {
+        snprintf(mount, sizeof(mount), "%s/sys/fs/cgroup", root);
+        cgroup_walk(mount, group, visit_v2, limits);
+        return;
+    }
+    if (cgroup_path(table, "cpu", group, sizeof(group))) {
+        snprintf(mount, sizeof(mount), "%s/sys/fs/cgroup/cpu", root);
+        cgroup_walk(mount, group, visit_v1_cpu, limits);
+    }
+    if (cgroup_path(table, "memory", group, sizeof(group))) {
+        snprintf(mount, sizeof(mount), "%s/sys/fs/cgroup/memory", root);
+        cgroup_walk(mount, group, visit_v1_memory, limits);
+    }
+}
+
+// -----------------------------
+// Сбор сведений
+// -----------------------------
+
+static void load_cpu(const char* root, BMSysInfo* info) {
+    char buf[4096];
+    if (read_text(root, "/sys/devices/system/cpu/online", buf, sizeof(buf)))
+        info->cpus_online = count_cpulist(buf);
+    if (info->cpus_online <= 0) info->cpus_online = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    // Маска affinity: у настоящей системы — sched_getaffinity, у копии — status
+    cpu_set_t set;
+    if (!*root && sched_getaffinity(0, sizeof(set), &set) == 0) {
+        info->cpus_allowed = CPU_COUNT(&set);
+    } else if (read_text(root, "/proc/self/status", buf, sizeof(buf))) {
+        const char* list = find_field(buf, "Cpus_allowed_list");
+        if (list) info->cpus_allowed = count_cpulist(list);
+    }
+    if (info->cpus_allowed <= 0) info->cpus_allowed = info->cpus_online;
+
+    info->numa_nodes = 1;
+    if (read_text(root, "/sys/devices/system/node/online", buf, sizeof(buf)) && count_cpulist(buf) > 0)
+        info->numa_nodes = count_cpulist(buf);
+
+    load_caches(root, info);
+
+    if (read_text(root, "/proc/cpuinfo", buf, sizeof(buf))) {
+        const char* model = find_field(buf, "model name");
+        if (model) {
+            size_t len = strcspn(model, "\n");
+            if (len >= sizeof(info->cpu_model)) len = sizeof(info->cpu_model) - 1;
+            memcpy(info->cpu_model, model, len);
+            info->cpu_model[len] = '\0';
+        }
+    }
+
+    BMCgroupLimits limits;
+    cgroup_limits(root, &limits);
+    info->cpu_quota = limits.cpu_quota;
+}
+
+static void load_memory(const char* root, BMSysInfo* info) {
+    char buf[4096];
+    if (read_text(root, "/proc/meminfo", buf, sizeof(buf))) {
+        const char* total = find_field(buf, "MemTotal");
+        const char* available = find_field(buf, "MemAvailable");
+        if (!available) available = find_field(buf, "MemFree");
+        if (total) info->memory_total = strtoull(total, NULL, 10) * 1024u;
+        if (available) info->memory_available = strtoull(available, NULL, 10) * 1024u;
+    }
+
+    BMCgroupLimits limits;
+    cgroup_limits(root, &limits);
+    if (limits.memory_max && (!info->memory_total || limits.memory_max < info->memory_total))
+        info->memory_total = limits.memory_max;
+    if (limits.memory_max && limits.memory_left < info->memory_available)
+        info->memory_available = limits.memory_left;
+    if (info->memory_available > info->memory_total) info->memory_available = info->memory_total;
+}
+
+#else // !__linux__
+
+static void load_cpu(const char* root, BMSysInfo* info) {
+    (void)root;
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    info->cpus_online = (int)si.dwNumberOfProcessors;
+#else
+    info->cpus_online = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    info->cpus_allowed = info->cpus_online;
+    info->numa_nodes = 1;
+}
+
+static void load_memory(const char* root, BMSysInfo* info) {
+    (void)root;
+#ifdef _WIN32
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status)) {
+        info->memory_total = status.ullTotalPhys;
+        info->memory_available = status.ullAvailPhys;
+    }
+#elif defined(_SC_PHYS_PAGES)
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && page_size > 0) info->memory_total = (uint64_t)pages * (uint64_t)page_size;
+#endif
+}
+
+#endif // __linux__
+
+static void finish_cpu(BMSysInfo* info) {
+    info->simd = detect_simd();
+    info->cpu_budget = info->cpus_allowed > 0 ? info->cpus_allowed : 1;
+    if (info->cpu_quota > 0) {
+        int quota = (int)info->cpu_quota;
+        if ((double)quota < info->cpu_quota) ++quota;   // 1.5 CPU — два потока
+        if (quota < info->cpu_budget) info->cpu_budget = quota;
+    }
+    if (info->cpu_budget < 1) info->cpu_budget = 1;
+}
+
+BMResult bm_sysinfo_load(const char* root, BMSysInfo* info) {
+    if (!info) {
+        BM_SET_ERROR("bm_sysinfo_load: invalid arguments");
+        return BM_ERROR;
+    }
+    memset(info, 0, sizeof(*info));
+    if (!root) root = "";
+    load_cpu(root, info);
+    finish_cpu(info);
+    load_memory(root, info);
+    return BM_SUCCESS;
+}
+
+// -----------------------------
+// Снимок текущей системы
+// -----------------------------
+
+static BMSysInfo cpu_info;
+
+#ifdef _WIN32
+static INIT_ONCE cpu_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK cpu_init(PINIT_ONCE once, PVOID param, PVOID* context) {
+    (void)once; (void)param; (void)context;
+    load_cpu("", &cpu_info);
+    finish_cpu(&cpu_info);
+    return TRUE;
+}
+
+static void ensure_cpu_info(void) { InitOnceExecuteOnce(&cpu_once, cpu_init, NULL, NULL); }
+#else
+static pthread_once_t cpu_once = PTHREAD_ONCE_INIT;
+
+static void cpu_init(void) {
+    load_cpu("", &cpu_info);
+    finish_cpu(&cpu_info);
+}
+
+static void ensure_cpu_info(void) { pthread_once(&cpu_once, cpu_init); }
+#endif
+
+BMResult bm_sysinfo_get(BMSysInfo* info) {
+    if (!info) {
+        BM_SET_ERROR("bm_sysinfo_get: invalid arguments");
+        return BM_ERROR;
+    }
+    ensure_cpu_info();
+    *info = cpu_info;
+    load_memory("", info);
+    return BM_SUCCESS;
+}
+
+int bm_sysinfo_cpu_budget(void) {
+    ensure_cpu_info();
+    return cpu_info.cpu_budget;
+}
@@ -0,0 +1,61 @@
+#ifndef BM_MEM_SYSINFO_H
+#define BM_MEM_SYSINFO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bm_types.h"
+#include "bm_utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// -----------------------------
+// Сведения о хосте: CPU, кэши, SIMD, память с учётом cgroup
+// -----------------------------
+
+#define BM_SYSINFO_MODEL_MAX 64
+
+typedef struct BMSysInfo {
+    int cpus_online;            // /sys/devices/system/cpu/online
+    int cpus_allowed;           // маска affinity процесса
+    double cpu_quota;           // cpu.max / cpu.cfs_quota_us в CPU, 0 — без лимита
+    int cpu_budget;             // потоков имеет смысл запускать: min(allowed, ceil(quota)), ≥ 1
+    int numa_nodes;
+    size_t cache_line;          // байт, 0 — неизвестно
+    size_t cache_l1d;
+    size_t cache_l2;
+    size_t cache_l3;
+    unsigned simd;              // BM_SIMD_*
+    char cpu_model[BM_SYSINFO_MODEL_MAX];
+    uint64_t memory_total;      // MemTotal, урезанный memory.max cgroup
+    uint64_t memory_available;  // MemAvailable, урезанный остатком до memory.max
+} BMSysInfo;
+
+/**
+ * Чтение сведений о хосте из /proc и /sys (SIMD — всегда с текущего CPU)
+ * @param root Префикс путей /proc и /sys: NULL — настоящие, иначе каталог
+ *             с копией нужных файлов (для тестов)
+ * @param info Результат
+ * @return BM_SUCCESS или BM_ERROR
+ */
+BMResult bm_sysinfo_load(const char* root, BMSysInfo* info);
+
+/**
+ * Сведения о текущем хосте: CPU, кэши и квота читаются один раз,
+ * память — при каждом вызове
+ * @param info Результат
+ * @return BM_SUCCESS или BM_ERROR
+ */
+BMResult bm_sysinfo_get(BMSysInfo* info);
+
+/**
+ * Сколько потоков запускать под параллельную работу (BMSysInfo::cpu_budget)
+ */
+int bm_sysinfo_cpu_budget(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BM_MEM_SYSINFO_H
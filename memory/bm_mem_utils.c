@@ -1,4 +1,9 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L // posix_memalign
+#endif
+
 #include "bm_mem_utils.h"
+#include "bm_internal.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
@@ -11,7 +16,7 @@
  */
 BMResult bm_mem_zero(void* ptr, size_t size) {
     if (!ptr || size == 0) {
-        bm_set_last_error("bm_mem_zero: invalid arguments");
+        BM_SET_ERROR("bm_mem_zero: invalid arguments");
         return BM_ERROR;
     }
     memset(ptr, 0, size);
@@ -27,7 +32,7 @@ BMResult bm_mem_zero(void* ptr, size_t size) {
  */
 BMResult bm_mem_copy(void* dst, const void* src, size_t size) {
     if (!dst || !src || size == 0) {
-        bm_set_last_error("bm_mem_copy: invalid arguments");
+        BM_SET_ERROR("bm_mem_copy: invalid arguments");
         return BM_ERROR;
     }
     memcpy(dst, src, size);
@@ -43,25 +48,25 @@ BMResult bm_mem_copy(void* dst, const void* src, size_t size) {
  */
 BMResult bm_mem_align(void** ptr, size_t alignment, size_t size) {
     if (!ptr || alignment == 0 || size == 0) {
-        bm_set_last_error("bm_mem_align: invalid arguments");
+        BM_SET_ERROR("bm_mem_align: invalid arguments");
         return BM_ERROR;
     }
 
     if ((alignment & (alignment - 1)) != 0) {
-        bm_set_last_error("bm_mem_align: alignment must be a power of 2");
+        BM_SET_ERROR("bm_mem_align: alignment must be a power of 2");
         return BM_ERROR;
     }
 
 #if defined(_MSC_VER)
     void* p = _aligned_malloc(size, alignment);
     if (!p) {
-        bm_set_last_error("bm_mem_align: out of memory");
+        BM_SET_ERROR("bm_mem_align: out of memory");
         return BM_ERROR;
     }
 #else
     void* p = NULL;
     if (posix_memalign(&p, alignment, size) != 0) {
-        bm_set_last_error("bm_mem_align: out of memory");
+        BM_SET_ERROR("bm_mem_align: out of memory");
         return BM_ERROR;
     }
 #endif
@@ -69,3 +74,15 @@ BMResult bm_mem_align(void** ptr, size_t alignment, size_t size) {
     *ptr = p;
     return BM_SUCCESS;
 }
+
+/**
+ * Освобождает память, выделенную bm_mem_align
+ * @param ptr Указатель на память (NULL допустим)
+ */
+void bm_mem_align_free(void* ptr) {
+#if defined(_MSC_VER)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
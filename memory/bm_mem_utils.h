@@ -38,6 +38,12 @@ BMResult bm_mem_copy(void* dst, const void* src, size_t size);
  */
 BMResult bm_mem_align(void** ptr, size_t alignment, size_t size);
 
+/**
+ * Освобождает память, выделенную bm_mem_align
+ * @param ptr Указатель на память (NULL допустим)
+ */
+void bm_mem_align_free(void* ptr);
+
 #ifdef __cplusplus
 }
 #endif
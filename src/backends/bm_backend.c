@@ -1,6 +1,8 @@
 // bm_backend.c
 #include "burymetal.h"
 #include "bm_utils.h"
+#include "bm_internal.h"
+#include "bm_mem_alloc.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -20,13 +22,14 @@
 // CPU Backend
 // -----------------------------------------
 void* bm_backend_alloc_buffer_cpu(size_t size) {
-    void* ptr = malloc(size);
-    if (!ptr) bm_set_last_error("CPU backend: не удалось выделить память");
+    void* ptr = NULL;
+    if (bm_cpu_alloc_ex(size, BM_ALLOC_UNINIT, &ptr) != BM_SUCCESS)
+        BM_SET_ERROR("CPU backend: не удалось выделить память");
     return ptr;
 }
 
 void bm_backend_free_buffer_cpu(void* ptr) {
-    if (ptr) free(ptr);
+    if (ptr) bm_cpu_free(ptr);
 }
 
 BMResult bm_backend_upload_data_cpu(void* dst, const void* src, size_t size) {
@@ -56,7 +59,7 @@ void* bm_backend_alloc_buffer_cuda(BMDevice* dev, size_t size) {
     void* dev_ptr = NULL;
     cudaError_t err = cudaMalloc(&dev_ptr, size);
     if (err != cudaSuccess) {
-        bm_set_last_error("CUDA alloc error: %s", cudaGetErrorString(err));
+        BM_SET_ERROR("CUDA alloc error: %s", cudaGetErrorString(err));
         return NULL;
     }
     return dev_ptr;
@@ -69,7 +72,7 @@ void bm_backend_free_buffer_cuda(void* dev_ptr) {
 BMResult bm_backend_upload_data_cuda(void* dst, const void* src, size_t size) {
     cudaError_t err = cudaMemcpy(dst, src, size, cudaMemcpyHostToDevice);
     if (err != cudaSuccess) {
-        bm_set_last_error("CUDA upload error: %s", cudaGetErrorString(err));
+        BM_SET_ERROR("CUDA upload error: %s", cudaGetErrorString(err));
         return BM_ERROR;
     }
     return BM_OK;
@@ -78,7 +81,7 @@ BMResult bm_backend_upload_data_cuda(void* dst, const void* src, size_t size) {
 BMResult bm_backend_download_data_cuda(const void* src, void* dst, size_t size) {
     cudaError_t err = cudaMemcpy(dst, src, size, cudaMemcpyDeviceToHost);
     if (err != cudaSuccess) {
-        bm_set_last_error("CUDA download error: %s", cudaGetErrorString(err));
+        BM_SET_ERROR("CUDA download error: %s", cudaGetErrorString(err));
         return BM_ERROR;
     }
     return BM_OK;
@@ -125,7 +128,7 @@ void* bm_backend_alloc_buffer(BMDevice* dev, size_t size) {
         case BM_INTEL: return bm_backend_alloc_buffer_vk(dev, size);
 #endif
         default:
-            bm_set_last_error("Unsupported backend type");
+            BM_SET_ERROR("Unsupported backend type");
             return NULL;
     }
 }
@@ -143,7 +146,7 @@ void bm_backend_free_buffer(BMBuffer* buf) {
 #ifdef BM_USE_VULKAN
         case BM_INTEL: bm_backend_free_buffer_vk(buf->gpu_ptr); break;
 #endif
-        default: bm_set_last_error("Unsupported backend type"); break;
+        default: BM_SET_ERROR("Unsupported backend type"); break;
     }
 }
 
@@ -2,18 +2,26 @@
 #include "bm_types.h"
 #include "bm_backend.h"
 #include "bm_utils.h"
+#include "bm_internal.h"
+#include "bm_mem_slab.h"
+#include "bm_mem_alloc.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+// Тип буферов для общей части эмулируемых backend'ов (bm_backend_host.c)
+const BMComputeTarget bm_backend_host_target = BM_AMD;
+
 // ----------------------------------------
 // AMD Backend: создание и уничтожение устройства
 // ----------------------------------------
 BMDevice* bm_backend_create_device(BMComputeTarget type) {
-    BMDevice* dev = (BMDevice*)malloc(sizeof(BMDevice));
+    (void)type;
+
+    BMDevice* dev = bm_handle_alloc_device();
     if (!dev) {
-        bm_set_last_error("[AMD] Ошибка: не удалось выделить память для устройства");
+        BM_SET_ERROR("[AMD] Ошибка: не удалось выделить память для устройства");
         return NULL;
     }
 
@@ -29,7 +37,7 @@ BMDevice* bm_backend_create_device(BMComputeTarget type) {
 void bm_backend_destroy_device(BMDevice* device) {
     if (device) {
         bm_log_info("[AMD] Устройство уничтожено: %s (id=%d)", device->name, device->id);
-        free(device);
+        bm_handle_free_device(device);
     }
 }
 
@@ -38,22 +46,24 @@ void bm_backend_destroy_device(BMDevice* device) {
 // ----------------------------------------
 BMBuffer* bm_backend_alloc_buffer(BMDevice* device, size_t size) {
     if (!device || size == 0) {
-        bm_set_last_error("[AMD] alloc_buffer: некорректные аргументы");
+        BM_SET_ERROR("[AMD] alloc_buffer: некорректные аргументы");
         return NULL;
     }
 
-    BMBuffer* buf = (BMBuffer*)malloc(sizeof(BMBuffer));
+    BMBuffer* buf = bm_handle_alloc_buffer();
     if (!buf) {
-        bm_set_last_error("[AMD] Ошибка выделения памяти под BMBuffer");
+        BM_SET_ERROR("[AMD] Ошибка выделения памяти под BMBuffer");
         return NULL;
     }
 
     buf->device = device;
+    buf->backend = BM_AMD;
     buf->size = size;
-    buf->gpu_ptr = malloc(size); // заглушка вместо hipMalloc
-    if (!buf->gpu_ptr) {
-        free(buf);
-        bm_set_last_error("[AMD] Ошибка выделения памяти под gpu_ptr");
+    // Заглушка вместо hipMalloc: память эмулируемого устройства берётся тем же
+    // аллокатором, что и у CPU (mmap для больших буферов, bm_mem_clone без копий)
+    if (bm_cpu_alloc_ex(size, BM_ALLOC_UNINIT, &buf->gpu_ptr) != BM_SUCCESS) {
+        bm_handle_free_buffer(buf);
+        BM_SET_ERROR("[AMD] Ошибка выделения памяти под gpu_ptr");
         return NULL;
     }
 
@@ -61,68 +71,40 @@ BMBuffer* bm_backend_alloc_buffer(BMDevice* device, size_t size) {
     return buf;
 }
 
-void bm_backend_free_buffer(BMBuffer* buffer) {
-    if (buffer) {
-        if (buffer->gpu_ptr) free(buffer->gpu_ptr);
-        bm_log_debug("[AMD] Освобождён буфер %zu байт", buffer->size);
-        free(buffer);
-    }
-}
-
-// ----------------------------------------
-// AMD Backend: загрузка и скачивание данных
-// ----------------------------------------
-BMStatus bm_backend_upload_data(BMBuffer* buffer, const void* data) {
-    if (!buffer || !data || !buffer->gpu_ptr) {
-        bm_set_last_error("[AMD] upload_data: некорректные аргументы");
-        return BM_STATUS_ERROR;
-    }
-    memcpy(buffer->gpu_ptr, data, buffer->size);
-    bm_log_debug("[AMD] Загружены данные в буфер (%zu байт)", buffer->size);
-    return BM_STATUS_OK;
-}
-
-BMStatus bm_backend_download_data(BMBuffer* buffer, void* data) {
-    if (!buffer || !data || !buffer->gpu_ptr) {
-        bm_set_last_error("[AMD] download_data: некорректные аргументы");
-        return BM_STATUS_ERROR;
-    }
-    memcpy(data, buffer->gpu_ptr, buffer->size);
-    bm_log_debug("[AMD] Скачаны данные из буфера (%zu байт)", buffer->size);
-    return BM_STATUS_OK;
-}
+// wrap_host, free_buffer, host_ptr, pin/unpin и передачи — в bm_backend_host.c
 
 // ----------------------------------------
 // AMD Backend: ядра
 // ----------------------------------------
 BMKernel* bm_backend_load_kernel(BMDevice* device, const char* kernel_path) {
     if (!device || !kernel_path) {
-        bm_set_last_error("[AMD] load_kernel: некорректные аргументы");
+        BM_SET_ERROR("[AMD] load_kernel: некорректные аргументы");
         return NULL;
     }
 
-    BMKernel* kernel = (BMKernel*)malloc(sizeof(BMKernel));
+    BMKernel* kernel = bm_handle_alloc_kernel();
     if (!kernel) {
-        bm_set_last_error("[AMD] Ошибка выделения памяти под BMKernel");
+        BM_SET_ERROR("[AMD] Ошибка выделения памяти под BMKernel");
         return NULL;
     }
 
     kernel->device = device;
+    kernel->type = BM_AMD;
     kernel->kernel_ptr = NULL; // заглушка
     kernel->cpu_func = NULL;   // можно назначить CPU fallback
-    snprintf(kernel->name, sizeof(kernel->name), "%s", kernel_path);
+    snprintf(kernel->cold->name, sizeof(kernel->cold->name), "%s", kernel_path);
 
-    bm_log_info("[AMD] Загружен kernel: %s", kernel->name);
+    bm_log_info("[AMD] Загружен kernel: %s", kernel->cold->name);
     return kernel;
 }
 
 BMStatus bm_backend_run_kernel(BMKernel* kernel, BMBuffer* buffer, size_t count) {
     if (!kernel || !buffer) {
-        bm_set_last_error("[AMD] run_kernel: некорректные аргументы");
+        BM_SET_ERROR("[AMD] run_kernel: некорректные аргументы");
         return BM_STATUS_ERROR;
     }
 
-    bm_log_info("[AMD] Запуск kernel '%s' на %zu элементов", kernel->name, count);
+    bm_log_debug("[AMD] Запуск kernel '%s' на %zu элементов", kernel->cold->name, count);
 
     // CPU fallback для тестов
     if (kernel->cpu_func && buffer->gpu_ptr) {
@@ -136,8 +118,8 @@ BMStatus bm_backend_run_kernel(BMKernel* kernel, BMBuffer* buffer, size_t count)
 
 void bm_backend_destroy_kernel(BMKernel* kernel) {
     if (kernel) {
-        bm_log_info("[AMD] Kernel уничтожен: %s", kernel->name);
-        free(kernel);
+        bm_log_info("[AMD] Kernel уничтожен: %s", kernel->cold->name);
+        bm_handle_free_kernel(kernel);
     }
 }
 
@@ -2,20 +2,27 @@
 #include "bm_types.h"
 #include "bm_backend.h"
 #include "bm_utils.h"
+#include "bm_internal.h"
+#include "bm_mem_slab.h"
+#include "bm_mem_alloc.h"
+#include "bm_mem_numa.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+// Тип буферов для общей части эмулируемых backend'ов (bm_backend_host.c)
+const BMComputeTarget bm_backend_host_target = BM_CPU;
+
 // ----------------------------------------
 // CPU Backend: создание и уничтожение устройства
 // ----------------------------------------
 BMDevice* bm_backend_create_device(BMComputeTarget type) {
     (void)type;
 
-    BMDevice* dev = (BMDevice*)malloc(sizeof(BMDevice));
+    BMDevice* dev = bm_handle_alloc_device();
     if (!dev) {
-        bm_set_last_error("[CPU] Ошибка выделения памяти для BMDevice");
+        BM_SET_ERROR("[CPU] Ошибка выделения памяти для BMDevice");
         return NULL;
     }
 
@@ -31,7 +38,7 @@ BMDevice* bm_backend_create_device(BMComputeTarget type) {
 void bm_backend_destroy_device(BMDevice* device) {
     if (device) {
         bm_log_info("[CPU] Устройство уничтожено: %s", device->name);
-        free(device);
+        bm_handle_free_device(device);
     }
 }
 
@@ -40,59 +47,33 @@ void bm_backend_destroy_device(BMDevice* device) {
 // ----------------------------------------
 BMBuffer* bm_backend_alloc_buffer(BMDevice* device, size_t size) {
     if (!device || size == 0) {
-        bm_set_last_error("[CPU] alloc_buffer: некорректные аргументы");
+        BM_SET_ERROR("[CPU] alloc_buffer: некорректные аргументы");
         return NULL;
     }
 
-    BMBuffer* buf = (BMBuffer*)malloc(sizeof(BMBuffer));
+    BMBuffer* buf = bm_handle_alloc_buffer();
     if (!buf) {
-        bm_set_last_error("[CPU] Ошибка выделения памяти для BMBuffer");
+        BM_SET_ERROR("[CPU] Ошибка выделения памяти для BMBuffer");
         return NULL;
     }
 
     buf->device = device;
+    buf->backend = BM_CPU;
     buf->size = size;
-    buf->gpu_ptr = malloc(size);
-    if (!buf->gpu_ptr) {
-        free(buf);
-        bm_set_last_error("[CPU] Ошибка выделения памяти для gpu_ptr");
+    // Большие буферы идут через mmap на huge-страницах (см. bm_mem_set_huge_pages)
+    if (bm_cpu_alloc_ex(size, BM_ALLOC_UNINIT, &buf->gpu_ptr) != BM_SUCCESS) {
+        bm_handle_free_buffer(buf);
+        BM_SET_ERROR("[CPU] Ошибка выделения памяти для gpu_ptr");
         return NULL;
     }
+    // Страницы ещё не тронуты — размещаем их на узле(ах) устройства
+    bm_numa_place(device, buf->gpu_ptr, size);
 
     bm_log_debug("[CPU] Выделен буфер %zu байт", size);
     return buf;
 }
 
-void bm_backend_free_buffer(BMBuffer* buffer) {
-    if (buffer) {
-        if (buffer->gpu_ptr) free(buffer->gpu_ptr);
-        bm_log_debug("[CPU] Освобождён буфер %zu байт", buffer->size);
-        free(buffer);
-    }
-}
-
-// ----------------------------------------
-// CPU Backend: загрузка и скачивание данных
-// ----------------------------------------
-BMStatus bm_backend_upload_data(BMBuffer* buffer, const void* data) {
-    if (!buffer || !data || !buffer->gpu_ptr) {
-        bm_set_last_error("[CPU] upload_data: некорректные аргументы");
-        return BM_STATUS_ERROR;
-    }
-    memcpy(buffer->gpu_ptr, data, buffer->size);
-    bm_log_debug("[CPU] Загружены данные в буфер (%zu байт)", buffer->size);
-    return BM_STATUS_OK;
-}
-
-BMStatus bm_backend_download_data(BMBuffer* buffer, void* data) {
-    if (!buffer || !data || !buffer->gpu_ptr) {
-        bm_set_last_error("[CPU] download_data: некорректные аргументы");
-        return BM_STATUS_ERROR;
-    }
-    memcpy(data, buffer->gpu_ptr, buffer->size);
-    bm_log_debug("[CPU] Скачаны данные из буфера (%zu байт)", buffer->size);
-    return BM_STATUS_OK;
-}
+// wrap_host, free_buffer, host_ptr, pin/unpin и передачи — в bm_backend_host.c
 
 // ----------------------------------------
 // CPU Backend: ядра
@@ -100,28 +81,29 @@ BMStatus bm_backend_download_data(BMBuffer* buffer, void* data) {
 BMKernel* bm_backend_load_kernel(BMDevice* device, const char* kernel_path) {
     (void)kernel_path;
 
-    BMKernel* kernel = (BMKernel*)malloc(sizeof(BMKernel));
+    BMKernel* kernel = bm_handle_alloc_kernel();
     if (!kernel) {
-        bm_set_last_error("[CPU] Ошибка выделения памяти для BMKernel");
+        BM_SET_ERROR("[CPU] Ошибка выделения памяти для BMKernel");
         return NULL;
     }
 
     kernel->device = device;
+    kernel->type = BM_CPU;
     kernel->kernel_ptr = NULL;
     kernel->cpu_func = NULL; // можно назначить функцию для CPU fallback
-    snprintf(kernel->name, sizeof(kernel->name), "CPU Kernel");
+    snprintf(kernel->cold->name, sizeof(kernel->cold->name), "CPU Kernel");
 
-    bm_log_info("[CPU] Kernel загружен: %s", kernel->name);
+    bm_log_info("[CPU] Kernel загружен: %s", kernel->cold->name);
     return kernel;
 }
 
 BMStatus bm_backend_run_kernel(BMKernel* kernel, BMBuffer* buffer, size_t count) {
     if (!kernel || !buffer || !buffer->gpu_ptr) {
-        bm_set_last_error("[CPU] run_kernel: некорректные аргументы");
+        BM_SET_ERROR("[CPU] run_kernel: некорректные аргументы");
         return BM_STATUS_ERROR;
     }
 
-    bm_log_info("[CPU] Запуск kernel '%s' на %zu элементов", kernel->name, count);
+    bm_log_debug("[CPU] Запуск kernel '%s' на %zu элементов", kernel->cold->name, count);
 
     // CPU fallback
     if (kernel->cpu_func) {
@@ -134,8 +116,8 @@ BMStatus bm_backend_run_kernel(BMKernel* kernel, BMBuffer* buffer, size_t count)
 
 void bm_backend_destroy_kernel(BMKernel* kernel) {
     if (kernel) {
-        bm_log_info("[CPU] Kernel уничтожен: %s", kernel->name);
-        free(kernel);
+        bm_log_info("[CPU] Kernel уничтожен: %s", kernel->cold->name);
+        bm_handle_free_kernel(kernel);
     }
 }
 
@@ -148,15 +130,11 @@ BMStatus bm_backend_sync(BMDevice* device) {
     return BM_STATUS_OK;
 }
 
+// CPU-устройства при любом backend'е описывает bm_query_device, а других
+// этот backend не создаёт — сюда ничего не попадает
 BMStatus bm_backend_query_device(BMDevice* device, BMDeviceInfo* info) {
-    if (!device || !info) return BM_STATUS_ERROR;
-
-    info->type = BM_CPU;
-    snprintf(info->name, sizeof(info->name), "CPU Device");
-    info->memory_total = 16384; // 16 GB
-    info->memory_free  = 8192;  // 8 GB
-    info->compute_units = 8;    // 8 потоков
-
-    bm_log_info("[CPU] Запрос информации об устройстве: %s", info->name);
-    return BM_STATUS_OK;
+    (void)device;
+    (void)info;
+    BM_SET_ERROR("[CPU] query_device: CPU-устройство описывает bm_query_device");
+    return BM_STATUS_ERROR;
 }
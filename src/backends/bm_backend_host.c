@@ -0,0 +1,150 @@
+// bm_backend_host.c
+#include "burymetal.h"
+#include "bm_types.h"
+#include "bm_backend.h"
+#include "bm_utils.h"
+#include "bm_internal.h"
+#include "bm_mem_slab.h"
+#include "bm_mem_alloc.h"
+
+#include <string.h>
+
+// ----------------------------------------
+// Общая host-память эмулируемых backend'ов (cpu, amd, intel)
+// ----------------------------------------
+// Память их устройств лежит в RAM (gpu_ptr — обычный указатель), поэтому
+// обёртка host-памяти, map, pin и все передачи у них одинаковые и собираются
+// вместе с любым из этих backend'ов. Создание устройств, выделение буферов и
+// ядра остаются в bm_backend_<имя>.c.
+
+// Префикс сообщений — как у остального backend'а сборки
+static const char* host_tag(void) {
+    switch (bm_backend_host_target) {
+        case BM_AMD:   return "[AMD]";
+        case BM_INTEL: return "[Intel]";
+        default:       return "[CPU]";
+    }
+}
+
+// Zero-copy: буфер указывает прямо на память вызывающего
+BMBuffer* bm_backend_wrap_host(BMDevice* device, void* ptr, size_t size, unsigned flags) {
+    if (!device || !ptr || size == 0) {
+        BM_SET_ERROR("%s wrap_host: некорректные аргументы", host_tag());
+        return NULL;
+    }
+
+    BMBuffer* buf = bm_handle_alloc_buffer();
+    if (!buf) {
+        BM_SET_ERROR("%s Ошибка выделения памяти для BMBuffer", host_tag());
+        return NULL;
+    }
+
+    buf->device = device;
+    buf->backend = bm_backend_host_target;
+    buf->size = size;
+    buf->gpu_ptr = ptr;
+    buf->flags = BM_BUFFER_WRAPPED | ((flags & BM_WRAP_ADOPT) ? BM_BUFFER_ADOPTED : 0u);
+
+    bm_log_debug("%s Обёрнут host-буфер %zu байт (zero-copy)", host_tag(), size);
+    return buf;
+}
+
+void bm_backend_free_buffer(BMBuffer* buffer) {
+    if (!buffer) return;
+    // Чужую память (BM_BUFFER_WRAPPED без ADOPTED) не освобождаем
+    if (buffer->gpu_ptr && (!(buffer->flags & BM_BUFFER_WRAPPED) || (buffer->flags & BM_BUFFER_ADOPTED)))
+        bm_cpu_free(buffer->gpu_ptr);
+    bm_log_debug("%s Освобождён буфер %zu байт", host_tag(), buffer->size);
+    bm_handle_free_buffer(buffer);
+}
+
+// ----------------------------------------
+// Загрузка и скачивание данных
+// ----------------------------------------
+// Память эмулируемого устройства лежит в RAM — map возвращает её напрямую
+void* bm_backend_host_ptr(BMBuffer* buffer) {
+    return buffer ? buffer->gpu_ptr : NULL;
+}
+
+// Память и так в RAM — закреплять для DMA нечего
+BMStatus bm_backend_pin_host(BMDevice* device, void* ptr, size_t size) {
+    (void)device;
+    (void)ptr;
+    (void)size;
+    return BM_STATUS_OK;
+}
+
+void bm_backend_unpin_host(BMDevice* device, void* ptr, size_t size) {
+    (void)device;
+    (void)ptr;
+    (void)size;
+}
+
+BMStatus bm_backend_upload_range(BMBuffer* buffer, const void* data, size_t offset, size_t size) {
+    if (!buffer || !data || !buffer->gpu_ptr || offset > buffer->size || size > buffer->size - offset) {
+        BM_SET_ERROR("%s upload_range: некорректные аргументы", host_tag());
+        return BM_STATUS_ERROR;
+    }
+    if (buffer->flags & BM_BUFFER_READONLY) {
+        BM_SET_ERROR("%s upload_range: буфер только для чтения", host_tag());
+        return BM_STATUS_ERROR;
+    }
+    char* dst = (char*)buffer->gpu_ptr + offset;
+    if (data != dst) // обёрнутый буфер: данные уже на месте
+        memcpy(dst, data, size);
+    bm_log_debug("%s Загружены данные в буфер (%zu байт, offset=%zu)", host_tag(), size, offset);
+    return BM_STATUS_OK;
+}
+
+BMStatus bm_backend_download_range(BMBuffer* buffer, void* data, size_t offset, size_t size) {
+    if (!buffer || !data || !buffer->gpu_ptr || offset > buffer->size || size > buffer->size - offset) {
+        BM_SET_ERROR("%s download_range: некорректные аргументы", host_tag());
+        return BM_STATUS_ERROR;
+    }
+    const char* src = (const char*)buffer->gpu_ptr + offset;
+    if (data != src)
+        memcpy(data, src, size);
+    bm_log_debug("%s Скачаны данные из буфера (%zu байт, offset=%zu)", host_tag(), size, offset);
+    return BM_STATUS_OK;
+}
+
+// Память в RAM: каждый фрагмент — один memcpy, объединять нечего
+BMStatus bm_backend_upload_regions(BMBuffer* buffer, const BMTransferRegion* regions, size_t count) {
+    if (!buffer || (!regions && count)) {
+        BM_SET_ERROR("%s upload_regions: некорректные аргументы", host_tag());
+        return BM_STATUS_ERROR;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (bm_backend_upload_range(buffer, regions[i].host, regions[i].offset, regions[i].size) != BM_STATUS_OK)
+            return BM_STATUS_ERROR;
+    }
+    return BM_STATUS_OK;
+}
+
+BMStatus bm_backend_download_regions(BMBuffer* buffer, const BMTransferRegion* regions, size_t count) {
+    if (!buffer || (!regions && count)) {
+        BM_SET_ERROR("%s download_regions: некорректные аргументы", host_tag());
+        return BM_STATUS_ERROR;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (bm_backend_download_range(buffer, regions[i].host, regions[i].offset, regions[i].size) != BM_STATUS_OK)
+            return BM_STATUS_ERROR;
+    }
+    return BM_STATUS_OK;
+}
+
+BMStatus bm_backend_upload_data(BMBuffer* buffer, const void* data) {
+    if (!buffer) {
+        BM_SET_ERROR("%s upload_data: некорректные аргументы", host_tag());
+        return BM_STATUS_ERROR;
+    }
+    return bm_backend_upload_range(buffer, data, 0, buffer->size);
+}
+
+BMStatus bm_backend_download_data(BMBuffer* buffer, void* data) {
+    if (!buffer) {
+        BM_SET_ERROR("%s download_data: некорректные аргументы", host_tag());
+        return BM_STATUS_ERROR;
+    }
+    return bm_backend_download_range(buffer, data, 0, buffer->size);
+}
@@ -2,9 +2,13 @@
 #include "bm_types.h"
 #include "bm_backend.h"
 #include "bm_utils.h"
+#include "bm_internal.h"
+#include "bm_mem_slab.h"
+#include "bm_mem_alloc.h"
 #include <cuda_runtime.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 // ----------------------------------------
 // CUDA Kernel для удвоения чисел
@@ -21,13 +25,13 @@ BMDevice* bm_backend_create_device(BMComputeTarget type) {
     int deviceCount = 0;
     cudaError_t err = cudaGetDeviceCount(&deviceCount);
     if (err != cudaSuccess || deviceCount == 0) {
-        bm_set_last_error("[CUDA] Нет доступных GPU");
+        BM_SET_ERROR("[CUDA] Нет доступных GPU");
         return NULL;
     }
 
-    BMDevice* dev = (BMDevice*)malloc(sizeof(BMDevice));
+    BMDevice* dev = bm_handle_alloc_device();
     if (!dev) {
-        bm_set_last_error("[CUDA] Ошибка выделения памяти для BMDevice");
+        BM_SET_ERROR("[CUDA] Ошибка выделения памяти для BMDevice");
         return NULL;
     }
 
@@ -47,7 +51,7 @@ BMDevice* bm_backend_create_device(BMComputeTarget type) {
 void bm_backend_destroy_device(BMDevice* device) {
     if (!device) return;
     bm_log_info("[CUDA] Устройство уничтожено: %s", device->name);
-    free(device);
+    bm_handle_free_device(device);
 }
 
 // ----------------------------------------
@@ -55,22 +59,23 @@ void bm_backend_destroy_device(BMDevice* device) {
 // ----------------------------------------
 BMBuffer* bm_backend_alloc_buffer(BMDevice* device, size_t size) {
     if (!device || size == 0) {
-        bm_set_last_error("[CUDA] alloc_buffer: некорректные аргументы");
+        BM_SET_ERROR("[CUDA] alloc_buffer: некорректные аргументы");
         return NULL;
     }
 
-    BMBuffer* buf = (BMBuffer*)malloc(sizeof(BMBuffer));
+    BMBuffer* buf = bm_handle_alloc_buffer();
     if (!buf) {
-        bm_set_last_error("[CUDA] Ошибка выделения памяти для BMBuffer");
+        BM_SET_ERROR("[CUDA] Ошибка выделения памяти для BMBuffer");
         return NULL;
     }
 
     buf->device = device;
+    buf->backend = BM_NVIDIA;
     buf->size = size;
     cudaError_t err = cudaMalloc(&buf->gpu_ptr, size);
     if (err != cudaSuccess) {
-        bm_set_last_error("[CUDA] Ошибка cudaMalloc: %s", cudaGetErrorString(err));
-        free(buf);
+        BM_SET_ERROR("[CUDA] Ошибка cudaMalloc: %s", cudaGetErrorString(err));
+        bm_handle_free_buffer(buf);
         return NULL;
     }
 
@@ -78,48 +83,237 @@ BMBuffer* bm_backend_alloc_buffer(BMDevice* device, size_t size) {
     return buf;
 }
 
+// Zero-copy: host-память регистрируется как mapped, ядро читает её по PCIe
+BMBuffer* bm_backend_wrap_host(BMDevice* device, void* ptr, size_t size, unsigned flags) {
+    if (!device || !ptr || size == 0) {
+        BM_SET_ERROR("[CUDA] wrap_host: некорректные аргументы");
+        return NULL;
+    }
+
+    BMBuffer* buf = bm_handle_alloc_buffer();
+    if (!buf) {
+        BM_SET_ERROR("[CUDA] Ошибка выделения памяти для BMBuffer");
+        return NULL;
+    }
+
+    cudaError_t err = cudaHostRegister(ptr, size, cudaHostRegisterMapped);
+    if (err == cudaSuccess) err = cudaHostGetDevicePointer(&buf->gpu_ptr, ptr, 0);
+    if (err != cudaSuccess) {
+        BM_SET_ERROR("[CUDA] wrap_host: %s", cudaGetErrorString(err));
+        cudaHostUnregister(ptr);
+        bm_handle_free_buffer(buf);
+        return NULL;
+    }
+
+    buf->device = device;
+    buf->backend = BM_NVIDIA;
+    buf->size = size;
+    buf->backend_ptr = ptr; // host-адрес для cudaHostUnregister
+    buf->flags = BM_BUFFER_WRAPPED | ((flags & BM_WRAP_ADOPT) ? BM_BUFFER_ADOPTED : 0u);
+
+    bm_log_info("[CUDA] Обёрнут host-буфер %zu байт (zero-copy)", size);
+    return buf;
+}
+
 void bm_backend_free_buffer(BMBuffer* buffer) {
     if (!buffer) return;
-    if (buffer->gpu_ptr) cudaFree(buffer->gpu_ptr);
+    if (buffer->flags & BM_BUFFER_WRAPPED) {
+        cudaHostUnregister(buffer->backend_ptr);
+        if (buffer->flags & BM_BUFFER_ADOPTED) bm_cpu_free(buffer->backend_ptr);
+    } else if (buffer->gpu_ptr) {
+        cudaFree(buffer->gpu_ptr);
+    }
     bm_log_info("[CUDA] Освобождён буфер %zu байт", buffer->size);
-    free(buffer);
+    bm_handle_free_buffer(buffer);
 }
 
 // ----------------------------------------
 // Загрузка/скачивание данных
 // ----------------------------------------
-BMStatus bm_backend_upload_data(BMBuffer* buffer, const void* data) {
-    if (!buffer || !buffer->gpu_ptr || !data) {
-        bm_set_last_error("[CUDA] upload_data: некорректные аргументы");
+// Видна с host только обёрнутая (mapped) память; остальное — через staging
+void* bm_backend_host_ptr(BMBuffer* buffer) {
+    if (!buffer || !(buffer->flags & BM_BUFFER_WRAPPED)) return NULL;
+    return buffer->backend_ptr;
+}
+
+// Page-locked память: cudaMemcpy идёт DMA напрямую, без промежуточной копии драйвера
+BMStatus bm_backend_pin_host(BMDevice* device, void* ptr, size_t size) {
+    (void)device;
+    cudaError_t err = cudaHostRegister(ptr, size, cudaHostRegisterPortable);
+    if (err != cudaSuccess) {
+        BM_SET_ERROR("[CUDA] pin_host: %s", cudaGetErrorString(err));
+        return BM_STATUS_ERROR;
+    }
+    return BM_STATUS_OK;
+}
+
+void bm_backend_unpin_host(BMDevice* device, void* ptr, size_t size) {
+    (void)device;
+    (void)size;
+    cudaHostUnregister(ptr);
+}
+
+BMStatus bm_backend_upload_range(BMBuffer* buffer, const void* data, size_t offset, size_t size) {
+    if (!buffer || !buffer->gpu_ptr || !data || offset > buffer->size || size > buffer->size - offset) {
+        BM_SET_ERROR("[CUDA] upload_range: некорректные аргументы");
         return BM_STATUS_ERROR;
     }
 
-    cudaError_t err = cudaMemcpy(buffer->gpu_ptr, data, buffer->size, cudaMemcpyHostToDevice);
+    cudaError_t err = cudaMemcpy((char*)buffer->gpu_ptr + offset, data, size, cudaMemcpyHostToDevice);
     if (err != cudaSuccess) {
-        bm_set_last_error("[CUDA] upload_data: %s", cudaGetErrorString(err));
+        BM_SET_ERROR("[CUDA] upload_range: %s", cudaGetErrorString(err));
         return BM_STATUS_ERROR;
     }
 
-    bm_log_debug("[CUDA] Загружены данные в буфер (%zu байт)", buffer->size);
+    bm_log_debug("[CUDA] Загружены данные в буфер (%zu байт, offset=%zu)", size, offset);
     return BM_STATUS_OK;
 }
 
-BMStatus bm_backend_download_data(BMBuffer* buffer, void* data) {
-    if (!buffer || !buffer->gpu_ptr || !data) {
-        bm_set_last_error("[CUDA] download_data: некорректные аргументы");
+BMStatus bm_backend_download_range(BMBuffer* buffer, void* data, size_t offset, size_t size) {
+    if (!buffer || !buffer->gpu_ptr || !data || offset > buffer->size || size > buffer->size - offset) {
+        BM_SET_ERROR("[CUDA] download_range: некорректные аргументы");
         return BM_STATUS_ERROR;
     }
 
-    cudaError_t err = cudaMemcpy(data, buffer->gpu_ptr, buffer->size, cudaMemcpyDeviceToHost);
+    cudaError_t err = cudaMemcpy(data, (const char*)buffer->gpu_ptr + offset, size, cudaMemcpyDeviceToHost);
     if (err != cudaSuccess) {
-        bm_set_last_error("[CUDA] download_data: %s", cudaGetErrorString(err));
+        BM_SET_ERROR("[CUDA] download_range: %s", cudaGetErrorString(err));
         return BM_STATUS_ERROR;
     }
 
-    bm_log_debug("[CUDA] Скачаны данные из буфера (%zu байт)", buffer->size);
+    bm_log_debug("[CUDA] Скачаны данные из буфера (%zu байт, offset=%zu)", size, offset);
     return BM_STATUS_OK;
 }
 
+// ----------------------------------------
+// Scatter/gather
+// ----------------------------------------
+// Фрагменты упаковываются в одну pinned-область и уходят асинхронными копиями
+// в одном stream с одной синхронизацией. Соседние по offset фрагменты сливаются
+// в одну копию; при скачивании сливаются и фрагменты с небольшим зазором
+// (лишние байты дешевле отдельной DMA-транзакции).
+#define BM_CUDA_GATHER_GAP (64 * 1024)
+
+typedef struct BMCudaRun {
+    size_t offset;   // начало диапазона в буфере
+    size_t size;
+    size_t staging;  // смещение в pinned-области
+} BMCudaRun;
+
+static int check_regions(BMBuffer* buffer, const BMTransferRegion* regions, size_t count, size_t* total) {
+    *total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!regions[i].host || regions[i].offset > buffer->size ||
+            regions[i].size > buffer->size - regions[i].offset)
+            return 0;
+        *total += regions[i].size;
+    }
+    return 1;
+}
+
+// Разбивка фрагментов (в порядке вызывающего) на непрерывные диапазоны копий;
+// placement[i] — смещение фрагмента i в pinned-области
+static size_t build_runs(const BMTransferRegion* regions, size_t count, size_t max_gap,
+                         BMCudaRun* runs, size_t* placement) {
+    size_t run_count = 0;
+    size_t staging = 0;
+    for (size_t i = 0; i < count; ++i) {
+        BMCudaRun* last = run_count ? &runs[run_count - 1] : NULL;
+        size_t end = last ? last->offset + last->size : 0;
+        if (last && regions[i].offset >= end && regions[i].offset - end <= max_gap) {
+            placement[i] = last->staging + (regions[i].offset - last->offset);
+            size_t grow = regions[i].offset + regions[i].size - end;
+            last->size += grow;
+            staging += grow;
+            continue;
+        }
+        runs[run_count].offset = regions[i].offset;
+        runs[run_count].size = regions[i].size;
+        runs[run_count].staging = staging;
+        placement[i] = staging;
+        staging += regions[i].size;
+        ++run_count;
+    }
+    return run_count;
+}
+
+static BMStatus transfer_regions(BMBuffer* buffer, const BMTransferRegion* regions, size_t count, int upload) {
+    const char* what = upload ? "upload_regions" : "download_regions";
+    size_t total = 0;
+    if (!buffer || !buffer->gpu_ptr || (!regions && count) || !check_regions(buffer, regions, count, &total)) {
+        BM_SET_ERROR("[CUDA] %s: некорректные аргументы", what);
+        return BM_STATUS_ERROR;
+    }
+    if (count == 0 || total == 0) return BM_STATUS_OK;
+
+    BMCudaRun* runs = (BMCudaRun*)malloc((sizeof(BMCudaRun) + sizeof(size_t)) * count);
+    if (!runs) {
+        BM_SET_ERROR("[CUDA] %s: нет памяти", what);
+        return BM_STATUS_ERROR;
+    }
+    // Запись в зазоры испортила бы данные устройства — при загрузке сливаем только стык в стык
+    size_t* placement = (size_t*)(runs + count);
+    size_t run_count = build_runs(regions, count, upload ? 0 : BM_CUDA_GATHER_GAP, runs, placement);
+    size_t staging_size = runs[run_count - 1].staging + runs[run_count - 1].size;
+
+    char* staging = NULL;
+    cudaStream_t stream = NULL;
+    cudaError_t err = cudaMallocHost((void**)&staging, staging_size);
+    if (err == cudaSuccess) err = cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking);
+
+    if (err == cudaSuccess && upload) {
+        for (size_t i = 0; i < count; ++i)
+            memcpy(staging + placement[i], regions[i].host, regions[i].size);
+    }
+    for (size_t r = 0; r < run_count && err == cudaSuccess; ++r) {
+        char* dev = (char*)buffer->gpu_ptr + runs[r].offset;
+        err = upload
+            ? cudaMemcpyAsync(dev, staging + runs[r].staging, runs[r].size, cudaMemcpyHostToDevice, stream)
+            : cudaMemcpyAsync(staging + runs[r].staging, dev, runs[r].size, cudaMemcpyDeviceToHost, stream);
+    }
+    if (err == cudaSuccess) err = cudaStreamSynchronize(stream);
+    if (err == cudaSuccess && !upload) {
+        for (size_t i = 0; i < count; ++i)
+            memcpy(regions[i].host, staging + placement[i], regions[i].size);
+    }
+
+    if (stream) cudaStreamDestroy(stream);
+    if (staging) cudaFreeHost(staging);
+    free(runs);
+
+    if (err != cudaSuccess) {
+        BM_SET_ERROR("[CUDA] %s: %s", what, cudaGetErrorString(err));
+        return BM_STATUS_ERROR;
+    }
+
+    bm_log_debug("[CUDA] %s: %zu фрагментов, %zu копий, %zu байт", what, count, run_count, total);
+    return BM_STATUS_OK;
+}
+
+BMStatus bm_backend_upload_regions(BMBuffer* buffer, const BMTransferRegion* regions, size_t count) {
+    return transfer_regions(buffer, regions, count, 1);
+}
+
+BMStatus bm_backend_download_regions(BMBuffer* buffer, const BMTransferRegion* regions, size_t count) {
+    return transfer_regions(buffer, regions, count, 0);
+}
+
+BMStatus bm_backend_upload_data(BMBuffer* buffer, const void* data) {
+    if (!buffer) {
+        BM_SET_ERROR("[CUDA] upload_data: некорректные аргументы");
+        return BM_STATUS_ERROR;
+    }
+    return bm_backend_upload_range(buffer, data, 0, buffer->size);
+}
+
+BMStatus bm_backend_download_data(BMBuffer* buffer, void* data) {
+    if (!buffer) {
+        BM_SET_ERROR("[CUDA] download_data: некорректные аргументы");
+        return BM_STATUS_ERROR;
+    }
+    return bm_backend_download_range(buffer, data, 0, buffer->size);
+}
+
 // ----------------------------------------
 // Ядра
 // ----------------------------------------
@@ -127,24 +321,25 @@ BMKernel* bm_backend_load_kernel(BMDevice* device, const char* kernel_path) {
     (void)device;
     (void)kernel_path;
 
-    BMKernel* kernel = (BMKernel*)malloc(sizeof(BMKernel));
+    BMKernel* kernel = bm_handle_alloc_kernel();
     if (!kernel) {
-        bm_set_last_error("[CUDA] Ошибка выделения памяти для BMKernel");
+        BM_SET_ERROR("[CUDA] Ошибка выделения памяти для BMKernel");
         return NULL;
     }
 
     kernel->device = device;
+    kernel->type = BM_NVIDIA;
     kernel->kernel_ptr = (void*)double_kernel_cuda;
     kernel->cpu_func = NULL; // CPU fallback можно назначить
-    snprintf(kernel->name, sizeof(kernel->name), "double_kernel_cuda");
+    snprintf(kernel->cold->name, sizeof(kernel->cold->name), "double_kernel_cuda");
 
-    bm_log_info("[CUDA] Kernel загружен: %s", kernel->name);
+    bm_log_info("[CUDA] Kernel загружен: %s", kernel->cold->name);
     return kernel;
 }
 
 BMStatus bm_backend_run_kernel(BMKernel* kernel, BMBuffer* buffer, size_t count) {
     if (!kernel || !buffer || !buffer->gpu_ptr) {
-        bm_set_last_error("[CUDA] run_kernel: некорректные аргументы");
+        BM_SET_ERROR("[CUDA] run_kernel: некорректные аргументы");
         return BM_STATUS_ERROR;
     }
 
@@ -154,18 +349,18 @@ BMStatus bm_backend_run_kernel(BMKernel* kernel, BMBuffer* buffer, size_t count)
     double_kernel_cuda<<<blocks, threads>>>((float*)buffer->gpu_ptr, count);
     cudaError_t err = cudaDeviceSynchronize();
     if (err != cudaSuccess) {
-        bm_set_last_error("[CUDA] run_kernel: %s", cudaGetErrorString(err));
+        BM_SET_ERROR("[CUDA] run_kernel: %s", cudaGetErrorString(err));
         return BM_STATUS_ERROR;
     }
 
-    bm_log_info("[CUDA] Kernel выполнен на %zu элементов", count);
+    bm_log_debug("[CUDA] Kernel выполнен на %zu элементов", count);
     return BM_STATUS_OK;
 }
 
 void bm_backend_destroy_kernel(BMKernel* kernel) {
     if (!kernel) return;
-    bm_log_info("[CUDA] Kernel уничтожен: %s", kernel->name);
-    free(kernel);
+    bm_log_info("[CUDA] Kernel уничтожен: %s", kernel->cold->name);
+    bm_handle_free_kernel(kernel);
 }
 
 // ----------------------------------------
@@ -176,7 +371,7 @@ BMStatus bm_backend_sync(BMDevice* device) {
 
     cudaError_t err = cudaDeviceSynchronize();
     if (err != cudaSuccess) {
-        bm_set_last_error("[CUDA] sync: %s", cudaGetErrorString(err));
+        BM_SET_ERROR("[CUDA] sync: %s", cudaGetErrorString(err));
         return BM_STATUS_ERROR;
     }
 
@@ -193,7 +388,7 @@ BMStatus bm_backend_query_device(BMDevice* device, BMDeviceInfo* info) {
     cudaDeviceProp prop;
     cudaError_t err = cudaGetDeviceProperties(&prop, device->id);
     if (err != cudaSuccess) {
-        bm_set_last_error("[CUDA] query_device: %s", cudaGetErrorString(err));
+        BM_SET_ERROR("[CUDA] query_device: %s", cudaGetErrorString(err));
         return BM_STATUS_ERROR;
     }
 
@@ -0,0 +1,569 @@
+// bm_alloc_track.c
+#include "burymetal.h"
+#include "bm_utils.h"
+#include "bm_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define THREAD_LOCAL __declspec(thread)
+#else
+#include <pthread.h>
+#define THREAD_LOCAL __thread
+#endif
+
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#define BM_HAVE_BACKTRACE 1
+#endif
+
+// ----------------------------------------
+// Учёт выделений
+// ----------------------------------------
+// Живые выделения — хеш-таблица с открытой адресацией по адресу (буфер —
+// по BMBuffer*, host/device-память — по указателю), удаление сдвигом назад.
+// Места — массив с цепочками по корзинам; ключ — вид, метка потока и стек.
+// Всё под одним мьютексом: учёт включают для диагностики, не в бою.
+// Стек собирается до мьютекса.
+
+#define BM_ALLOC_TRACK_SITE_BUCKETS 256
+#define BM_ALLOC_TRACK_INITIAL_LIVE 1024
+#define BM_ALLOC_TRACK_LEAK_SAMPLES 8       // сколько утечек устройства расписать в логе
+
+typedef struct {
+    const void* ptr;                // NULL — слот пуст
+    size_t size;
+    const BMDevice* device;
+    uint32_t site;
+} BMLiveAlloc;
+
+typedef struct {
+    BMAllocSite info;
+    uint64_t hash;
+    int32_t next;                   // следующее место в корзине, -1 — конец
+} BMSiteEntry;
+
+typedef struct {
+    const BMDevice* device;         // NULL — host-память (bm_cpu_alloc)
+    BMComputeTarget type;
+    BMAllocUsage usage;
+} BMDeviceUsage;
+
+int bm_alloc_track_active = 0;
+
+// Под track_lock
+static unsigned stack_depth = 0;
+static BMAllocUsage total;
+static BMLiveAlloc* live = NULL;
+static size_t live_capacity = 0;    // степень двойки
+static size_t live_count = 0;
+static BMSiteEntry* sites = NULL;
+static size_t site_count = 0;
+static size_t site_capacity = 0;
+static int32_t site_buckets[BM_ALLOC_TRACK_SITE_BUCKETS];
+static BMDeviceUsage* devices = NULL;
+static size_t device_count = 0;
+static size_t device_capacity = 0;
+
+static THREAD_LOCAL unsigned suspended = 0;
+static THREAD_LOCAL const char* thread_tag = NULL;
+
+#ifdef _WIN32
+static INIT_ONCE track_once = INIT_ONCE_STATIC_INIT;
+static CRITICAL_SECTION track_lock;
+
+static BOOL CALLBACK track_init(PINIT_ONCE once, PVOID param, PVOID* context) {
+    (void)once; (void)param; (void)context;
+    InitializeCriticalSection(&track_lock);
+    return TRUE;
+}
+
+static void lock_track(void) {
+    InitOnceExecuteOnce(&track_once, track_init, NULL, NULL);
+    EnterCriticalSection(&track_lock);
+}
+
+static void unlock_track(void) { LeaveCriticalSection(&track_lock); }
+#else
+static pthread_mutex_t track_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void lock_track(void) { pthread_mutex_lock(&track_lock); }
+static void unlock_track(void) { pthread_mutex_unlock(&track_lock); }
+#endif
+
+// ----------------------------------------
+// Счётчики
+// ----------------------------------------
+static void usage_add(BMAllocUsage* usage, size_t size) {
+    usage->allocations++;
+    usage->live_count++;
+    usage->live_bytes += size;
+    if (usage->live_bytes > usage->peak_bytes) usage->peak_bytes = usage->live_bytes;
+}
+
+static void usage_sub(BMAllocUsage* usage, size_t size) {
+    usage->live_count--;
+    usage->live_bytes -= size;
+}
+
+static BMDeviceUsage* device_usage(const BMDevice* device, int create) {
+    for (size_t i = 0; i < device_count; ++i)
+        if (devices[i].device == device) return &devices[i];
+    if (!create) return NULL;
+
+    if (device_count == device_capacity) {
+        size_t capacity = device_capacity ? device_capacity * 2 : 8;
+        BMDeviceUsage* grown = (BMDeviceUsage*)realloc(devices, capacity * sizeof(BMDeviceUsage));
+        if (!grown) return NULL;
+        devices = grown;
+        device_capacity = capacity;
+    }
+    BMDeviceUsage* slot = &devices[device_count++];
+    memset(slot, 0, sizeof(*slot));
+    slot->device = device;
+    slot->type = device ? device->type : BM_CPU;
+    return slot;
+}
+
+// ----------------------------------------
+// Таблица живых выделений
+// ----------------------------------------
+static size_t live_slot(const void* ptr) {
+    uint64_t h = ((uint64_t)(uintptr_t)ptr >> 4) * 0x9E3779B97F4A7C15ull;
+    return (size_t)(h >> 32) & (live_capacity - 1);
+}
+
+static BMLiveAlloc* live_find(const void* ptr) {
+    if (!live_capacity) return NULL;
+    for (size_t i = live_slot(ptr);; i = (i + 1) & (live_capacity - 1)) {
+        if (live[i].ptr == ptr) return &live[i];
+        if (!live[i].ptr) return NULL;
+    }
+}
+
+static void live_put(const BMLiveAlloc* entry) {
+    size_t i = live_slot(entry->ptr);
+    while (live[i].ptr) i = (i + 1) & (live_capacity - 1);
+    live[i] = *entry;
+    live_count++;
+}
+
+static int live_grow(void) {
+    size_t capacity = live_capacity ? live_capacity * 2 : BM_ALLOC_TRACK_INITIAL_LIVE;
+    BMLiveAlloc* old = live;
+    size_t old_capacity = live_capacity;
+    BMLiveAlloc* table = (BMLiveAlloc*)calloc(capacity, sizeof(BMLiveAlloc));
+    if (!table) return 0;
+
+    live = table;
+    live_capacity = capacity;
+    live_count = 0;
+    for (size_t i = 0; i < old_capacity; ++i)
+        if (old[i].ptr) live_put(&old[i]);
+    free(old);
+    return 1;
+}
+
+// Удаление со сдвигом назад: цепочки проб остаются без дыр
+static void live_erase(BMLiveAlloc* entry) {
+    size_t hole = (size_t)(entry - live);
+    size_t mask = live_capacity - 1;
+    for (size_t i = (hole + 1) & mask; live[i].ptr; i = (i + 1) & mask) {
+        size_t home = live_slot(live[i].ptr);
+        // Элемент можно поднять в дыру, если его место не между дырой и им
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            live[hole] = live[i];
+            hole = i;
+        }
+    }
+    live[hole].ptr = NULL;
+    live_count--;
+}
+
+// Убрать живое выделение из всех счётчиков (записи в таблице не трогает)
+static void account_free(const BMLiveAlloc* entry) {
+    BMAllocSite* site = &sites[entry->site].info;
+    site->live_count--;
+    site->live_bytes -= entry->size;
+    usage_sub(&total, entry->size);
+    BMDeviceUsage* dev = device_usage(entry->device, 0);
+    if (dev) usage_sub(&dev->usage, entry->size);
+}
+
+// ----------------------------------------
+// Места выделения
+// ----------------------------------------
+static uint64_t site_hash(BMAllocKind kind, const char* tag, void* const* frames, unsigned count) {
+    uint64_t h = 1469598103934665603ull;   // FNV-1a по словам
+    h = (h ^ (uint64_t)kind) * 1099511628211ull;
+    h = (h ^ (uint64_t)(uintptr_t)tag) * 1099511628211ull;
+    for (unsigned i = 0; i < count; ++i) h = (h ^ (uint64_t)(uintptr_t)frames[i]) * 1099511628211ull;
+    return h;
+}
+
+static int32_t site_find_or_add(BMAllocKind kind, const char* tag, void* const* frames, unsigned count) {
+    uint64_t hash = site_hash(kind, tag, frames, count);
+    int32_t* bucket = &site_buckets[hash % BM_ALLOC_TRACK_SITE_BUCKETS];
+    for (int32_t i = *bucket; i >= 0; i = sites[i].next) {
+        const BMAllocSite* s = &sites[i].info;
+        if (sites[i].hash == hash && s->kind == kind && s->tag == tag && s->frame_count == count &&
+            memcmp(s->frames, frames, count * sizeof(void*)) == 0)
+            return i;
+    }
+
+    if (site_count == site_capacity) {
+        size_t capacity = site_capacity ? site_capacity * 2 : 64;
+        BMSiteEntry* grown = (BMSiteEntry*)realloc(sites, capacity * sizeof(BMSiteEntry));
+        if (!grown) return -1;
+        sites = grown;
+        site_capacity = capacity;
+    }
+    BMSiteEntry* entry = &sites[site_count];
+    memset(entry, 0, sizeof(*entry));
+    entry->info.kind = kind;
+    entry->info.tag = tag;
+    entry->info.frame_count = count;
+    memcpy(entry->info.frames, frames, count * sizeof(void*));
+    entry->hash = hash;
+    entry->next = *bucket;
+    *bucket = (int32_t)site_count;
+    return (int32_t)site_count++;
+}
+
+// ----------------------------------------
+// Точки выделения
+// ----------------------------------------
+int bm_alloc_track_suspend(void) {
+    ++suspended;
+    return 1;
+}
+
+void bm_alloc_track_resume(const void* ptr, size_t size, BMDevice* device, BMAllocKind kind) {
+    if (--suspended || !ptr) return;
+
+    void* frames[BM_ALLOC_TRACK_MAX_FRAMES + 1];
+    unsigned count = 0;
+#ifdef BM_HAVE_BACKTRACE
+    unsigned depth = __atomic_load_n(&stack_depth, __ATOMIC_RELAXED);
+    if (depth) {
+        // Кадр 0 — эта функция, дальше — функция выделения и её вызывающие
+        int got = backtrace(frames, (int)depth + 1);
+        count = got > 1 ? (unsigned)got - 1 : 0;
+        memmove(frames, frames + 1, count * sizeof(void*));
+    }
+#endif
+
+    lock_track();
+    if (!__atomic_load_n(&bm_alloc_track_active, __ATOMIC_RELAXED)) {
+        unlock_track();
+        return;
+    }
+
+    // Адрес мог освободиться мимо учёта (например, до его включения)
+    BMLiveAlloc* stale = live_find(ptr);
+    if (stale) {
+        account_free(stale);
+        live_erase(stale);
+    }
+
+    int32_t site = site_find_or_add(kind, thread_tag, frames, count);
+    BMDeviceUsage* dev = device_usage(device, 1);
+    if (site < 0 || !dev || ((live_count + 1) * 2 > live_capacity && !live_grow())) {
+        unlock_track();
+        bm_log(BM_LOG_WARN, "Учёт выделений: не хватило памяти, выделение %p не учтено", ptr);
+        return;
+    }
+
+    BMLiveAlloc entry = { ptr, size, device, (uint32_t)site };
+    live_put(&entry);
+    usage_add(&total, size);
+    usage_add(&dev->usage, size);
+    BMAllocSite* s = &sites[site].info;
+    s->allocations++;
+    s->total_bytes += size;
+    s->live_count++;
+    s->live_bytes += size;
+    if (s->live_bytes > s->peak_bytes) s->peak_bytes = s->live_bytes;
+    unlock_track();
+}
+
+void bm_alloc_track_remove(const void* ptr) {
+    if (!ptr) return;
+    lock_track();
+    BMLiveAlloc* entry = live_find(ptr);
+    if (entry) {
+        account_free(entry);
+        live_erase(entry);
+    }
+    unlock_track();
+}
+
+static const char* kind_name(BMAllocKind kind) {
+    switch (kind) {
+        case BM_ALLOC_KIND_HOST:   return "host";
+        case BM_ALLOC_KIND_DEVICE: return "device";
+        case BM_ALLOC_KIND_BUFFER: return "buffer";
+        case BM_ALLOC_KIND_POOL:   return "pool";
+    }
+    return "?";
+}
+
+typedef struct {
+    size_t size;
+    BMAllocKind kind;
+    const char* tag;
+    void* frame;                    // первый кадр за функцией выделения
+} BMLeakSample;
+
+void bm_alloc_track_device_destroy(BMDevice* device) {
+    BMLeakSample samples[BM_ALLOC_TRACK_LEAK_SAMPLES];
+    size_t leaked = 0;
+    uint64_t leaked_bytes = 0;
+
+    lock_track();
+    // После сдвига назад в слот i мог попасть следующий элемент — i не растёт
+    for (size_t i = 0; i < live_capacity;) {
+        BMLiveAlloc* entry = &live[i];
+        if (!entry->ptr || entry->device != device) {
+            ++i;
+            continue;
+        }
+        const BMAllocSite* site = &sites[entry->site].info;
+        if (leaked < BM_ALLOC_TRACK_LEAK_SAMPLES) {
+            BMLeakSample* sample = &samples[leaked];
+            sample->size = entry->size;
+            sample->kind = site->kind;
+            sample->tag = site->tag;
+            sample->frame = site->frame_count > 1 ? site->frames[1] : NULL;
+        }
+        ++leaked;
+        leaked_bytes += entry->size;
+        account_free(entry);
+        live_erase(entry);
+    }
+    total.leaked_count += leaked;
+    total.leaked_bytes += leaked_bytes;
+
+    // Адрес устройства может достаться новому — его счётчики начинаются заново
+    BMDeviceUsage* dev = device_usage(device, 0);
+    if (dev) *dev = devices[--device_count];
+    int report = __atomic_load_n(&bm_alloc_track_active, __ATOMIC_RELAXED) && leaked;
+    unlock_track();
+    if (!report) return;
+
+    bm_log(BM_LOG_WARN, "bm_destroy_device: живыми остались %zu выделений устройства (%llu байт)",
+           leaked, (unsigned long long)leaked_bytes);
+    size_t shown = leaked < BM_ALLOC_TRACK_LEAK_SAMPLES ? leaked : BM_ALLOC_TRACK_LEAK_SAMPLES;
+    for (size_t i = 0; i < shown; ++i) {
+        const BMLeakSample* sample = &samples[i];
+        char where[256] = "";
+#ifdef BM_HAVE_BACKTRACE
+        char** symbols = sample->frame ? backtrace_symbols(&sample->frame, 1) : NULL;
+        if (symbols) {
+            snprintf(where, sizeof(where), "%s", symbols[0]);
+            free(symbols);
+        }
+#endif
+        bm_log(BM_LOG_WARN, "  %s %zu байт, метка %s%s%s", kind_name(sample->kind), sample->size,
+               sample->tag ? sample->tag : "-", where[0] ? ", из " : "", where);
+    }
+}
+
+// ----------------------------------------
+// Управление
+// ----------------------------------------
+static void reset_locked(void) {
+    free(live);
+    free(sites);
+    free(devices);
+    live = NULL;
+    sites = NULL;
+    devices = NULL;
+    live_capacity = live_count = 0;
+    site_count = site_capacity = 0;
+    device_count = device_capacity = 0;
+    memset(&total, 0, sizeof(total));
+    for (size_t i = 0; i < BM_ALLOC_TRACK_SITE_BUCKETS; ++i) site_buckets[i] = -1;
+}
+
+BMResult bm_alloc_track_start(unsigned stack_frames) {
+#ifdef BM_HAVE_BACKTRACE
+    // Первый backtrace подгружает libgcc — не под мьютексом и не в выделении
+    void* warm[2];
+    if (stack_frames) backtrace(warm, 2);
+#endif
+
+    lock_track();
+    if (__atomic_load_n(&bm_alloc_track_active, __ATOMIC_RELAXED)) {
+        unlock_track();
+        BM_SET_ERROR("bm_alloc_track_start: учёт уже включён");
+        return BM_ERROR_INVALID_ARG;
+    }
+    reset_locked();
+#ifdef BM_HAVE_BACKTRACE
+    stack_depth = stack_frames < BM_ALLOC_TRACK_MAX_FRAMES ? stack_frames : BM_ALLOC_TRACK_MAX_FRAMES;
+#else
+    stack_depth = 0;
+#endif
+    __atomic_store_n(&bm_alloc_track_active, 1, __ATOMIC_RELEASE);
+    unlock_track();
+
+    bm_log(BM_LOG_INFO, "Учёт выделений включён (стек %u кадров)", stack_depth);
+    return BM_OK;
+}
+
+BMResult bm_alloc_track_stop(void) {
+    lock_track();
+    if (!__atomic_load_n(&bm_alloc_track_active, __ATOMIC_RELAXED)) {
+        unlock_track();
+        BM_SET_ERROR("bm_alloc_track_stop: учёт не включён");
+        return BM_ERROR_INVALID_ARG;
+    }
+    __atomic_store_n(&bm_alloc_track_active, 0, __ATOMIC_RELEASE);
+    unlock_track();
+    return BM_OK;
+}
+
+const char* bm_alloc_set_tag(const char* tag) {
+    const char* previous = thread_tag;
+    thread_tag = tag;
+    return previous;
+}
+
+// ----------------------------------------
+// Итоги
+// ----------------------------------------
+BMResult bm_alloc_track_usage(const BMDevice* device, BMAllocUsage* usage) {
+    if (!usage) return BM_ERROR_INVALID_ARG;
+
+    lock_track();
+    if (!device) {
+        *usage = total;
+    } else {
+        BMDeviceUsage* dev = device_usage(device, 0);
+        if (dev) *usage = dev->usage;
+        else memset(usage, 0, sizeof(*usage));
+    }
+    unlock_track();
+    return BM_OK;
+}
+
+static int compare_peak(const void* a, const void* b) {
+    const BMAllocSite* x = (const BMAllocSite*)a;
+    const BMAllocSite* y = (const BMAllocSite*)b;
+    if (x->peak_bytes != y->peak_bytes) return x->peak_bytes < y->peak_bytes ? 1 : -1;
+    if (x->total_bytes != y->total_bytes) return x->total_bytes < y->total_bytes ? 1 : -1;
+    return 0;
+}
+
+size_t bm_alloc_track_sites(BMAllocSite* out, size_t capacity) {
+    lock_track();
+    size_t count = site_count;
+    if (!out || !capacity || !count) {
+        unlock_track();
+        return count;
+    }
+
+    BMAllocSite* sorted = (BMAllocSite*)malloc(count * sizeof(BMAllocSite));
+    if (!sorted) {
+        unlock_track();
+        BM_SET_ERROR("bm_alloc_track_sites: не удалось выделить память");
+        return 0;
+    }
+    for (size_t i = 0; i < count; ++i) sorted[i] = sites[i].info;
+    unlock_track();
+
+    qsort(sorted, count, sizeof(BMAllocSite), compare_peak);
+    memcpy(out, sorted, (count < capacity ? count : capacity) * sizeof(BMAllocSite));
+    free(sorted);
+    return count;
+}
+
+static const char* format_bytes(uint64_t bytes, char* out, size_t size) {
+    static const char* units[] = { "B", "KiB", "MiB", "GiB", "TiB" };
+    double value = (double)bytes;
+    unsigned unit = 0;
+    while (value >= 1024.0 && unit < 4) {
+        value /= 1024.0;
+        ++unit;
+    }
+    if (unit == 0) snprintf(out, size, "%llu B", (unsigned long long)bytes);
+    else snprintf(out, size, "%.2f %s", value, units[unit]);
+    return out;
+}
+
+static const char* target_name(BMComputeTarget type) {
+    switch (type) {
+        case BM_CPU:    return "CPU";
+        case BM_NVIDIA: return "NVIDIA";
+        case BM_AMD:    return "AMD";
+        case BM_INTEL:  return "Intel";
+        default:        return "auto";
+    }
+}
+
+BMResult bm_alloc_track_report(const char* path, size_t top) {
+    size_t count = bm_alloc_track_sites(NULL, 0);
+    BMAllocSite* rows = (BMAllocSite*)calloc(count ? count : 1, sizeof(BMAllocSite));
+    if (!rows) {
+        BM_SET_ERROR("bm_alloc_track_report: не удалось выделить память");
+        return BM_ERROR_NOMEM;
+    }
+    // Между двумя вызовами могли появиться новые места — берём сколько влезло
+    size_t total_sites = bm_alloc_track_sites(rows, count);
+    if (total_sites > count) total_sites = count;
+    if (top && top < total_sites) total_sites = top;
+
+    FILE* f = path ? fopen(path, "w") : stdout;
+    if (!f) {
+        free(rows);
+        BM_SET_ERROR("bm_alloc_track_report: не удалось открыть %s", path);
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    char live_buf[32], peak_buf[32], extra_buf[32];
+    lock_track();
+    fprintf(f, "allocations: %llu, live %llu (%s), peak %s, leaked at device destroy %llu (%s)\n",
+            (unsigned long long)total.allocations, (unsigned long long)total.live_count,
+            format_bytes(total.live_bytes, live_buf, sizeof(live_buf)),
+            format_bytes(total.peak_bytes, peak_buf, sizeof(peak_buf)),
+            (unsigned long long)total.leaked_count, format_bytes(total.leaked_bytes, extra_buf, sizeof(extra_buf)));
+    fprintf(f, "%-28s %12s %10s %14s %14s\n", "device", "allocations", "live", "live_bytes", "peak_bytes");
+    for (size_t i = 0; i < device_count; ++i) {
+        const BMDeviceUsage* dev = &devices[i];
+        char name[32];
+        if (dev->device) snprintf(name, sizeof(name), "%s %p", target_name(dev->type), (const void*)dev->device);
+        else snprintf(name, sizeof(name), "host");
+        fprintf(f, "%-28s %12llu %10llu %14s %14s\n", name, (unsigned long long)dev->usage.allocations,
+                (unsigned long long)dev->usage.live_count,
+                format_bytes(dev->usage.live_bytes, live_buf, sizeof(live_buf)),
+                format_bytes(dev->usage.peak_bytes, peak_buf, sizeof(peak_buf)));
+    }
+    unlock_track();
+
+    fprintf(f, "top sites by peak:\n");
+    for (size_t i = 0; i < total_sites; ++i) {
+        const BMAllocSite* s = &rows[i];
+        fprintf(f, "#%-3zu %-6s peak %s, live %s in %llu, %llu allocations (%s), tag %s\n", i + 1,
+                kind_name(s->kind), format_bytes(s->peak_bytes, peak_buf, sizeof(peak_buf)),
+                format_bytes(s->live_bytes, live_buf, sizeof(live_buf)), (unsigned long long)s->live_count,
+                (unsigned long long)s->allocations, format_bytes(s->total_bytes, extra_buf, sizeof(extra_buf)),
+                s->tag ? s->tag : "-");
+#ifdef BM_HAVE_BACKTRACE
+        char** symbols = s->frame_count ? backtrace_symbols(s->frames, (int)s->frame_count) : NULL;
+        for (unsigned j = 0; symbols && j < s->frame_count; ++j) fprintf(f, "      %s\n", symbols[j]);
+        free(symbols);
+#endif
+    }
+
+    free(rows);
+    int failed = ferror(f);
+    if (path ? fclose(f) != 0 || failed : fflush(f) != 0 || failed) {
+        BM_SET_ERROR("bm_alloc_track_report: ошибка записи %s", path ? path : "stdout");
+        return BM_ERROR_INTERNAL;
+    }
+    return BM_OK;
+}
@@ -1,39 +1,192 @@
 // bm_buffer.c
 #include "burymetal.h"
 #include "bm_utils.h"
+#include "bm_internal.h"
 #include "bm_backend.h"
+#include "bm_mem_slab.h"
+#include "bm_mem_alloc.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 // ----------------------------------------
 // Выделение буфера
 // ----------------------------------------
-BMBuffer* bm_alloc_buffer(BMDevice* device, size_t size) {
-    if (!device || size == 0) {
-        bm_set_last_error("bm_alloc_buffer: некорректные аргументы");
-        return NULL;
+BMResult bm_alloc_buffer(BMDevice* device, size_t size, BMBuffer** out_buffer) {
+    if (!device || size == 0 || !out_buffer) {
+        BM_SET_ERROR("bm_alloc_buffer: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
     }
 
-    BMBuffer* buf = (BMBuffer*)malloc(sizeof(BMBuffer));
+    BMRecordCall rec;
+    bm_record_begin(&rec);
+    uint64_t trace = bm_trace_begin();
+    // Дескриптор и память выделяет backend, он же их освобождает
+    int track = bm_alloc_track_begin();
+    BMBuffer* buf = bm_backend_alloc_buffer(device, size);
+    bm_alloc_track_end(track, buf, size, device, BM_ALLOC_KIND_BUFFER);
     if (!buf) {
-        bm_set_last_error("bm_alloc_buffer: не удалось выделить память для BMBuffer");
-        return NULL;
+        // bm_backend_alloc_buffer устанавливает last_error
+        return BM_ERROR_NOMEM;
     }
 
-    buf->device = device;
-    buf->size = size;
-    buf->backend_ptr = bm_backend_alloc_buffer(device, size);
-    buf->backend = device->type;
+    bm_stats_alloc(device, size);
+    bm_trace_end(trace, "memory", "bm_alloc_buffer", "bytes", size);
+    bm_record_end(&rec, BM_RECORD_ALLOC_BUFFER, device, buf, size, 0, BM_OK);
+    bm_log(BM_LOG_INFO, "Буфер выделен: %zu байт на устройстве %s", size, device->name);
+    *out_buffer = buf;
+    return BM_OK;
+}
 
-    if (!buf->backend_ptr) {
-        free(buf);
-        bm_set_last_error("bm_alloc_buffer: backend не смог выделить память");
-        return NULL;
+// ----------------------------------------
+// Обёртка над host-памятью (zero-copy)
+// ----------------------------------------
+BMResult bm_buffer_wrap_host(BMDevice* device, void* ptr, size_t size, unsigned flags, BMBuffer** out_buffer) {
+    if (!device || !ptr || size == 0 || !out_buffer || (flags & ~BM_WRAP_ADOPT)) {
+        BM_SET_ERROR("bm_buffer_wrap_host: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
     }
 
-    bm_log(BM_LOG_INFO, "Буфер выделен: %zu байт на устройстве %s", size, device->name);
-    return buf;
+    if ((uintptr_t)ptr % BM_HOST_WRAP_ALIGNMENT != 0) {
+        BM_SET_ERROR("bm_buffer_wrap_host: указатель не выровнен по %d байт", BM_HOST_WRAP_ALIGNMENT);
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    BMRecordCall rec;
+    bm_record_begin(&rec);
+    BMBuffer* buf = bm_backend_wrap_host(device, ptr, size, flags);
+    if (!buf) {
+        // bm_backend_wrap_host устанавливает last_error
+        return BM_ERROR_UNSUPPORTED;
+    }
+    if (flags & BM_WRAP_ADOPT) bm_stats_adopt(buf);
+    bm_record_end(&rec, BM_RECORD_WRAP_HOST, device, buf, size, flags, BM_OK);
+
+    *out_buffer = buf;
+    bm_log(BM_LOG_DEBUG, "Host-память обёрнута: %zu байт на устройстве %s", size, device->name);
+    return BM_OK;
+}
+
+// ----------------------------------------
+// Буфер поверх отображённого файла
+// ----------------------------------------
+BMResult bm_buffer_map_file(BMDevice* device, const char* path, uint64_t offset, size_t length,
+                            unsigned flags, BMBuffer** out_buffer) {
+    if (!device || !path || !out_buffer) {
+        BM_SET_ERROR("bm_buffer_map_file: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+    // Отображение — host-память: напрямую её видит только CPU-устройство
+    if (device->type != BM_CPU) {
+        BM_SET_ERROR("bm_buffer_map_file: поддерживается только CPU-устройство");
+        return BM_ERROR_UNSUPPORTED;
+    }
+
+    BMRecordCall rec;
+    bm_record_begin(&rec);
+    void* ptr = NULL;
+    size_t mapped = 0;
+    // Диапазон вне файла — INVALID_ARG, отказ open/fstat/mmap — INTERNAL/NOMEM;
+    // текст ошибки (с errno) устанавливает bm_mem_map_file
+    BMResult res = bm_mem_map_file(path, offset, length, flags, &ptr, &mapped);
+    if (res != BM_SUCCESS) return res;
+
+    // ADOPT: bm_free_buffer вернёт отображение через bm_cpu_free (munmap)
+    BMBuffer* buf = bm_backend_wrap_host(device, ptr, mapped, BM_WRAP_ADOPT);
+    if (!buf) {
+        bm_cpu_free(ptr);
+        return BM_ERROR_NOMEM;
+    }
+    if (!(flags & BM_FILE_COPY_ON_WRITE))
+        buf->flags |= BM_BUFFER_READONLY;
+    bm_stats_adopt(buf);
+    bm_record_end(&rec, BM_RECORD_MAP_FILE, device, buf, mapped, flags, BM_OK);
+
+    *out_buffer = buf;
+    bm_log(BM_LOG_INFO, "Файл отображён в буфер: %s (%zu байт, %s)", path, mapped,
+           (flags & BM_FILE_COPY_ON_WRITE) ? "copy-on-write" : "только чтение");
+    return BM_OK;
+}
+
+// ----------------------------------------
+// Клонирование буфера
+// ----------------------------------------
+#define BM_CLONE_BOUNCE (4u * 1024u * 1024u)   // порция копирования через host
+
+// Память устройства не видна с host: новый буфер и копия порциями через host
+static BMResult clone_staged(BMBuffer* buf, BMBuffer** out_clone) {
+    BMBuffer* clone = NULL;
+    BMResult res = bm_alloc_buffer(buf->device, buf->size, &clone);
+    if (res != BM_OK) return res;
+
+    size_t bounce_size = buf->size < BM_CLONE_BOUNCE ? buf->size : BM_CLONE_BOUNCE;
+    void* bounce = NULL;
+    if (bm_cpu_alloc_ex(bounce_size, BM_ALLOC_UNINIT, &bounce) != BM_SUCCESS) {
+        bm_free_buffer(clone);
+        return BM_ERROR_NOMEM;
+    }
+    for (size_t done = 0; done < buf->size && res == BM_OK;) {
+        size_t chunk = buf->size - done < bounce_size ? buf->size - done : bounce_size;
+        res = bm_read_buffer(buf, bounce, chunk, done);
+        if (res == BM_OK) res = bm_write_buffer(clone, bounce, chunk, done);
+        done += chunk;
+    }
+    bm_cpu_free(bounce);
+
+    if (res != BM_OK) {
+        bm_free_buffer(clone);
+        return res;
+    }
+    *out_clone = clone;
+    return BM_OK;
+}
+
+static BMResult clone_buffer(BMBuffer* buf, unsigned flags, BMBuffer** out_clone) {
+    void* host = bm_backend_host_ptr(buf);
+    if (!host) return clone_staged(buf, out_clone);
+
+    // Копия host-памяти, которую затем забирает во владение новый буфер
+    void* ptr = NULL;
+    int ok;
+    if (flags & BM_CLONE_COW) {
+        ok = bm_mem_clone(host, buf->size, &ptr) == BM_SUCCESS;
+    } else {
+        ok = bm_cpu_alloc_ex(buf->size, BM_ALLOC_UNINIT, &ptr) == BM_SUCCESS;
+        if (ok) memcpy(ptr, host, buf->size);
+    }
+    if (!ok) {
+        BM_SET_ERROR("bm_buffer_clone: не удалось выделить память (%zu байт)", buf->size);
+        return BM_ERROR_NOMEM;
+    }
+
+    BMBuffer* clone = bm_backend_wrap_host(buf->device, ptr, buf->size, BM_WRAP_ADOPT);
+    if (!clone) {
+        bm_cpu_free(ptr);
+        return BM_ERROR_UNSUPPORTED; // bm_backend_wrap_host устанавливает last_error
+    }
+    bm_stats_adopt(clone);
+
+    *out_clone = clone;
+    bm_log(BM_LOG_DEBUG, "Буфер клонирован: %zu байт%s", buf->size,
+           (flags & BM_CLONE_COW) ? " (copy-on-write)" : "");
+    return BM_OK;
+}
+
+BMResult bm_buffer_clone(BMBuffer* buf, unsigned flags, BMBuffer** out_clone) {
+    if (!buf || !out_clone || (flags & ~BM_CLONE_COW)) {
+        BM_SET_ERROR("bm_buffer_clone: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    // Вложенные alloc/read/write копии через host — часть этого вызова
+    BMRecordCall rec;
+    bm_record_begin(&rec);
+    int record = bm_record_suspend_thread(1);
+    BMResult res = clone_buffer(buf, flags, out_clone);
+    bm_record_suspend_thread(record);
+    if (res == BM_OK) bm_record_end(&rec, BM_RECORD_CLONE_BUFFER, buf, *out_clone, flags, 0, BM_OK);
+    return res;
 }
 
 // ----------------------------------------
@@ -45,12 +198,27 @@ BMResult bm_free_buffer(BMBuffer* buf) {
         return BM_ERROR_INVALID_ARG;
     }
 
-    if (buf->backend_ptr) {
+    BMRecordCall rec;
+    bm_record_begin_destroy(&rec);
+    uint64_t trace = bm_trace_begin();
+    size_t size = buf->size;
+    BMDevice* device = buf->device;
+
+    // Обёртку целиком освобождает backend (включая дескриптор)
+    if (buf->flags & BM_BUFFER_WRAPPED) {
+        if (buf->flags & BM_BUFFER_COUNTED) bm_stats_free(device, size);
         bm_backend_free_buffer(buf);
-        bm_log(BM_LOG_INFO, "Буфер освобождён: %zu байт на устройстве %s", buf->size, buf->device->name);
+        bm_trace_end(trace, "memory", "bm_free_buffer", "bytes", size);
+        bm_record_end(&rec, BM_RECORD_FREE_BUFFER, buf, device, size, 0, BM_OK);
+        return BM_OK;
     }
 
-    free(buf);
+    bm_alloc_track_free(buf);
+    bm_stats_free(device, size);
+    bm_log(BM_LOG_INFO, "Буфер освобождён: %zu байт на устройстве %s", size, device->name);
+    bm_backend_free_buffer(buf);
+    bm_trace_end(trace, "memory", "bm_free_buffer", "bytes", size);
+    bm_record_end(&rec, BM_RECORD_FREE_BUFFER, buf, device, size, 0, BM_OK);
     return BM_OK;
 }
 
@@ -59,13 +227,23 @@ BMResult bm_free_buffer(BMBuffer* buf) {
 // ----------------------------------------
 BMResult bm_write_buffer(BMBuffer* buf, const void* data, size_t size, size_t offset) {
     if (!buf || !data) return BM_ERROR_INVALID_ARG;
-    if (offset + size > buf->size) return BM_ERROR_INVALID_ARG;
+    if (offset > buf->size || size > buf->size - offset) return BM_ERROR_INVALID_ARG;
+    if (buf->flags & BM_BUFFER_READONLY) {
+        BM_SET_ERROR("bm_write_buffer: буфер только для чтения");
+        return BM_ERROR_INVALID_ARG;
+    }
 
-    BMResult res = bm_backend_upload_data(buf, ((char*)data) + offset, size, offset);
-    if (res != BM_OK) {
-        bm_set_last_error("bm_write_buffer: ошибка при записи в backend");
-        return res;
+    // data — начало записываемых данных, offset относится только к буферу
+    BMRecordCall rec;
+    bm_record_begin(&rec);
+    uint64_t trace = bm_trace_begin();
+    if (bm_backend_upload_range(buf, data, offset, size) != BM_STATUS_OK) {
+        BM_SET_ERROR("bm_write_buffer: ошибка при записи в backend");
+        return BM_ERROR_DEVICE_LOST;
     }
+    bm_stats_add(buf->device, BM_STAT_BYTES_UPLOADED, size);
+    bm_trace_end(trace, "transfer", "bm_write_buffer", "bytes", size);
+    bm_record_end(&rec, BM_RECORD_WRITE_BUFFER, buf, NULL, size, offset, BM_OK);
 
     bm_log(BM_LOG_DEBUG, "Данные записаны в буфер: %zu байт, offset=%zu", size, offset);
     return BM_OK;
@@ -76,35 +254,264 @@ BMResult bm_write_buffer(BMBuffer* buf, const void* data, size_t size, size_t of
 // ----------------------------------------
 BMResult bm_read_buffer(BMBuffer* buf, void* data, size_t size, size_t offset) {
     if (!buf || !data) return BM_ERROR_INVALID_ARG;
-    if (offset + size > buf->size) return BM_ERROR_INVALID_ARG;
+    if (offset > buf->size || size > buf->size - offset) return BM_ERROR_INVALID_ARG;
 
-    BMResult res = bm_backend_download_data(buf, ((char*)data) + offset, size, offset);
-    if (res != BM_OK) {
-        bm_set_last_error("bm_read_buffer: ошибка при чтении из backend");
-        return res;
+    BMRecordCall rec;
+    bm_record_begin(&rec);
+    uint64_t trace = bm_trace_begin();
+    if (bm_backend_download_range(buf, data, offset, size) != BM_STATUS_OK) {
+        BM_SET_ERROR("bm_read_buffer: ошибка при чтении из backend");
+        return BM_ERROR_DEVICE_LOST;
     }
+    bm_stats_add(buf->device, BM_STAT_BYTES_DOWNLOADED, size);
+    bm_trace_end(trace, "transfer", "bm_read_buffer", "bytes", size);
+    bm_record_end(&rec, BM_RECORD_READ_BUFFER, buf, NULL, size, offset, BM_OK);
 
     bm_log(BM_LOG_DEBUG, "Данные прочитаны из буфера: %zu байт, offset=%zu", size, offset);
     return BM_OK;
 }
 
+// ----------------------------------------
+// Загрузка/скачивание с начала буфера
+// ----------------------------------------
+BMResult bm_upload_data(BMBuffer* buf, const void* data, size_t length) {
+    return bm_write_buffer(buf, data, length, 0);
+}
+
+BMResult bm_download_data(BMBuffer* buf, void* data, size_t length) {
+    return bm_read_buffer(buf, data, length, 0);
+}
+
+// ----------------------------------------
+// Scatter/gather: несколько фрагментов одного буфера
+// ----------------------------------------
+static int regions_valid(const BMBuffer* buf, const BMTransferRegion* regions, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (!regions[i].host || regions[i].offset > buf->size ||
+            regions[i].size > buf->size - regions[i].offset)
+            return 0;
+    }
+    return 1;
+}
+
+static uint64_t regions_bytes(const BMTransferRegion* regions, size_t count) {
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < count; ++i) bytes += regions[i].size;
+    return bytes;
+}
+
+BMResult bm_write_buffer_regions(BMBuffer* buf, const BMTransferRegion* regions, size_t count) {
+    if (!buf || (!regions && count) || !regions_valid(buf, regions, count)) {
+        BM_SET_ERROR("bm_write_buffer_regions: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+    if (buf->flags & BM_BUFFER_READONLY) {
+        BM_SET_ERROR("bm_write_buffer_regions: буфер только для чтения");
+        return BM_ERROR_INVALID_ARG;
+    }
+    BMRecordCall rec;
+    bm_record_begin(&rec);
+    uint64_t trace = bm_trace_begin();
+    if (bm_backend_upload_regions(buf, regions, count) != BM_STATUS_OK) {
+        BM_SET_ERROR("bm_write_buffer_regions: ошибка при записи в backend");
+        return BM_ERROR_DEVICE_LOST;
+    }
+    uint64_t bytes = regions_bytes(regions, count);
+    bm_stats_add(buf->device, BM_STAT_BYTES_UPLOADED, bytes);
+    bm_trace_end(trace, "transfer", "bm_write_buffer_regions", "regions", count);
+    bm_record_end(&rec, BM_RECORD_WRITE_REGIONS, buf, NULL, bytes, count, BM_OK);
+
+    bm_log(BM_LOG_DEBUG, "Записано фрагментов в буфер: %zu", count);
+    return BM_OK;
+}
+
+BMResult bm_read_buffer_regions(BMBuffer* buf, const BMTransferRegion* regions, size_t count) {
+    if (!buf || (!regions && count) || !regions_valid(buf, regions, count)) {
+        BM_SET_ERROR("bm_read_buffer_regions: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+    BMRecordCall rec;
+    bm_record_begin(&rec);
+    uint64_t trace = bm_trace_begin();
+    if (bm_backend_download_regions(buf, regions, count) != BM_STATUS_OK) {
+        BM_SET_ERROR("bm_read_buffer_regions: ошибка при чтении из backend");
+        return BM_ERROR_DEVICE_LOST;
+    }
+    uint64_t bytes = regions_bytes(regions, count);
+    bm_stats_add(buf->device, BM_STAT_BYTES_DOWNLOADED, bytes);
+    bm_trace_end(trace, "transfer", "bm_read_buffer_regions", "regions", count);
+    bm_record_end(&rec, BM_RECORD_READ_REGIONS, buf, NULL, bytes, count, BM_OK);
+
+    bm_log(BM_LOG_DEBUG, "Прочитано фрагментов из буфера: %zu", count);
+    return BM_OK;
+}
+
 // ----------------------------------------
 // Работа с массивом буферов (для ядра)
 // ----------------------------------------
-BMResult bm_write_buffers(BMBuffer** bufs, size_t num_bufs, const void** data, const size_t* sizes, const size_t* offsets) {
-    if (!bufs || !data || !sizes || !offsets) return BM_ERROR_INVALID_ARG;
-    for (size_t i = 0; i < num_bufs; ++i) {
-        BMResult res = bm_write_buffer(bufs[i], data[i], sizes[i], offsets[i]);
+// Подряд идущие записи в один и тот же буфер уходят одной scatter/gather-передачей
+#define BM_BATCH_REGIONS 64
+
+static BMResult transfer_buffers(BMBuffer** bufs, size_t num_bufs, void* const* data,
+                                 const size_t* sizes, const size_t* offsets, int write) {
+    BMTransferRegion regions[BM_BATCH_REGIONS];
+    size_t i = 0;
+    while (i < num_bufs) {
+        BMBuffer* buf = bufs[i];
+        size_t count = 0;
+        while (i < num_bufs && bufs[i] == buf && count < BM_BATCH_REGIONS) {
+            regions[count].host = data[i];
+            regions[count].offset = offsets[i];
+            regions[count].size = sizes[i];
+            ++count;
+            ++i;
+        }
+        BMResult res = write ? bm_write_buffer_regions(buf, regions, count)
+                             : bm_read_buffer_regions(buf, regions, count);
         if (res != BM_OK) return res;
     }
     return BM_OK;
 }
 
+BMResult bm_write_buffers(BMBuffer** bufs, size_t num_bufs, const void** data, const size_t* sizes, const size_t* offsets) {
+    if (!bufs || !data || !sizes || !offsets) return BM_ERROR_INVALID_ARG;
+    return transfer_buffers(bufs, num_bufs, (void* const*)data, sizes, offsets, 1);
+}
+
 BMResult bm_read_buffers(BMBuffer** bufs, size_t num_bufs, void** data, const size_t* sizes, const size_t* offsets) {
     if (!bufs || !data || !sizes || !offsets) return BM_ERROR_INVALID_ARG;
-    for (size_t i = 0; i < num_bufs; ++i) {
-        BMResult res = bm_read_buffer(bufs[i], data[i], sizes[i], offsets[i]);
-        if (res != BM_OK) return res;
+    return transfer_buffers(bufs, num_bufs, data, sizes, offsets, 0);
+}
+
+// ----------------------------------------
+// Информация о буфере
+// ----------------------------------------
+BMResult bm_query_buffer(BMBuffer* buf, BMBufferInfo* info) {
+    if (!buf || !info) return BM_ERROR_INVALID_ARG;
+
+    info->type = buf->backend;
+    info->size = buf->size;
+    info->page_size = 0;
+    info->huge_pages = 0;
+
+    // Страницы известны только для host-памяти CPU-устройства
+    if (buf->backend == BM_CPU && buf->data) {
+        BMMemInfo mem;
+        if (bm_mem_query(buf->data, &mem) == BM_SUCCESS) {
+            info->page_size = mem.page_size;
+            info->huge_pages = (mem.kind == BM_MEM_HUGE_THP || mem.kind == BM_MEM_HUGE_TLB);
+        }
     }
+
     return BM_OK;
 }
+
+// ----------------------------------------
+// Прямой доступ: map/unmap
+// ----------------------------------------
+// Staging-копия для памяти, не видимой с host (одна активная на буфер).
+// Сразу за заголовком лежит копия отображённого диапазона.
+typedef struct BMMapStaging {
+    unsigned flags;
+    size_t offset;
+    size_t length;
+    char data[];
+} BMMapStaging;
+
+// Флаги map не помещаются в событие — идут блоком данных
+static void record_map(BMRecordCall* rec, BMBuffer* buf, void* ptr, size_t offset, size_t length, unsigned flags) {
+    if (!rec->start_ns) return;
+    uint64_t block = flags;
+    bm_record_call(rec, BM_RECORD_MAP_BUFFER, buf, ptr, length, offset, BM_OK, &block, sizeof(block));
+}
+
+void* bm_get_host_ptr(BMBuffer* buf) {
+    if (!buf) return NULL;
+    return bm_backend_host_ptr(buf);
+}
+
+BMResult bm_map_buffer(BMBuffer* buf, size_t offset, size_t length, unsigned flags, void** out_ptr) {
+    const unsigned known = BM_MAP_READ | BM_MAP_WRITE | BM_MAP_DISCARD;
+    if (!buf || !out_ptr || length == 0 || !(flags & (BM_MAP_READ | BM_MAP_WRITE)) || (flags & ~known)) {
+        BM_SET_ERROR("bm_map_buffer: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+    if (offset > buf->size || length > buf->size - offset) {
+        BM_SET_ERROR("bm_map_buffer: диапазон выходит за пределы буфера");
+        return BM_ERROR_INVALID_ARG;
+    }
+    if ((flags & BM_MAP_WRITE) && (buf->flags & BM_BUFFER_READONLY)) {
+        BM_SET_ERROR("bm_map_buffer: буфер только для чтения");
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    // Host-видимая память: указатель прямо в буфер, без копий
+    BMRecordCall rec;
+    bm_record_begin(&rec);
+    char* host = (char*)bm_backend_host_ptr(buf);
+    if (host) {
+        *out_ptr = host + offset;
+        record_map(&rec, buf, *out_ptr, offset, length, flags);
+        return BM_OK;
+    }
+
+    if (buf->mapping) {
+        BM_SET_ERROR("bm_map_buffer: буфер уже отображён");
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    BMMapStaging* staging = (BMMapStaging*)malloc(sizeof(BMMapStaging) + length);
+    if (!staging) {
+        BM_SET_ERROR("bm_map_buffer: не удалось выделить staging-копию");
+        return BM_ERROR_NOMEM;
+    }
+    staging->flags = flags;
+    staging->offset = offset;
+    staging->length = length;
+
+    // Читается только отображённый диапазон; при DISCARD — ничего
+    if (!(flags & BM_MAP_DISCARD) && bm_backend_download_range(buf, staging->data, offset, length) != BM_STATUS_OK) {
+        free(staging);
+        return BM_ERROR_DEVICE_LOST;
+    }
+
+    buf->mapping = staging;
+    *out_ptr = staging->data;
+    record_map(&rec, buf, *out_ptr, offset, length, flags);
+    bm_log(BM_LOG_DEBUG, "Буфер отображён через staging: %zu байт, offset=%zu", length, offset);
+    return BM_OK;
+}
+
+BMResult bm_unmap_buffer(BMBuffer* buf, void* mapped_ptr) {
+    if (!buf || !mapped_ptr) {
+        BM_SET_ERROR("bm_unmap_buffer: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    BMRecordCall rec;
+    bm_record_begin_destroy(&rec);
+    char* host = (char*)bm_backend_host_ptr(buf);
+    if (host) {
+        if ((char*)mapped_ptr < host || (char*)mapped_ptr >= host + buf->size) {
+            BM_SET_ERROR("bm_unmap_buffer: указатель не принадлежит буферу");
+            return BM_ERROR_INVALID_ARG;
+        }
+        bm_record_end(&rec, BM_RECORD_UNMAP_BUFFER, buf, mapped_ptr, 0, 0, BM_OK);
+        return BM_OK;
+    }
+
+    BMMapStaging* staging = (BMMapStaging*)buf->mapping;
+    if (!staging || (char*)mapped_ptr != staging->data) {
+        BM_SET_ERROR("bm_unmap_buffer: указатель не получен от bm_map_buffer");
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    BMResult res = BM_OK;
+    if ((staging->flags & BM_MAP_WRITE) && bm_backend_upload_range(buf, staging->data, staging->offset, staging->length) != BM_STATUS_OK)
+        res = BM_ERROR_DEVICE_LOST;
+
+    buf->mapping = NULL;
+    free(staging);
+    bm_record_end(&rec, BM_RECORD_UNMAP_BUFFER, buf, mapped_ptr, 0, 0, res);
+    return res;
+}
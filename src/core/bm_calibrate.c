@@ -0,0 +1,791 @@
+// bm_calibrate.c
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "burymetal.h"
+#include "bm_utils.h"
+#include "bm_internal.h"
+#include "bm_mem_alloc.h"
+#include "bm_mem_numa.h"
+#include "bm_mem_slab.h"
+#include "bm_mem_sysinfo.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#define BM_MKDIR(path) _mkdir(path)
+#else
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BM_MKDIR(path) mkdir(path, 0755)
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define BM_CALIBRATE_X86 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BM_CALIBRATE_NEON 1
+#endif
+
+// ----------------------------------------
+// Калибровка CPU-устройства (roofline)
+// ----------------------------------------
+// Четыре замера, из повторов берётся лучший:
+//   - STREAM triad a[i] = b[i] + s * c[i] всеми потоками бюджета CPU; массивы
+//     больше L3, первое касание — теми же потоками, что потом их читают;
+//   - memcpy одним потоком между теми же массивами;
+//   - bm_launch_kernel пустого ядра на служебном устройстве со своими метриками;
+//     трассировка, запись и профилирование в потоке замера на это время
+//     приостановлены и служебных вызовов не видят;
+//   - пик FLOP/s: 12 независимых цепочек FMA на самом широком SIMD CPU во всех
+//     потоках сразу.
+// Итог кэшируется в памяти процесса и в файле roofline-<хост>-<модель>-<потоки>.txt
+// (-node<N> для устройства BM_NUMA_BIND). Устройство на узле меряется
+// потоками, закреплёнными на CPU узла, по числу его CPU, и памятью узла.
+// Время повтора в многопоточных замерах — от первого старта до последнего
+// финиша: потоки стартуют с барьера.
+
+#define BM_CALIBRATE_REPS 5
+#define BM_CALIBRATE_ARRAY_MIN (16u << 20)  // байт на массив triad
+#define BM_CALIBRATE_ARRAY_MAX (64u << 20)
+#define BM_CALIBRATE_LAUNCHES 2000          // запусков в серии
+#define BM_CALIBRATE_FLOP_NS 20000000ull    // длительность повтора замера FLOP/s
+#define BM_CALIBRATE_PATH_MAX 1024          // каталог кэша
+#define BM_CALIBRATE_FILE_MAX (BM_CALIBRATE_PATH_MAX + 256)
+#define BM_CALIBRATE_HOST_MAX 256
+
+// Цепочка x = x * m + k сходится к 1: ни переполнения, ни денормалов
+#define BM_FLOP_MUL 0.999999
+#define BM_FLOP_ADD 0.000001
+#define BM_FLOP_CHAINS 12
+
+static int calibration_mode = BM_CALIBRATION_OFF;
+
+// Под calibration_lock; замер тоже идёт под ним, чтобы устройства,
+// создаваемые параллельно, не мерили одновременно
+static char cache_dir[BM_CALIBRATE_PATH_MAX];   // пусто — каталог по умолчанию
+static BMCalibration memo;                      // measured_unix == 0 — пусто
+static char memo_path[BM_CALIBRATE_FILE_MAX];   // файл кэша, которому соответствует memo
+
+#ifdef _WIN32
+static INIT_ONCE calibration_once = INIT_ONCE_STATIC_INIT;
+static CRITICAL_SECTION calibration_lock;
+
+static BOOL CALLBACK calibration_init(PINIT_ONCE once, PVOID param, PVOID* context) {
+    (void)once; (void)param; (void)context;
+    InitializeCriticalSection(&calibration_lock);
+    return TRUE;
+}
+
+static void lock_calibration(void) {
+    InitOnceExecuteOnce(&calibration_once, calibration_init, NULL, NULL);
+    EnterCriticalSection(&calibration_lock);
+}
+
+static void unlock_calibration(void) { LeaveCriticalSection(&calibration_lock); }
+#else
+static pthread_mutex_t calibration_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void lock_calibration(void) { pthread_mutex_lock(&calibration_lock); }
+static void unlock_calibration(void) { pthread_mutex_unlock(&calibration_lock); }
+#endif
+
+// ----------------------------------------
+// Параллельный замер
+// ----------------------------------------
+
+typedef struct BMCalibJob BMCalibJob;
+typedef void (*BMCalibBody)(BMCalibJob* job, int index);
+
+typedef struct {
+    double (*run)(uint64_t iters);
+    unsigned flops_per_iter;
+    const char* name;
+} BMFlopKernel;
+
+struct BMCalibJob {
+    const BMDevice* device;     // BM_NUMA_BIND: потоки и память на узле; иначе NULL
+    int threads;
+    int reps;
+    BMCalibBody body;
+    double* a;
+    double* b;
+    double* c;
+    size_t n;                   // элементов в массиве
+    BMFlopKernel flop;
+    uint64_t flop_iters;        // итераций на поток
+    uint64_t* start_ns;         // [threads]
+    uint64_t* end_ns;
+    uint64_t best_ns;
+#ifndef _WIN32
+    pthread_barrier_t barrier;
+    pthread_mutex_t gate_lock;
+    pthread_cond_t gate;
+    int go;                     // 0 — ждать, 1 — старт, -1 — отмена
+#endif
+};
+
+static void job_rep_done(BMCalibJob* job) {
+    uint64_t first = job->start_ns[0], last = job->end_ns[0];
+    for (int t = 1; t < job->threads; ++t) {
+        if (job->start_ns[t] < first) first = job->start_ns[t];
+        if (job->end_ns[t] > last) last = job->end_ns[t];
+    }
+    uint64_t wall = last > first ? last - first : 1;
+    if (!job->best_ns || wall < job->best_ns) job->best_ns = wall;
+}
+
+#ifndef _WIN32
+typedef struct {
+    BMCalibJob* job;
+    int index;
+} BMCalibWorker;
+
+// После второго барьера итог повтора считает поток 0: остальные в это время
+// ждут на первом барьере следующего повтора и времена не перезаписывают
+static void job_thread(BMCalibJob* job, int index) {
+    for (int rep = 0; rep < job->reps; ++rep) {
+        pthread_barrier_wait(&job->barrier);
+        job->start_ns[index] = bm_now_ns();
+        job->body(job, index);
+        job->end_ns[index] = bm_now_ns();
+        pthread_barrier_wait(&job->barrier);
+        if (index == 0) job_rep_done(job);
+    }
+}
+
+static void* job_worker(void* arg) {
+    BMCalibWorker* worker = (BMCalibWorker*)arg;
+    BMCalibJob* job = worker->job;
+    if (job->device) bm_numa_bind_thread(job->device);
+    pthread_mutex_lock(&job->gate_lock);
+    while (job->go == 0) pthread_cond_wait(&job->gate, &job->gate_lock);
+    int go = job->go;
+    pthread_mutex_unlock(&job->gate_lock);
+    if (go > 0) job_thread(job, worker->index);
+    return NULL;
+}
+#endif
+
+// reps раз выполняет body во всех потоках; в job->best_ns — лучший повтор.
+// Потоки ждут на воротах, пока не стартуют все: если какой-то не создался,
+// остальные отпускаются без замера.
+static BMResult job_run(BMCalibJob* job, BMCalibBody body, int reps) {
+    job->body = body;
+    job->reps = reps;
+    job->best_ns = 0;
+    if (job->threads == 1) {
+        for (int rep = 0; rep < reps; ++rep) {
+            job->start_ns[0] = bm_now_ns();
+            body(job, 0);
+            job->end_ns[0] = bm_now_ns();
+            job_rep_done(job);
+        }
+        return BM_OK;
+    }
+
+#ifdef _WIN32
+    return BM_ERROR_UNSUPPORTED;
+#else
+    pthread_t* threads = (pthread_t*)calloc((size_t)job->threads, sizeof(pthread_t));
+    BMCalibWorker* workers = (BMCalibWorker*)calloc((size_t)job->threads, sizeof(BMCalibWorker));
+    if (!threads || !workers) {
+        free(threads);
+        free(workers);
+        BM_SET_ERROR("bm_device_calibrate: не удалось выделить память");
+        return BM_ERROR_NOMEM;
+    }
+    pthread_barrier_init(&job->barrier, NULL, (unsigned)job->threads);
+    pthread_mutex_init(&job->gate_lock, NULL);
+    pthread_cond_init(&job->gate, NULL);
+    job->go = 0;
+
+    int started = 1;
+    for (; started < job->threads; ++started) {
+        workers[started].job = job;
+        workers[started].index = started;
+        if (pthread_create(&threads[started], NULL, job_worker, &workers[started]) != 0) break;
+    }
+    int ok = started == job->threads;
+    pthread_mutex_lock(&job->gate_lock);
+    job->go = ok ? 1 : -1;
+    pthread_cond_broadcast(&job->gate);
+    pthread_mutex_unlock(&job->gate_lock);
+    if (ok) job_thread(job, 0);
+    for (int t = 1; t < started; ++t)
+        pthread_join(threads[t], NULL);
+
+    pthread_cond_destroy(&job->gate);
+    pthread_mutex_destroy(&job->gate_lock);
+    pthread_barrier_destroy(&job->barrier);
+    free(threads);
+    free(workers);
+    if (!ok) {
+        BM_SET_ERROR("bm_device_calibrate: не удалось запустить %d потоков", job->threads);
+        return BM_ERROR_INTERNAL;
+    }
+    return BM_OK;
+#endif
+}
+
+// ----------------------------------------
+// Память: STREAM triad и memcpy
+// ----------------------------------------
+
+static void job_chunk(const BMCalibJob* job, int index, size_t* first, size_t* last) {
+    *first = job->n * (size_t)index / (size_t)job->threads;
+    *last = job->n * (size_t)(index + 1) / (size_t)job->threads;
+}
+
+static void triad_touch(BMCalibJob* job, int index) {
+    size_t first, last;
+    job_chunk(job, index, &first, &last);
+    for (size_t i = first; i < last; ++i) {
+        job->a[i] = 0.0;
+        job->b[i] = 1.0;
+        job->c[i] = 2.0;
+    }
+}
+
+static void triad(BMCalibJob* job, int index) {
+    size_t first, last;
+    job_chunk(job, index, &first, &last);
+    double* restrict a = job->a;
+    const double* restrict b = job->b;
+    const double* restrict c = job->c;
+    for (size_t i = first; i < last; ++i)
+        a[i] = b[i] + 3.0 * c[i];
+}
+
+// Массив с запасом больше L3, но все три — не больше четверти свободной памяти
+static size_t triad_array_bytes(const BMSysInfo* sys) {
+    size_t bytes = sys->cache_l3 * 4;
+    if (bytes < BM_CALIBRATE_ARRAY_MIN) bytes = BM_CALIBRATE_ARRAY_MIN;
+    if (bytes > BM_CALIBRATE_ARRAY_MAX) bytes = BM_CALIBRATE_ARRAY_MAX;
+    if (sys->memory_available && bytes > sys->memory_available / 12)
+        bytes = (size_t)(sys->memory_available / 12);
+    return bytes & ~(size_t)4095;
+}
+
+// STREAM считает 3 массива на элемент triad и 2 на memcpy: запись с
+// выделением строки (write-allocate) в ГБ/с не входит
+static BMResult measure_memory(BMCalibJob* job, const BMSysInfo* sys, BMCalibration* out) {
+    size_t bytes = triad_array_bytes(sys);
+    if (bytes < 4096) {
+        BM_SET_ERROR("bm_device_calibrate: слишком мало свободной памяти");
+        return BM_ERROR_NOMEM;
+    }
+    void* arrays[3] = {NULL, NULL, NULL};
+    for (int i = 0; i < 3; ++i) {
+        if (bm_cpu_alloc_ex(bytes, 0, &arrays[i]) != BM_SUCCESS) {
+            for (int j = 0; j < i; ++j) bm_cpu_free(arrays[j]);
+            BM_SET_ERROR("bm_device_calibrate: не удалось выделить %zu байт под triad", bytes);
+            return BM_ERROR_NOMEM;
+        }
+        if (job->device) bm_numa_place(job->device, arrays[i], bytes);
+    }
+    job->a = (double*)arrays[0];
+    job->b = (double*)arrays[1];
+    job->c = (double*)arrays[2];
+    job->n = bytes / sizeof(double);
+
+    BMResult res = job_run(job, triad_touch, 1);
+    if (res == BM_OK) res = job_run(job, triad, BM_CALIBRATE_REPS);
+    if (res == BM_OK) {
+        out->triad_gbps = 3.0 * (double)bytes / (double)job->best_ns;
+
+        uint64_t best = 0;
+        for (int rep = 0; rep < BM_CALIBRATE_REPS; ++rep) {
+            uint64_t start = bm_now_ns();
+            memcpy(job->a, job->b, bytes);
+            uint64_t ns = bm_now_ns() - start;
+            if (!best || ns < best) best = ns;
+        }
+        out->memcpy_gbps = 2.0 * (double)bytes / (double)(best ? best : 1);
+    }
+
+    for (int i = 0; i < 3; ++i) bm_cpu_free(arrays[i]);
+    job->a = job->b = job->c = NULL;
+    return res;
+}
+
+// ----------------------------------------
+// Пик FLOP/s
+// ----------------------------------------
+// Цепочек больше, чем (задержка FMA) x (число FMA-портов): конвейер занят
+// полностью. Каждый шаг — FMA (2 FLOP на элемент); без FMA — mul + add.
+
+static double flop_sink;   // результат цепочек, чтобы их не выбросил компилятор
+
+#define BM_FLOP_LOOP(type, splat, madd, add)                                                              \
+    const type m = splat(BM_FLOP_MUL), k = splat(BM_FLOP_ADD);                                           \
+    type x0 = splat(0.0), x1 = splat(0.1), x2 = splat(0.2), x3 = splat(0.3), x4 = splat(0.4);            \
+    type x5 = splat(0.5), x6 = splat(0.6), x7 = splat(0.7), x8 = splat(0.8), x9 = splat(0.9);            \
+    type x10 = splat(1.0), x11 = splat(1.1);                                                            \
+    for (uint64_t it = 0; it < iters; ++it) {                                                           \
+        x0 = madd(x0, m, k); x1 = madd(x1, m, k); x2 = madd(x2, m, k); x3 = madd(x3, m, k);               \
+        x4 = madd(x4, m, k); x5 = madd(x5, m, k); x6 = madd(x6, m, k); x7 = madd(x7, m, k);               \
+        x8 = madd(x8, m, k); x9 = madd(x9, m, k); x10 = madd(x10, m, k); x11 = madd(x11, m, k);           \
+    }                                                                                                   \
+    type sum = add(add(add(add(x0, x1), add(x2, x3)), add(add(x4, x5), add(x6, x7))),                    \
+                   add(add(x8, x9), add(x10, x11)));                                                    \
+    double first;                                                                                       \
+    memcpy(&first, &sum, sizeof(first));                                                                \
+    return first
+
+#define BM_SCALAR_SPLAT(v) (v)
+#define BM_SCALAR_MADD(x, m, k) ((x) * (m) + (k))
+#define BM_SCALAR_ADD(a, b) ((a) + (b))
+
+static double flops_scalar(uint64_t iters) { BM_FLOP_LOOP(double, BM_SCALAR_SPLAT, BM_SCALAR_MADD, BM_SCALAR_ADD); }
+
+#ifdef BM_CALIBRATE_X86
+#define BM_SSE2_MADD(x, m, k) _mm_add_pd(_mm_mul_pd(x, m), k)
+
+__attribute__((target("sse2"))) static double flops_sse2(uint64_t iters) {
+    BM_FLOP_LOOP(__m128d, _mm_set1_pd, BM_SSE2_MADD, _mm_add_pd);
+}
+
+__attribute__((target("avx2,fma"))) static double flops_avx2(uint64_t iters) {
+    BM_FLOP_LOOP(__m256d, _mm256_set1_pd, _mm256_fmadd_pd, _mm256_add_pd);
+}
+
+__attribute__((target("avx512f"))) static double flops_avx512(uint64_t iters) {
+    BM_FLOP_LOOP(__m512d, _mm512_set1_pd, _mm512_fmadd_pd, _mm512_add_pd);
+}
+#endif
+
+#ifdef BM_CALIBRATE_NEON
+#define BM_NEON_MADD(x, m, k) vfmaq_f64(k, x, m)
+
+static double flops_neon(uint64_t iters) { BM_FLOP_LOOP(float64x2_t, vdupq_n_f64, BM_NEON_MADD, vaddq_f64); }
+#endif
+
+static BMFlopKernel pick_flop_kernel(unsigned simd) {
+    BMFlopKernel kernel = {flops_scalar, BM_FLOP_CHAINS * 2, "scalar"};
+#ifdef BM_CALIBRATE_X86
+    if (simd & BM_SIMD_AVX512F) {
+        kernel.run = flops_avx512;
+        kernel.flops_per_iter = BM_FLOP_CHAINS * 8 * 2;
+        kernel.name = "avx512";
+    } else if ((simd & BM_SIMD_AVX2) && (simd & BM_SIMD_FMA)) {
+        kernel.run = flops_avx2;
+        kernel.flops_per_iter = BM_FLOP_CHAINS * 4 * 2;
+        kernel.name = "avx2+fma";
+    } else if (simd & BM_SIMD_SSE2) {
+        kernel.run = flops_sse2;
+        kernel.flops_per_iter = BM_FLOP_CHAINS * 2 * 2;
+        kernel.name = "sse2";
+    }
+#elif defined(BM_CALIBRATE_NEON)
+    if (simd & BM_SIMD_NEON) {
+        kernel.run = flops_neon;
+        kernel.flops_per_iter = BM_FLOP_CHAINS * 2 * 2;
+        kernel.name = "neon";
+    }
+#else
+    (void)simd;
+#endif
+    return kernel;
+}
+
+static void flops_body(BMCalibJob* job, int index) {
+    (void)index;
+    double result = job->flop.run(job->flop_iters);
+    __atomic_store(&flop_sink, &result, __ATOMIC_RELAXED);
+}
+
+// Число итераций подбирается одним потоком под BM_CALIBRATE_FLOP_NS
+static BMResult measure_flops(BMCalibJob* job, const BMSysInfo* sys, BMCalibration* out) {
+    job->flop = pick_flop_kernel(sys->simd);
+    uint64_t iters = 1u << 12;
+    uint64_t ns = 0;
+    for (;;) {
+        uint64_t start = bm_now_ns();
+        double result = job->flop.run(iters);
+        ns = bm_now_ns() - start;
+        __atomic_store(&flop_sink, &result, __ATOMIC_RELAXED);
+        if (ns >= BM_CALIBRATE_FLOP_NS / 8 || iters >= (1ull << 40)) break;
+        iters *= 4;
+    }
+    job->flop_iters = ns ? (uint64_t)((double)iters * (double)BM_CALIBRATE_FLOP_NS / (double)ns) : iters;
+    if (job->flop_iters == 0) job->flop_iters = 1;
+
+    BMResult res = job_run(job, flops_body, 3);
+    if (res != BM_OK) return res;
+    double flops = (double)job->flop_iters * job->flop.flops_per_iter * (double)job->threads;
+    out->peak_gflops = flops / (double)job->best_ns;
+    return BM_OK;
+}
+
+// ----------------------------------------
+// Цена запуска ядра
+// ----------------------------------------
+
+static void noop_kernel(void* data, size_t count) {
+    (void)data;
+    (void)count;
+}
+
+// Служебное устройство со своими метриками, как у bm_create_device, но без
+// калибровки. Пока оно живо, трассировка, запись и профилирование приостановлены
+// в этом потоке: служебные вызовы не попадают в записи пользователя, а хуки не
+// мерятся вместо запуска. Потолок лога этого потока — WARN: сообщения запуска
+// отбрасываются до форматирования. Остальных потоков это не касается.
+static BMResult measure_launch_on(BMDevice* dev, BMCalibration* out) {
+    BM_ALIGNAS(BM_HOST_WRAP_ALIGNMENT) double data[8] = {0};
+    BMBuffer* buf = NULL;
+    BMKernel* kernel = bm_register_kernel(dev, "bm_calibrate_noop", noop_kernel);
+    BMResult res = kernel ? bm_buffer_wrap_host(dev, data, sizeof(data), BM_WRAP_BORROW, &buf)
+                          : BM_ERROR_NOMEM;
+    if (res == BM_OK) {
+        uint64_t best = 0;
+        for (int rep = 0; rep < BM_CALIBRATE_REPS && res == BM_OK; ++rep) {
+            uint64_t start = bm_now_ns();
+            for (int i = 0; i < BM_CALIBRATE_LAUNCHES && res == BM_OK; ++i)
+                res = bm_launch_kernel(kernel, buf, 1);
+            uint64_t ns = bm_now_ns() - start;
+            if (!best || ns < best) best = ns;
+        }
+        out->launch_ns = (double)best / BM_CALIBRATE_LAUNCHES;
+    }
+
+    if (buf) bm_free_buffer(buf);
+    if (kernel) bm_unregister_kernel(kernel);
+    return res;
+}
+
+static BMResult measure_launch(BMCalibration* out) {
+    BMDevice* dev = bm_handle_alloc_device();
+    if (!dev) {
+        BM_SET_ERROR("bm_device_calibrate: не удалось выделить память");
+        return BM_ERROR_NOMEM;
+    }
+    dev->type = BM_CPU;
+    if (!bm_stats_device_init(dev)) {
+        bm_handle_free_device(dev);
+        BM_SET_ERROR("bm_device_calibrate: не удалось выделить память под метрики");
+        return BM_ERROR_NOMEM;
+    }
+
+    int trace = bm_trace_suspend_thread(1);
+    int record = bm_record_suspend_thread(1);
+    int profile = bm_profile_suspend_thread(1);
+    int thread_level = bm_log_set_thread_level(BM_LOG_LEVEL_WARN);
+    BMResult res = measure_launch_on(dev, out);
+    bm_destroy_device(dev);
+    bm_log_set_thread_level(thread_level);
+    bm_profile_suspend_thread(profile);
+    bm_record_suspend_thread(record);
+    bm_trace_suspend_thread(trace);
+    return res;
+}
+
+static BMResult measure(const BMSysInfo* sys, int threads, const BMDevice* device, BMCalibration* out) {
+    BMCalibJob job;
+    memset(&job, 0, sizeof(job));
+    job.device = device;
+    job.threads = threads;
+    job.start_ns = (uint64_t*)calloc((size_t)threads, sizeof(uint64_t));
+    job.end_ns = (uint64_t*)calloc((size_t)threads, sizeof(uint64_t));
+    if (!job.start_ns || !job.end_ns) {
+        free(job.start_ns);
+        free(job.end_ns);
+        BM_SET_ERROR("bm_device_calibrate: не удалось выделить память");
+        return BM_ERROR_NOMEM;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->threads = threads;
+    BMResult res = measure_memory(&job, sys, out);
+    if (res == BM_OK) res = measure_launch(out);
+    if (res == BM_OK) res = measure_flops(&job, sys, out);
+    out->measured_unix = (int64_t)time(NULL);
+
+    free(job.start_ns);
+    free(job.end_ns);
+    return res;
+}
+
+#ifndef _WIN32
+typedef struct {
+    const BMSysInfo* sys;
+    int threads;
+    const BMDevice* device;
+    BMCalibration* out;
+    BMResult result;
+    char error[256];            // last_error потока замера (он thread-local)
+} BMCalibRun;
+
+static void* measure_worker(void* arg) {
+    BMCalibRun* run = (BMCalibRun*)arg;
+    bm_numa_bind_thread(run->device);
+    run->result = measure(run->sys, run->threads, run->device, run->out);
+    if (run->result != BM_OK) snprintf(run->error, sizeof(run->error), "%s", bm_get_last_error());
+    return NULL;
+}
+#endif
+
+// Устройство на узле меряется из отдельного потока, закреплённого на узле:
+// однопоточные замеры и подбор итераций тоже идут на его CPU, а привязка
+// вызывающего потока не меняется
+static BMResult measure_device(const BMSysInfo* sys, int threads, const BMDevice* device, BMCalibration* out) {
+#ifndef _WIN32
+    if (device) {
+        BMCalibRun run = {sys, threads, device, out, BM_OK, ""};
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, measure_worker, &run) != 0) {
+            BM_SET_ERROR("bm_device_calibrate: не удалось запустить поток замера");
+            return BM_ERROR_INTERNAL;
+        }
+        pthread_join(thread, NULL);
+        if (run.result != BM_OK) BM_SET_ERROR("%s", run.error);
+        return run.result;
+    }
+#endif
+    return measure(sys, threads, NULL, out);
+}
+
+// ----------------------------------------
+// Кэш на диске
+// ----------------------------------------
+
+static void default_cache_dir(char* out, size_t cap) {
+    const char* base = getenv("XDG_CACHE_HOME");
+    if (base && *base) {
+        snprintf(out, cap, "%s/burymetal", base);
+        return;
+    }
+#ifdef _WIN32
+    base = getenv("LOCALAPPDATA");
+    snprintf(out, cap, "%s\\burymetal", base && *base ? base : ".");
+#else
+    base = getenv("HOME");
+    if (base && *base)
+        snprintf(out, cap, "%s/.cache/burymetal", base);
+    else
+        snprintf(out, cap, "/tmp/burymetal-%d", (int)getuid());
+#endif
+}
+
+// Каталог со всеми родителями
+static int make_dirs(const char* dir) {
+    char path[BM_CALIBRATE_PATH_MAX];
+    snprintf(path, sizeof(path), "%s", dir);
+    for (char* p = path + 1; *p; ++p) {
+        if (*p != '/' && *p != '\\') continue;
+        char sep = *p;
+        *p = '\0';
+        BM_MKDIR(path);
+        *p = sep;
+    }
+    return BM_MKDIR(path) == 0 || errno == EEXIST;
+}
+
+// Имя CPU и хоста в имени файла: всё, кроме [A-Za-z0-9.-], — в '_'
+static void sanitize(char* out, size_t cap, const char* text) {
+    size_t len = 0;
+    for (; *text && len + 1 < cap; ++text) {
+        char ch = *text;
+        int keep = (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') ||
+                   ch == '.' || ch == '-';
+        out[len++] = keep ? ch : '_';
+    }
+    if (!len) {
+        snprintf(out, cap, "unknown");
+        return;
+    }
+    out[len] = '\0';
+}
+
+// node < 0 — устройство без узла
+static void cache_path(char* out, size_t cap, const char* dir, const char* host, const char* model, int threads,
+                       int node) {
+    char host_part[64], model_part[BM_SYSINFO_MODEL_MAX], node_part[24] = "";
+    sanitize(host_part, sizeof(host_part), host);
+    sanitize(model_part, sizeof(model_part), model);
+    if (node >= 0) snprintf(node_part, sizeof(node_part), "-node%d", node);
+    snprintf(out, cap, "%s/roofline-%s-%s-%d%s.txt", dir, host_part, model_part, threads, node_part);
+}
+
+// Файл принимается, только если хост, модель, число потоков и узел совпадают
+// дословно (имя файла их сокращает) и все пики положительны. Файл без
+// строки node — от устройства без узла.
+static int cache_load(const char* path, const char* host, const char* model, int threads, int node,
+                      BMCalibration* out) {
+    FILE* file = fopen(path, "r");
+    if (!file) return 0;
+
+    BMCalibration cal;
+    memset(&cal, 0, sizeof(cal));
+    int matched = 0, file_node = -1;
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char* value = strchr(line, '=');
+        if (!value || line[0] == '#') continue;
+        *value++ = '\0';
+        if (strcmp(line, "host") == 0) matched += strcmp(value, host) == 0;
+        else if (strcmp(line, "cpu") == 0) matched += strcmp(value, model) == 0;
+        else if (strcmp(line, "threads") == 0) matched += (cal.threads = atoi(value)) == threads;
+        else if (strcmp(line, "node") == 0) file_node = atoi(value);
+        else if (strcmp(line, "triad_gbps") == 0) cal.triad_gbps = strtod(value, NULL);
+        else if (strcmp(line, "memcpy_gbps") == 0) cal.memcpy_gbps = strtod(value, NULL);
+        else if (strcmp(line, "launch_ns") == 0) cal.launch_ns = strtod(value, NULL);
+        else if (strcmp(line, "peak_gflops") == 0) cal.peak_gflops = strtod(value, NULL);
+        else if (strcmp(line, "measured_unix") == 0) cal.measured_unix = strtoll(value, NULL, 10);
+    }
+    fclose(file);
+
+    if (matched != 3 || file_node != node || !(cal.triad_gbps > 0) || !(cal.memcpy_gbps > 0) || !(cal.launch_ns > 0) ||
+        !(cal.peak_gflops > 0) || cal.measured_unix <= 0)
+        return 0;
+    *out = cal;
+    return 1;
+}
+
+// Через временный файл и rename: читатель в другом процессе не видит половину,
+// а fsync файла до rename и каталога после не оставляют после сбоя питания
+// пустой файл под итоговым именем
+static BMResult cache_store(const char* dir, const char* path, const char* host, const char* model, int node,
+                            const BMCalibration* cal) {
+    if (!make_dirs(dir)) {
+        BM_SET_ERROR("bm_device_calibrate: не удалось создать каталог %s", dir);
+        return BM_ERROR_INTERNAL;
+    }
+    char tmp[BM_CALIBRATE_FILE_MAX + 32];
+#ifdef _WIN32
+    snprintf(tmp, sizeof(tmp), "%s.tmp%lu", path, (unsigned long)GetCurrentProcessId());
+#else
+    snprintf(tmp, sizeof(tmp), "%s.tmp%d", path, (int)getpid());
+#endif
+    FILE* file = fopen(tmp, "w");
+    if (!file) {
+        BM_SET_ERROR("bm_device_calibrate: не удалось открыть %s", tmp);
+        return BM_ERROR_INTERNAL;
+    }
+    fprintf(file, "# burymetal roofline calibration\nhost=%s\ncpu=%s\nthreads=%d\n", host, model, cal->threads);
+    if (node >= 0) fprintf(file, "node=%d\n", node);
+    fprintf(file, "triad_gbps=%.6g\nmemcpy_gbps=%.6g\nlaunch_ns=%.6g\npeak_gflops=%.6g\nmeasured_unix=%lld\n",
+            cal->triad_gbps, cal->memcpy_gbps, cal->launch_ns, cal->peak_gflops, (long long)cal->measured_unix);
+    int failed = ferror(file) || !bm_file_sync(file);
+    if (fclose(file) != 0) failed = 1;
+#ifdef _WIN32
+    if (!failed) remove(path);  // rename на Windows не заменяет существующий файл
+#endif
+    if (failed || rename(tmp, path) != 0) {
+        remove(tmp);
+        BM_SET_ERROR("bm_device_calibrate: не удалось записать %s", path);
+        return BM_ERROR_INTERNAL;
+    }
+    if (!bm_sync_parent_dir(path)) {
+        BM_SET_ERROR("bm_device_calibrate: не удалось синхронизировать каталог %s", dir);
+        return BM_ERROR_INTERNAL;
+    }
+    return BM_OK;
+}
+
+// ----------------------------------------
+// Интерфейс
+// ----------------------------------------
+
+BMResult bm_set_calibration(BMCalibrationMode mode, const char* dir) {
+    if (mode > BM_CALIBRATION_FORCE || (dir && strlen(dir) >= sizeof(cache_dir) - 64)) {
+        BM_SET_ERROR("bm_set_calibration: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+    lock_calibration();
+    snprintf(cache_dir, sizeof(cache_dir), "%s", dir ? dir : "");
+    unlock_calibration();
+    __atomic_store_n(&calibration_mode, (int)mode, __ATOMIC_RELAXED);
+    return BM_OK;
+}
+
+BMResult bm_device_calibrate(BMDevice* device, BMCalibrationMode mode) {
+    if (!device || (mode != BM_CALIBRATION_CACHED && mode != BM_CALIBRATION_FORCE)) {
+        BM_SET_ERROR("bm_device_calibrate: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+    if (device->type != BM_CPU) {
+        BM_SET_ERROR("bm_device_calibrate: поддерживается только CPU-устройство");
+        return BM_ERROR_UNSUPPORTED;
+    }
+
+    uint64_t trace = bm_trace_begin();
+    BMSysInfo sys;
+    bm_sysinfo_get(&sys);
+    // Устройство на узле: потоков не больше CPU узла, как compute_units в bm_query_device
+    const BMDevice* bound = device->numa_policy == BM_NUMA_BIND ? device : NULL;
+    int node = bound ? device->numa_node : -1;
+#ifdef _WIN32
+    int threads = 1;
+#else
+    int threads = sys.cpu_budget;
+    if (bound) {
+        int node_cpus = bm_numa_node_cpu_count(node);
+        if (node_cpus > 0 && node_cpus < threads) threads = node_cpus;
+    }
+#endif
+    char host[BM_CALIBRATE_HOST_MAX] = "";
+#ifdef _WIN32
+    DWORD host_len = sizeof(host);
+    if (!GetComputerNameA(host, &host_len)) host[0] = '\0';
+#else
+    if (gethostname(host, sizeof(host) - 1) != 0) host[0] = '\0';
+#endif
+    if (!host[0]) snprintf(host, sizeof(host), "localhost");
+    const char* model = sys.cpu_model[0] ? sys.cpu_model : "unknown";
+
+    lock_calibration();
+    char dir[BM_CALIBRATE_PATH_MAX], path[BM_CALIBRATE_FILE_MAX];
+    if (cache_dir[0]) snprintf(dir, sizeof(dir), "%s", cache_dir);
+    else default_cache_dir(dir, sizeof(dir));
+    cache_path(path, sizeof(path), dir, host, model, threads, node);
+
+    BMCalibration cal;
+    BMResult res = BM_OK;
+    int found = 0;
+    if (mode == BM_CALIBRATION_CACHED) {
+        if (memo.measured_unix && strcmp(memo_path, path) == 0) {
+            cal = memo;
+            found = 1;
+        } else {
+            found = cache_load(path, host, model, threads, node, &cal);
+        }
+        cal.from_cache = 1;
+    }
+    if (!found) {
+        res = measure_device(&sys, threads, bound, &cal);
+        if (res == BM_OK && cache_store(dir, path, host, model, node, &cal) != BM_OK)
+            bm_log(BM_LOG_WARN, "Калибровка: кэш не сохранён: %s", bm_get_last_error());
+    }
+    if (res == BM_OK) {
+        memo = cal;
+        snprintf(memo_path, sizeof(memo_path), "%s", path);
+    }
+    unlock_calibration();
+
+    if (res != BM_OK) return res;
+    device->calibration = cal;
+    bm_trace_end(trace, "device", "bm_device_calibrate", "threads", (uint64_t)threads);
+    bm_log(BM_LOG_INFO, "Калибровка CPU (потоков: %d%s): triad %.1f ГБ/с, memcpy %.1f ГБ/с, запуск %.0f нс, %.1f GFLOP/s",
+           threads, cal.from_cache ? ", из кэша" : "", cal.triad_gbps, cal.memcpy_gbps, cal.launch_ns,
+           cal.peak_gflops);
+    return BM_OK;
+}
+
+void bm_calibrate_on_create(BMDevice* device) {
+    int mode = __atomic_load_n(&calibration_mode, __ATOMIC_RELAXED);
+    if (mode == BM_CALIBRATION_OFF || device->type != BM_CPU) return;
+    if (bm_device_calibrate(device, (BMCalibrationMode)mode) != BM_OK)
+        bm_log(BM_LOG_WARN, "Калибровка устройства не удалась: %s", bm_get_last_error());
+}
@@ -0,0 +1,376 @@
+// bm_copy_queue.c
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "burymetal.h"
+#include "bm_utils.h"
+#include "bm_internal.h"
+#include "bm_backend.h"
+#include "bm_mem_alloc.h"
+#include "bm_mem_numa.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// ----------------------------------------
+// Очередь копирования: отдельный поток на устройство
+// ----------------------------------------
+// Передачи выполняются рабочим потоком через pinned staging-буферы,
+// поэтому upload следующей порции идёт параллельно с ядром текущей.
+// Буферы, видимые с host, копируются напрямую — staging им не нужен.
+
+typedef enum {
+    BM_TRANSFER_UPLOAD,
+    BM_TRANSFER_DOWNLOAD
+} BMTransferKind;
+
+struct BMTransfer {
+    BMTransferKind kind;
+    BMBuffer* buffer;
+    void* host;
+    size_t size;
+    size_t offset;
+    BMResult result;
+    char error[256];        // last_error рабочего потока при ошибке (он thread-local)
+    int done;
+    int detached;           // без билета: освобождается рабочим потоком
+    struct BMTransfer* next;
+};
+
+struct BMCopyQueue {
+    BMDevice* device;
+    size_t staging_size;
+    unsigned flags;         // BM_COPY_QUEUE_*
+    void* staging;          // pinned-буфер, через который идут все передачи
+
+    BMTransfer* head;
+    BMTransfer* tail;
+    size_t pending;         // поставлено, но ещё не завершено
+    int stop;
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE work;
+    CONDITION_VARIABLE done;
+    HANDLE thread;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    pthread_t thread;
+#endif
+};
+
+// ----------------------------------------
+// Синхронизация
+// ----------------------------------------
+static void queue_lock(BMCopyQueue* queue) {
+#ifdef _WIN32
+    EnterCriticalSection(&queue->lock);
+#else
+    pthread_mutex_lock(&queue->lock);
+#endif
+}
+
+static void queue_unlock(BMCopyQueue* queue) {
+#ifdef _WIN32
+    LeaveCriticalSection(&queue->lock);
+#else
+    pthread_mutex_unlock(&queue->lock);
+#endif
+}
+
+static void queue_wait_work(BMCopyQueue* queue) {
+#ifdef _WIN32
+    SleepConditionVariableCS(&queue->work, &queue->lock, INFINITE);
+#else
+    pthread_cond_wait(&queue->work, &queue->lock);
+#endif
+}
+
+static void queue_wait_done(BMCopyQueue* queue) {
+#ifdef _WIN32
+    SleepConditionVariableCS(&queue->done, &queue->lock, INFINITE);
+#else
+    pthread_cond_wait(&queue->done, &queue->lock);
+#endif
+}
+
+static void queue_signal_work(BMCopyQueue* queue) {
+#ifdef _WIN32
+    WakeConditionVariable(&queue->work);
+#else
+    pthread_cond_signal(&queue->work);
+#endif
+}
+
+static void queue_broadcast_done(BMCopyQueue* queue) {
+#ifdef _WIN32
+    WakeAllConditionVariable(&queue->done);
+#else
+    pthread_cond_broadcast(&queue->done);
+#endif
+}
+
+// ----------------------------------------
+// Рабочий поток
+// ----------------------------------------
+// Передача порциями по staging_size: каждая порция проходит через pinned-буфер.
+// Память, видимая с host, копируется одним memcpy без промежуточной копии.
+static BMResult run_transfer(BMCopyQueue* queue, BMTransfer* t) {
+    void* staging = queue->staging;
+    int direct = !(queue->flags & BM_COPY_QUEUE_STAGED) && bm_backend_host_ptr(t->buffer) != NULL;
+    uint64_t trace = bm_trace_begin();
+
+    if (direct) {
+        BMStatus st = t->kind == BM_TRANSFER_UPLOAD
+                          ? bm_backend_upload_range(t->buffer, t->host, t->offset, t->size)
+                          : bm_backend_download_range(t->buffer, t->host, t->offset, t->size);
+        if (st != BM_STATUS_OK) return BM_ERROR_DEVICE_LOST;
+    }
+    for (size_t done = direct ? t->size : 0; done < t->size;) {
+        size_t chunk = t->size - done;
+        if (chunk > queue->staging_size) chunk = queue->staging_size;
+        char* host = (char*)t->host + done;
+
+        if (t->kind == BM_TRANSFER_UPLOAD) {
+            memcpy(staging, host, chunk);
+            if (bm_backend_upload_range(t->buffer, staging, t->offset + done, chunk) != BM_STATUS_OK)
+                return BM_ERROR_DEVICE_LOST;
+        } else {
+            if (bm_backend_download_range(t->buffer, staging, t->offset + done, chunk) != BM_STATUS_OK)
+                return BM_ERROR_DEVICE_LOST;
+            memcpy(host, staging, chunk);
+        }
+        done += chunk;
+    }
+    bm_stats_add(t->buffer->device, t->kind == BM_TRANSFER_UPLOAD ? BM_STAT_BYTES_UPLOADED : BM_STAT_BYTES_DOWNLOADED,
+                 t->size);
+    bm_trace_end(trace, "transfer", t->kind == BM_TRANSFER_UPLOAD ? "bm_upload_async" : "bm_download_async",
+                 "bytes", t->size);
+    return BM_OK;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI copy_worker(LPVOID arg) {
+#else
+static void* copy_worker(void* arg) {
+#endif
+    BMCopyQueue* queue = (BMCopyQueue*)arg;
+    // Staging и память буферов — на узле устройства; неудача не мешает копированию
+    if (queue->device->numa_policy == BM_NUMA_BIND) bm_numa_bind_thread(queue->device);
+
+    queue_lock(queue);
+    for (;;) {
+        while (!queue->head && !queue->stop)
+            queue_wait_work(queue);
+        if (!queue->head) break; // stop и очередь пуста
+
+        BMTransfer* t = queue->head;
+        queue->head = t->next;
+        if (!queue->head) queue->tail = NULL;
+        queue_unlock(queue);
+
+        BMResult res = run_transfer(queue, t);
+        if (res != BM_OK) snprintf(t->error, sizeof(t->error), "%s", bm_get_last_error());
+
+        queue_lock(queue);
+        --queue->pending;
+        if (t->detached) {
+            if (res != BM_OK) bm_log(BM_LOG_WARN, "bm_copy_queue: передача без билета завершилась с ошибкой: %s", t->error);
+            free(t);
+        } else {
+            t->result = res;
+            t->done = 1;
+        }
+        queue_broadcast_done(queue);
+    }
+    queue_unlock(queue);
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+// ----------------------------------------
+// Создание/удаление очереди
+// ----------------------------------------
+static void free_staging(BMCopyQueue* queue) {
+    bm_backend_unpin_host(queue->device, queue->staging, queue->staging_size);
+    bm_cpu_free(queue->staging);
+}
+
+BMResult bm_copy_queue_create(BMDevice* device, size_t staging_size, BMCopyQueue** out_queue) {
+    return bm_copy_queue_create_ex(device, staging_size, 0, out_queue);
+}
+
+BMResult bm_copy_queue_create_ex(BMDevice* device, size_t staging_size, unsigned flags, BMCopyQueue** out_queue) {
+    if (!device || staging_size == 0 || (flags & ~BM_COPY_QUEUE_STAGED) || !out_queue) {
+        BM_SET_ERROR("bm_copy_queue_create: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    BMCopyQueue* queue = (BMCopyQueue*)calloc(1, sizeof(BMCopyQueue));
+    if (!queue) {
+        BM_SET_ERROR("bm_copy_queue_create: не удалось выделить память");
+        return BM_ERROR_NOMEM;
+    }
+    queue->device = device;
+    queue->staging_size = staging_size;
+    queue->flags = flags;
+
+    if (bm_cpu_alloc_ex(staging_size, BM_ALLOC_UNINIT, &queue->staging) != BM_SUCCESS) {
+        free(queue);
+        BM_SET_ERROR("bm_copy_queue_create: не удалось выделить staging-буфер (%zu байт)", staging_size);
+        return BM_ERROR_NOMEM;
+    }
+    // Без pinned-памяти передачи работают, просто медленнее
+    if (bm_backend_pin_host(device, queue->staging, staging_size) != BM_STATUS_OK)
+        bm_log(BM_LOG_WARN, "bm_copy_queue_create: staging-буфер не закреплён: %s", bm_get_last_error());
+
+#ifdef _WIN32
+    InitializeCriticalSection(&queue->lock);
+    InitializeConditionVariable(&queue->work);
+    InitializeConditionVariable(&queue->done);
+    queue->thread = CreateThread(NULL, 0, copy_worker, queue, 0, NULL);
+    int started = queue->thread != NULL;
+#else
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->work, NULL);
+    pthread_cond_init(&queue->done, NULL);
+    int started = pthread_create(&queue->thread, NULL, copy_worker, queue) == 0;
+#endif
+    if (!started) {
+#ifdef _WIN32
+        DeleteCriticalSection(&queue->lock);
+#else
+        pthread_cond_destroy(&queue->done);
+        pthread_cond_destroy(&queue->work);
+        pthread_mutex_destroy(&queue->lock);
+#endif
+        free_staging(queue);
+        free(queue);
+        BM_SET_ERROR("bm_copy_queue_create: не удалось запустить поток копирования");
+        return BM_ERROR_INTERNAL;
+    }
+
+    *out_queue = queue;
+    bm_log(BM_LOG_DEBUG, "Очередь копирования создана: staging %zu байт на устройстве %s",
+           staging_size, device->name);
+    return BM_OK;
+}
+
+BMResult bm_copy_queue_destroy(BMCopyQueue* queue) {
+    if (!queue) return BM_OK;
+
+    // Поток дорабатывает всё, что уже поставлено
+    queue_lock(queue);
+    queue->stop = 1;
+    queue_signal_work(queue);
+    queue_unlock(queue);
+
+#ifdef _WIN32
+    WaitForSingleObject(queue->thread, INFINITE);
+    CloseHandle(queue->thread);
+    DeleteCriticalSection(&queue->lock);
+#else
+    pthread_join(queue->thread, NULL);
+    pthread_cond_destroy(&queue->done);
+    pthread_cond_destroy(&queue->work);
+    pthread_mutex_destroy(&queue->lock);
+#endif
+
+    free_staging(queue);
+    free(queue);
+    return BM_OK;
+}
+
+// ----------------------------------------
+// Постановка передач
+// ----------------------------------------
+static BMResult enqueue(BMCopyQueue* queue, BMTransferKind kind, BMBuffer* buf, void* host,
+                        size_t size, size_t offset, BMTransfer** out_transfer) {
+    if (!queue || !buf || !host || size == 0 || offset > buf->size || size > buf->size - offset) {
+        BM_SET_ERROR("bm_copy_queue: некорректные аргументы передачи");
+        return BM_ERROR_INVALID_ARG;
+    }
+    // Память такого буфера отображена PROT_READ: memcpy в потоке копирования упал бы
+    if (kind == BM_TRANSFER_UPLOAD && (buf->flags & BM_BUFFER_READONLY)) {
+        BM_SET_ERROR("bm_upload_async: буфер только для чтения");
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    BMTransfer* t = (BMTransfer*)calloc(1, sizeof(BMTransfer));
+    if (!t) {
+        BM_SET_ERROR("bm_copy_queue: не удалось выделить память");
+        return BM_ERROR_NOMEM;
+    }
+    t->kind = kind;
+    t->buffer = buf;
+    t->host = host;
+    t->size = size;
+    t->offset = offset;
+    t->detached = out_transfer == NULL;
+
+    queue_lock(queue);
+    if (queue->tail) queue->tail->next = t;
+    else queue->head = t;
+    queue->tail = t;
+    ++queue->pending;
+    queue_signal_work(queue);
+    queue_unlock(queue);
+
+    if (out_transfer) *out_transfer = t;
+    return BM_OK;
+}
+
+BMResult bm_upload_async(BMCopyQueue* queue, BMBuffer* buf, const void* data, size_t size, size_t offset, BMTransfer** out_transfer) {
+    return enqueue(queue, BM_TRANSFER_UPLOAD, buf, (void*)data, size, offset, out_transfer);
+}
+
+BMResult bm_download_async(BMCopyQueue* queue, BMBuffer* buf, void* data, size_t size, size_t offset, BMTransfer** out_transfer) {
+    return enqueue(queue, BM_TRANSFER_DOWNLOAD, buf, data, size, offset, out_transfer);
+}
+
+// ----------------------------------------
+// Ожидание
+// ----------------------------------------
+BMResult bm_transfer_wait(BMCopyQueue* queue, BMTransfer* transfer) {
+    if (!queue || !transfer) {
+        BM_SET_ERROR("bm_transfer_wait: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    uint64_t trace = bm_trace_begin();
+    queue_lock(queue);
+    while (!transfer->done)
+        queue_wait_done(queue);
+    queue_unlock(queue);
+    bm_trace_end(trace, "sync", "bm_transfer_wait", NULL, 0);
+
+    BMResult res = transfer->result;
+    if (res != BM_OK) BM_SET_ERROR("bm_transfer_wait: %s", transfer->error);
+    free(transfer);
+    return res;
+}
+
+BMResult bm_copy_queue_flush(BMCopyQueue* queue) {
+    if (!queue) return BM_ERROR_INVALID_ARG;
+
+    uint64_t trace = bm_trace_begin();
+    queue_lock(queue);
+    while (queue->pending)
+        queue_wait_done(queue);
+    queue_unlock(queue);
+    bm_trace_end(trace, "sync", "bm_copy_queue_flush", NULL, 0);
+    return BM_OK;
+}
@@ -1,80 +1,172 @@
 // bm_device.c
 #include "burymetal.h"
 #include "bm_utils.h"
+#include "bm_internal.h"
 #include "bm_backend.h"
+#include "bm_mem_slab.h"
+#include "bm_mem_numa.h"
+#include "bm_mem_sysinfo.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 // -----------------------------
 // Создание устройства
 // -----------------------------
-BMResult bm_create_device(BMComputeTarget type, BMDevice** out_device) {
-    if (!out_device) return BM_ERROR_INVALID_ARG;
+// Имя CPU-устройства — модель процессора и политика NUMA
+static void cpu_device_name(BMDevice* dev) {
+    BMSysInfo sys;
+    const char* model = "CPU";
+    if (bm_sysinfo_get(&sys) == BM_SUCCESS && sys.cpu_model[0]) model = sys.cpu_model;
+    else bm_log(BM_LOG_WARN, "bm_create_device: модель CPU неизвестна: %s", bm_get_last_error());
 
-    BMDevice* dev = (BMDevice*)malloc(sizeof(BMDevice));
-    if (!dev) {
-        bm_set_last_error("bm_create_device: не удалось выделить память");
-        return BM_ERROR_NOMEM;
-    }
+    if (dev->numa_policy == BM_NUMA_BIND)
+        snprintf(dev->name, sizeof(dev->name), "%.40s (NUMA node %d)", model, dev->numa_node);
+    else if (dev->numa_policy == BM_NUMA_INTERLEAVE)
+        snprintf(dev->name, sizeof(dev->name), "%.40s (NUMA interleave)", model);
+    else
+        snprintf(dev->name, sizeof(dev->name), "%s", model);
+}
 
-    memset(dev, 0, sizeof(*dev));
-    dev->type = type;
+// Политика NUMA задаётся до калибровки: устройство на узле меряется на узле
+static BMResult create_device(BMComputeTarget type, BMNumaPolicy policy, int node, BMDevice** out_device) {
 
-    // Инициализация backend
-    if (type != BM_CPU) {
-        BMResult res = bm_backend_init_device(dev);
-        if (res != BM_OK) {
-            free(dev);
-            // bm_backend_init_device должен установить last_error
-            return res;
+    BMRecordCall rec;
+    bm_record_begin(&rec);
+    uint64_t trace = bm_trace_begin();
+    // CPU-устройство — только дескриптор; остальные создаёт backend сборки
+    BMDevice* dev = (type == BM_CPU) ? bm_handle_alloc_device() : bm_backend_create_device(type);
+    if (!dev) {
+        if (type == BM_CPU) {
+            BM_SET_ERROR("bm_create_device: не удалось выделить память");
+            return BM_ERROR_NOMEM;
         }
+        // bm_backend_create_device устанавливает last_error
+        return BM_ERROR_UNSUPPORTED;
     }
 
+    if (type == BM_CPU) { // тип backend-устройства задаёт backend
+        dev->type = BM_CPU;
+        dev->numa_policy = policy;
+        dev->numa_node = node;
+        cpu_device_name(dev);
+    }
+    if (!bm_stats_device_init(dev)) {
+        if (type == BM_CPU) bm_handle_free_device(dev);
+        else bm_backend_destroy_device(dev);
+        BM_SET_ERROR("bm_create_device: не удалось выделить память под метрики");
+        return BM_ERROR_NOMEM;
+    }
+
+    // Калибровка не мешает созданию: при ошибке только предупреждение в лог
+    bm_calibrate_on_create(dev);
+
     *out_device = dev;
-    bm_log(BM_LOG_INFO, "Устройство создано: %s", 
-           (type == BM_CPU) ? "CPU" : "GPU/Backend");
+    bm_trace_end(trace, "device", "bm_create_device", "type", (uint64_t)type);
+    bm_record_end(&rec, BM_RECORD_CREATE_DEVICE, NULL, dev, (uint64_t)type, 0, BM_OK);
+    bm_log(BM_LOG_INFO, "Устройство создано: %s", dev->name);
     return BM_OK;
 }
 
+BMResult bm_create_device(BMComputeTarget type, BMDevice** out_device) {
+    if (!out_device) return BM_ERROR_INVALID_ARG;
+    return create_device(type, BM_NUMA_DEFAULT, -1, out_device);
+}
+
 // -----------------------------
 // Уничтожение устройства
 // -----------------------------
 BMResult bm_destroy_device(BMDevice* device) {
     if (!device) return BM_OK;
 
-    if (device->type != BM_CPU && device->backend_context) {
-        BMResult res = bm_backend_destroy_device(device);
-        if (res != BM_OK) {
-            bm_set_last_error("bm_destroy_device: ошибка backend при уничтожении");
-            return res;
-        }
-    }
-
+    BMRecordCall rec;
+    bm_record_begin_destroy(&rec);
     bm_log(BM_LOG_INFO, "Устройство уничтожено");
-    free(device);
+    bm_alloc_track_device_destroy(device);
+    bm_stats_device_destroy(device);
+    // Дескриптор устройства backend'а освобождает сам backend
+    if (device->type == BM_CPU) bm_handle_free_device(device);
+    else bm_backend_destroy_device(device);
+    bm_record_end(&rec, BM_RECORD_DESTROY_DEVICE, device, NULL, 0, 0, BM_OK);
     return BM_OK;
 }
 
 // -----------------------------
 // Получение информации о устройстве
 // -----------------------------
+// CPU-устройства создаёт и описывает ядро при любом backend'е сборки;
+// bm_backend_query_device — только для устройств backend'а
 BMResult bm_query_device(BMDevice* device, BMDeviceInfo* info) {
     if (!device || !info) return BM_ERROR_INVALID_ARG;
 
+    memset(info, 0, sizeof(*info));
     if (device->type == BM_CPU) {
-        info->name = "CPU";
-        info->compute_units = 1;   // пример
-        info->memory_size = 0;     // RAM не отслеживаем
+        BMSysInfo sys;
+        if (bm_sysinfo_get(&sys) != BM_SUCCESS) {
+            BM_SET_ERROR("bm_query_device: не удалось получить сведения о системе: %s", bm_get_last_error());
+            return BM_ERROR_INTERNAL;
+        }
+        info->type = BM_CPU;
+        memcpy(info->name, device->name, sizeof(info->name));
+        info->compute_units = sys.cpu_budget;
+        info->memory_size = (size_t)sys.memory_total;
+        info->memory_available = (size_t)sys.memory_available;
+        info->cpus_online = sys.cpus_online;
+        info->cpus_allowed = sys.cpus_allowed;
+        info->cpu_quota = sys.cpu_quota;
+        info->cache_line = sys.cache_line;
+        info->cache_l1d = sys.cache_l1d;
+        info->cache_l2 = sys.cache_l2;
+        info->cache_l3 = sys.cache_l3;
+        info->simd = sys.simd;
+        info->calibration = device->calibration;
+        info->numa_node = -1;
+        info->numa_node_count = bm_numa_node_count();
+        if (device->numa_policy == BM_NUMA_BIND) {
+            info->numa_node = device->numa_node;
+            // Квота cgroup делится на весь процесс — узлу достаётся не больше неё
+            int node_cpus = bm_numa_node_cpu_count(device->numa_node);
+            if (node_cpus < info->compute_units) info->compute_units = node_cpus;
+            size_t node_memory = bm_numa_node_memory(device->numa_node);
+            if (node_memory && node_memory < info->memory_size) info->memory_size = node_memory;
+            if (info->memory_available > info->memory_size) info->memory_available = info->memory_size;
+        }
+        info->memory_total = (uint32_t)(info->memory_size >> 20);
+        info->memory_free = (uint32_t)(info->memory_available >> 20);
         return BM_OK;
     }
 
     // Для GPU делегируем backend
-    BMResult res = bm_backend_query_device(device, info);
-    if (res != BM_OK) {
-        bm_set_last_error("bm_query_device: ошибка backend");
-        return res;
+    if (bm_backend_query_device(device, info) != BM_STATUS_OK) {
+        BM_SET_ERROR("bm_query_device: ошибка backend");
+        return BM_ERROR_INTERNAL;
+    }
+
+    return BM_OK;
+}
+
+// -----------------------------
+// NUMA: CPU-устройство на узле или с чередованием узлов
+// -----------------------------
+BMResult bm_create_device_numa(BMNumaPolicy policy, int node, BMDevice** out_device) {
+    if (!out_device || policy > BM_NUMA_INTERLEAVE) return BM_ERROR_INVALID_ARG;
+
+    if (policy == BM_NUMA_BIND && bm_numa_node_cpu_count(node) == 0) {
+        BM_SET_ERROR("bm_create_device_numa: NUMA-узел %d не найден или без CPU", node);
+        return BM_ERROR_INVALID_ARG;
     }
 
+    BMDevice* dev = NULL;
+    BMResult res = create_device(BM_CPU, policy, policy == BM_NUMA_BIND ? node : -1, &dev);
+    if (res != BM_OK) return res;
+
+    *out_device = dev;
+    bm_log(BM_LOG_INFO, "CPU-устройство на NUMA: policy=%d node=%d", (int)policy, dev->numa_node);
     return BM_OK;
 }
+
+BMResult bm_device_bind_thread(BMDevice* device) {
+    if (!device || device->type != BM_CPU) return BM_ERROR_INVALID_ARG;
+    return bm_numa_bind_thread(device) == BM_SUCCESS ? BM_OK : BM_ERROR_INTERNAL;
+}
@@ -0,0 +1,287 @@
+#ifndef BM_INTERNAL_H
+#define BM_INTERNAL_H
+
+// Внутренние объявления библиотеки: ленивые ошибки, хуки трассировки,
+// профилирования, записи, учёта выделений и метрик. В публичные заголовки не
+// попадают: include-путь src/core есть только у библиотеки, её тестов и tools/.
+#include <stdio.h>
+#include <stdint.h>
+#include "bm_types.h"
+#include "bm_utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- Ошибки без форматирования ---
+// BM_SET_ERROR запоминает формат и до BM_ERROR_MAX_ARGS аргументов (строки
+// копируются), а текст собирается только в bm_get_last_error() — ошибки на
+// горячих путях не стоят vsnprintf. Формат — строковый литерал (иначе не
+// соберётся), больше BM_ERROR_MAX_ARGS аргументов тоже ошибка компиляции.
+// В C++ (nvidia backend) это обычный bm_set_last_error.
+#define BM_ERROR_MAX_ARGS 6
+
+typedef struct BMErrorArg {
+    char type;                  // 'i', 'u', 'f', 's', 'p'
+    union {
+        long long i;
+        unsigned long long u;
+        double f;
+        const char* s;
+        const void* p;
+    } value;
+} BMErrorArg;
+
+void bm_set_last_error_args(const char* fmt, const BMErrorArg* args, int count);
+
+#ifndef __cplusplus
+static inline BMErrorArg bm_error_arg_i(long long v) { BMErrorArg a = {'i', {.i = v}}; return a; }
+static inline BMErrorArg bm_error_arg_u(unsigned long long v) { BMErrorArg a = {'u', {.u = v}}; return a; }
+static inline BMErrorArg bm_error_arg_f(double v) { BMErrorArg a = {'f', {.f = v}}; return a; }
+static inline BMErrorArg bm_error_arg_s(const char* v) { BMErrorArg a = {'s', {.s = v}}; return a; }
+static inline BMErrorArg bm_error_arg_p(const void* v) { BMErrorArg a = {'p', {.p = v}}; return a; }
+
+#define BM_ERROR_ARG(x) _Generic((x),                                           \
+    char*: bm_error_arg_s, const char*: bm_error_arg_s,                         \
+    float: bm_error_arg_f, double: bm_error_arg_f,                              \
+    char: bm_error_arg_i, signed char: bm_error_arg_i, short: bm_error_arg_i,   \
+    int: bm_error_arg_i, long: bm_error_arg_i, long long: bm_error_arg_i,       \
+    _Bool: bm_error_arg_u, unsigned char: bm_error_arg_u,                       \
+    unsigned short: bm_error_arg_u, unsigned int: bm_error_arg_u,               \
+    unsigned long: bm_error_arg_u, unsigned long long: bm_error_arg_u,          \
+    default: bm_error_arg_p)(x)
+
+#define BM_ERROR_NARGS_(_0, _1, _2, _3, _4, _5, _6, n, ...) n
+#define BM_ERROR_NARGS(...) BM_ERROR_NARGS_(__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0, -)
+#define BM_ERROR_CAT_(a, b) a##b
+#define BM_ERROR_CAT(a, b) BM_ERROR_CAT_(a, b)
+#define BM_ERROR_SET_(fmt, n, ...) bm_set_last_error_args(("" fmt), (const BMErrorArg[]){__VA_ARGS__}, (n))
+#define BM_ERROR_SET_0(fmt) bm_set_last_error_args(("" fmt), NULL, 0)
+#define BM_ERROR_SET_1(fmt, a) BM_ERROR_SET_(fmt, 1, BM_ERROR_ARG(a))
+#define BM_ERROR_SET_2(fmt, a, b) BM_ERROR_SET_(fmt, 2, BM_ERROR_ARG(a), BM_ERROR_ARG(b))
+#define BM_ERROR_SET_3(fmt, a, b, c) \
+    BM_ERROR_SET_(fmt, 3, BM_ERROR_ARG(a), BM_ERROR_ARG(b), BM_ERROR_ARG(c))
+#define BM_ERROR_SET_4(fmt, a, b, c, d) \
+    BM_ERROR_SET_(fmt, 4, BM_ERROR_ARG(a), BM_ERROR_ARG(b), BM_ERROR_ARG(c), BM_ERROR_ARG(d))
+#define BM_ERROR_SET_5(fmt, a, b, c, d, e) \
+    BM_ERROR_SET_(fmt, 5, BM_ERROR_ARG(a), BM_ERROR_ARG(b), BM_ERROR_ARG(c), BM_ERROR_ARG(d), BM_ERROR_ARG(e))
+#define BM_ERROR_SET_6(fmt, a, b, c, d, e, f) \
+    BM_ERROR_SET_(fmt, 6, BM_ERROR_ARG(a), BM_ERROR_ARG(b), BM_ERROR_ARG(c), BM_ERROR_ARG(d), BM_ERROR_ARG(e), \
+                  BM_ERROR_ARG(f))
+
+#define BM_SET_ERROR(...) BM_ERROR_CAT(BM_ERROR_SET_, BM_ERROR_NARGS(__VA_ARGS__))(__VA_ARGS__)
+#else
+#define BM_SET_ERROR(...) BM_SET_ERROR(__VA_ARGS__)
+#endif // !__cplusplus
+
+// --- Время ---
+uint64_t bm_now_ns(void);   // монотонные наносекунды
+
+// --- Файлы ---
+// Для записи через временный файл и rename: данные — на диск до rename,
+// запись каталога о rename — после. 0 — ошибка (errno от fflush/fsync).
+int bm_file_sync(FILE* file);               // fflush + fsync
+int bm_sync_parent_dir(const char* path);   // fsync каталога, где лежит path
+
+// --- Трассировка ---
+// Включается bm_trace_start (burymetal.h). Интервал размечается парой
+//   uint64_t t = bm_trace_begin(); ...; bm_trace_end(t, "категория", имя, "аргумент", значение);
+// Категория и имя аргумента — статические строки (arg_name может быть NULL),
+// имя копируется. Пока трассировка выключена, это одна загрузка флага.
+// bm_trace_suspend_thread(1) выключает её только в текущем потоке (возвращает прежнее).
+extern int bm_trace_active;
+
+uint64_t bm_trace_clock(void);   // 0 — поток приостановлен
+int bm_trace_suspend_thread(int suspend);
+
+void bm_trace_record(uint64_t begin_ns, const char* category, const char* name,
+                     const char* arg_name, uint64_t arg);
+
+static inline uint64_t bm_trace_begin(void) {
+    return BM_ATOMIC_LOAD_RELAXED(&bm_trace_active) ? bm_trace_clock() : 0;
+}
+
+static inline void bm_trace_end(uint64_t begin_ns, const char* category, const char* name,
+                                const char* arg_name, uint64_t arg) {
+    if (begin_ns) bm_trace_record(begin_ns, category, name, arg_name, arg);
+}
+
+// --- Профилирование ядер ---
+// Запуск ядра размечается парой bm_profile_begin/bm_profile_end на стеке;
+// пока профилирование выключено, это одна загрузка флага.
+#define BM_PROFILE_COUNTER_COUNT 5
+
+extern int bm_profile_active;
+
+typedef struct BMProfileSample {
+    uint64_t start_ns;          // 0 — профилирование выключено
+    uint64_t values[BM_PROFILE_COUNTER_COUNT];
+    uint64_t enabled_ns;
+    uint64_t running_ns;
+    int counters;
+} BMProfileSample;
+
+int bm_profile_suspend_thread(int suspend);   // только текущий поток, возвращает прежнее
+void bm_profile_sample_begin(BMProfileSample* sample);
+void bm_profile_sample_end(BMProfileSample* sample, const char* kernel_name);
+
+static inline void bm_profile_begin(BMProfileSample* sample) {
+    sample->start_ns = 0;
+    if (BM_ATOMIC_LOAD_RELAXED(&bm_profile_active)) bm_profile_sample_begin(sample);
+}
+
+static inline void bm_profile_end(BMProfileSample* sample, const char* kernel_name) {
+    if (sample->start_ns) bm_profile_sample_end(sample, kernel_name);
+}
+
+// --- Запись вызовов ---
+// Включается bm_record_start (burymetal.h). Вызов API размечается так:
+//   BMRecordCall rec; bm_record_begin(&rec); ...; bm_record_end(&rec, op, объект, цель, a0, a1, результат);
+// Для вызовов, уничтожающих объект, — bm_record_begin_destroy: порядковый номер
+// берётся до освобождения, чтобы повторно выданный адрес получил номер позже.
+// Формат файла (его читает tools/bm_replay.c): BMRecordHeader, затем
+// 64-байтные BMRecordEvent потоков пачками; за REGISTER_KERNEL, POOL_CREATE и
+// MAP_BUFFER следует ещё один 64-байтный блок данных (имя ядра / параметры
+// пула / флаги map). Версия 2 добавила операции от WRAP_HOST и дальше.
+// Не записываются: bm_buffer_export_fd и fence'ы разделяемых буферов, передачи
+// BMCopyQueue и BMLoader (идут в backend мимо bm_write_buffer), буферы
+// bm_snapshot_open на CPU-устройстве (обёртки payload'ов файла).
+#define BM_RECORD_MAGIC   "BMREC\0\0\1"
+#define BM_RECORD_VERSION 2
+
+typedef enum {
+    BM_RECORD_CREATE_DEVICE = 1,    // цель — устройство, a0 — BMComputeTarget
+    BM_RECORD_DESTROY_DEVICE,       // объект — устройство
+    BM_RECORD_ALLOC_BUFFER,         // объект — устройство, цель — буфер, a0 — размер
+    BM_RECORD_FREE_BUFFER,          // объект — буфер, цель — его устройство
+    BM_RECORD_WRITE_BUFFER,         // объект — буфер, a0 — размер, a1 — смещение
+    BM_RECORD_READ_BUFFER,          // то же
+    BM_RECORD_REGISTER_KERNEL,      // объект — устройство, цель — ядро; блок — имя
+    BM_RECORD_UNREGISTER_KERNEL,    // объект — ядро, цель — его устройство
+    BM_RECORD_LAUNCH_KERNEL,        // объект — ядро, цель — буфер, a0 — count
+    BM_RECORD_POOL_CREATE,          // объект — устройство, цель — пул, a0 — buffer_size,
+                                    // a1 — initial_count; блок — grow_chunk, max_count,
+                                    // idle_shrink_ms, alloc_flags (uint64_t)
+    BM_RECORD_POOL_DESTROY,         // объект — пул, цель — его устройство
+    BM_RECORD_POOL_ACQUIRE,         // объект — пул, цель — буфер, a0 — timeout_ms (int64_t)
+    BM_RECORD_POOL_RELEASE,         // объект — пул, цель — буфер
+    BM_RECORD_WRAP_HOST,            // объект — устройство, цель — буфер, a0 — размер, a1 — BM_WRAP_*
+    BM_RECORD_CLONE_BUFFER,         // объект — исходный буфер, цель — копия, a0 — BM_CLONE_*
+    BM_RECORD_MAP_FILE,             // объект — устройство, цель — буфер, a0 — размер, a1 — BM_FILE_*
+    BM_RECORD_CREATE_SHARED,        // объект — устройство, цель — буфер, a0 — размер,
+                                    // a1 — 1, если объект именованный
+    BM_RECORD_IMPORT_SHARED,        // объект — устройство, цель — буфер, a0 — размер, a1 — BM_SHARED_*
+    BM_RECORD_MAP_BUFFER,           // объект — буфер, цель — указатель, a0 — длина, a1 — смещение;
+                                    // блок — BM_MAP_* (uint64_t)
+    BM_RECORD_UNMAP_BUFFER,         // объект — буфер, цель — указатель
+    BM_RECORD_WRITE_REGIONS,        // объект — буфер, a0 — байт во всех фрагментах, a1 — их число
+    BM_RECORD_READ_REGIONS,         // то же
+    BM_RECORD_OP_COUNT
+} BMRecordOp;
+
+typedef struct BMRecordHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t event_size;            // sizeof(BMRecordEvent)
+    uint64_t start_unix_ns;         // время начала записи (CLOCK_REALTIME)
+    uint64_t reserved[5];
+} BMRecordHeader;
+
+typedef struct BMRecordEvent {
+    uint16_t op;                    // BMRecordOp
+    uint16_t thread;                // номер потока в записи (с 1)
+    int32_t result;                 // BMResult
+    uint64_t seq;                   // общий порядок вызовов
+    uint64_t start_ns;              // от bm_record_start
+    uint64_t duration_ns;
+    uint64_t object;                // адреса объектов при записи (0 — нет)
+    uint64_t target;
+    uint64_t args[2];
+} BMRecordEvent;
+
+typedef struct BMRecordCall {
+    uint64_t start_ns;              // 0 — запись выключена
+    uint64_t seq;                   // 0 — номер берётся в bm_record_end
+} BMRecordCall;
+
+extern int bm_record_active;
+
+uint64_t bm_record_clock(void);              // 0 — поток приостановлен
+int bm_record_suspend_thread(int suspend);   // только текущий поток, возвращает прежнее
+uint64_t bm_record_next_seq(void);
+void bm_record_call(BMRecordCall* call, BMRecordOp op, const void* object, const void* target,
+                    uint64_t arg0, uint64_t arg1, int result, const void* data, size_t data_size);
+
+static inline void bm_record_begin(BMRecordCall* call) {
+    call->start_ns = BM_ATOMIC_LOAD_RELAXED(&bm_record_active) ? bm_record_clock() : 0;
+    call->seq = 0;
+}
+
+static inline void bm_record_begin_destroy(BMRecordCall* call) {
+    bm_record_begin(call);
+    if (call->start_ns) call->seq = bm_record_next_seq();
+}
+
+static inline void bm_record_end(BMRecordCall* call, BMRecordOp op, const void* object, const void* target,
+                                 uint64_t arg0, uint64_t arg1, int result) {
+    if (call->start_ns) bm_record_call(call, op, object, target, arg0, arg1, result, NULL, 0);
+}
+
+// --- Учёт выделений ---
+// Включается bm_alloc_track_start (burymetal.h). Выделение размечается так:
+//   int track = bm_alloc_track_begin(); ...; bm_alloc_track_end(track, ptr, size, устройство, вид);
+// (ptr == NULL — выделение не удалось), освобождение — bm_alloc_track_free(ptr).
+// Между begin и end учёт в потоке приостановлен: вложенные bm_cpu_alloc внутри
+// bm_alloc_buffer или буфера пула не считаются второй раз.
+extern int bm_alloc_track_active;
+
+int bm_alloc_track_suspend(void);
+void bm_alloc_track_resume(const void* ptr, size_t size, BMDevice* device, BMAllocKind kind);
+void bm_alloc_track_remove(const void* ptr);
+void bm_alloc_track_device_destroy(BMDevice* device);
+
+static inline int bm_alloc_track_begin(void) {
+    return BM_ATOMIC_LOAD_RELAXED(&bm_alloc_track_active) ? bm_alloc_track_suspend() : 0;
+}
+
+static inline void bm_alloc_track_end(int track, const void* ptr, size_t size, BMDevice* device, BMAllocKind kind) {
+    if (track) bm_alloc_track_resume(ptr, size, device, kind);
+}
+
+static inline void bm_alloc_track_free(const void* ptr) {
+    if (BM_ATOMIC_LOAD_RELAXED(&bm_alloc_track_active)) bm_alloc_track_remove(ptr);
+}
+
+// --- Калибровка ---
+// Вызывается из bm_create_device: калибрует CPU-устройство, если она включена
+// bm_set_calibration; ошибка только пишется в лог
+void bm_calibrate_on_create(BMDevice* device);
+
+// --- Метрики ---
+typedef enum {
+    BM_STAT_LAUNCHES = 0,
+    BM_STAT_LAUNCH_NS,
+    BM_STAT_BYTES_UPLOADED,
+    BM_STAT_BYTES_DOWNLOADED,
+    BM_STAT_ALLOCATIONS,
+    BM_STAT_FREES,
+    BM_STAT_POOL_HITS,
+    BM_STAT_POOL_MISSES,
+    BM_STAT_POOL_WAIT_NS,
+    BM_STAT_COUNT
+} BMStatCounter;
+
+int bm_stats_device_init(BMDevice* device);     // 0 — не хватило памяти
+void bm_stats_device_destroy(BMDevice* device);
+void bm_stats_add(BMDevice* device, BMStatCounter counter, uint64_t value);
+void bm_stats_launch(BMKernel* kernel, uint64_t ns);
+void bm_stats_alloc(BMDevice* device, uint64_t bytes);
+void bm_stats_free(BMDevice* device, uint64_t bytes);
+void bm_stats_adopt(BMBuffer* buffer);          // учесть обёртку как выделение (BM_BUFFER_COUNTED)
+void bm_stats_pool_acquire(BMDevice* device, int hit, uint64_t wait_ns);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // BM_INTERNAL_H
@@ -2,55 +2,61 @@
 #include "burymetal.h"
 #include "bm_backend.h"
 #include "bm_utils.h"
+#include "bm_internal.h"
+#include "bm_mem_slab.h"
 
 #include <stdlib.h>
 #include <string.h>
 
-#define BM_KERNEL_NAME_MAX 64
-
 // -----------------------------
 // Регистрация ядра (CPU-функция)
 // -----------------------------
 BMKernel* bm_register_kernel(BMDevice* device, const char* name, BMKernelFunc func) {
     if (!device || !name || !func) {
-        bm_set_last_error("bm_register_kernel: некорректные аргументы");
+        BM_SET_ERROR("bm_register_kernel: некорректные аргументы");
         return NULL;
     }
 
-    BMKernel* kernel = (BMKernel*)malloc(sizeof(BMKernel));
+    BMRecordCall rec;
+    bm_record_begin(&rec);
+    BMKernel* kernel = bm_handle_alloc_kernel();
     if (!kernel) {
-        bm_set_last_error("bm_register_kernel: не удалось выделить память");
+        BM_SET_ERROR("bm_register_kernel: не удалось выделить память");
         return NULL;
     }
 
-    memset(kernel, 0, sizeof(*kernel));
     kernel->device = device;
+    kernel->type = device->type;
     kernel->cpu_func = func;
     kernel->backend_kernel = NULL;
-    strncpy(kernel->name, name, BM_KERNEL_NAME_MAX - 1);
-    kernel->name[BM_KERNEL_NAME_MAX - 1] = '\0';
+    strncpy(kernel->cold->name, name, BM_KERNEL_NAME_MAX - 1);
+    kernel->cold->name[BM_KERNEL_NAME_MAX - 1] = '\0';
+    if (rec.start_ns)
+        bm_record_call(&rec, BM_RECORD_REGISTER_KERNEL, device, kernel, 0, 0, BM_OK,
+                       kernel->cold->name, BM_KERNEL_NAME_MAX);
 
-    bm_log(BM_LOG_INFO, "CPU kernel зарегистрировано: %s", kernel->name);
+    bm_log(BM_LOG_INFO, "CPU kernel зарегистрировано: %s", kernel->cold->name);
     return kernel;
 }
 
 // -----------------------------
 // Загрузка ядра из backend (GPU)
 // -----------------------------
-BMKernel* bm_load_kernel_from_backend(BMDevice* device, const char* path) {
-    if (!device || !path) {
-        bm_set_last_error("bm_load_kernel_from_backend: некорректные аргументы");
-        return NULL;
+BMResult bm_load_kernel(BMDevice* device, const char* kernel_path, BMKernel** out_kernel) {
+    if (!device || !kernel_path || !out_kernel) {
+        BM_SET_ERROR("bm_load_kernel: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
     }
 
-    BMKernel* kernel = bm_backend_load_kernel(device, path);
+    BMKernel* kernel = bm_backend_load_kernel(device, kernel_path);
     if (!kernel) {
         // bm_backend_load_kernel должен установить last_error
-        return NULL;
+        return BM_ERROR_INTERNAL;
     }
 
-    bm_log(BM_LOG_INFO, "Backend kernel загружено: %s", kernel->name);
-    return kernel;
+    bm_log(BM_LOG_INFO, "Backend kernel загружено: %s", kernel->cold->name);
+    *out_kernel = kernel;
+    return BM_OK;
 }
 
 // -----------------------------
@@ -58,35 +64,61 @@ BMKernel* bm_load_kernel_from_backend(BMDevice* device, const char* path) {
 // -----------------------------
 BMResult bm_launch_kernel(BMKernel* kernel, BMBuffer* buf, size_t count) {
     if (!kernel || !buf || !buf->data) {
-        bm_set_last_error("bm_launch_kernel: некорректные аргументы или буфер не инициализирован");
+        BM_SET_ERROR("bm_launch_kernel: некорректные аргументы или буфер не инициализирован");
+        return BM_ERROR_INVALID_ARG;
+    }
+    // Ядро меняет буфер на месте: страницы read-only отображения ему не отдаём
+    if (buf->flags & BM_BUFFER_READONLY) {
+        BM_SET_ERROR("bm_launch_kernel: буфер только для чтения");
         return BM_ERROR_INVALID_ARG;
     }
 
-    // CPU режим
-    if (kernel->device->type == BM_CPU) {
+    // CPU режим (тип устройства продублирован в горячей части ядра)
+    if (kernel->type == BM_CPU) {
         if (!kernel->cpu_func) {
-            bm_set_last_error("bm_launch_kernel: CPU-ядро не задано");
+            BM_SET_ERROR("bm_launch_kernel: CPU-ядро не задано");
             return BM_ERROR_INTERNAL;
         }
+        BMProfileSample profile;
+        BMRecordCall rec;
+        bm_record_begin(&rec);
+        uint64_t trace = bm_trace_begin();
+        uint64_t start = bm_now_ns();
+        bm_profile_begin(&profile);
         kernel->cpu_func(buf->data, count);
-        bm_log(BM_LOG_INFO, "CPU kernel %s выполнено на %zu элементов", kernel->name, count);
+        bm_profile_end(&profile, kernel->cold->name);
+        bm_stats_launch(kernel, bm_now_ns() - start);
+        bm_trace_end(trace, "kernel", kernel->cold->name, "count", count);
+        bm_record_end(&rec, BM_RECORD_LAUNCH_KERNEL, kernel, buf, count, 0, BM_OK);
+        // Строка на каждый запуск — только на DEBUG: макрос проверяет уровень до
+        // вызова, и kernel->cold на обычном уровне не читается
+        bm_log_debug("CPU kernel %s выполнено на %zu элементов", kernel->cold->name, count);
         return BM_OK;
     }
 
     // GPU / Backend режим
     if (!kernel->backend_kernel) {
-        bm_set_last_error("bm_launch_kernel: backend ядро не загружено");
+        BM_SET_ERROR("bm_launch_kernel: backend ядро не загружено");
         return BM_ERROR_INVALID_ARG;
     }
 
-    BMResult res = bm_backend_launch_kernel(kernel, buf, count);
+    BMProfileSample profile;
+    BMRecordCall rec;
+    bm_record_begin(&rec);
+    uint64_t trace = bm_trace_begin();
+    uint64_t start = bm_now_ns();
+    bm_profile_begin(&profile);
+    BMResult res = bm_backend_run_kernel(kernel, buf, count) == BM_STATUS_OK ? BM_OK : BM_ERROR_INTERNAL;
+    bm_profile_end(&profile, kernel->cold->name);
+    bm_stats_launch(kernel, bm_now_ns() - start);
+    bm_trace_end(trace, "kernel", kernel->cold->name, "count", count);
+    bm_record_end(&rec, BM_RECORD_LAUNCH_KERNEL, kernel, buf, count, 0, res);
     if (res != BM_OK) {
-        // bm_backend_launch_kernel должен установить last_error
-        bm_set_last_error("bm_launch_kernel: ошибка backend при запуске ядра");
+        // bm_backend_run_kernel устанавливает last_error
         return res;
     }
 
-    bm_log(BM_LOG_INFO, "Backend kernel %s выполнено на %zu элементов", kernel->name, count);
+    bm_log_debug("Backend kernel %s выполнено на %zu элементов", kernel->cold->name, count);
     return BM_OK;
 }
 
@@ -96,10 +128,17 @@ BMResult bm_launch_kernel(BMKernel* kernel, BMBuffer* buf, size_t count) {
 void bm_unregister_kernel(BMKernel* kernel) {
     if (!kernel) return;
 
-    if (kernel->backend_kernel) {
-        bm_backend_destroy_kernel(kernel);
-    }
+    BMRecordCall rec;
+    bm_record_begin_destroy(&rec);
+    BMDevice* device = kernel->device;
+    bm_log(BM_LOG_INFO, "Ядро уничтожено: %s", kernel->cold->name);
+    // Дескриптор ядра backend'а освобождает сам backend
+    if (kernel->backend_kernel) bm_backend_destroy_kernel(kernel);
+    else bm_handle_free_kernel(kernel);
+    bm_record_end(&rec, BM_RECORD_UNREGISTER_KERNEL, kernel, device, 0, 0, BM_OK);
+}
 
-    bm_log(BM_LOG_INFO, "Ядро уничтожено: %s", kernel->name);
-    free(kernel);
+BMResult bm_destroy_kernel(BMKernel* kernel) {
+    bm_unregister_kernel(kernel);
+    return BM_OK;
 }
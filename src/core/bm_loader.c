@@ -0,0 +1,673 @@
+// bm_loader.c
+#ifndef _WIN32
+#define _GNU_SOURCE
+#endif
+
+#include "burymetal.h"
+#include "bm_utils.h"
+#include "bm_internal.h"
+#include "bm_backend.h"
+#include "bm_mem_utils.h"
+#include "bm_mem_numa.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define BM_HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+// ----------------------------------------
+// Загрузчик файлов в буферы
+// ----------------------------------------
+// Рабочий поток режет запросы на блоки по block_size и держит до queue_depth
+// чтений в полёте через io_uring (raw-syscalls, без liburing). Блок читается
+// прямо в host-память буфера, если она видна и O_DIRECT не нужен; иначе — в
+// выровненный staging-блок с последующим bm_backend_upload_range.
+// Без io_uring (старое ядро, seccomp) те же блоки читаются pread'ом.
+
+#define BM_LOADER_DEFAULT_DEPTH 64
+#define BM_LOADER_DEFAULT_BLOCK (1024u * 1024u)
+#define BM_LOADER_DIRECT_ALIGN  4096u   // выравнивание адреса/смещения/длины для O_DIRECT
+#define BM_LOADER_MAX_BLOCK     (1u << 30)  // длина SQE — 32 бита
+#define BM_LOADER_CANCEL_TAG    UINT64_MAX  // user_data SQE отмены
+
+#ifndef _WIN32
+
+struct BMLoadEvent {
+    BMLoadRequest* requests;    // копия запросов
+    int* fds;
+    int* direct;                // файл открыт с O_DIRECT
+    size_t count;
+
+    size_t next_request;        // разбивка на блоки
+    uint64_t next_pos;          // позиция внутри текущего запроса
+    size_t inflight;
+
+    BMResult result;
+    char error[256];
+    int done;
+    struct BMLoadEvent* next;
+    struct BMLoadEvent* live_prev;  // события, ещё не отданные bm_load_event_wait
+    struct BMLoadEvent* live_next;
+};
+
+typedef struct BMLoadSlot {
+    int busy;
+    BMLoadEvent* event;
+    size_t request;
+    char* staging;              // выровненный блок под O_DIRECT и буферы без host-памяти
+
+    int fd;
+    uint64_t pos;               // следующая позиция чтения в файле
+    char* dst;                  // куда ляжет следующая порция
+    size_t want;                // сколько ещё читать
+
+    int staged;
+    size_t skip;                // байт выравнивания перед полезными данными
+    size_t useful;              // полезных байт в блоке
+    size_t got;
+    size_t buffer_offset;
+} BMLoadSlot;
+
+struct BMLoader {
+    BMDevice* device;
+    unsigned depth;
+    size_t block_size;
+    int direct_io;
+    BMLoadSlot* slots;
+
+    BMLoadEvent* head;
+    BMLoadEvent* tail;
+    BMLoadEvent* live;          // все неосвобождённые события (bm_loader_destroy)
+    int stop;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    pthread_t thread;
+
+#ifdef BM_HAVE_IO_URING
+    int ring_fd;                // -1 — io_uring недоступен, работаем через pread
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+    void* sq_map;
+    size_t sq_map_size;
+    void* cq_map;
+    size_t cq_map_size;
+    size_t sqes_size;
+#endif
+};
+
+static void event_fail(BMLoadEvent* ev, BMResult code, const char* fmt, ...) {
+    if (ev->result != BM_OK) return; // важна первая ошибка
+    ev->result = code;
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(ev->error, sizeof(ev->error), fmt, args);
+    va_end(args);
+}
+
+// ----------------------------------------
+// io_uring
+// ----------------------------------------
+#ifdef BM_HAVE_IO_URING
+
+static int ring_setup(BMLoader* loader) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    // Вдвое больше слотов: при отказе enter в SQ могут лежать и чтения, и их отмены
+    int fd = (int)syscall(__NR_io_uring_setup, loader->depth * 2, &params);
+    if (fd < 0) return 0;
+
+    loader->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    loader->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    int single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && loader->cq_map_size > loader->sq_map_size)
+        loader->sq_map_size = loader->cq_map_size;
+
+    loader->sq_map = mmap(NULL, loader->sq_map_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    loader->cq_map = single ? loader->sq_map
+                            : mmap(NULL, loader->cq_map_size, PROT_READ | PROT_WRITE,
+                                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    loader->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    loader->sqes = (struct io_uring_sqe*)mmap(NULL, loader->sqes_size, PROT_READ | PROT_WRITE,
+                                              MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (loader->sq_map == MAP_FAILED || loader->cq_map == MAP_FAILED || loader->sqes == MAP_FAILED) {
+        if (loader->sq_map != MAP_FAILED) munmap(loader->sq_map, loader->sq_map_size);
+        if (!single && loader->cq_map != MAP_FAILED) munmap(loader->cq_map, loader->cq_map_size);
+        if (loader->sqes != MAP_FAILED) munmap(loader->sqes, loader->sqes_size);
+        close(fd);
+        return 0;
+    }
+
+    char* sq = (char*)loader->sq_map;
+    char* cq = (char*)loader->cq_map;
+    loader->sq_head = (unsigned*)(sq + params.sq_off.head);
+    loader->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    loader->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    loader->sq_array = (unsigned*)(sq + params.sq_off.array);
+    loader->cq_head = (unsigned*)(cq + params.cq_off.head);
+    loader->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    loader->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    loader->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    loader->ring_fd = fd;
+    return 1;
+}
+
+static void ring_teardown(BMLoader* loader) {
+    if (loader->ring_fd < 0) return;
+    munmap(loader->sqes, loader->sqes_size);
+    if (loader->cq_map != loader->sq_map) munmap(loader->cq_map, loader->cq_map_size);
+    munmap(loader->sq_map, loader->sq_map_size);
+    close(loader->ring_fd);
+    loader->ring_fd = -1;
+}
+
+// Очередная свободная SQE (видна ядру после ring_push)
+static struct io_uring_sqe* ring_sqe(BMLoader* loader) {
+    struct io_uring_sqe* sqe = &loader->sqes[*loader->sq_tail & *loader->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+static void ring_push(BMLoader* loader) {
+    unsigned tail = *loader->sq_tail;
+    unsigned at = tail & *loader->sq_mask;
+    loader->sq_array[at] = at;
+    __atomic_store_n(loader->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// Кладёт чтение слота в SQ (отправка — в ring_enter)
+static void ring_queue_read(BMLoader* loader, BMLoadSlot* slot, size_t index) {
+    struct io_uring_sqe* sqe = ring_sqe(loader);
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = slot->fd;
+    sqe->off = slot->pos;
+    sqe->addr = (uint64_t)(uintptr_t)slot->dst;
+    sqe->len = (uint32_t)slot->want;
+    sqe->user_data = index;
+    ring_push(loader);
+}
+
+// Отмена чтения слота index; её собственный CQE помечен BM_LOADER_CANCEL_TAG
+static void ring_queue_cancel(BMLoader* loader, size_t index) {
+    struct io_uring_sqe* sqe = ring_sqe(loader);
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = index;
+    sqe->user_data = BM_LOADER_CANCEL_TAG;
+    ring_push(loader);
+}
+
+// Отправляет всё, что лежит в SQ (в том числе не принятое прошлым вызовом)
+static int ring_enter(BMLoader* loader, unsigned min_complete) {
+    unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+    for (;;) {
+        unsigned to_submit = *loader->sq_tail - __atomic_load_n(loader->sq_head, __ATOMIC_ACQUIRE);
+        long res = syscall(__NR_io_uring_enter, loader->ring_fd, to_submit, min_complete, flags, NULL, 0);
+        if (res >= 0 || errno != EINTR) return res >= 0;
+    }
+}
+
+#endif // BM_HAVE_IO_URING
+
+// ----------------------------------------
+// Блоки
+// ----------------------------------------
+static uint64_t align_down(uint64_t v) { return v & ~(uint64_t)(BM_LOADER_DIRECT_ALIGN - 1); }
+
+// Готовит слот под следующий блок события; 0 — блоков больше нет
+static int slot_prepare(BMLoader* loader, BMLoadEvent* ev, BMLoadSlot* slot) {
+    while (ev->next_request < ev->count && ev->next_pos >= ev->requests[ev->next_request].length) {
+        ++ev->next_request;
+        ev->next_pos = 0;
+    }
+    if (ev->next_request >= ev->count) return 0;
+
+    const BMLoadRequest* req = &ev->requests[ev->next_request];
+    size_t len = req->length - (size_t)ev->next_pos;
+    if (len > loader->block_size) len = loader->block_size;
+
+    uint64_t file_pos = req->file_offset + ev->next_pos;
+    slot->busy = 1;
+    slot->event = ev;
+    slot->request = ev->next_request;
+    slot->fd = ev->fds[ev->next_request];
+    slot->buffer_offset = req->buffer_offset + (size_t)ev->next_pos;
+    slot->useful = len;
+    slot->got = 0;
+
+    char* host = (char*)bm_backend_host_ptr(req->buffer);
+    if (host && !ev->direct[ev->next_request]) {
+        // Прямо в буфер, без промежуточной копии
+        slot->staged = 0;
+        slot->skip = 0;
+        slot->dst = host + slot->buffer_offset;
+        slot->pos = file_pos;
+        slot->want = len;
+    } else {
+        slot->staged = 1;
+        uint64_t start = ev->direct[ev->next_request] ? align_down(file_pos) : file_pos;
+        uint64_t end = file_pos + len;
+        if (ev->direct[ev->next_request])
+            end = (end + BM_LOADER_DIRECT_ALIGN - 1) & ~(uint64_t)(BM_LOADER_DIRECT_ALIGN - 1);
+        slot->skip = (size_t)(file_pos - start);
+        slot->dst = slot->staging;
+        slot->pos = start;
+        slot->want = (size_t)(end - start);
+    }
+
+    ev->next_pos += len;
+    ++ev->inflight;
+    return 1;
+}
+
+// Обработка результата чтения. Возвращает 1, если блок надо дочитать.
+static int slot_complete(BMLoadSlot* slot, long res) {
+    BMLoadEvent* ev = slot->event;
+    const BMLoadRequest* req = &ev->requests[slot->request];
+
+    // Путь к этому моменту уже не хранится — в ошибке указываем номер запроса
+    if (res == -EINTR || res == -EAGAIN) return 1;
+    if (res < 0) {
+        event_fail(ev, BM_ERROR_INTERNAL, "bm_loader: запрос %zu: ошибка чтения: %s", slot->request, strerror((int)-res));
+    } else {
+        slot->got += (size_t)res;
+        slot->dst += res;
+        slot->pos += (uint64_t)res;
+        slot->want -= (size_t)res;
+        int complete = slot->got >= slot->skip + slot->useful;
+        if (!complete && res > 0 && slot->want > 0) return 1;
+        if (!complete) {
+            event_fail(ev, BM_ERROR_INVALID_ARG, "bm_loader: запрос %zu: файл короче запрошенного диапазона", slot->request);
+        } else if (slot->staged && ev->result == BM_OK &&
+                   bm_backend_upload_range(req->buffer, slot->staging + slot->skip,
+                                           slot->buffer_offset, slot->useful) != BM_STATUS_OK) {
+            event_fail(ev, BM_ERROR_DEVICE_LOST, "bm_loader: upload в буфер: %s", bm_get_last_error());
+        }
+    }
+
+    slot->busy = 0;
+    --ev->inflight;
+    return 0;
+}
+
+// ----------------------------------------
+// Выполнение события
+// ----------------------------------------
+// Дочитывает блок слота pread'ом с текущей позиции
+static void slot_read_sync(BMLoadSlot* slot) {
+    long res;
+    do {
+        res = pread(slot->fd, slot->dst, slot->want, (off_t)slot->pos);
+        if (res < 0) res = -errno;
+    } while (slot_complete(slot, res));
+}
+
+static void run_sync(BMLoader* loader, BMLoadEvent* ev) {
+    BMLoadSlot* slot = &loader->slots[0];
+    while (ev->result == BM_OK && slot_prepare(loader, ev, slot))
+        slot_read_sync(slot);
+}
+
+#ifdef BM_HAVE_IO_URING
+// Ядро отказало в io_uring_enter: чтения в полёте отменяются, их CQE
+// собираются, а недочитанные блоки доделываются pread'ом. Кольцо закрывается,
+// оставшиеся блоки события читает run_sync. Если ядро не приняло даже отмены,
+// чтения снимает закрытие кольца, и их блоки перечитываются целиком.
+static void ring_abandon(BMLoader* loader) {
+    bm_log(BM_LOG_WARN, "bm_loader: io_uring_enter: %s, переход на pread", strerror(errno));
+    size_t pending = 0;
+    for (unsigned i = 0; i < loader->depth; ++i) {
+        if (!loader->slots[i].busy) continue;
+        ring_queue_cancel(loader, i);
+        ++pending;
+    }
+
+    while (pending && ring_enter(loader, 1)) {
+        unsigned head = *loader->cq_head;
+        unsigned tail = __atomic_load_n(loader->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            struct io_uring_cqe* cqe = &loader->cqes[head & *loader->cq_mask];
+            if (cqe->user_data == BM_LOADER_CANCEL_TAG) continue;
+            BMLoadSlot* slot = &loader->slots[(size_t)cqe->user_data];
+            --pending;
+            if (cqe->res == -ECANCELED || slot_complete(slot, cqe->res)) slot_read_sync(slot);
+        }
+        __atomic_store_n(loader->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    ring_teardown(loader);
+    for (unsigned i = 0; i < loader->depth; ++i)
+        if (loader->slots[i].busy) slot_read_sync(&loader->slots[i]);
+}
+
+static void run_ring(BMLoader* loader, BMLoadEvent* ev) {
+    for (;;) {
+        // Дозаполняем очередь, пока есть блоки и свободные слоты
+        for (unsigned i = 0; i < loader->depth && ev->result == BM_OK; ++i) {
+            BMLoadSlot* slot = &loader->slots[i];
+            if (slot->busy) continue;
+            if (!slot_prepare(loader, ev, slot)) break;
+            ring_queue_read(loader, slot, i);
+        }
+        if (ev->inflight == 0) break;
+
+        if (!ring_enter(loader, 1)) break;
+
+        unsigned head = *loader->cq_head;
+        unsigned tail = __atomic_load_n(loader->cq_tail, __ATOMIC_ACQUIRE);
+        unsigned resubmit = 0;
+        for (; head != tail; ++head) {
+            struct io_uring_cqe* cqe = &loader->cqes[head & *loader->cq_mask];
+            size_t index = (size_t)cqe->user_data;
+            if (slot_complete(&loader->slots[index], cqe->res)) {
+                ring_queue_read(loader, &loader->slots[index], index);
+                ++resubmit;
+            }
+        }
+        __atomic_store_n(loader->cq_head, head, __ATOMIC_RELEASE);
+        if (resubmit && !ring_enter(loader, 0)) break;
+    }
+    if (ev->inflight == 0) return;
+
+    // Дальше загрузчик работает через pread
+    ring_abandon(loader);
+    run_sync(loader, ev);
+}
+#endif
+
+static void* loader_worker(void* arg) {
+    BMLoader* loader = (BMLoader*)arg;
+    // Чтения идут в память устройства и staging-блоки: держим поток на его узле
+    if (loader->device->numa_policy == BM_NUMA_BIND) bm_numa_bind_thread(loader->device);
+
+    pthread_mutex_lock(&loader->lock);
+    for (;;) {
+        while (!loader->head && !loader->stop)
+            pthread_cond_wait(&loader->work, &loader->lock);
+        if (!loader->head) break;
+
+        BMLoadEvent* ev = loader->head;
+        loader->head = ev->next;
+        if (!loader->head) loader->tail = NULL;
+        pthread_mutex_unlock(&loader->lock);
+
+#ifdef BM_HAVE_IO_URING
+        if (loader->ring_fd >= 0) run_ring(loader, ev);
+        else run_sync(loader, ev);
+#else
+        run_sync(loader, ev);
+#endif
+
+        pthread_mutex_lock(&loader->lock);
+        ev->done = 1;
+        pthread_cond_broadcast(&loader->done);
+    }
+    pthread_mutex_unlock(&loader->lock);
+    return NULL;
+}
+
+static void event_free(BMLoadEvent* ev) {
+    for (size_t i = 0; i < ev->count; ++i)
+        if (ev->fds[i] >= 0) close(ev->fds[i]);
+    free(ev->requests);
+    free(ev->fds);
+    free(ev->direct);
+    free(ev);
+}
+
+// Под loader->lock (или после остановки потока)
+static void event_unlink(BMLoader* loader, BMLoadEvent* ev) {
+    if (ev->live_prev) ev->live_prev->live_next = ev->live_next;
+    else loader->live = ev->live_next;
+    if (ev->live_next) ev->live_next->live_prev = ev->live_prev;
+}
+
+#endif // !_WIN32
+
+// ----------------------------------------
+// Создание/удаление загрузчика
+// ----------------------------------------
+BMResult bm_loader_create(BMDevice* device, const BMLoaderConfig* config, BMLoader** out_loader) {
+    if (!device || !out_loader) {
+        BM_SET_ERROR("bm_loader_create: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+
+#ifdef _WIN32
+    (void)config;
+    BM_SET_ERROR("bm_loader_create: не поддерживается на этой платформе");
+    return BM_ERROR_UNSUPPORTED;
+#else
+    BMLoader* loader = (BMLoader*)calloc(1, sizeof(BMLoader));
+    if (!loader) {
+        BM_SET_ERROR("bm_loader_create: не удалось выделить память");
+        return BM_ERROR_NOMEM;
+    }
+    loader->device = device;
+    loader->depth = (config && config->queue_depth) ? config->queue_depth : BM_LOADER_DEFAULT_DEPTH;
+    loader->block_size = (config && config->block_size) ? config->block_size : BM_LOADER_DEFAULT_BLOCK;
+    loader->direct_io = config ? config->direct_io : 0;
+    if (loader->block_size > BM_LOADER_MAX_BLOCK) loader->block_size = BM_LOADER_MAX_BLOCK;
+    // O_DIRECT читает целыми выровненными блоками
+    loader->block_size = (loader->block_size + BM_LOADER_DIRECT_ALIGN - 1) & ~(size_t)(BM_LOADER_DIRECT_ALIGN - 1);
+
+    loader->slots = (BMLoadSlot*)calloc(loader->depth, sizeof(BMLoadSlot));
+    if (!loader->slots) {
+        free(loader);
+        BM_SET_ERROR("bm_loader_create: не удалось выделить память");
+        return BM_ERROR_NOMEM;
+    }
+    // Запас в 2 страницы: начало и конец блока округляются для O_DIRECT
+    size_t staging_size = loader->block_size + 2 * BM_LOADER_DIRECT_ALIGN;
+    for (unsigned i = 0; i < loader->depth; ++i) {
+        if (bm_mem_align((void**)&loader->slots[i].staging, BM_LOADER_DIRECT_ALIGN, staging_size) != BM_SUCCESS) {
+            BM_SET_ERROR("bm_loader_create: не удалось выделить staging-блоки (%u x %zu байт)",
+                         loader->depth, staging_size);
+            for (unsigned j = 0; j < i; ++j) bm_mem_align_free(loader->slots[j].staging);
+            free(loader->slots);
+            free(loader);
+            return BM_ERROR_NOMEM;
+        }
+    }
+
+#ifdef BM_HAVE_IO_URING
+    loader->ring_fd = -1;
+    if (!ring_setup(loader))
+        bm_log(BM_LOG_WARN, "bm_loader: io_uring недоступен (%s), чтение через pread", strerror(errno));
+#endif
+
+    pthread_mutex_init(&loader->lock, NULL);
+    pthread_cond_init(&loader->work, NULL);
+    pthread_cond_init(&loader->done, NULL);
+    if (pthread_create(&loader->thread, NULL, loader_worker, loader) != 0) {
+        pthread_cond_destroy(&loader->done);
+        pthread_cond_destroy(&loader->work);
+        pthread_mutex_destroy(&loader->lock);
+#ifdef BM_HAVE_IO_URING
+        ring_teardown(loader);
+#endif
+        for (unsigned i = 0; i < loader->depth; ++i) bm_mem_align_free(loader->slots[i].staging);
+        free(loader->slots);
+        free(loader);
+        BM_SET_ERROR("bm_loader_create: не удалось запустить поток загрузки");
+        return BM_ERROR_INTERNAL;
+    }
+
+    *out_loader = loader;
+    return BM_OK;
+#endif
+}
+
+BMResult bm_loader_destroy(BMLoader* loader) {
+    if (!loader) return BM_OK;
+#ifndef _WIN32
+    // Поток дорабатывает уже поставленные события
+    pthread_mutex_lock(&loader->lock);
+    loader->stop = 1;
+    pthread_cond_signal(&loader->work);
+    pthread_mutex_unlock(&loader->lock);
+    pthread_join(loader->thread, NULL);
+
+    // События, которых никто не дождался: загрузки завершены, освобождаем сами
+    while (loader->live) {
+        BMLoadEvent* ev = loader->live;
+        event_unlink(loader, ev);
+        event_free(ev);
+    }
+
+    pthread_cond_destroy(&loader->done);
+    pthread_cond_destroy(&loader->work);
+    pthread_mutex_destroy(&loader->lock);
+#ifdef BM_HAVE_IO_URING
+    ring_teardown(loader);
+#endif
+    for (unsigned i = 0; i < loader->depth; ++i) bm_mem_align_free(loader->slots[i].staging);
+    free(loader->slots);
+    free(loader);
+#endif
+    return BM_OK;
+}
+
+// ----------------------------------------
+// Постановка загрузки и ожидание
+// ----------------------------------------
+#ifndef _WIN32
+// Файлы открываются сразу: ошибки пути видны вызывающему синхронно
+static int open_source(const BMLoader* loader, const BMLoadRequest* req, int* fd, int* direct) {
+    *direct = 0;
+#ifdef O_DIRECT
+    if (loader->direct_io) {
+        *fd = open(req->path, O_RDONLY | O_CLOEXEC | O_DIRECT);
+        if (*fd >= 0) {
+            *direct = 1;
+            return 1;
+        }
+        // tmpfs и некоторые FS не поддерживают O_DIRECT — читаем через page cache
+    }
+#else
+    (void)loader;
+#endif
+    *fd = open(req->path, O_RDONLY | O_CLOEXEC);
+    return *fd >= 0;
+}
+#endif
+
+BMResult bm_loader_submit(BMLoader* loader, const BMLoadRequest* requests, size_t count, BMLoadEvent** out_event) {
+    if (!loader || !requests || count == 0 || !out_event) {
+        BM_SET_ERROR("bm_loader_submit: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+#ifdef _WIN32
+    return BM_ERROR_UNSUPPORTED;
+#else
+    for (size_t i = 0; i < count; ++i) {
+        const BMLoadRequest* req = &requests[i];
+        if (!req->buffer || !req->path || req->buffer_offset > req->buffer->size ||
+            req->length > req->buffer->size - req->buffer_offset) {
+            BM_SET_ERROR("bm_loader_submit: запрос %zu выходит за пределы буфера", i);
+            return BM_ERROR_INVALID_ARG;
+        }
+    }
+
+    BMLoadEvent* ev = (BMLoadEvent*)calloc(1, sizeof(BMLoadEvent));
+    if (ev) {
+        ev->requests = (BMLoadRequest*)malloc(sizeof(BMLoadRequest) * count);
+        ev->fds = (int*)malloc(sizeof(int) * count);
+        ev->direct = (int*)malloc(sizeof(int) * count);
+    }
+    if (!ev || !ev->requests || !ev->fds || !ev->direct) {
+        if (ev) { free(ev->requests); free(ev->fds); free(ev->direct); free(ev); }
+        BM_SET_ERROR("bm_loader_submit: не удалось выделить память");
+        return BM_ERROR_NOMEM;
+    }
+    memcpy(ev->requests, requests, sizeof(BMLoadRequest) * count);
+    ev->count = count;
+    ev->result = BM_OK;
+    for (size_t i = 0; i < count; ++i) ev->fds[i] = -1;
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!open_source(loader, &requests[i], &ev->fds[i], &ev->direct[i])) {
+            BM_SET_ERROR("bm_loader_submit: не удалось открыть '%s': %s", requests[i].path, strerror(errno));
+            event_free(ev);
+            return BM_ERROR_INVALID_ARG;
+        }
+        ev->requests[i].path = NULL; // путь вызывающего больше не нужен
+    }
+
+    pthread_mutex_lock(&loader->lock);
+    if (loader->tail) loader->tail->next = ev;
+    else loader->head = ev;
+    loader->tail = ev;
+    ev->live_next = loader->live;
+    if (loader->live) loader->live->live_prev = ev;
+    loader->live = ev;
+    pthread_cond_signal(&loader->work);
+    pthread_mutex_unlock(&loader->lock);
+
+    *out_event = ev;
+    return BM_OK;
+#endif
+}
+
+int bm_load_event_done(BMLoader* loader, BMLoadEvent* event) {
+    if (!loader || !event) return 0;
+#ifdef _WIN32
+    return 1;
+#else
+    pthread_mutex_lock(&loader->lock);
+    int done = event->done;
+    pthread_mutex_unlock(&loader->lock);
+    return done;
+#endif
+}
+
+BMResult bm_load_event_wait(BMLoader* loader, BMLoadEvent* event) {
+    if (!loader || !event) {
+        BM_SET_ERROR("bm_load_event_wait: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+#ifdef _WIN32
+    return BM_ERROR_UNSUPPORTED;
+#else
+    uint64_t trace = bm_trace_begin();
+    pthread_mutex_lock(&loader->lock);
+    while (!event->done)
+        pthread_cond_wait(&loader->done, &loader->lock);
+    event_unlink(loader, event);
+    pthread_mutex_unlock(&loader->lock);
+    bm_trace_end(trace, "sync", "bm_load_event_wait", NULL, 0);
+
+    BMResult res = event->result;
+    if (res != BM_OK) BM_SET_ERROR("%s", event->error);
+    event_free(event);
+    return res;
+#endif
+}
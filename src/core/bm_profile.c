@@ -0,0 +1,404 @@
+// bm_profile.c
+#ifndef _WIN32
+#define _GNU_SOURCE
+#endif
+
+#include "burymetal.h"
+#include "bm_utils.h"
+#include "bm_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+// ----------------------------------------
+// Профилирование ядер
+// ----------------------------------------
+// У каждого потока своя группа счётчиков perf_event_open (лидер — cycles),
+// открытая при первом профилируемом запуске. Запуск читает группу до и после
+// (два read) и добавляет разность в таблицу потока. Таблица под мьютексом
+// потока: он не конкурирует ни с кем, кроме bm_profile_query/dump.
+
+#define BM_PROFILE_INITIAL_ENTRIES 8
+
+typedef struct {
+    char name[BM_KERNEL_NAME_MAX];
+    uint64_t launches;
+    uint64_t counted;               // запусков, в которые группа реально считала
+    uint64_t wall_ns;
+    uint64_t values[BM_PROFILE_COUNTER_COUNT];
+} BMProfileEntry;
+
+typedef struct BMProfileThread {
+    struct BMProfileThread* next;
+    unsigned tid;
+    int exited;
+    int opened;                     // попытка открыть счётчики уже была
+    int leader_fd;                  // -1 — счётчиков нет
+    int fds[BM_PROFILE_COUNTER_COUNT];
+    int slot[BM_PROFILE_COUNTER_COUNT]; // позиция счётчика в группе, -1 — не открыт
+    unsigned counters;              // маска открытых (BM_PROFILE_*)
+    size_t group_size;
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+#else
+    pthread_mutex_t lock;
+#endif
+    BMProfileEntry* entries;
+    size_t count;
+    size_t capacity;
+} BMProfileThread;
+
+int bm_profile_active = 0;
+
+static BMProfileThread* threads = NULL;
+
+#ifdef _WIN32
+static __declspec(thread) BMProfileThread* self = NULL;
+static __declspec(thread) int suspended = 0;
+static INIT_ONCE list_once = INIT_ONCE_STATIC_INIT;
+static CRITICAL_SECTION list_lock;
+
+static BOOL CALLBACK list_init(PINIT_ONCE once, PVOID param, PVOID* context) {
+    (void)once; (void)param; (void)context;
+    InitializeCriticalSection(&list_lock);
+    return TRUE;
+}
+
+static void lock_list(void) {
+    InitOnceExecuteOnce(&list_once, list_init, NULL, NULL);
+    EnterCriticalSection(&list_lock);
+}
+static void unlock_list(void) { LeaveCriticalSection(&list_lock); }
+static void lock_thread(BMProfileThread* t) { EnterCriticalSection(&t->lock); }
+static void unlock_thread(BMProfileThread* t) { LeaveCriticalSection(&t->lock); }
+#else
+static __thread BMProfileThread* self = NULL;
+static __thread int suspended = 0;
+static pthread_mutex_t list_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_key;
+
+static void lock_list(void) { pthread_mutex_lock(&list_lock); }
+static void unlock_list(void) { pthread_mutex_unlock(&list_lock); }
+static void lock_thread(BMProfileThread* t) { pthread_mutex_lock(&t->lock); }
+static void unlock_thread(BMProfileThread* t) { pthread_mutex_unlock(&t->lock); }
+#endif
+
+// ----------------------------------------
+// Счётчики perf_event_open
+// ----------------------------------------
+#ifdef __linux__
+// Порядок совпадает с битами BM_PROFILE_*
+static const uint64_t counter_events[BM_PROFILE_COUNTER_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_STALLED_CYCLES_BACKEND,
+};
+
+static int open_counter(uint64_t config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;        // работает при perf_event_paranoid <= 2
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+}
+#endif
+
+static void counters_open(BMProfileThread* t) {
+    t->opened = 1;
+    t->leader_fd = -1;
+    for (int i = 0; i < BM_PROFILE_COUNTER_COUNT; ++i) {
+        t->fds[i] = -1;
+        t->slot[i] = -1;
+    }
+#ifdef __linux__
+    // Без лидера группы нет: остаётся только время
+    t->leader_fd = open_counter(counter_events[0], -1);
+    if (t->leader_fd < 0) {
+        bm_log(BM_LOG_WARN, "[CPU] профилирование: счётчики недоступны (perf_event_open), только время");
+        return;
+    }
+    t->fds[0] = t->leader_fd;
+    t->slot[0] = 0;
+    t->counters = BM_PROFILE_CYCLES;
+    t->group_size = 1;
+
+    // Остальные — по возможности: не каждый процессор умеет, например, stalled cycles
+    for (int i = 1; i < BM_PROFILE_COUNTER_COUNT; ++i) {
+        int fd = open_counter(counter_events[i], t->leader_fd);
+        if (fd < 0) continue;
+        t->fds[i] = fd;
+        t->slot[i] = (int)t->group_size++;
+        t->counters |= 1u << i;
+    }
+#endif
+}
+
+static void counters_close(BMProfileThread* t) {
+#ifndef _WIN32
+    for (int i = BM_PROFILE_COUNTER_COUNT - 1; i >= 0; --i)
+        if (t->fds[i] >= 0) close(t->fds[i]);
+#endif
+    for (int i = 0; i < BM_PROFILE_COUNTER_COUNT; ++i) t->fds[i] = -1;
+    t->leader_fd = -1;
+}
+
+// Значения группы в порядке BM_PROFILE_*; 0 — не удалось прочитать
+static int counters_read(BMProfileThread* t, BMProfileSample* sample) {
+#ifdef __linux__
+    uint64_t buf[3 + BM_PROFILE_COUNTER_COUNT];
+    if (t->leader_fd < 0 || read(t->leader_fd, buf, sizeof(buf)) < (ssize_t)((3 + t->group_size) * sizeof(uint64_t)))
+        return 0;
+    sample->enabled_ns = buf[1];
+    sample->running_ns = buf[2];
+    for (int i = 0; i < BM_PROFILE_COUNTER_COUNT; ++i)
+        sample->values[i] = t->slot[i] >= 0 ? buf[3 + t->slot[i]] : 0;
+    return 1;
+#else
+    (void)t;
+    (void)sample;
+    return 0;
+#endif
+}
+
+// ----------------------------------------
+// Потоки
+// ----------------------------------------
+#ifndef _WIN32
+static void thread_exit(void* arg) {
+    BMProfileThread* t = (BMProfileThread*)arg;
+    lock_thread(t);
+    counters_close(t);
+    t->exited = 1;
+    unlock_thread(t);
+}
+
+static void key_init(void) { pthread_key_create(&thread_key, thread_exit); }
+#endif
+
+static BMProfileThread* thread_attach(void) {
+    BMProfileThread* t = (BMProfileThread*)calloc(1, sizeof(BMProfileThread));
+    if (!t) return NULL;
+#ifdef _WIN32
+    InitializeCriticalSection(&t->lock);
+    t->tid = (unsigned)GetCurrentThreadId();
+#else
+    pthread_mutex_init(&t->lock, NULL);
+#ifdef __linux__
+    t->tid = (unsigned)syscall(SYS_gettid);
+#endif
+    pthread_once(&key_once, key_init);
+    pthread_setspecific(thread_key, t);
+#endif
+    counters_open(t);
+
+    lock_list();
+    t->next = threads;
+    threads = t;
+    unlock_list();
+    return t;
+}
+
+static BMProfileEntry* entry_find(BMProfileThread* t, const char* name) {
+    for (size_t i = 0; i < t->count; ++i)
+        if (strcmp(t->entries[i].name, name) == 0) return &t->entries[i];
+
+    if (t->count == t->capacity) {
+        size_t capacity = t->capacity ? t->capacity * 2 : BM_PROFILE_INITIAL_ENTRIES;
+        BMProfileEntry* entries = (BMProfileEntry*)realloc(t->entries, capacity * sizeof(BMProfileEntry));
+        if (!entries) return NULL;
+        t->entries = entries;
+        t->capacity = capacity;
+    }
+    BMProfileEntry* e = &t->entries[t->count++];
+    memset(e, 0, sizeof(*e));
+    strncpy(e->name, name, BM_KERNEL_NAME_MAX - 1);
+    return e;
+}
+
+// ----------------------------------------
+// Запуск ядра
+// ----------------------------------------
+int bm_profile_suspend_thread(int suspend) {
+    int prev = suspended;
+    suspended = suspend;
+    return prev;
+}
+
+void bm_profile_sample_begin(BMProfileSample* sample) {
+    if (suspended) return;
+    BMProfileThread* t = self;
+    if (!t && !(t = self = thread_attach())) return;
+
+    sample->counters = counters_read(t, sample);
+    // Время — последним, чтобы read счётчиков не попал в интервал
+    sample->start_ns = bm_now_ns();
+}
+
+void bm_profile_sample_end(BMProfileSample* sample, const char* kernel_name) {
+    uint64_t end_ns = bm_now_ns();
+    BMProfileThread* t = self;
+
+    BMProfileSample after;
+    int counted = sample->counters && counters_read(t, &after);
+
+    lock_thread(t);
+    BMProfileEntry* e = entry_find(t, kernel_name ? kernel_name : "");
+    if (e) {
+        ++e->launches;
+        e->wall_ns += end_ns - sample->start_ns;
+        // Группу могли мультиплексировать с чужими событиями: масштабируем.
+        // running == 0 — группа за весь запуск не стояла на PMU ни разу:
+        // это не ноль событий, а отсутствие замера, запуск не учитывается
+        uint64_t enabled = counted ? after.enabled_ns - sample->enabled_ns : 0;
+        uint64_t running = counted ? after.running_ns - sample->running_ns : 0;
+        if (running) {
+            double scale = running < enabled ? (double)enabled / (double)running : 1.0;
+            for (int i = 0; i < BM_PROFILE_COUNTER_COUNT; ++i)
+                e->values[i] += (uint64_t)((double)(after.values[i] - sample->values[i]) * scale);
+            ++e->counted;
+        }
+    }
+    unlock_thread(t);
+}
+
+// ----------------------------------------
+// Интерфейс
+// ----------------------------------------
+BMResult bm_profile_enable(int enable) {
+    __atomic_store_n(&bm_profile_active, enable ? 1 : 0, __ATOMIC_RELAXED);
+    bm_log(BM_LOG_INFO, "Профилирование ядер %s", enable ? "включено" : "выключено");
+    return BM_OK;
+}
+
+void bm_profile_reset(void) {
+    lock_list();
+    BMProfileThread** link = &threads;
+    while (*link) {
+        BMProfileThread* t = *link;
+        lock_thread(t);
+        t->count = 0;
+        int exited = t->exited;
+        unlock_thread(t);
+
+        // Записи завершившихся потоков больше никому не нужны
+        if (exited) {
+            *link = t->next;
+#ifdef _WIN32
+            DeleteCriticalSection(&t->lock);
+#else
+            pthread_mutex_destroy(&t->lock);
+#endif
+            free(t->entries);
+            free(t);
+            continue;
+        }
+        link = &t->next;
+    }
+    unlock_list();
+}
+
+size_t bm_profile_query(BMKernelProfile* out, size_t capacity) {
+    size_t total = 0;
+    lock_list();
+    for (BMProfileThread* t = threads; t; t = t->next) {
+        lock_thread(t);
+        for (size_t i = 0; i < t->count; ++i, ++total) {
+            if (!out || total >= capacity) continue;
+            const BMProfileEntry* e = &t->entries[i];
+            BMKernelProfile* p = &out[total];
+            memset(p, 0, sizeof(*p));
+            memcpy(p->kernel, e->name, sizeof(p->kernel));
+            p->thread = t->tid;
+            p->counters = e->counted ? t->counters : 0;
+            p->launches = e->launches;
+            p->counted_launches = e->counted;
+            p->wall_sec = (double)e->wall_ns * 1e-9;
+            p->cycles = e->values[0];
+            p->instructions = e->values[1];
+            p->llc_misses = e->values[2];
+            p->branch_misses = e->values[3];
+            p->stalled_cycles = e->values[4];
+        }
+        unlock_thread(t);
+    }
+    unlock_list();
+    return total;
+}
+
+static void dump_counter(FILE* f, unsigned counters, unsigned bit, uint64_t value) {
+    if (counters & bit) fprintf(f, " %14llu", (unsigned long long)value);
+    else fprintf(f, " %14s", "-");
+}
+
+BMResult bm_profile_dump(const char* path) {
+    size_t count = bm_profile_query(NULL, 0);
+    BMKernelProfile* rows = (BMKernelProfile*)calloc(count ? count : 1, sizeof(BMKernelProfile));
+    if (!rows) {
+        BM_SET_ERROR("bm_profile_dump: не удалось выделить память");
+        return BM_ERROR_NOMEM;
+    }
+    // Между двумя вызовами могли появиться новые записи — берём сколько влезло
+    size_t total = bm_profile_query(rows, count);
+    if (total > count) total = count;
+
+    FILE* f = path ? fopen(path, "w") : stdout;
+    if (!f) {
+        free(rows);
+        BM_SET_ERROR("bm_profile_dump: не удалось открыть %s", path);
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    fprintf(f, "%-24s %8s %10s %10s %12s %14s %14s %14s %14s %14s %6s %9s\n", "kernel", "thread", "launches",
+            "counted", "wall_ms", "cycles", "instructions", "llc_misses", "branch_misses", "stalled", "IPC",
+            "LLC/kinst");
+    for (size_t i = 0; i < total; ++i) {
+        const BMKernelProfile* p = &rows[i];
+        fprintf(f, "%-24.24s %8u %10llu %10llu %12.3f", p->kernel, p->thread, (unsigned long long)p->launches,
+                (unsigned long long)p->counted_launches, p->wall_sec * 1e3);
+        dump_counter(f, p->counters, BM_PROFILE_CYCLES, p->cycles);
+        dump_counter(f, p->counters, BM_PROFILE_INSTRUCTIONS, p->instructions);
+        dump_counter(f, p->counters, BM_PROFILE_LLC_MISSES, p->llc_misses);
+        dump_counter(f, p->counters, BM_PROFILE_BRANCH_MISSES, p->branch_misses);
+        dump_counter(f, p->counters, BM_PROFILE_STALLED_CYCLES, p->stalled_cycles);
+
+        // IPC и промахи LLC на тысячу инструкций: низкий IPC при многих промахах — упор в память
+        unsigned need = BM_PROFILE_CYCLES | BM_PROFILE_INSTRUCTIONS;
+        if ((p->counters & need) == need && p->cycles)
+            fprintf(f, " %6.2f", (double)p->instructions / (double)p->cycles);
+        else
+            fprintf(f, " %6s", "-");
+        need = BM_PROFILE_INSTRUCTIONS | BM_PROFILE_LLC_MISSES;
+        if ((p->counters & need) == need && p->instructions)
+            fprintf(f, " %9.2f\n", (double)p->llc_misses * 1000.0 / (double)p->instructions);
+        else
+            fprintf(f, " %9s\n", "-");
+    }
+
+    free(rows);
+    int failed = ferror(f);
+    if (path ? fclose(f) != 0 || failed : fflush(f) != 0 || failed) {
+        BM_SET_ERROR("bm_profile_dump: ошибка записи %s", path ? path : "stdout");
+        return BM_ERROR_INTERNAL;
+    }
+    return BM_OK;
+}
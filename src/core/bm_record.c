@@ -0,0 +1,301 @@
+// bm_record.c
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "burymetal.h"
+#include "bm_utils.h"
+#include "bm_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define THREAD_LOCAL __declspec(thread)
+#else
+#include <pthread.h>
+#define THREAD_LOCAL __thread
+#endif
+
+// ----------------------------------------
+// Запись вызовов API
+// ----------------------------------------
+// Каждый поток складывает записи в свой блок без блокировок и публикует
+// счётчик (release). Заполненный блок поток сам дописывает в файл под
+// control_lock; bm_record_stop дописывает опубликованные хвосты всех потоков.
+// Завершившийся поток сбрасывает свой хвост, и его запись достаётся новому
+// потоку уже с новым номером.
+
+#define BM_RECORD_CHUNK_EVENTS 1024u   // 64 КБ на поток
+
+enum { BM_RECORD_OWNED, BM_RECORD_ORPHANED };
+
+typedef struct BMRecordThread {
+    struct BMRecordThread* next;    // список всех записей (только добавление)
+    int state;
+    unsigned session;               // сессия, к которой относятся события
+    unsigned id;                    // номер потока в сессии
+    size_t count;                   // опубликовано событий в блоке
+    BMRecordEvent events[BM_RECORD_CHUNK_EVENTS];
+} BMRecordThread;
+
+int bm_record_active = 0;
+
+static BMRecordThread* threads = NULL;
+static unsigned session = 0;
+static unsigned next_thread_id = 0;
+static uint64_t next_seq = 0;
+static uint64_t session_start_ns = 0;
+// Под control_lock
+static FILE* session_file = NULL;
+static char* session_path = NULL;
+static size_t session_events = 0;
+static int session_failed = 0;
+static THREAD_LOCAL BMRecordThread* self = NULL;
+static THREAD_LOCAL int suspended = 0;
+
+#ifdef _WIN32
+static INIT_ONCE control_once = INIT_ONCE_STATIC_INIT;
+static INIT_ONCE key_once = INIT_ONCE_STATIC_INIT;
+static CRITICAL_SECTION control_lock;
+static DWORD thread_key = FLS_OUT_OF_INDEXES;
+
+static BOOL CALLBACK control_init(PINIT_ONCE once, PVOID param, PVOID* context) {
+    (void)once; (void)param; (void)context;
+    InitializeCriticalSection(&control_lock);
+    return TRUE;
+}
+
+static void lock_control(void) {
+    InitOnceExecuteOnce(&control_once, control_init, NULL, NULL);
+    EnterCriticalSection(&control_lock);
+}
+
+static void unlock_control(void) { LeaveCriticalSection(&control_lock); }
+#else
+static pthread_mutex_t control_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_key;
+
+static void lock_control(void) { pthread_mutex_lock(&control_lock); }
+static void unlock_control(void) { pthread_mutex_unlock(&control_lock); }
+#endif
+
+// Дописать опубликованные события потока в файл сессии (под control_lock)
+static void write_events_locked(BMRecordThread* rec, unsigned current) {
+    size_t count = __atomic_load_n(&rec->count, __ATOMIC_ACQUIRE);
+    if (!session_file || !count || __atomic_load_n(&rec->session, __ATOMIC_ACQUIRE) != current) return;
+    if (fwrite(rec->events, sizeof(BMRecordEvent), count, session_file) != count) session_failed = 1;
+    session_events += count;
+}
+
+// Владелец освобождает блок: события уходят в файл, счётчик обнуляется
+static void thread_flush(BMRecordThread* rec) {
+    lock_control();
+    write_events_locked(rec, __atomic_load_n(&session, __ATOMIC_ACQUIRE));
+    __atomic_store_n(&rec->count, 0, __ATOMIC_RELEASE);
+    unlock_control();
+}
+
+// Поток завершился: хвост в файл, запись можно отдать другому
+static void thread_release(BMRecordThread* rec) {
+    thread_flush(rec);
+    __atomic_store_n(&rec->state, BM_RECORD_ORPHANED, __ATOMIC_RELEASE);
+}
+
+#ifdef _WIN32
+// FLS-callback вызывается при выходе потока, в том числе не созданного через CRT
+static VOID WINAPI thread_exit(PVOID arg) {
+    if (arg) thread_release((BMRecordThread*)arg);
+}
+
+static BOOL CALLBACK key_init(PINIT_ONCE once, PVOID param, PVOID* context) {
+    (void)once; (void)param; (void)context;
+    thread_key = FlsAlloc(thread_exit);
+    return TRUE;
+}
+#else
+static void thread_exit(void* arg) { thread_release((BMRecordThread*)arg); }
+
+static void key_init(void) { pthread_key_create(&thread_key, thread_exit); }
+#endif
+
+static BMRecordThread* thread_attach(void) {
+    BMRecordThread* rec = __atomic_load_n(&threads, __ATOMIC_ACQUIRE);
+    for (; rec; rec = rec->next) {
+        int orphaned = BM_RECORD_ORPHANED;
+        if (__atomic_compare_exchange_n(&rec->state, &orphaned, BM_RECORD_OWNED, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            break;
+    }
+
+    if (!rec) {
+        rec = (BMRecordThread*)calloc(1, sizeof(BMRecordThread));
+        if (!rec) return NULL;
+        rec->next = __atomic_load_n(&threads, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&threads, &rec->next, rec, 1,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+    // Новый владелец — новый номер потока при первой записи
+    __atomic_store_n(&rec->session, __atomic_load_n(&session, __ATOMIC_ACQUIRE) - 1, __ATOMIC_RELEASE);
+
+#ifdef _WIN32
+    InitOnceExecuteOnce(&key_once, key_init, NULL, NULL);
+    if (thread_key != FLS_OUT_OF_INDEXES) FlsSetValue(thread_key, rec);
+#else
+    pthread_once(&key_once, key_init);
+    pthread_setspecific(thread_key, rec);
+#endif
+    return rec;
+}
+
+uint64_t bm_record_clock(void) {
+    return suspended ? 0 : bm_now_ns();
+}
+
+int bm_record_suspend_thread(int suspend) {
+    int prev = suspended;
+    suspended = suspend;
+    return prev;
+}
+
+uint64_t bm_record_next_seq(void) {
+    return __atomic_add_fetch(&next_seq, 1, __ATOMIC_RELAXED);
+}
+
+void bm_record_call(BMRecordCall* call, BMRecordOp op, const void* object, const void* target,
+                    uint64_t arg0, uint64_t arg1, int result, const void* data, size_t data_size) {
+    if (!__atomic_load_n(&bm_record_active, __ATOMIC_ACQUIRE)) return;
+    uint64_t end_ns = bm_now_ns();
+    uint64_t seq = call->seq ? call->seq : bm_record_next_seq();
+
+    BMRecordThread* rec = self;
+    if (!rec && !(rec = self = thread_attach())) return;
+
+    // Новая сессия: блок с начала, номер потока заново
+    unsigned current = __atomic_load_n(&session, __ATOMIC_ACQUIRE);
+    if (rec->session != current) {
+        __atomic_store_n(&rec->count, 0, __ATOMIC_RELAXED);
+        rec->id = __atomic_add_fetch(&next_thread_id, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&rec->session, current, __ATOMIC_RELEASE);
+    }
+
+    size_t slots = data ? 2 : 1;
+    if (rec->count + slots > BM_RECORD_CHUNK_EVENTS) thread_flush(rec);
+
+    uint64_t start_ns = __atomic_load_n(&session_start_ns, __ATOMIC_RELAXED);
+    BMRecordEvent* ev = &rec->events[rec->count];
+    ev->op = (uint16_t)op;
+    ev->thread = (uint16_t)rec->id;
+    ev->result = result;
+    ev->seq = seq;
+    ev->start_ns = call->start_ns > start_ns ? call->start_ns - start_ns : 0;
+    ev->duration_ns = end_ns - call->start_ns;
+    ev->object = (uint64_t)(uintptr_t)object;
+    ev->target = (uint64_t)(uintptr_t)target;
+    ev->args[0] = arg0;
+    ev->args[1] = arg1;
+    if (data) {
+        memset(ev + 1, 0, sizeof(BMRecordEvent));
+        memcpy(ev + 1, data, data_size < sizeof(BMRecordEvent) ? data_size : sizeof(BMRecordEvent));
+    }
+    __atomic_store_n(&rec->count, rec->count + slots, __ATOMIC_RELEASE);
+}
+
+// ----------------------------------------
+// Управление
+// ----------------------------------------
+static uint64_t unix_now_ns(void) {
+#ifdef _WIN32
+    return (uint64_t)time(NULL) * 1000000000ull;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+BMResult bm_record_start(const char* path) {
+    if (!path || !*path) {
+        BM_SET_ERROR("bm_record_start: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    lock_control();
+    if (session_file) {
+        unlock_control();
+        BM_SET_ERROR("bm_record_start: запись уже включена");
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    size_t len = strlen(path);
+    session_path = (char*)malloc(len + 1);
+    if (!session_path) {
+        unlock_control();
+        BM_SET_ERROR("bm_record_start: не удалось выделить память");
+        return BM_ERROR_NOMEM;
+    }
+    memcpy(session_path, path, len + 1);
+
+    BMRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BM_RECORD_MAGIC, sizeof(header.magic));
+    header.version = BM_RECORD_VERSION;
+    header.event_size = sizeof(BMRecordEvent);
+    header.start_unix_ns = unix_now_ns();
+
+    session_file = fopen(path, "wb");
+    if (!session_file || fwrite(&header, sizeof(header), 1, session_file) != 1) {
+        if (session_file) fclose(session_file);
+        session_file = NULL;
+        free(session_path);
+        session_path = NULL;
+        unlock_control();
+        BM_SET_ERROR("bm_record_start: не удалось открыть %s", path);
+        return BM_ERROR_INVALID_ARG;
+    }
+    session_events = 0;
+    session_failed = 0;
+
+    __atomic_store_n(&next_thread_id, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&next_seq, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&session_start_ns, bm_now_ns(), __ATOMIC_RELAXED);
+    __atomic_add_fetch(&session, 1, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&bm_record_active, 1, __ATOMIC_RELEASE);
+    unlock_control();
+
+    bm_log(BM_LOG_INFO, "Запись вызовов включена: %s", path);
+    return BM_OK;
+}
+
+BMResult bm_record_stop(void) {
+    lock_control();
+    if (!session_file) {
+        unlock_control();
+        BM_SET_ERROR("bm_record_stop: запись не включена");
+        return BM_ERROR_INVALID_ARG;
+    }
+    __atomic_store_n(&bm_record_active, 0, __ATOMIC_RELEASE);
+
+    // Вызовы, ещё не дошедшие до публикации, в файл не попадут
+    unsigned current = __atomic_load_n(&session, __ATOMIC_ACQUIRE);
+    for (BMRecordThread* rec = __atomic_load_n(&threads, __ATOMIC_ACQUIRE); rec; rec = rec->next)
+        write_events_locked(rec, current);
+
+    BMResult res = BM_OK;
+    if (fclose(session_file) != 0 || session_failed) {
+        BM_SET_ERROR("bm_record_stop: ошибка записи %s", session_path);
+        res = BM_ERROR_INTERNAL;
+    } else {
+        bm_log(BM_LOG_INFO, "Запись вызовов сохранена: %s (%zu записей)", session_path, session_events);
+    }
+    session_file = NULL;
+    free(session_path);
+    session_path = NULL;
+    unlock_control();
+    return res;
+}
@@ -0,0 +1,271 @@
+// bm_shared.c
+#ifndef _WIN32
+#define _GNU_SOURCE
+#endif
+
+#include "burymetal.h"
+#include "bm_utils.h"
+#include "bm_internal.h"
+#include "bm_backend.h"
+#include "bm_mem_alloc.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+// ----------------------------------------
+// Разделяемые буферы
+// ----------------------------------------
+// Объект memfd/shm: [служебная страница][данные]. Служебная страница
+// отображена на запись во всех процессах (даже при READ_ONLY-импорте),
+// в ней лежат проверочные поля и fence'ы — по одному на кэш-линию,
+// чтобы процессы, ждущие разные fence'ы, не делили линию.
+
+#define BM_SHARED_MAGIC   0x48534d42u   // "BMSH"
+#define BM_SHARED_VERSION 1u
+
+typedef struct {
+    uint32_t value;         // текущее значение счётчика (futex-слово)
+    uint32_t waiters;       // сколько процессов спит в futex_wait
+    uint8_t pad[BM_CACHE_LINE_SIZE - 2 * sizeof(uint32_t)];
+} BMSharedFence;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+    uint8_t pad[BM_CACHE_LINE_SIZE - 2 * sizeof(uint32_t) - sizeof(uint64_t)];
+    BMSharedFence fences[BM_SHARED_FENCES];
+} BMSharedHeader;
+
+#ifndef _WIN32
+// Служебная область занимает целую страницу: данные выровнены по странице
+static size_t shared_header_size(void) {
+    long page = sysconf(_SC_PAGESIZE);
+    return page > 0 ? (size_t)page : 4096u;
+}
+
+static BMSharedHeader* shared_header(BMBuffer* buf) {
+    return (BMSharedHeader*)((char*)buf->data - shared_header_size());
+}
+#endif
+
+// ----------------------------------------
+// Создание, экспорт, импорт
+// ----------------------------------------
+static BMResult wrap_shared(BMDevice* device, void* ptr, size_t size, unsigned extra_flags, BMBuffer** out_buffer) {
+    // ADOPT: bm_free_buffer вернёт память через bm_cpu_free (munmap, close, shm_unlink)
+    BMBuffer* buf = bm_backend_wrap_host(device, ptr, size, BM_WRAP_ADOPT);
+    if (!buf) {
+        bm_cpu_free(ptr);
+        return BM_ERROR_NOMEM;
+    }
+    buf->flags |= BM_BUFFER_SHARED | extra_flags;
+    bm_stats_adopt(buf);
+    *out_buffer = buf;
+    return BM_OK;
+}
+
+BMResult bm_buffer_create_shared(BMDevice* device, const char* name, size_t size, BMBuffer** out_buffer) {
+    if (!device || size == 0 || !out_buffer) {
+        BM_SET_ERROR("bm_buffer_create_shared: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+    // Разделяемая память — host-память: напрямую её видит только CPU-устройство
+    if (device->type != BM_CPU) {
+        BM_SET_ERROR("bm_buffer_create_shared: поддерживается только CPU-устройство");
+        return BM_ERROR_UNSUPPORTED;
+    }
+
+#ifdef _WIN32
+    (void)name;
+    BM_SET_ERROR("bm_buffer_create_shared: не поддерживается на этой платформе");
+    return BM_ERROR_UNSUPPORTED;
+#else
+    BMRecordCall rec;
+    bm_record_begin(&rec);
+    void* ptr = NULL;
+    if (bm_mem_shared_create(name, shared_header_size(), size, &ptr) != BM_SUCCESS)
+        return BM_ERROR_INVALID_ARG; // bm_mem_shared_create устанавливает last_error
+
+    // Объект свежий и обнулён: fence'ы стартуют с 0
+    BMSharedHeader* header = (BMSharedHeader*)((char*)ptr - shared_header_size());
+    header->size = size;
+    header->version = BM_SHARED_VERSION;
+    __atomic_store_n(&header->magic, BM_SHARED_MAGIC, __ATOMIC_RELEASE);
+
+    BMResult res = wrap_shared(device, ptr, size, 0, out_buffer);
+    if (res == BM_OK) {
+        bm_record_end(&rec, BM_RECORD_CREATE_SHARED, device, *out_buffer, size, name != NULL, BM_OK);
+        bm_log(BM_LOG_INFO, "Разделяемый буфер создан: %s (%zu байт)", name ? name : "memfd", size);
+    }
+    return res;
+#endif
+}
+
+BMResult bm_buffer_export_fd(BMBuffer* buf, int* out_fd) {
+    if (!buf || !out_fd || !(buf->flags & BM_BUFFER_SHARED)) {
+        BM_SET_ERROR("bm_buffer_export_fd: буфер не разделяемый");
+        return BM_ERROR_INVALID_ARG;
+    }
+    if (bm_mem_shared_fd(buf->data, out_fd) != BM_SUCCESS) return BM_ERROR_INTERNAL;
+    return BM_OK;
+}
+
+BMResult bm_buffer_import_shared(BMDevice* device, const char* name, int fd, unsigned flags, BMBuffer** out_buffer) {
+    if (!device || (!name && fd < 0) || !out_buffer || (flags & ~BM_SHARED_READ_ONLY)) {
+        BM_SET_ERROR("bm_buffer_import_shared: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+    if (device->type != BM_CPU) {
+        BM_SET_ERROR("bm_buffer_import_shared: поддерживается только CPU-устройство");
+        return BM_ERROR_UNSUPPORTED;
+    }
+
+#ifdef _WIN32
+    BM_SET_ERROR("bm_buffer_import_shared: не поддерживается на этой платформе");
+    return BM_ERROR_UNSUPPORTED;
+#else
+    BMRecordCall rec;
+    bm_record_begin(&rec);
+    int read_only = (flags & BM_SHARED_READ_ONLY) != 0;
+    void* ptr = NULL;
+    size_t length = 0;
+    if (bm_mem_shared_open(name, fd, shared_header_size(), read_only, &ptr, &length) != BM_SUCCESS)
+        return BM_ERROR_INVALID_ARG; // bm_mem_shared_open устанавливает last_error
+
+    const BMSharedHeader* header = (const BMSharedHeader*)((char*)ptr - shared_header_size());
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != BM_SHARED_MAGIC ||
+        header->version != BM_SHARED_VERSION || header->size > length) {
+        bm_cpu_free(ptr);
+        BM_SET_ERROR("bm_buffer_import_shared: объект не является разделяемым буфером burymetal");
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    BMResult res = wrap_shared(device, ptr, (size_t)header->size, read_only ? BM_BUFFER_READONLY : 0, out_buffer);
+    if (res == BM_OK) {
+        bm_record_end(&rec, BM_RECORD_IMPORT_SHARED, device, *out_buffer, header->size, flags, BM_OK);
+        bm_log(BM_LOG_INFO, "Разделяемый буфер импортирован: %s (%zu байт%s)", name ? name : "fd",
+               (size_t)header->size, read_only ? ", только чтение" : "");
+    }
+    return res;
+#endif
+}
+
+// ----------------------------------------
+// Fence'ы
+// ----------------------------------------
+#ifndef _WIN32
+// Не private-futex: слово лежит в MAP_SHARED и ждут его разные процессы
+static void fence_sleep(uint32_t* word, uint32_t observed, const struct timespec* timeout) {
+#ifdef __linux__
+    syscall(SYS_futex, word, FUTEX_WAIT, observed, timeout, NULL, 0);
+#else
+    (void)word;
+    (void)observed;
+    (void)timeout;
+    struct timespec pause = {0, 100000};  // без futex — опрос раз в 100 мкс
+    nanosleep(&pause, NULL);
+#endif
+}
+
+static void fence_wake(uint32_t* word) {
+#ifdef __linux__
+    syscall(SYS_futex, word, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+#else
+    (void)word;
+#endif
+}
+
+// Счётчик дошёл до value (с учётом переполнения 32 бит)
+static int fence_reached(uint32_t current, uint32_t value) {
+    return (int32_t)(current - value) >= 0;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+#endif
+
+static BMResult fence_check(const char* fn, BMBuffer* buf, unsigned fence) {
+    if (!buf || !(buf->flags & BM_BUFFER_SHARED) || fence >= BM_SHARED_FENCES) {
+        BM_SET_ERROR("%s: некорректный буфер или номер fence", fn);
+        return BM_ERROR_INVALID_ARG;
+    }
+    return BM_OK;
+}
+
+BMResult bm_shared_fence_signal(BMBuffer* buf, unsigned fence, uint32_t value) {
+    BMResult res = fence_check("bm_shared_fence_signal", buf, fence);
+    if (res != BM_OK) return res;
+
+#ifdef _WIN32
+    (void)value;
+    return BM_ERROR_UNSUPPORTED;
+#else
+    BMSharedFence* f = &shared_header(buf)->fences[fence];
+    // seq_cst в паре с wait: либо ждущий увидит новое значение,
+    // либо мы увидим его в waiters и разбудим
+    __atomic_store_n(&f->value, value, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&f->waiters, __ATOMIC_SEQ_CST) > 0)
+        fence_wake(&f->value);
+    return BM_OK;
+#endif
+}
+
+BMResult bm_shared_fence_wait(BMBuffer* buf, unsigned fence, uint32_t value, int timeout_ms) {
+    BMResult res = fence_check("bm_shared_fence_wait", buf, fence);
+    if (res != BM_OK) return res;
+
+#ifdef _WIN32
+    (void)value;
+    (void)timeout_ms;
+    return BM_ERROR_UNSUPPORTED;
+#else
+    BMSharedFence* f = &shared_header(buf)->fences[fence];
+
+    // Быстрый путь без системного вызова
+    if (fence_reached(__atomic_load_n(&f->value, __ATOMIC_ACQUIRE), value)) return BM_OK;
+
+    uint64_t trace = bm_trace_begin();
+    double deadline = timeout_ms >= 0 ? now_sec() + timeout_ms * 1e-3 : 0.0;
+    __atomic_fetch_add(&f->waiters, 1, __ATOMIC_SEQ_CST);
+    for (;;) {
+        uint32_t current = __atomic_load_n(&f->value, __ATOMIC_SEQ_CST);
+        if (fence_reached(current, value)) break;
+
+        struct timespec timeout;
+        const struct timespec* timeout_ptr = NULL;
+        if (timeout_ms >= 0) {
+            double left = deadline - now_sec();
+            if (left <= 0.0) {
+                res = BM_ERROR_TIMEOUT;
+                break;
+            }
+            timeout.tv_sec = (time_t)left;
+            timeout.tv_nsec = (long)((left - (double)timeout.tv_sec) * 1e9);
+            timeout_ptr = &timeout;
+        }
+        // Ядро само сравнит слово с current: сигнал между load и sleep не теряется
+        fence_sleep(&f->value, current, timeout_ptr);
+    }
+    __atomic_fetch_sub(&f->waiters, 1, __ATOMIC_SEQ_CST);
+    bm_trace_end(trace, "sync", "bm_shared_fence_wait", "fence", fence);
+
+    if (res == BM_ERROR_TIMEOUT)
+        BM_SET_ERROR("bm_shared_fence_wait: fence %u не дошёл до %u за %d мс", fence, value, timeout_ms);
+    return res;
+#endif
+}
@@ -0,0 +1,405 @@
+// bm_snapshot.c
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "burymetal.h"
+#include "bm_utils.h"
+#include "bm_internal.h"
+#include "bm_backend.h"
+#include "bm_mem_alloc.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+// ----------------------------------------
+// Формат снапшота
+// ----------------------------------------
+// [заголовок 64 байта][индекс: count записей по 64 байта][payload'ы]
+// Каждый payload выровнен по BM_SNAPSHOT_ALIGN от начала файла, поэтому
+// после mmap всего файла его можно обернуть в буфер без копирования.
+// Числа записаны в порядке байт host'а; чужой порядок отвергается по endian.
+
+#define BM_SNAPSHOT_MAGIC    "BMSNAP\0\1"
+#define BM_SNAPSHOT_VERSION  1u
+#define BM_SNAPSHOT_ENDIAN   0x01020304u
+#define BM_SNAPSHOT_ALIGN    4096u
+#define BM_SNAPSHOT_BOUNCE   (4u * 1024u * 1024u)   // порция download при сохранении
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint32_t count;
+    uint32_t alignment;
+    uint64_t index_offset;
+    uint64_t file_size;
+    uint8_t reserved[24];
+} BMSnapshotHeader;
+
+typedef struct {
+    uint64_t offset;
+    uint64_t size;
+    char name[BM_SNAPSHOT_NAME_MAX];
+} BMSnapshotRecord;
+
+struct BMSnapshot {
+    BMDevice* device;
+    size_t count;
+    BMSnapshotRecord* records;
+    BMBuffer** buffers;
+    void* mapping;              // mmap всего файла (CPU, zero-copy) или NULL
+};
+
+static uint64_t snapshot_align(uint64_t v) {
+    return (v + BM_SNAPSHOT_ALIGN - 1) & ~(uint64_t)(BM_SNAPSHOT_ALIGN - 1);
+}
+
+// ----------------------------------------
+// Сохранение
+// ----------------------------------------
+static int write_zeros(FILE* f, uint64_t count) {
+    static const char zeros[512];
+    while (count > 0) {
+        size_t n = count < sizeof(zeros) ? (size_t)count : sizeof(zeros);
+        if (fwrite(zeros, 1, n, f) != n) return 0;
+        count -= n;
+    }
+    return 1;
+}
+
+// Host-видимый буфер пишется напрямую, остальные — через bounce-буфер
+static BMResult write_payload(FILE* f, BMBuffer* buf, char** bounce) {
+    const void* host = bm_get_host_ptr(buf);
+    if (host) return fwrite(host, 1, buf->size, f) == buf->size ? BM_OK : BM_ERROR_INTERNAL;
+
+    if (!*bounce && !(*bounce = (char*)malloc(BM_SNAPSHOT_BOUNCE))) return BM_ERROR_NOMEM;
+    for (size_t done = 0; done < buf->size;) {
+        size_t chunk = buf->size - done;
+        if (chunk > BM_SNAPSHOT_BOUNCE) chunk = BM_SNAPSHOT_BOUNCE;
+        BMResult res = bm_read_buffer(buf, *bounce, chunk, done);
+        if (res != BM_OK) return res;
+        if (fwrite(*bounce, 1, chunk, f) != chunk) return BM_ERROR_INTERNAL;
+        done += chunk;
+    }
+    return BM_OK;
+}
+
+static BMResult snapshot_validate_entries(const BMSnapshotEntry* entries, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const char* name = entries[i].name;
+        if (!name || !entries[i].buffer || name[0] == '\0' || strlen(name) >= BM_SNAPSHOT_NAME_MAX) {
+            BM_SET_ERROR("bm_snapshot_save: запись %zu: пустое/слишком длинное имя или нет буфера", i);
+            return BM_ERROR_INVALID_ARG;
+        }
+        for (size_t j = 0; j < i; ++j) {
+            if (strcmp(entries[j].name, name) == 0) {
+                BM_SET_ERROR("bm_snapshot_save: имя '%s' повторяется", name);
+                return BM_ERROR_INVALID_ARG;
+            }
+        }
+    }
+    return BM_OK;
+}
+
+BMResult bm_snapshot_save(const char* path, const BMSnapshotEntry* entries, size_t count) {
+    if (!path || (count > 0 && !entries) || count > UINT32_MAX) {
+        BM_SET_ERROR("bm_snapshot_save: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+    BMResult res = snapshot_validate_entries(entries, count);
+    if (res != BM_OK) return res;
+
+    BMSnapshotRecord* records = (BMSnapshotRecord*)calloc(count ? count : 1, sizeof(BMSnapshotRecord));
+    if (!records) {
+        BM_SET_ERROR("bm_snapshot_save: не удалось выделить память");
+        return BM_ERROR_NOMEM;
+    }
+
+    // Раскладка: payload'ы подряд, каждый с выровненного смещения
+    uint64_t pos = snapshot_align(sizeof(BMSnapshotHeader) + (uint64_t)count * sizeof(BMSnapshotRecord));
+    for (size_t i = 0; i < count; ++i) {
+        records[i].offset = pos;
+        records[i].size = entries[i].buffer->size;
+        strcpy(records[i].name, entries[i].name);
+        pos = snapshot_align(pos + records[i].size);
+    }
+
+    BMSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BM_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = BM_SNAPSHOT_VERSION;
+    header.endian = BM_SNAPSHOT_ENDIAN;
+    header.count = (uint32_t)count;
+    header.alignment = BM_SNAPSHOT_ALIGN;
+    header.index_offset = sizeof(BMSnapshotHeader);
+    header.file_size = count ? records[count - 1].offset + records[count - 1].size : sizeof(header);
+
+    // Пишем во временный файл и переименовываем: читатель не увидит половину снапшота
+    size_t tmp_len = strlen(path) + sizeof(".tmp");
+    char* tmp_path = (char*)malloc(tmp_len);
+    if (!tmp_path) {
+        free(records);
+        BM_SET_ERROR("bm_snapshot_save: не удалось выделить память");
+        return BM_ERROR_NOMEM;
+    }
+    snprintf(tmp_path, tmp_len, "%s.tmp", path);
+
+    FILE* f = fopen(tmp_path, "wb");
+    if (!f) {
+        BM_SET_ERROR("bm_snapshot_save: не удалось создать '%s': %s", tmp_path, strerror(errno));
+        free(tmp_path);
+        free(records);
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    char* bounce = NULL;
+    uint64_t written = sizeof(header) + (uint64_t)count * sizeof(BMSnapshotRecord);
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+             (count == 0 || fwrite(records, sizeof(BMSnapshotRecord), count, f) == count);
+    res = ok ? BM_OK : BM_ERROR_INTERNAL;
+    for (size_t i = 0; i < count && res == BM_OK; ++i) {
+        if (!write_zeros(f, records[i].offset - written)) {
+            res = BM_ERROR_INTERNAL;
+            break;
+        }
+        res = write_payload(f, entries[i].buffer, &bounce);
+        written = records[i].offset + records[i].size;
+    }
+    free(bounce);
+    // Данные на диске до rename, запись каталога — после: сбой питания не
+    // оставит под именем path пустой или обрезанный файл
+    if (res == BM_OK && !bm_file_sync(f)) res = BM_ERROR_INTERNAL;
+    if (fclose(f) != 0 && res == BM_OK) res = BM_ERROR_INTERNAL;
+
+    if (res == BM_OK) {
+#ifdef _WIN32
+        remove(path); // rename на Windows не заменяет существующий файл
+#endif
+        if (rename(tmp_path, path) != 0) res = BM_ERROR_INTERNAL;
+        else if (!bm_sync_parent_dir(path)) res = BM_ERROR_INTERNAL;
+    }
+    if (res != BM_OK) {
+        remove(tmp_path);
+        BM_SET_ERROR("bm_snapshot_save: не удалось записать '%s' (%s)", path, bm_result_string(res));
+    } else {
+        bm_log(BM_LOG_INFO, "Снапшот сохранён: %s (%zu буферов, %llu байт)", path, count,
+               (unsigned long long)header.file_size);
+    }
+    free(tmp_path);
+    free(records);
+    return res;
+}
+
+// ----------------------------------------
+// Разбор заголовка и индекса
+// ----------------------------------------
+static int snapshot_parse_header(const BMSnapshotHeader* header, uint64_t file_size) {
+    return memcmp(header->magic, BM_SNAPSHOT_MAGIC, sizeof(header->magic)) == 0 &&
+           header->version == BM_SNAPSHOT_VERSION && header->endian == BM_SNAPSHOT_ENDIAN &&
+           header->alignment == BM_SNAPSHOT_ALIGN && header->index_offset == sizeof(BMSnapshotHeader) &&
+           header->file_size == file_size &&
+           (uint64_t)header->count <= (file_size - sizeof(BMSnapshotHeader)) / sizeof(BMSnapshotRecord);
+}
+
+static int snapshot_check_records(const BMSnapshotRecord* records, size_t count, uint64_t file_size) {
+    for (size_t i = 0; i < count; ++i) {
+        const BMSnapshotRecord* r = &records[i];
+        if (r->size == 0 || r->size > SIZE_MAX || r->offset % BM_SNAPSHOT_ALIGN != 0 ||
+            r->offset > file_size || r->size > file_size - r->offset ||
+            memchr(r->name, '\0', sizeof(r->name)) == NULL)
+            return 0;
+    }
+    return 1;
+}
+
+// ----------------------------------------
+// Восстановление
+// ----------------------------------------
+#ifndef _WIN32
+static BMResult snapshot_corrupt(const char* path) {
+    BM_SET_ERROR("bm_snapshot_open: '%s' не является снапшотом или повреждён", path);
+    return BM_ERROR_INVALID_ARG;
+}
+
+static BMResult snapshot_alloc_index(BMSnapshot* snap, size_t count) {
+    snap->count = count;
+    snap->records = (BMSnapshotRecord*)calloc(count ? count : 1, sizeof(BMSnapshotRecord));
+    snap->buffers = (BMBuffer**)calloc(count ? count : 1, sizeof(BMBuffer*));
+    if (!snap->records || !snap->buffers) {
+        BM_SET_ERROR("bm_snapshot_open: не удалось выделить память под индекс");
+        return BM_ERROR_NOMEM;
+    }
+    return BM_OK;
+}
+
+// CPU: один mmap на весь файл, буферы — обёртки над payload'ами
+static BMResult restore_mapped(BMSnapshot* snap, const char* path, unsigned flags) {
+    size_t length = 0;
+    BMResult res = bm_mem_map_file(path, 0, 0, flags, &snap->mapping, &length);
+    if (res != BM_SUCCESS) return res; // bm_mem_map_file устанавливает last_error
+
+    const char* base = (const char*)snap->mapping;
+    BMSnapshotHeader header;
+    if (length < sizeof(header)) return snapshot_corrupt(path);
+    memcpy(&header, base, sizeof(header));
+    if (!snapshot_parse_header(&header, length)) return snapshot_corrupt(path);
+
+    res = snapshot_alloc_index(snap, header.count);
+    if (res != BM_OK) return res;
+    memcpy(snap->records, base + header.index_offset, snap->count * sizeof(BMSnapshotRecord));
+    if (!snapshot_check_records(snap->records, snap->count, length)) return snapshot_corrupt(path);
+
+    for (size_t i = 0; i < snap->count; ++i) {
+        // BORROW: отображение принадлежит снапшоту и освобождается в bm_snapshot_close
+        BMBuffer* buf = bm_backend_wrap_host(snap->device, (char*)snap->mapping + snap->records[i].offset,
+                                             (size_t)snap->records[i].size, BM_WRAP_BORROW);
+        if (!buf) return BM_ERROR_UNSUPPORTED; // bm_backend_wrap_host устанавливает last_error
+        if (!(flags & BM_FILE_COPY_ON_WRITE)) buf->flags |= BM_BUFFER_READONLY;
+        bm_stats_adopt(buf); // отображением владеет снапшот, т.е. библиотека
+        snap->buffers[i] = buf;
+    }
+    return BM_OK;
+}
+
+static int read_exact(int fd, void* dst, size_t size, off_t offset) {
+    char* p = (char*)dst;
+    while (size > 0) {
+        ssize_t n = pread(fd, p, size, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        size -= (size_t)n;
+        offset += n;
+    }
+    return 1;
+}
+
+// Остальные устройства: индекс читается сразу, payload'ы грузятся bm_loader'ом
+// (много чтений в полёте, upload каждого блока сразу после чтения)
+static BMResult restore_uploaded(BMSnapshot* snap, const char* path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        BM_SET_ERROR("bm_snapshot_open: не удалось открыть '%s': %s", path, strerror(errno));
+        return BM_ERROR_INVALID_ARG;
+    }
+    struct stat st;
+    BMSnapshotHeader header;
+    int ok = fstat(fd, &st) == 0 && (uint64_t)st.st_size >= sizeof(header) &&
+             read_exact(fd, &header, sizeof(header), 0) && snapshot_parse_header(&header, (uint64_t)st.st_size);
+    if (ok) {
+        if (snapshot_alloc_index(snap, header.count) != BM_OK) {
+            close(fd);
+            return BM_ERROR_NOMEM;
+        }
+        ok = read_exact(fd, snap->records, snap->count * sizeof(BMSnapshotRecord), (off_t)header.index_offset) &&
+             snapshot_check_records(snap->records, snap->count, (uint64_t)st.st_size);
+    }
+    close(fd);
+    if (!ok) return snapshot_corrupt(path);
+    if (snap->count == 0) return BM_OK;
+
+    BMLoadRequest* requests = (BMLoadRequest*)calloc(snap->count, sizeof(BMLoadRequest));
+    if (!requests) {
+        BM_SET_ERROR("bm_snapshot_open: не удалось выделить память");
+        return BM_ERROR_NOMEM;
+    }
+    BMResult res = BM_OK;
+    for (size_t i = 0; i < snap->count && res == BM_OK; ++i) {
+        res = bm_alloc_buffer(snap->device, (size_t)snap->records[i].size, &snap->buffers[i]);
+        requests[i].buffer = snap->buffers[i];
+        requests[i].path = path;
+        requests[i].file_offset = snap->records[i].offset;
+        requests[i].length = (size_t)snap->records[i].size;
+    }
+
+    BMLoader* loader = NULL;
+    BMLoadEvent* event = NULL;
+    if (res == BM_OK) res = bm_loader_create(snap->device, NULL, &loader);
+    if (res == BM_OK) res = bm_loader_submit(loader, requests, snap->count, &event);
+    if (res == BM_OK) res = bm_load_event_wait(loader, event);
+    bm_loader_destroy(loader);
+    free(requests);
+    return res;
+}
+#endif // !_WIN32
+
+BMResult bm_snapshot_open(BMDevice* device, const char* path, unsigned flags, BMSnapshot** out_snapshot) {
+    if (!device || !path || !out_snapshot) {
+        BM_SET_ERROR("bm_snapshot_open: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+
+#ifdef _WIN32
+    (void)flags;
+    BM_SET_ERROR("bm_snapshot_open: не поддерживается на этой платформе");
+    return BM_ERROR_UNSUPPORTED;
+#else
+    BMSnapshot* snap = (BMSnapshot*)calloc(1, sizeof(BMSnapshot));
+    if (!snap) {
+        BM_SET_ERROR("bm_snapshot_open: не удалось выделить память");
+        return BM_ERROR_NOMEM;
+    }
+    snap->device = device;
+
+    // Отображение — host-память: напрямую её видит только CPU-устройство
+    BMResult res = device->type == BM_CPU ? restore_mapped(snap, path, flags) : restore_uploaded(snap, path);
+    if (res != BM_OK) {
+        bm_snapshot_close(snap);
+        return res;
+    }
+
+    *out_snapshot = snap;
+    bm_log(BM_LOG_INFO, "Снапшот восстановлен: %s (%zu буферов, %s)", path, snap->count,
+           snap->mapping ? "zero-copy mmap" : "загрузка в устройство");
+    return BM_OK;
+#endif
+}
+
+BMResult bm_snapshot_close(BMSnapshot* snapshot) {
+    if (!snapshot) return BM_OK;
+
+    // Сначала обёртки, затем отображение под ними
+    if (snapshot->buffers)
+        for (size_t i = 0; i < snapshot->count; ++i)
+            if (snapshot->buffers[i]) bm_free_buffer(snapshot->buffers[i]);
+    if (snapshot->mapping) bm_cpu_free(snapshot->mapping);
+
+    free(snapshot->buffers);
+    free(snapshot->records);
+    free(snapshot);
+    return BM_OK;
+}
+
+// ----------------------------------------
+// Доступ к буферам снапшота
+// ----------------------------------------
+size_t bm_snapshot_count(const BMSnapshot* snapshot) {
+    return snapshot ? snapshot->count : 0;
+}
+
+BMResult bm_snapshot_entry(const BMSnapshot* snapshot, size_t index, BMSnapshotEntry* out_entry) {
+    if (!snapshot || index >= snapshot->count || !out_entry) {
+        BM_SET_ERROR("bm_snapshot_entry: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+    out_entry->name = snapshot->records[index].name;
+    out_entry->buffer = snapshot->buffers[index];
+    return BM_OK;
+}
+
+BMBuffer* bm_snapshot_find(const BMSnapshot* snapshot, const char* name) {
+    if (!snapshot || !name) return NULL;
+    for (size_t i = 0; i < snapshot->count; ++i)
+        if (strcmp(snapshot->records[i].name, name) == 0) return snapshot->buffers[i];
+    return NULL;
+}
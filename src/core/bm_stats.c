@@ -0,0 +1,362 @@
+// bm_stats.c
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "burymetal.h"
+#include "bm_utils.h"
+#include "bm_internal.h"
+#include "bm_mem_utils.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define THREAD_LOCAL __declspec(thread)
+#else
+#include <pthread.h>
+#define THREAD_LOCAL __thread
+#endif
+
+// ----------------------------------------
+// Метрики устройства
+// ----------------------------------------
+// Счётчики и гистограммы разнесены по BM_STATS_SHARDS шардам, каждый со своих
+// кэш-линий; поток раз и навсегда получает номер шарда по кругу, так что
+// потоки почти не делят линии. Запуски по ядрам — там же: ядро при первом
+// запуске получает номер в таблице имён устройства (номер кэшируется в
+// горячей части ядра, kernel->stats_slot). Живые байты и их максимум — один
+// счётчик на устройство: максимум по шардам не собрать.
+
+#define BM_STATS_SHARDS      16
+#define BM_STATS_MAX_KERNELS 63     // дальше — общий слот "other"
+
+typedef struct {
+    BM_ALIGNAS(BM_CACHE_LINE_SIZE) uint64_t counters[BM_STAT_COUNT];
+    uint64_t launch_hist[BM_STATS_BUCKETS];
+    uint64_t pool_wait_hist[BM_STATS_BUCKETS];
+    uint64_t kernel_launches[BM_STATS_MAX_KERNELS + 1];
+} BMStatsShard;
+
+typedef struct BMDeviceStats {
+    BMStatsShard shards[BM_STATS_SHARDS];
+    BM_ALIGNAS(BM_CACHE_LINE_SIZE) uint64_t bytes_live;
+    uint64_t bytes_high_water;
+#ifdef _WIN32
+    SRWLOCK kernels_lock;
+#else
+    pthread_mutex_t kernels_lock;
+#endif
+    int kernel_count;
+    int serial;                     // номер устройства в процессе — для меток
+    char kernel_names[BM_STATS_MAX_KERNELS][BM_KERNEL_NAME_MAX];
+} BMDeviceStats;
+
+static unsigned next_shard = 0;
+static int next_device_serial = 0;
+static THREAD_LOCAL unsigned shard_of_thread = 0; // 1 + номер, 0 — не назначен
+
+static BMStatsShard* shard(BMDeviceStats* stats) {
+    unsigned index = shard_of_thread;
+    if (!index) index = shard_of_thread = __atomic_fetch_add(&next_shard, 1, __ATOMIC_RELAXED) % BM_STATS_SHARDS + 1;
+    return &stats->shards[index - 1];
+}
+
+static unsigned bucket_of(uint64_t ns) {
+    unsigned bucket = 0;
+    for (uint64_t v = ns >> 10; v && bucket < BM_STATS_BUCKETS - 1; v >>= 1) ++bucket;
+    return bucket;
+}
+
+static void counter_add(uint64_t* counter, uint64_t value) {
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+// ----------------------------------------
+// Жизненный цикл
+// ----------------------------------------
+int bm_stats_device_init(BMDevice* device) {
+    void* ptr = NULL;
+    if (bm_mem_align(&ptr, BM_CACHE_LINE_SIZE, sizeof(BMDeviceStats)) != BM_SUCCESS) return 0;
+    BMDeviceStats* stats = (BMDeviceStats*)ptr;
+    memset(stats, 0, sizeof(*stats));
+    // device->id у всех эмулируемых устройств 0 — метке нужен свой номер
+    stats->serial = __atomic_fetch_add(&next_device_serial, 1, __ATOMIC_RELAXED);
+#ifdef _WIN32
+    InitializeSRWLock(&stats->kernels_lock);
+#else
+    pthread_mutex_init(&stats->kernels_lock, NULL);
+#endif
+    device->stats = stats;
+    return 1;
+}
+
+void bm_stats_device_destroy(BMDevice* device) {
+    if (!device || !device->stats) return;
+#ifndef _WIN32
+    pthread_mutex_destroy(&device->stats->kernels_lock);
+#endif
+    bm_mem_align_free(device->stats);
+    device->stats = NULL;
+}
+
+// ----------------------------------------
+// Запись
+// ----------------------------------------
+void bm_stats_add(BMDevice* device, BMStatCounter counter, uint64_t value) {
+    if (!device || !device->stats) return;
+    counter_add(&shard(device->stats)->counters[counter], value);
+}
+
+// Номер ядра в таблице имён устройства; ядра с одинаковым именем делят номер
+static int kernel_slot(BMDeviceStats* stats, BMKernel* kernel) {
+    int slot = __atomic_load_n(&kernel->stats_slot, __ATOMIC_RELAXED);
+    if (slot) return slot - 1;
+
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&stats->kernels_lock);
+#else
+    pthread_mutex_lock(&stats->kernels_lock);
+#endif
+    slot = BM_STATS_MAX_KERNELS;
+    for (int i = 0; i < stats->kernel_count; ++i) {
+        if (strcmp(stats->kernel_names[i], kernel->cold->name) == 0) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot == BM_STATS_MAX_KERNELS && stats->kernel_count < BM_STATS_MAX_KERNELS) {
+        slot = stats->kernel_count;
+        memcpy(stats->kernel_names[slot], kernel->cold->name, BM_KERNEL_NAME_MAX);
+        // Имя записано до публикации счётчика имён
+        __atomic_store_n(&stats->kernel_count, slot + 1, __ATOMIC_RELEASE);
+    }
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&stats->kernels_lock);
+#else
+    pthread_mutex_unlock(&stats->kernels_lock);
+#endif
+
+    __atomic_store_n(&kernel->stats_slot, slot + 1, __ATOMIC_RELAXED);
+    return slot;
+}
+
+void bm_stats_launch(BMKernel* kernel, uint64_t ns) {
+    BMDeviceStats* stats = kernel->device ? kernel->device->stats : NULL;
+    if (!stats) return;
+    BMStatsShard* s = shard(stats);
+    counter_add(&s->counters[BM_STAT_LAUNCHES], 1);
+    counter_add(&s->counters[BM_STAT_LAUNCH_NS], ns);
+    counter_add(&s->launch_hist[bucket_of(ns)], 1);
+    counter_add(&s->kernel_launches[kernel_slot(stats, kernel)], 1);
+}
+
+void bm_stats_alloc(BMDevice* device, uint64_t bytes) {
+    if (!device || !device->stats) return;
+    BMDeviceStats* stats = device->stats;
+    counter_add(&shard(stats)->counters[BM_STAT_ALLOCATIONS], 1);
+
+    uint64_t live = __atomic_add_fetch(&stats->bytes_live, bytes, __ATOMIC_RELAXED);
+    uint64_t high = __atomic_load_n(&stats->bytes_high_water, __ATOMIC_RELAXED);
+    while (live > high && !__atomic_compare_exchange_n(&stats->bytes_high_water, &high, live, 1,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void bm_stats_free(BMDevice* device, uint64_t bytes) {
+    if (!device || !device->stats) return;
+    counter_add(&shard(device->stats)->counters[BM_STAT_FREES], 1);
+    __atomic_sub_fetch(&device->stats->bytes_live, bytes, __ATOMIC_RELAXED);
+}
+
+// Обёртки над памятью, которой владеет библиотека (клон, файл, shared, снапшот),
+// живут в bytes_live наравне с bm_alloc_buffer; bm_free_buffer снимает их по флагу
+void bm_stats_adopt(BMBuffer* buffer) {
+    if (!buffer || (buffer->flags & BM_BUFFER_COUNTED)) return;
+    buffer->flags |= BM_BUFFER_COUNTED;
+    bm_stats_alloc(buffer->device, buffer->size);
+}
+
+void bm_stats_pool_acquire(BMDevice* device, int hit, uint64_t wait_ns) {
+    if (!device || !device->stats) return;
+    BMStatsShard* s = shard(device->stats);
+    counter_add(&s->counters[hit ? BM_STAT_POOL_HITS : BM_STAT_POOL_MISSES], 1);
+    if (wait_ns) {
+        counter_add(&s->counters[BM_STAT_POOL_WAIT_NS], wait_ns);
+        counter_add(&s->pool_wait_hist[bucket_of(wait_ns)], 1);
+    }
+}
+
+// ----------------------------------------
+// Чтение
+// ----------------------------------------
+static uint64_t sum_counter(const BMDeviceStats* stats, BMStatCounter counter) {
+    uint64_t total = 0;
+    for (int i = 0; i < BM_STATS_SHARDS; ++i)
+        total += __atomic_load_n(&stats->shards[i].counters[counter], __ATOMIC_RELAXED);
+    return total;
+}
+
+BMResult bm_get_stats(BMDevice* device, BMStats* out) {
+    if (!device || !out) {
+        BM_SET_ERROR("bm_get_stats: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+    memset(out, 0, sizeof(*out));
+    const BMDeviceStats* stats = device->stats;
+    if (!stats) return BM_OK;
+
+    out->launches = sum_counter(stats, BM_STAT_LAUNCHES);
+    out->launch_ns = sum_counter(stats, BM_STAT_LAUNCH_NS);
+    out->bytes_uploaded = sum_counter(stats, BM_STAT_BYTES_UPLOADED);
+    out->bytes_downloaded = sum_counter(stats, BM_STAT_BYTES_DOWNLOADED);
+    out->allocations = sum_counter(stats, BM_STAT_ALLOCATIONS);
+    out->frees = sum_counter(stats, BM_STAT_FREES);
+    out->pool_hits = sum_counter(stats, BM_STAT_POOL_HITS);
+    out->pool_misses = sum_counter(stats, BM_STAT_POOL_MISSES);
+    out->pool_wait_ns = sum_counter(stats, BM_STAT_POOL_WAIT_NS);
+    for (int i = 0; i < BM_STATS_SHARDS; ++i) {
+        for (int b = 0; b < BM_STATS_BUCKETS; ++b) {
+            out->launch_latency[b] += __atomic_load_n(&stats->shards[i].launch_hist[b], __ATOMIC_RELAXED);
+            out->pool_wait[b] += __atomic_load_n(&stats->shards[i].pool_wait_hist[b], __ATOMIC_RELAXED);
+        }
+    }
+    out->bytes_live = __atomic_load_n(&stats->bytes_live, __ATOMIC_RELAXED);
+    out->bytes_high_water = __atomic_load_n(&stats->bytes_high_water, __ATOMIC_RELAXED);
+    return BM_OK;
+}
+
+// ----------------------------------------
+// Текстовый формат Prometheus
+// ----------------------------------------
+typedef struct {
+    char* out;
+    size_t capacity;
+    size_t length;          // длина всего текста, даже если он не влез
+} BMStatsText;
+
+static void text_printf(BMStatsText* text, const char* fmt, ...) {
+    char* dst = text->length < text->capacity ? text->out + text->length : NULL;
+    size_t room = dst ? text->capacity - text->length : 0;
+    va_list args;
+    va_start(args, fmt);
+    int written = vsnprintf(dst, room, fmt, args);
+    va_end(args);
+    if (written > 0) text->length += (size_t)written;
+}
+
+// Значение метки: экранируем \, " и перевод строки
+static void label_escape(char* out, size_t cap, const char* value) {
+    size_t len = 0;
+    for (; *value && len + 2 < cap; ++value) {
+        if (*value == '\\' || *value == '"') out[len++] = '\\';
+        if (*value == '\n') {
+            out[len++] = '\\';
+            out[len++] = 'n';
+            continue;
+        }
+        out[len++] = *value;
+    }
+    out[len] = '\0';
+}
+
+static const char* target_name(BMComputeTarget type) {
+    switch (type) {
+        case BM_CPU:    return "cpu";
+        case BM_NVIDIA: return "nvidia";
+        case BM_AMD:    return "amd";
+        case BM_INTEL:  return "intel";
+        default:        return "auto";
+    }
+}
+
+static void text_counter(BMStatsText* text, const char* labels, const char* name, const char* type,
+                         const char* help, uint64_t value) {
+    text_printf(text, "# HELP burymetal_%s %s\n# TYPE burymetal_%s %s\nburymetal_%s{%s} %llu\n", name, help,
+                name, type, name, labels, (unsigned long long)value);
+}
+
+static void text_gauge(BMStatsText* text, const char* labels, const char* name, const char* help, double value) {
+    text_printf(text, "# HELP burymetal_%s %s\n# TYPE burymetal_%s gauge\nburymetal_%s{%s} %.6g\n", name, help, name,
+                name, labels, value);
+}
+
+static void text_histogram(BMStatsText* text, const char* labels, const char* name, const char* help,
+                           const uint64_t* buckets, uint64_t sum_ns) {
+    text_printf(text, "# HELP burymetal_%s %s\n# TYPE burymetal_%s histogram\n", name, help, name);
+    uint64_t cumulative = 0;
+    for (int b = 0; b < BM_STATS_BUCKETS - 1; ++b) {
+        cumulative += buckets[b];
+        text_printf(text, "burymetal_%s_bucket{%s,le=\"%g\"} %llu\n", name, labels,
+                    (double)(1024ull << b) * 1e-9, (unsigned long long)cumulative);
+    }
+    cumulative += buckets[BM_STATS_BUCKETS - 1];
+    text_printf(text, "burymetal_%s_bucket{%s,le=\"+Inf\"} %llu\n", name, labels, (unsigned long long)cumulative);
+    text_printf(text, "burymetal_%s_sum{%s} %.9f\n", name, labels, (double)sum_ns * 1e-9);
+    text_printf(text, "burymetal_%s_count{%s} %llu\n", name, labels, (unsigned long long)cumulative);
+}
+
+size_t bm_stats_prometheus(BMDevice* device, char* out, size_t capacity) {
+    BMStatsText text = {out, out ? capacity : 0, 0};
+    if (text.capacity) out[0] = '\0';
+
+    BMStats s;
+    if (bm_get_stats(device, &s) != BM_OK) return 0;
+    // Статистика не заведена (устройство не из bm_create_device): метрик нет
+    if (!device->stats) return 0;
+
+    char labels[96];
+    snprintf(labels, sizeof(labels), "device=\"%s%d\"", target_name(device->type), device->stats->serial);
+
+    text_counter(&text, labels, "kernel_launches_total", "counter", "Kernel launches.", s.launches);
+    text_histogram(&text, labels, "launch_latency_seconds", "bm_launch_kernel latency.", s.launch_latency,
+                   s.launch_ns);
+    text_counter(&text, labels, "uploaded_bytes_total", "counter", "Bytes written to device buffers.",
+                 s.bytes_uploaded);
+    text_counter(&text, labels, "downloaded_bytes_total", "counter", "Bytes read from device buffers.",
+                 s.bytes_downloaded);
+    text_counter(&text, labels, "allocations_total", "counter", "Buffers allocated.", s.allocations);
+    text_counter(&text, labels, "frees_total", "counter", "Buffers freed.", s.frees);
+    text_counter(&text, labels, "live_bytes", "gauge", "Bytes in live buffers.", s.bytes_live);
+    text_counter(&text, labels, "live_bytes_high_water", "gauge", "Maximum of live_bytes.", s.bytes_high_water);
+    text_counter(&text, labels, "pool_hits_total", "counter", "Pool acquires served immediately.", s.pool_hits);
+    text_counter(&text, labels, "pool_misses_total", "counter", "Pool acquires that grew, waited or failed.",
+                 s.pool_misses);
+    text_histogram(&text, labels, "pool_wait_seconds", "Time spent waiting for a pool buffer.", s.pool_wait,
+                   s.pool_wait_ns);
+
+    // Пики калибровки: эффективность ядер на дашбордах — относительно них
+    const BMCalibration* cal = &device->calibration;
+    if (cal->measured_unix) {
+        text_gauge(&text, labels, "roofline_triad_bytes_per_second", "STREAM triad bandwidth, all threads.",
+                   cal->triad_gbps * 1e9);
+        text_gauge(&text, labels, "roofline_memcpy_bytes_per_second", "memcpy bandwidth, one thread.",
+                   cal->memcpy_gbps * 1e9);
+        text_gauge(&text, labels, "roofline_launch_seconds", "bm_launch_kernel cost of an empty kernel.",
+                   cal->launch_ns * 1e-9);
+        text_gauge(&text, labels, "roofline_peak_flops", "Peak double FLOP/s, all threads.", cal->peak_gflops * 1e9);
+    }
+
+    // Запуски по ядрам
+    const BMDeviceStats* stats = device->stats;
+    if (stats) {
+        text_printf(&text, "# HELP burymetal_kernel_launches_by_name_total Kernel launches by kernel name.\n"
+                           "# TYPE burymetal_kernel_launches_by_name_total counter\n");
+        int count = __atomic_load_n(&stats->kernel_count, __ATOMIC_ACQUIRE);
+        for (int k = 0; k <= BM_STATS_MAX_KERNELS; ++k) {
+            if (k >= count && k != BM_STATS_MAX_KERNELS) continue;
+            uint64_t launches = 0;
+            for (int i = 0; i < BM_STATS_SHARDS; ++i)
+                launches += __atomic_load_n(&stats->shards[i].kernel_launches[k], __ATOMIC_RELAXED);
+            if (k == BM_STATS_MAX_KERNELS && !launches) continue;
+
+            char name[2 * BM_KERNEL_NAME_MAX];
+            label_escape(name, sizeof(name), k < BM_STATS_MAX_KERNELS ? stats->kernel_names[k] : "other");
+            text_printf(&text, "burymetal_kernel_launches_by_name_total{%s,kernel=\"%s\"} %llu\n", labels, name,
+                        (unsigned long long)launches);
+        }
+    }
+    return text.length;
+}
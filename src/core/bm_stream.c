@@ -0,0 +1,380 @@
+// bm_stream.c
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "burymetal.h"
+#include "bm_utils.h"
+#include "bm_internal.h"
+#include "bm_mem_pool.h"
+#include "bm_mem_alloc.h"
+#include "bm_mem_numa.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// ----------------------------------------
+// Потоковый конвейер: read → upload → launch → download → sink
+// ----------------------------------------
+// Кольцо из depth слотов (host-буфер + буфер устройства из BMBufferPool).
+// Три стадии работают в своих потоках и передают слоты друг другу по кругу:
+//   чтение + upload  (поток reader)
+//   запуск ядра      (поток compute)
+//   download + sink  (вызывающий поток)
+// Пока ядро считает слот i, reader заполняет i+1, а sink сливает i-1, поэтому
+// время конвейера определяется самой медленной стадией, а память — depth слотами.
+
+typedef enum {
+    BM_SLOT_FREE,       // ждёт чтения
+    BM_SLOT_LOADED,     // данные на устройстве, ждёт ядра
+    BM_SLOT_COMPUTED    // ядро отработало, ждёт download + sink
+} BMSlotState;
+
+typedef struct BMStreamSlot {
+    BMSlotState state;
+    char* host;
+    BMBuffer* buffer;
+    size_t bytes;       // 0 в состоянии LOADED — конец данных
+} BMStreamSlot;
+
+typedef struct BMStream {
+    BMDevice* device;
+    const BMStreamConfig* config;
+    BMKernel* kernel;
+    size_t depth;
+    BMStreamSlot* slots;
+
+    int failed;
+    BMResult result;    // код первой ошибки
+    char error[256];
+    double busy[3];     // занятость стадий: чтение, ядро, sink
+
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE changed;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+#endif
+} BMStream;
+
+// ----------------------------------------
+// Вспомогательные функции
+// ----------------------------------------
+static double stream_now(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+static void stream_lock(BMStream* s) {
+#ifdef _WIN32
+    EnterCriticalSection(&s->lock);
+#else
+    pthread_mutex_lock(&s->lock);
+#endif
+}
+
+static void stream_unlock(BMStream* s) {
+#ifdef _WIN32
+    LeaveCriticalSection(&s->lock);
+#else
+    pthread_mutex_unlock(&s->lock);
+#endif
+}
+
+// Ожидание, пока слот перейдёт в state (0 — конвейер остановлен ошибкой)
+static int stream_wait_slot(BMStream* s, BMStreamSlot* slot, BMSlotState state) {
+    stream_lock(s);
+    while (slot->state != state && !s->failed) {
+#ifdef _WIN32
+        SleepConditionVariableCS(&s->changed, &s->lock, INFINITE);
+#else
+        pthread_cond_wait(&s->changed, &s->lock);
+#endif
+    }
+    int ok = !s->failed;
+    stream_unlock(s);
+    return ok;
+}
+
+static void stream_set_slot(BMStream* s, BMStreamSlot* slot, BMSlotState state) {
+    stream_lock(s);
+    slot->state = state;
+#ifdef _WIN32
+    WakeAllConditionVariable(&s->changed);
+#else
+    pthread_cond_broadcast(&s->changed);
+#endif
+    stream_unlock(s);
+}
+
+// Первая ошибка останавливает все стадии; текст копируется из last_error
+// потока, где она случилась (last_error — thread-local)
+static void stream_fail(BMStream* s, BMResult code, const char* what) {
+    stream_lock(s);
+    if (!s->failed) {
+        s->failed = 1;
+        s->result = code;
+        snprintf(s->error, sizeof(s->error), "bm_stream_run: %s: %s", what, bm_get_last_error());
+    }
+#ifdef _WIN32
+    WakeAllConditionVariable(&s->changed);
+#else
+    pthread_cond_broadcast(&s->changed);
+#endif
+    stream_unlock(s);
+}
+
+// Чтение до chunk_size байт (короткие read() дочитываются до EOF)
+static int stream_read(BMStream* s, char* dst, size_t* out_bytes) {
+    const BMStreamConfig* cfg = s->config;
+    if (cfg->read) {
+        size_t n = cfg->read(cfg->read_user, dst, cfg->chunk_size);
+        if (n == BM_STREAM_READ_ERROR || n > cfg->chunk_size) {
+            BM_SET_ERROR("ошибка источника данных");
+            return 0;
+        }
+        *out_bytes = n;
+        return 1;
+    }
+
+    size_t total = 0;
+    while (total < cfg->chunk_size) {
+#ifdef _WIN32
+        int n = _read(cfg->fd, dst + total, (unsigned)(cfg->chunk_size - total));
+#else
+        ssize_t n = read(cfg->fd, dst + total, cfg->chunk_size - total);
+#endif
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            BM_SET_ERROR("read(fd=%d): %s", cfg->fd, strerror(errno));
+            return 0;
+        }
+        if (n == 0) break;
+        total += (size_t)n;
+    }
+    *out_bytes = total;
+    return 1;
+}
+
+// ----------------------------------------
+// Стадии
+// ----------------------------------------
+// Стадии работают с буферами кольца: на BM_NUMA_BIND — с узла устройства
+static void stream_bind_thread(BMStream* s) {
+    if (s->device->numa_policy == BM_NUMA_BIND) bm_numa_bind_thread(s->device);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI stream_reader(LPVOID arg) {
+#else
+static void* stream_reader(void* arg) {
+#endif
+    BMStream* s = (BMStream*)arg;
+    stream_bind_thread(s);
+    size_t element = s->config->element_size ? s->config->element_size : 1;
+    for (size_t i = 0;; ++i) {
+        BMStreamSlot* slot = &s->slots[i % s->depth];
+        if (!stream_wait_slot(s, slot, BM_SLOT_FREE)) break;
+
+        double start = stream_now();
+        size_t bytes = 0;
+        if (!stream_read(s, slot->host, &bytes)) {
+            stream_fail(s, BM_ERROR_INTERNAL, "чтение");
+            break;
+        }
+        // Неполный элемент ядро не обработало бы — отклоняем, а не теряем молча
+        if (bytes % element != 0) {
+            BM_SET_ERROR("порция %zu байт не кратна element_size %zu", bytes, element);
+            stream_fail(s, BM_ERROR_INVALID_ARG, "чтение");
+            break;
+        }
+        if (bytes && bm_write_buffer(slot->buffer, slot->host, bytes, 0) != BM_OK) {
+            stream_fail(s, BM_ERROR_INTERNAL, "upload");
+            break;
+        }
+        s->busy[0] += stream_now() - start;
+
+        slot->bytes = bytes;
+        stream_set_slot(s, slot, BM_SLOT_LOADED);
+        if (bytes == 0) break; // конец данных передаётся дальше пустым слотом
+    }
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+#ifdef _WIN32
+static DWORD WINAPI stream_compute(LPVOID arg) {
+#else
+static void* stream_compute(void* arg) {
+#endif
+    BMStream* s = (BMStream*)arg;
+    stream_bind_thread(s);
+    size_t element = s->config->element_size ? s->config->element_size : 1;
+    for (size_t i = 0;; ++i) {
+        BMStreamSlot* slot = &s->slots[i % s->depth];
+        if (!stream_wait_slot(s, slot, BM_SLOT_LOADED)) break;
+
+        if (slot->bytes) {
+            double start = stream_now();
+            if (bm_launch_kernel(s->kernel, slot->buffer, slot->bytes / element) != BM_OK) {
+                stream_fail(s, BM_ERROR_INTERNAL, "запуск ядра");
+                break;
+            }
+            s->busy[1] += stream_now() - start;
+        }
+
+        size_t bytes = slot->bytes;
+        stream_set_slot(s, slot, BM_SLOT_COMPUTED);
+        if (bytes == 0) break;
+    }
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+// Download + sink в вызывающем потоке
+static void stream_drain(BMStream* s, BMStreamStats* stats) {
+    for (size_t i = 0;; ++i) {
+        BMStreamSlot* slot = &s->slots[i % s->depth];
+        if (!stream_wait_slot(s, slot, BM_SLOT_COMPUTED)) break;
+        if (slot->bytes == 0) break;
+
+        double start = stream_now();
+        if (bm_read_buffer(slot->buffer, slot->host, slot->bytes, 0) != BM_OK) {
+            stream_fail(s, BM_ERROR_INTERNAL, "download");
+            break;
+        }
+        if (s->config->sink && s->config->sink(s->config->sink_user, slot->host, slot->bytes) != 0) {
+            BM_SET_ERROR("sink вернул ошибку");
+            stream_fail(s, BM_ERROR_INTERNAL, "sink");
+            break;
+        }
+        s->busy[2] += stream_now() - start;
+
+        ++stats->chunks;
+        stats->bytes += slot->bytes;
+        stream_set_slot(s, slot, BM_SLOT_FREE);
+    }
+}
+
+// ----------------------------------------
+// Запуск конвейера
+// ----------------------------------------
+BMResult bm_stream_run(BMDevice* device, BMKernel* kernel, const BMStreamConfig* config, BMStreamStats* out_stats) {
+    if (!device || !kernel || !config || config->chunk_size == 0 ||
+        (!config->read && config->fd < 0) ||
+        (config->element_size && config->chunk_size % config->element_size != 0)) {
+        BM_SET_ERROR("bm_stream_run: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    BMStream s;
+    memset(&s, 0, sizeof(s));
+    s.device = device;
+    s.config = config;
+    s.kernel = kernel;
+    s.depth = config->depth ? config->depth : BM_STREAM_DEFAULT_DEPTH;
+
+    BMBufferPool* pool = bm_pool_create(device, config->chunk_size, s.depth);
+    s.slots = (BMStreamSlot*)calloc(s.depth, sizeof(BMStreamSlot));
+    if (!pool || !s.slots) {
+        if (pool) bm_pool_destroy(pool);
+        free(s.slots);
+        BM_SET_ERROR("bm_stream_run: не удалось выделить кольцо из %zu буферов по %zu байт", s.depth, config->chunk_size);
+        return BM_ERROR_NOMEM;
+    }
+
+    BMResult res = BM_OK;
+    for (size_t i = 0; i < s.depth && res == BM_OK; ++i) {
+        if (bm_pool_acquire(pool, &s.slots[i].buffer) != BM_SUCCESS ||
+            bm_cpu_alloc_ex(config->chunk_size, BM_ALLOC_UNINIT, (void**)&s.slots[i].host) != BM_SUCCESS)
+            res = BM_ERROR_NOMEM;
+    }
+
+    BMStreamStats stats;
+    memset(&stats, 0, sizeof(stats));
+    double start = stream_now();
+
+    if (res == BM_OK) {
+#ifdef _WIN32
+        InitializeCriticalSection(&s.lock);
+        InitializeConditionVariable(&s.changed);
+        HANDLE reader = CreateThread(NULL, 0, stream_reader, &s, 0, NULL);
+        HANDLE compute = reader ? CreateThread(NULL, 0, stream_compute, &s, 0, NULL) : NULL;
+        int started = reader && compute;
+#else
+        pthread_mutex_init(&s.lock, NULL);
+        pthread_cond_init(&s.changed, NULL);
+        pthread_t reader, compute;
+        int reader_ok = pthread_create(&reader, NULL, stream_reader, &s) == 0;
+        int compute_ok = reader_ok && pthread_create(&compute, NULL, stream_compute, &s) == 0;
+        int started = reader_ok && compute_ok;
+#endif
+        if (started) {
+            stream_drain(&s, &stats);
+        } else {
+            BM_SET_ERROR("не удалось запустить потоки стадий");
+            stream_fail(&s, BM_ERROR_INTERNAL, "запуск");
+        }
+
+#ifdef _WIN32
+        if (reader) { WaitForSingleObject(reader, INFINITE); CloseHandle(reader); }
+        if (compute) { WaitForSingleObject(compute, INFINITE); CloseHandle(compute); }
+        DeleteCriticalSection(&s.lock);
+#else
+        if (reader_ok) pthread_join(reader, NULL);
+        if (compute_ok) pthread_join(compute, NULL);
+        pthread_cond_destroy(&s.changed);
+        pthread_mutex_destroy(&s.lock);
+#endif
+        if (s.failed) {
+            BM_SET_ERROR("%s", s.error);
+            res = s.result;
+        }
+    } else {
+        BM_SET_ERROR("bm_stream_run: не удалось выделить кольцо из %zu буферов по %zu байт", s.depth, config->chunk_size);
+    }
+
+    for (size_t i = 0; i < s.depth; ++i) {
+        if (s.slots[i].buffer) bm_pool_release(pool, s.slots[i].buffer);
+        if (s.slots[i].host) bm_cpu_free(s.slots[i].host);
+    }
+    free(s.slots);
+    bm_pool_destroy(pool);
+
+    stats.elapsed_sec = stream_now() - start;
+    stats.read_busy_sec = s.busy[0];
+    stats.kernel_busy_sec = s.busy[1];
+    stats.sink_busy_sec = s.busy[2];
+    if (out_stats) *out_stats = stats;
+
+    if (res == BM_OK)
+        bm_log(BM_LOG_INFO, "Поток обработан: %zu порций, %llu байт за %.3f с",
+               stats.chunks, (unsigned long long)stats.bytes, stats.elapsed_sec);
+    return res;
+}
@@ -0,0 +1,327 @@
+// bm_trace.c
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "burymetal.h"
+#include "bm_utils.h"
+#include "bm_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define THREAD_LOCAL __declspec(thread)
+#else
+#include <pthread.h>
+#define THREAD_LOCAL __thread
+#endif
+
+// ----------------------------------------
+// Трассировка
+// ----------------------------------------
+// Каждый поток пишет завершённые интервалы в свой список блоков без
+// блокировок и публикует счётчик событий (release). bm_trace_stop читает
+// опубликованное и выгружает его в Chrome trace JSON. Блоки не
+// освобождаются: следующая сессия переиспользует их с начала, а запись
+// потока, завершившегося до начала сессии, достаётся новому потоку.
+
+#define BM_TRACE_NAME_MAX          BM_KERNEL_NAME_MAX
+#define BM_TRACE_CHUNK_EVENTS      1024u
+#define BM_TRACE_MAX_EVENTS        (256u * 1024u)  // на поток за сессию, дальше — dropped
+
+typedef struct {
+    uint64_t begin_ns;
+    uint64_t end_ns;
+    const char* category;
+    const char* arg_name;
+    uint64_t arg;
+    char name[BM_TRACE_NAME_MAX];
+} BMTraceEvent;
+
+typedef struct BMTraceChunk {
+    struct BMTraceChunk* next;
+    BMTraceEvent events[BM_TRACE_CHUNK_EVENTS];
+} BMTraceChunk;
+
+enum { BM_TRACE_OWNED, BM_TRACE_ORPHANED };
+
+typedef struct BMTraceThread {
+    struct BMTraceThread* next;     // список всех записей (только добавление)
+    unsigned id;
+    int state;
+    unsigned session;               // сессия, к которой относятся события
+    size_t count;                   // опубликовано событий
+    size_t dropped;
+    BMTraceChunk* first;
+    // Поля ниже трогает только владелец
+    BMTraceChunk* current;
+    size_t current_used;
+} BMTraceThread;
+
+int bm_trace_active = 0;
+
+static BMTraceThread* threads = NULL;
+static unsigned next_thread_id = 0;
+static unsigned session = 0;
+static uint64_t session_start_ns = 0;
+static char* session_path = NULL;
+static THREAD_LOCAL BMTraceThread* self = NULL;
+static THREAD_LOCAL int suspended = 0;
+
+#ifdef _WIN32
+static INIT_ONCE control_once = INIT_ONCE_STATIC_INIT;
+static CRITICAL_SECTION control_lock;
+
+static BOOL CALLBACK control_init(PINIT_ONCE once, PVOID param, PVOID* context) {
+    (void)once; (void)param; (void)context;
+    InitializeCriticalSection(&control_lock);
+    return TRUE;
+}
+
+static void lock_control(void) {
+    InitOnceExecuteOnce(&control_once, control_init, NULL, NULL);
+    EnterCriticalSection(&control_lock);
+}
+
+static void unlock_control(void) { LeaveCriticalSection(&control_lock); }
+#else
+static pthread_mutex_t control_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_key;
+
+static void lock_control(void) { pthread_mutex_lock(&control_lock); }
+static void unlock_control(void) { pthread_mutex_unlock(&control_lock); }
+
+// Поток завершился: его запись можно отдать другому после выгрузки сессии
+static void thread_exit(void* arg) {
+    __atomic_store_n(&((BMTraceThread*)arg)->state, BM_TRACE_ORPHANED, __ATOMIC_RELEASE);
+}
+
+static void key_init(void) { pthread_key_create(&thread_key, thread_exit); }
+#endif
+
+// ----------------------------------------
+// Запись событий
+// ----------------------------------------
+static BMTraceThread* thread_attach(void) {
+    unsigned current = __atomic_load_n(&session, __ATOMIC_ACQUIRE);
+
+    // Свободная запись потока, завершившегося до этой сессии
+    BMTraceThread* rec = __atomic_load_n(&threads, __ATOMIC_ACQUIRE);
+    for (; rec; rec = rec->next) {
+        int orphaned = BM_TRACE_ORPHANED;
+        if (__atomic_load_n(&rec->session, __ATOMIC_ACQUIRE) != current &&
+            __atomic_compare_exchange_n(&rec->state, &orphaned, BM_TRACE_OWNED, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            break;
+    }
+
+    if (!rec) {
+        rec = (BMTraceThread*)calloc(1, sizeof(BMTraceThread));
+        if (!rec) return NULL;
+        rec->id = __atomic_add_fetch(&next_thread_id, 1, __ATOMIC_RELAXED);
+        rec->session = current - 1; // сброс при первой записи
+        rec->next = __atomic_load_n(&threads, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&threads, &rec->next, rec, 1,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+
+#ifndef _WIN32
+    pthread_once(&key_once, key_init);
+    pthread_setspecific(thread_key, rec);
+#endif
+    return rec;
+}
+
+uint64_t bm_trace_clock(void) {
+    return suspended ? 0 : bm_now_ns();
+}
+
+int bm_trace_suspend_thread(int suspend) {
+    int prev = suspended;
+    suspended = suspend;
+    return prev;
+}
+
+void bm_trace_record(uint64_t begin_ns, const char* category, const char* name,
+                     const char* arg_name, uint64_t arg) {
+    uint64_t end_ns = bm_now_ns();
+
+    BMTraceThread* rec = self;
+    if (!rec && !(rec = self = thread_attach())) return;
+
+    // Новая сессия: блоки переиспользуются с начала
+    unsigned current = __atomic_load_n(&session, __ATOMIC_ACQUIRE);
+    if (rec->session != current) {
+        __atomic_store_n(&rec->count, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&rec->dropped, 0, __ATOMIC_RELAXED);
+        rec->current = rec->first;
+        rec->current_used = 0;
+        __atomic_store_n(&rec->session, current, __ATOMIC_RELEASE);
+    }
+
+    size_t count = rec->count;
+    if (count >= BM_TRACE_MAX_EVENTS) {
+        __atomic_store_n(&rec->dropped, rec->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    if (!rec->current || rec->current_used == BM_TRACE_CHUNK_EVENTS) {
+        BMTraceChunk* next = rec->current ? rec->current->next : rec->first;
+        if (!next) {
+            next = (BMTraceChunk*)malloc(sizeof(BMTraceChunk));
+            if (!next) {
+                __atomic_store_n(&rec->dropped, rec->dropped + 1, __ATOMIC_RELAXED);
+                return;
+            }
+            next->next = NULL;
+            if (rec->current) __atomic_store_n(&rec->current->next, next, __ATOMIC_RELEASE);
+            else __atomic_store_n(&rec->first, next, __ATOMIC_RELEASE);
+        }
+        rec->current = next;
+        rec->current_used = 0;
+    }
+
+    BMTraceEvent* ev = &rec->current->events[rec->current_used++];
+    ev->begin_ns = begin_ns;
+    ev->end_ns = end_ns;
+    ev->category = category;
+    ev->arg_name = arg_name;
+    ev->arg = arg;
+    if (name) {
+        strncpy(ev->name, name, BM_TRACE_NAME_MAX - 1);
+        ev->name[BM_TRACE_NAME_MAX - 1] = '\0';
+    } else {
+        ev->name[0] = '\0';
+    }
+    __atomic_store_n(&rec->count, count + 1, __ATOMIC_RELEASE);
+}
+
+// ----------------------------------------
+// Выгрузка в Chrome trace JSON
+// ----------------------------------------
+static void write_json_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; ++s) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(f, "\\%c", c);
+        else if (c < 0x20) fprintf(f, "\\u%04x", c);
+        else fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+static void write_event(FILE* f, const BMTraceEvent* ev, unsigned tid) {
+    uint64_t begin = ev->begin_ns > session_start_ns ? ev->begin_ns - session_start_ns : 0;
+    uint64_t dur = ev->end_ns > ev->begin_ns ? ev->end_ns - ev->begin_ns : 0;
+
+    fputs(",\n{\"name\":", f);
+    write_json_string(f, ev->name);
+    fputs(",\"cat\":", f);
+    write_json_string(f, ev->category ? ev->category : "");
+    // ts и dur в микросекундах
+    fprintf(f, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu.%03u,\"dur\":%llu.%03u", tid,
+            (unsigned long long)(begin / 1000), (unsigned)(begin % 1000),
+            (unsigned long long)(dur / 1000), (unsigned)(dur % 1000));
+    if (ev->arg_name) {
+        fputs(",\"args\":{", f);
+        write_json_string(f, ev->arg_name);
+        fprintf(f, ":%llu}", (unsigned long long)ev->arg);
+    }
+    fputc('}', f);
+}
+
+static BMResult write_trace(const char* path, unsigned current, size_t* out_events, size_t* out_dropped) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        BM_SET_ERROR("bm_trace_stop: не удалось открыть %s", path);
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    size_t events = 0, dropped = 0;
+    fputs("{\"traceEvents\":[", f);
+    fputs("\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"burymetal\"}}", f);
+    for (BMTraceThread* rec = __atomic_load_n(&threads, __ATOMIC_ACQUIRE); rec; rec = rec->next) {
+        if (__atomic_load_n(&rec->session, __ATOMIC_ACQUIRE) != current) continue;
+        size_t count = __atomic_load_n(&rec->count, __ATOMIC_ACQUIRE);
+        dropped += __atomic_load_n(&rec->dropped, __ATOMIC_RELAXED);
+        if (!count) continue;
+
+        fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                   "\"args\":{\"name\":\"thread %u\"}}", rec->id, rec->id);
+        BMTraceChunk* chunk = __atomic_load_n(&rec->first, __ATOMIC_ACQUIRE);
+        for (size_t i = 0; i < count && chunk; ++i) {
+            write_event(f, &chunk->events[i % BM_TRACE_CHUNK_EVENTS], rec->id);
+            if (i % BM_TRACE_CHUNK_EVENTS == BM_TRACE_CHUNK_EVENTS - 1)
+                chunk = __atomic_load_n(&chunk->next, __ATOMIC_ACQUIRE);
+        }
+        events += count;
+    }
+    fputs("\n],\"displayTimeUnit\":\"ns\"}\n", f);
+
+    int failed = ferror(f);
+    if (fclose(f) != 0 || failed) {
+        BM_SET_ERROR("bm_trace_stop: ошибка записи %s", path);
+        return BM_ERROR_INTERNAL;
+    }
+    *out_events = events;
+    *out_dropped = dropped;
+    return BM_OK;
+}
+
+// ----------------------------------------
+// Управление
+// ----------------------------------------
+BMResult bm_trace_start(const char* path) {
+    if (!path || !*path) {
+        BM_SET_ERROR("bm_trace_start: некорректные аргументы");
+        return BM_ERROR_INVALID_ARG;
+    }
+
+    lock_control();
+    if (session_path) {
+        unlock_control();
+        BM_SET_ERROR("bm_trace_start: трассировка уже включена");
+        return BM_ERROR_INVALID_ARG;
+    }
+    size_t len = strlen(path);
+    session_path = (char*)malloc(len + 1);
+    if (!session_path) {
+        unlock_control();
+        BM_SET_ERROR("bm_trace_start: не удалось выделить память");
+        return BM_ERROR_NOMEM;
+    }
+    memcpy(session_path, path, len + 1);
+
+    session_start_ns = bm_now_ns();
+    __atomic_add_fetch(&session, 1, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&bm_trace_active, 1, __ATOMIC_RELEASE);
+    unlock_control();
+
+    bm_log(BM_LOG_INFO, "Трассировка включена: %s", path);
+    return BM_OK;
+}
+
+BMResult bm_trace_stop(void) {
+    lock_control();
+    if (!session_path) {
+        unlock_control();
+        BM_SET_ERROR("bm_trace_stop: трассировка не включена");
+        return BM_ERROR_INVALID_ARG;
+    }
+    __atomic_store_n(&bm_trace_active, 0, __ATOMIC_RELEASE);
+
+    size_t events = 0, dropped = 0;
+    BMResult res = write_trace(session_path, __atomic_load_n(&session, __ATOMIC_ACQUIRE), &events, &dropped);
+    if (res == BM_OK)
+        bm_log(BM_LOG_INFO, "Трассировка записана: %s (%zu событий, отброшено %zu)", session_path, events, dropped);
+
+    free(session_path);
+    session_path = NULL;
+    unlock_control();
+    return res;
+}
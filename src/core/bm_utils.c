@@ -1,5 +1,11 @@
 // bm_utils.c
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "bm_utils.h"
+#include "bm_internal.h"
+#include "burymetal.h"
 #include <stdio.h>
 #include <stdarg.h>
 #include <time.h>
@@ -9,29 +15,44 @@
 #ifdef _WIN32
 #include <windows.h>
 #include <synchapi.h>
+#include <io.h>
 #define THREAD_LOCAL __declspec(thread)
 #else
+#include <fcntl.h>
 #include <pthread.h>
+#include <unistd.h>
 #define THREAD_LOCAL __thread
 #endif
 
 // ----------------------------------------
 // Логирование
 // ----------------------------------------
+// Поток-источник проверяет уровень, форматирует сообщение прямо в слот своего
+// кольца (SPSC, без блокировок) и публикует его атомарным tail. Фоновый поток
+// обходит все кольца, собирает строки в пачку и пишет её одним fwrite на
+// stderr и в файл с одним fflush. Время форматируется раз в секунду.
+// Когда все кольца пусты, фоновый поток спит на condvar; его будит источник,
+// чьё сообщение легло в пустое кольцо, а также flush, exit и выход потока.
+// На Windows и если фоновый поток недоступен (не стартовал, после fork,
+// после exit) строки пишутся синхронно под мьютексом.
 
-typedef enum {
-    BM_LOG_ERROR,
-    BM_LOG_WARN,
-    BM_LOG_INFO,
-    BM_LOG_DEBUG
-} BMLogLevel;
+#define BM_LOG_MSG_MAX     232      // текст одного сообщения (длиннее — обрезается)
+#define BM_LOG_RING_SLOTS  1024u    // сообщений в кольце потока по умолчанию (256 КБ)
+#define BM_LOG_RING_MIN    8u
+#define BM_LOG_RING_MAX    (1u << 20)
+#define BM_LOG_BATCH_BYTES (64u * 1024u)
+#define BM_LOG_LINE_MAX    (BM_LOG_MSG_MAX + 64)
+#define BM_LOG_BLOCK_NS    50000L   // пауза источника при BM_LOG_OVERFLOW_BLOCK
 
-static BMLogLevel current_level = BM_LOG_INFO;
+int bm_log_current_level = BM_LOG_INFO;
+static THREAD_LOCAL int thread_level = 0;   // 1 + потолок уровня потока, 0 — без потолка
+static int overflow_policy = BM_LOG_OVERFLOW_DROP;
+static unsigned ring_slots = BM_LOG_RING_SLOTS;   // для колец, создаваемых дальше
 
 // Файл для логов
 static FILE* log_file = NULL;
 
-// Мьютекс для потокобезопасного логирования
+// Мьютекс вывода: смена файла, синхронная запись, запись пачки
 #ifdef _WIN32
 static CRITICAL_SECTION log_mutex;
 static int log_mutex_initialized = 0;
@@ -39,8 +60,20 @@ static int log_mutex_initialized = 0;
 static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
 #endif
 
-// Потокобезопасный last_error
-static THREAD_LOCAL char last_error[256] = {0};
+// Последняя ошибка потока: формат и захваченные аргументы, текст — по запросу
+#define BM_ERROR_TEXT_MAX    256
+#define BM_ERROR_STRINGS_MAX 192    // копии строковых аргументов
+
+typedef struct {
+    const char* fmt;                // NULL — ошибок не было
+    int count;
+    int formatted;                  // text актуален
+    BMErrorArg args[BM_ERROR_MAX_ARGS];
+    char strings[BM_ERROR_STRINGS_MAX];
+    char text[BM_ERROR_TEXT_MAX];
+} BMLastError;
+
+static THREAD_LOCAL BMLastError last_error;
 
 // Цвета для консоли
 #ifdef _WIN32
@@ -73,76 +106,396 @@ static void unlock_mutex() {
 #endif
 }
 
-// Внутренняя функция логирования
-static void bm_vlog(BMLogLevel level, const char* fmt, va_list args) {
-    if (level > current_level) return;
+static const char* level_name(int level) {
+    return (level == BM_LOG_ERROR) ? "ERROR" :
+           (level == BM_LOG_WARN)  ? "WARN"  :
+           (level == BM_LOG_INFO)  ? "INFO"  : "DEBUG";
+}
+
+static uint64_t wall_clock_ns(void) {
+#ifdef _WIN32
+    return (uint64_t)time(NULL) * 1000000000ull;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+uint64_t bm_now_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// "YYYY-mm-dd HH:MM:SS.mmm"; localtime/strftime — только при смене секунды
+static void format_time(uint64_t ns, char* out, size_t cap) {
+    static THREAD_LOCAL time_t cached_sec = (time_t)-1;
+    static THREAD_LOCAL char cached[32];
+
+    time_t sec = (time_t)(ns / 1000000000ull);
+    if (sec != cached_sec) {
+        struct tm tbuf;
+#ifdef _WIN32
+        localtime_s(&tbuf, &sec);
+#else
+        localtime_r(&sec, &tbuf);
+#endif
+        strftime(cached, sizeof(cached), "%Y-%m-%d %H:%M:%S", &tbuf);
+        cached_sec = sec;
+    }
+    snprintf(out, cap, "%s.%03u", cached, (unsigned)((ns / 1000000ull) % 1000ull));
+}
+
+// Строка для файла: "[время] [УРОВЕНЬ] текст\n"; для консоли (color) — с цветом
+static size_t format_line(char* out, size_t cap, uint64_t ns, int level, const char* text, int color) {
+    char ts[40];
+    format_time(ns, ts, sizeof(ts));
+    int n;
+#ifndef _WIN32
+    if (color) {
+        const char* c = (level == BM_LOG_ERROR) ? COLOR_ERROR :
+                        (level == BM_LOG_WARN)  ? COLOR_WARN  :
+                        (level == BM_LOG_INFO)  ? COLOR_INFO  : COLOR_DEBUG;
+        n = snprintf(out, cap, "%s[%s] [%s]%s %s\n", c, ts, level_name(level), COLOR_RESET, text);
+    } else
+#endif
+    {
+        (void)color;
+        n = snprintf(out, cap, "[%s] [%s] %s\n", ts, level_name(level), text);
+    }
+    if (n < 0) return 0;
+    if ((size_t)n >= cap) {
+        out[cap - 2] = '\n';    // обрезанная строка всё равно завершается переводом
+        return cap - 1;
+    }
+    return (size_t)n;
+}
 
-    const char* level_str =
-        (level == BM_LOG_ERROR) ? "ERROR" :
-        (level == BM_LOG_WARN)  ? "WARN"  :
-        (level == BM_LOG_INFO)  ? "INFO"  : "DEBUG";
+// Синхронная запись одной строки (Windows и запасной путь)
+static void write_line_sync(int level, const char* text) {
+    char line[BM_LOG_LINE_MAX];
+    uint64_t ns = wall_clock_ns();
 
+    lock_mutex();
 #ifdef _WIN32
     WORD color;
-    switch(level) {
+    switch (level) {
         case BM_LOG_ERROR: color = COLOR_ERROR; break;
         case BM_LOG_WARN:  color = COLOR_WARN;  break;
         case BM_LOG_INFO:  color = COLOR_INFO;  break;
-        case BM_LOG_DEBUG: color = COLOR_DEBUG; break;
+        default:           color = COLOR_DEBUG; break;
     }
     HANDLE hConsole = GetStdHandle(STD_ERROR_HANDLE);
     CONSOLE_SCREEN_BUFFER_INFO csbi;
     GetConsoleScreenBufferInfo(hConsole, &csbi);
     WORD old_color = csbi.wAttributes;
     SetConsoleTextAttribute(hConsole, color);
+    fwrite(line, 1, format_line(line, sizeof(line), ns, level, text, 0), stderr);
+    SetConsoleTextAttribute(hConsole, old_color);
 #else
-    const char* color =
-        (level == BM_LOG_ERROR) ? COLOR_ERROR :
-        (level == BM_LOG_WARN)  ? COLOR_WARN :
-        (level == BM_LOG_INFO)  ? COLOR_INFO : COLOR_DEBUG;
+    fwrite(line, 1, format_line(line, sizeof(line), ns, level, text, 1), stderr);
 #endif
+    if (log_file) {
+        fwrite(line, 1, format_line(line, sizeof(line), ns, level, text, 0), log_file);
+        fflush(log_file);
+    }
+    unlock_mutex();
+}
 
-    time_t now = time(NULL);
-    struct tm tbuf;
-#ifdef _WIN32
-    localtime_s(&tbuf, &now);
-#else
-    localtime_r(&now, &tbuf);
-#endif
-    char ts[32];
-    strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", &tbuf);
+#ifndef _WIN32
+// ----------------------------------------
+// Кольца потоков и фоновый поток записи
+// ----------------------------------------
+typedef struct {
+    uint64_t time_ns;
+    uint32_t level;
+    uint32_t length;
+    char text[BM_LOG_MSG_MAX];
+} BMLogRecord;
 
-    lock_mutex();
+enum { BM_RING_OWNED = 0, BM_RING_ORPHANED, BM_RING_FREE };
 
-#ifdef _WIN32
-    fprintf(stderr, "[%s] [%s] ", ts, level_str);
-    vfprintf(stderr, fmt, args);
-    fprintf(stderr, "\n");
-#else
-    fprintf(stderr, "%s[%s] [%s]%s ", color, ts, level_str, COLOR_RESET);
-    vfprintf(stderr, fmt, args);
-    fprintf(stderr, "\n");
-#endif
+typedef struct BMLogRing {
+    uint64_t head;                  // пишет только фоновый поток
+    char pad0[BM_CACHE_LINE_SIZE - sizeof(uint64_t)];
+    uint64_t tail;                  // пишет только поток-владелец
+    uint64_t dropped;
+    char pad1[BM_CACHE_LINE_SIZE - 2 * sizeof(uint64_t)];
+    int state;                      // BM_RING_*: кольца не освобождаются, а переиспользуются
+    unsigned mask;                  // слотов - 1
+    struct BMLogRing* next;
+    BMLogRecord slots[];
+} BMLogRing;
+
+enum { BM_WRITER_OFF = 0, BM_WRITER_RUNNING, BM_WRITER_STOPPING };
+
+static BMLogRing* rings = NULL;     // список только растёт (CAS в голову)
+static THREAD_LOCAL BMLogRing* tls_ring = NULL;
+static pthread_key_t ring_key;
+static pthread_once_t writer_once = PTHREAD_ONCE_INIT;
+static pthread_t writer_thread;
+static int writer_state = BM_WRITER_OFF;
+static uint64_t writer_passes = 0;  // завершённые проходы (для bm_log_flush)
+static uint64_t stat_written = 0;
+
+// Сон фонового потока: writer_sleeping публикуется до последней проверки колец,
+// источник после публикации tail проверяет его (обе стороны — через seq_cst fence)
+static pthread_mutex_t wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake_cond = PTHREAD_COND_INITIALIZER;
+static int writer_sleeping = 0;
+static int writer_kick = 0;         // под wake_lock: внеочередной проход
+
+static void writer_wake(void) {
+    pthread_mutex_lock(&wake_lock);
+    writer_kick = 1;
+    pthread_cond_signal(&wake_cond);
+    pthread_mutex_unlock(&wake_lock);
+}
+
+// Поток завершился: кольцо дочитывается и переходит следующему потоку
+static void ring_release(void* arg) {
+    __atomic_store_n(&((BMLogRing*)arg)->state, BM_RING_ORPHANED, __ATOMIC_RELEASE);
+    writer_wake();
+}
+
+static BMLogRing* ring_acquire(void) {
+    if (tls_ring) return tls_ring;
+
+    unsigned slots = __atomic_load_n(&ring_slots, __ATOMIC_RELAXED);
+    BMLogRing* ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE);
+    for (; ring; ring = ring->next) {
+        int expected = BM_RING_FREE;
+        if (ring->mask + 1 == slots &&
+            __atomic_compare_exchange_n(&ring->state, &expected, BM_RING_OWNED, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            break;
+    }
+    if (!ring) {
+        ring = (BMLogRing*)calloc(1, sizeof(BMLogRing) + slots * sizeof(BMLogRecord));
+        if (!ring) return NULL;
+        ring->mask = slots - 1;
+        ring->next = __atomic_load_n(&rings, __ATOMIC_ACQUIRE);
+        while (!__atomic_compare_exchange_n(&rings, &ring->next, ring, 1, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {}
+    }
+    tls_ring = ring;
+    pthread_setspecific(ring_key, ring);
+    return ring;
+}
+
+// Пачка строк для stderr (с цветом) и для файла
+typedef struct {
+    char err[BM_LOG_BATCH_BYTES];
+    char file[BM_LOG_BATCH_BYTES];
+    size_t err_len;
+    size_t file_len;
+    uint64_t lines;
+} BMLogBatch;
 
+static void batch_write(BMLogBatch* batch) {
+    if (!batch->lines) return;
+    lock_mutex();
+    fwrite(batch->err, 1, batch->err_len, stderr);
+    fflush(stderr);
     if (log_file) {
-        fprintf(log_file, "[%s] [%s] ", ts, level_str);
-        vfprintf(log_file, fmt, args);
-        fprintf(log_file, "\n");
+        fwrite(batch->file, 1, batch->file_len, log_file);
         fflush(log_file);
     }
+    unlock_mutex();
+    __atomic_add_fetch(&stat_written, batch->lines, __ATOMIC_RELAXED);
+    batch->err_len = batch->file_len = 0;
+    batch->lines = 0;
+}
 
-#ifdef _WIN32
-    SetConsoleTextAttribute(hConsole, old_color);
-#endif
+static void batch_add(BMLogBatch* batch, uint64_t ns, int level, const char* text) {
+    if (batch->err_len + BM_LOG_LINE_MAX > BM_LOG_BATCH_BYTES ||
+        batch->file_len + BM_LOG_LINE_MAX > BM_LOG_BATCH_BYTES)
+        batch_write(batch);
+    batch->err_len += format_line(batch->err + batch->err_len, BM_LOG_LINE_MAX, ns, level, text, 1);
+    batch->file_len += format_line(batch->file + batch->file_len, BM_LOG_LINE_MAX, ns, level, text, 0);
+    ++batch->lines;
+}
 
-    unlock_mutex();
+// Один проход по всем кольцам; возвращает число прочитанных сообщений
+static size_t writer_drain(BMLogBatch* batch, uint64_t* reported_drops) {
+    size_t drained = 0;
+    uint64_t drops = 0;
+
+    for (BMLogRing* ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        int state = __atomic_load_n(&ring->state, __ATOMIC_ACQUIRE);
+        uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        uint64_t head = ring->head;
+        for (; head != tail; ++head) {
+            const BMLogRecord* rec = &ring->slots[head & ring->mask];
+            batch_add(batch, rec->time_ns, (int)rec->level, rec->text);
+            ++drained;
+            // Слоты освобождаются сразу — BLOCK-источники не ждут конца прохода
+            if ((head & 31u) == 31u) __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+        }
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+        drops += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+
+        // Кольцо завершившегося потока пусто — его может взять новый поток
+        if (state == BM_RING_ORPHANED && head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE))
+            __atomic_store_n(&ring->state, BM_RING_FREE, __ATOMIC_RELEASE);
+    }
+
+    if (drops != *reported_drops) {
+        char text[128];
+        snprintf(text, sizeof(text), "лог: отброшено %llu сообщений (переполнение кольца)",
+                 (unsigned long long)(drops - *reported_drops));
+        batch_add(batch, wall_clock_ns(), BM_LOG_WARN, text);
+        *reported_drops = drops;
+    }
+    batch_write(batch);
+    __atomic_add_fetch(&writer_passes, 1, __ATOMIC_RELEASE);
+    return drained;
+}
+
+static int rings_empty(void) {
+    for (BMLogRing* ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring; ring = ring->next)
+        if (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) != ring->head) return 0;
+    return 1;
+}
+
+// Ждём, пока в каком-нибудь кольце появится сообщение или придёт внеочередной запрос
+static void writer_wait(void) {
+    pthread_mutex_lock(&wake_lock);
+    __atomic_store_n(&writer_sleeping, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    while (!writer_kick && rings_empty() &&
+           __atomic_load_n(&writer_state, __ATOMIC_ACQUIRE) == BM_WRITER_RUNNING)
+        pthread_cond_wait(&wake_cond, &wake_lock);
+    writer_kick = 0;
+    __atomic_store_n(&writer_sleeping, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&wake_lock);
+}
+
+static void* writer_main(void* arg) {
+    (void)arg;
+    BMLogBatch* batch = (BMLogBatch*)calloc(1, sizeof(BMLogBatch));
+    uint64_t reported_drops = 0;
+    if (!batch) return NULL;
+
+    for (;;) {
+        int stopping = __atomic_load_n(&writer_state, __ATOMIC_ACQUIRE) == BM_WRITER_STOPPING;
+        if (writer_drain(batch, &reported_drops) == 0) {
+            if (stopping) break;
+            writer_wait();
+        }
+    }
+    free(batch);
+    return NULL;
+}
+
+// exit(): дописываем всё, дальше — синхронная запись
+static void writer_shutdown(void) {
+    int expected = BM_WRITER_RUNNING;
+    if (!__atomic_compare_exchange_n(&writer_state, &expected, BM_WRITER_STOPPING, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return;
+    writer_wake();
+    pthread_join(writer_thread, NULL);
+    __atomic_store_n(&writer_state, BM_WRITER_OFF, __ATOMIC_RELEASE);
+}
+
+// В дочернем процессе фонового потока нет
+static void writer_after_fork(void) {
+    writer_state = BM_WRITER_OFF;
+    tls_ring = NULL;
+    pthread_mutex_init(&wake_lock, NULL); // мог быть захвачен потоком родителя
+    writer_sleeping = writer_kick = 0;
+}
+
+static void writer_start(void) {
+    if (pthread_key_create(&ring_key, ring_release) != 0) return;
+    if (pthread_create(&writer_thread, NULL, writer_main, NULL) != 0) return;
+    __atomic_store_n(&writer_state, BM_WRITER_RUNNING, __ATOMIC_RELEASE);
+    pthread_atfork(NULL, NULL, writer_after_fork);
+    atexit(writer_shutdown);
+}
+
+// Кладёт сообщение в кольцо потока; 0 — писать синхронно
+static int log_enqueue(int level, const char* fmt, va_list args) {
+    pthread_once(&writer_once, writer_start);
+    if (__atomic_load_n(&writer_state, __ATOMIC_ACQUIRE) != BM_WRITER_RUNNING) return 0;
+
+    BMLogRing* ring = ring_acquire();
+    if (!ring) return 0;
+
+    uint64_t tail = ring->tail;
+    while (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) > ring->mask) {
+        if (__atomic_load_n(&overflow_policy, __ATOMIC_RELAXED) == BM_LOG_OVERFLOW_DROP) {
+            __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+            return 1;
+        }
+        if (__atomic_load_n(&writer_state, __ATOMIC_ACQUIRE) != BM_WRITER_RUNNING) return 0;
+        struct timespec pause = {0, BM_LOG_BLOCK_NS};
+        nanosleep(&pause, NULL);
+    }
+
+    BMLogRecord* rec = &ring->slots[tail & ring->mask];
+    rec->time_ns = wall_clock_ns();
+    rec->level = (uint32_t)level;
+    int n = vsnprintf(rec->text, sizeof(rec->text), fmt, args);
+    rec->length = n < 0 ? 0u : (n >= (int)sizeof(rec->text) ? (uint32_t)sizeof(rec->text) - 1 : (uint32_t)n);
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+    // Сообщение легло в пустое кольцо — фоновый поток мог уснуть
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail &&
+        __atomic_load_n(&writer_sleeping, __ATOMIC_RELAXED))
+        writer_wake();
+    return 1;
+}
+#endif // !_WIN32
+
+// Внутренняя функция логирования
+static void bm_vlog(int level, const char* fmt, va_list args) {
+    if (!bm_log_enabled(level) || (thread_level && level >= thread_level)) return;
+
+#ifndef _WIN32
+    va_list copy;
+    va_copy(copy, args);
+    int queued = log_enqueue(level, fmt, copy);
+    va_end(copy);
+    if (queued) return;
+#endif
+    char text[BM_LOG_MSG_MAX];
+    vsnprintf(text, sizeof(text), fmt, args);
+    write_line_sync(level, text);
 }
 
 // ----------------------------------------
 // Интерфейс логирования
 // ----------------------------------------
 
-void bm_log_set_level(int level) { current_level = (BMLogLevel)level; }
+void bm_log_set_level(int level) { __atomic_store_n(&bm_log_current_level, level, __ATOMIC_RELAXED); }
+
+int bm_log_set_thread_level(int level) {
+    int previous = thread_level - 1;
+    thread_level = level < 0 ? 0 : level + 1;
+    return previous;
+}
+
+void bm_log_set_overflow(BMLogOverflow policy) {
+    __atomic_store_n(&overflow_policy, (int)policy, __ATOMIC_RELAXED);
+}
+
+void bm_log_set_ring_slots(size_t slots) {
+    unsigned n = BM_LOG_RING_MIN;
+    if (slots == 0) n = BM_LOG_RING_SLOTS;
+    while (n < slots && n < BM_LOG_RING_MAX) n <<= 1;
+    __atomic_store_n(&ring_slots, n, __ATOMIC_RELAXED);
+}
 
 void bm_log_set_file(const char* path) {
     lock_mutex();
@@ -154,28 +507,71 @@ void bm_log_set_file(const char* path) {
     unlock_mutex();
 }
 
-void bm_log_error(const char* fmt, ...) {
+void bm_log_flush(void) {
+#ifndef _WIN32
+    if (__atomic_load_n(&writer_state, __ATOMIC_ACQUIRE) != BM_WRITER_RUNNING) return;
+
+    // Ждём, пока фоновый поток прочитает всё опубликованное к этому моменту,
+    // и затем ещё один полный проход — чтобы прочитанное было записано
+    for (BMLogRing* ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        uint64_t target = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        while ((int64_t)(__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - target) < 0) {
+            if (__atomic_load_n(&writer_state, __ATOMIC_ACQUIRE) != BM_WRITER_RUNNING) return;
+            struct timespec pause = {0, BM_LOG_BLOCK_NS};
+            nanosleep(&pause, NULL);
+        }
+    }
+    // Спящий фоновый поток проходов не делает — будим на каждый
+    uint64_t pass = __atomic_load_n(&writer_passes, __ATOMIC_ACQUIRE);
+    while (__atomic_load_n(&writer_passes, __ATOMIC_ACQUIRE) < pass + 2 &&
+           __atomic_load_n(&writer_state, __ATOMIC_ACQUIRE) == BM_WRITER_RUNNING) {
+        writer_wake();
+        struct timespec pause = {0, BM_LOG_BLOCK_NS};
+        nanosleep(&pause, NULL);
+    }
+#endif
+}
+
+void bm_log_get_stats(BMLogStats* stats) {
+    if (!stats) return;
+    stats->written = 0;
+    stats->dropped = 0;
+#ifndef _WIN32
+    stats->written = __atomic_load_n(&stat_written, __ATOMIC_RELAXED);
+    for (BMLogRing* ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring; ring = ring->next)
+        stats->dropped += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+#endif
+}
+
+void (bm_log)(BMLogLevel level, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    bm_vlog((int)level, fmt, args);
+    va_end(args);
+}
+
+void (bm_log_error)(const char* fmt, ...) {
     va_list args;
     va_start(args, fmt);
     bm_vlog(BM_LOG_ERROR, fmt, args);
     va_end(args);
 }
 
-void bm_log_warn(const char* fmt, ...) {
+void (bm_log_warn)(const char* fmt, ...) {
     va_list args;
     va_start(args, fmt);
     bm_vlog(BM_LOG_WARN, fmt, args);
     va_end(args);
 }
 
-void bm_log_info(const char* fmt, ...) {
+void (bm_log_info)(const char* fmt, ...) {
     va_list args;
     va_start(args, fmt);
     bm_vlog(BM_LOG_INFO, fmt, args);
     va_end(args);
 }
 
-void bm_log_debug(const char* fmt, ...) {
+void (bm_log_debug)(const char* fmt, ...) {
     va_list args;
     va_start(args, fmt);
     bm_vlog(BM_LOG_DEBUG, fmt, args);
@@ -186,19 +582,166 @@ void bm_log_debug(const char* fmt, ...) {
 // Система ошибок
 // ----------------------------------------
 
+// Спецификатор формата с длиной, подобранной под тип захваченного аргумента
+static int error_format_arg(char* out, size_t room, char* spec, size_t n, char conv, const BMErrorArg* arg) {
+    long long i = arg->type == 'u' ? (long long)arg->value.u : arg->type == 'f' ? (long long)arg->value.f : arg->value.i;
+    unsigned long long u = arg->type == 'i' ? (unsigned long long)arg->value.i
+                         : arg->type == 'f' ? (unsigned long long)arg->value.f : arg->value.u;
+    double f = arg->type == 'f' ? arg->value.f : arg->type == 'u' ? (double)arg->value.u : (double)arg->value.i;
+
+    switch (conv) {
+        case 'd': case 'i':
+            spec[n++] = 'l'; spec[n++] = 'l'; spec[n++] = conv; spec[n] = '\0';
+            return snprintf(out, room, spec, i);
+        case 'o': case 'u': case 'x': case 'X':
+            spec[n++] = 'l'; spec[n++] = 'l'; spec[n++] = conv; spec[n] = '\0';
+            return snprintf(out, room, spec, u);
+        case 'c':
+            spec[n++] = conv; spec[n] = '\0';
+            return snprintf(out, room, spec, (int)i);
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            spec[n++] = conv; spec[n] = '\0';
+            return snprintf(out, room, spec, f);
+        case 's':
+            spec[n++] = conv; spec[n] = '\0';
+            return snprintf(out, room, spec, arg->type == 's' ? arg->value.s : "?");
+        case 'p':
+            spec[n++] = conv; spec[n] = '\0';
+            return snprintf(out, room, spec, arg->type == 'p' ? arg->value.p : (const void*)arg->value.s);
+    }
+    return 0;
+}
+
+static void error_format(BMLastError* e) {
+    char* out = e->text;
+    size_t cap = sizeof(e->text), len = 0;
+    const char* p = e->fmt;
+    int next = 0;
+
+    while (*p && len + 1 < cap) {
+        if (*p != '%') { out[len++] = *p++; continue; }
+        if (p[1] == '%') { out[len++] = '%'; p += 2; continue; }
+
+        // %[флаги][ширина][.точность][длина]преобразование; длину ставим сами
+        char spec[32];
+        size_t n = 0;
+        spec[n++] = *p++;
+        while (*p && strchr("-+ #0", *p) && n < 8) spec[n++] = *p++;
+        while (*p >= '0' && *p <= '9' && n < 16) spec[n++] = *p++;
+        if (*p == '.') {
+            spec[n++] = *p++;
+            while (*p >= '0' && *p <= '9' && n < 24) spec[n++] = *p++;
+        }
+        while (*p && strchr("hljztL", *p)) ++p;
+        if (!*p) break;
+        char conv = *p++;
+
+        if (next >= e->count) continue; // аргументов меньше, чем спецификаторов
+        int written = error_format_arg(out + len, cap - len, spec, n, conv, &e->args[next++]);
+        if (written > 0) len += (size_t)written < cap - len ? (size_t)written : cap - len - 1;
+    }
+    out[len] = '\0';
+}
+
+void bm_set_last_error_args(const char* fmt, const BMErrorArg* args, int count) {
+    BMLastError* e = &last_error;
+    if (count > BM_ERROR_MAX_ARGS) count = BM_ERROR_MAX_ARGS;
+
+    // Строки копируем сразу: к моменту bm_get_last_error их может уже не быть.
+    // Через локальный буфер — аргумент может указывать на прошлый текст ошибки.
+    char strings[BM_ERROR_STRINGS_MAX];
+    size_t used = 0;
+    for (int i = 0; i < count; ++i) {
+        e->args[i] = args[i];
+        if (args[i].type != 's') continue;
+        const char* src = args[i].value.s ? args[i].value.s : "(null)";
+        size_t room = sizeof(strings) - used;
+        size_t len = room ? strnlen(src, room - 1) : 0;
+        if (!room) {
+            e->args[i].value.s = "";
+            continue;
+        }
+        memcpy(strings + used, src, len);
+        strings[used + len] = '\0';
+        e->args[i].value.s = e->strings + used;
+        used += len + 1;
+    }
+    memcpy(e->strings, strings, used);
+    e->count = count;
+    e->fmt = fmt ? fmt : "";
+    e->formatted = 0;
+
+    if (bm_log_enabled(BM_LOG_DEBUG)) (bm_log_debug)("%s", bm_get_last_error());
+}
+
 void bm_set_last_error(const char* fmt, ...) {
+    BMLastError* e = &last_error;
     va_list args;
     va_start(args, fmt);
 #ifdef _WIN32
-    _vsnprintf_s(last_error, sizeof(last_error), _TRUNCATE, fmt, args);
+    _vsnprintf_s(e->text, sizeof(e->text), _TRUNCATE, fmt, args);
 #else
-    vsnprintf(last_error, sizeof(last_error), fmt, args);
+    vsnprintf(e->text, sizeof(e->text), fmt, args);
 #endif
     va_end(args);
-    // Автоматически логируем
-    bm_log_error("%s", last_error);
+    e->fmt = "";
+    e->count = 0;
+    e->formatted = 1;
+
+    bm_log_debug("%s", e->text);
 }
 
 const char* bm_get_last_error(void) {
-    return last_error[0] ? last_error : "OK";
+    BMLastError* e = &last_error;
+    if (!e->fmt) return "OK";
+    if (!e->formatted) {
+        error_format(e);
+        e->formatted = 1;
+    }
+    return e->text;
+}
+
+const char* bm_result_string(BMResult code) {
+    switch (code) {
+        case BM_OK:                return "OK";
+        case BM_ERROR_NOMEM:       return "недостаточно памяти";
+        case BM_ERROR_INVALID_ARG: return "некорректный аргумент";
+        case BM_ERROR_UNSUPPORTED: return "не поддерживается";
+        case BM_ERROR_DEVICE_LOST: return "устройство потеряно";
+        case BM_ERROR_INTERNAL:    return "внутренняя ошибка";
+        case BM_ERROR_TIMEOUT:     return "истекло время ожидания";
+    }
+    return "неизвестная ошибка";
+}
+
+// ----------------------------------------
+// Файлы
+// ----------------------------------------
+
+int bm_file_sync(FILE* file) {
+    if (fflush(file) != 0) return 0;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+int bm_sync_parent_dir(const char* path) {
+#ifdef _WIN32
+    (void)path; // NTFS журналирует rename сам, каталог не открыть через fsync
+    return 1;
+#else
+    char dir[1024];
+    const char* slash = strrchr(path, '/');
+    if (!slash) snprintf(dir, sizeof(dir), ".");
+    else if (slash == path) snprintf(dir, sizeof(dir), "/");
+    else snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0) return 0;
+    int ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+#endif
 }
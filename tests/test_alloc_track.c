@@ -0,0 +1,119 @@
+// test_alloc_track.c
+#define _POSIX_C_SOURCE 200809L
+#include "burymetal.h"
+#include "bm_utils.h"
+#include "bm_mem_alloc.h"
+#include "bm_mem_pool.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define THREADS 4
+#define ROUNDS 200
+
+static void* worker(void* arg) {
+    (void)arg;
+    bm_alloc_set_tag("worker");
+    for (int i = 0; i < ROUNDS; i++) {
+        void* ptr = NULL;
+        assert(bm_cpu_alloc(64 + (size_t)i, &ptr) == BM_SUCCESS);
+        assert(bm_cpu_free(ptr) == BM_SUCCESS);
+    }
+    return NULL;
+}
+
+int main(void) {
+    printf("=== Burymetal Allocation Tracking Tests ===\n");
+
+    assert(bm_alloc_track_stop() == BM_ERROR_INVALID_ARG); // не включён
+    assert(bm_alloc_track_start(8) == BM_OK);
+    assert(bm_alloc_track_start(8) == BM_ERROR_INVALID_ARG);
+
+    BMDevice* dev = NULL;
+    assert(bm_create_device(BM_CPU, &dev) == BM_OK);
+
+    // Буферы: вложенный bm_cpu_alloc backend'а второй раз не считается
+    assert(bm_alloc_set_tag("buffers") == NULL);
+    BMBuffer* bufs[3];
+    for (int i = 0; i < 3; i++) assert(bm_alloc_buffer(dev, 4096, &bufs[i]) == BM_OK);
+    assert(strcmp(bm_alloc_set_tag(NULL), "buffers") == 0);
+
+    BMAllocUsage usage, all;
+    assert(bm_alloc_track_usage(dev, &usage) == BM_OK);
+    assert(usage.allocations == 3 && usage.live_count == 3 && usage.live_bytes == 3 * 4096);
+    assert(bm_alloc_track_usage(NULL, &all) == BM_OK);
+    assert(all.allocations == 3 && all.live_bytes == 3 * 4096);
+
+    void* host = NULL;
+    void* gpu = NULL;
+    assert(bm_cpu_alloc(1000, &host) == BM_SUCCESS);
+    assert(bm_gpu_alloc(dev, 2000, &gpu) == BM_SUCCESS);
+    BMBufferPool* pool = bm_pool_create(dev, 512, 2);
+    assert(pool);
+    assert(bm_alloc_track_usage(dev, &usage) == BM_OK);
+    assert(usage.live_count == 6 && usage.live_bytes == 3 * 4096 + 2000 + 1024);
+    assert(bm_alloc_track_usage(NULL, &all) == BM_OK);
+    assert(all.live_bytes == usage.live_bytes + 1000);
+
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++) assert(pthread_create(&threads[i], NULL, worker, NULL) == 0);
+    for (int i = 0; i < THREADS; i++) pthread_join(threads[i], NULL);
+
+    assert(bm_free_buffer(bufs[0]) == BM_OK && bm_free_buffer(bufs[1]) == BM_OK);
+    assert(bm_cpu_free(host) == BM_SUCCESS);
+    assert(bm_gpu_free(dev, gpu) == BM_SUCCESS);
+    assert(bm_pool_destroy(pool) == BM_SUCCESS);
+    assert(bm_alloc_track_usage(dev, &usage) == BM_OK);
+    assert(usage.live_count == 1 && usage.live_bytes == 4096 && usage.peak_bytes == 3 * 4096 + 2000 + 1024);
+    assert(bm_alloc_track_usage(NULL, &all) == BM_OK);
+    assert(all.live_bytes == 4096 && all.allocations == 3 + 1 + 1 + 2 + THREADS * ROUNDS);
+
+    // Места: по убыванию пика, метки потоков разделяют места
+    size_t count = bm_alloc_track_sites(NULL, 0);
+    BMAllocSite* sites = (BMAllocSite*)calloc(count, sizeof(BMAllocSite));
+    assert(sites && bm_alloc_track_sites(sites, count) == count);
+    assert(sites[0].kind == BM_ALLOC_KIND_BUFFER && strcmp(sites[0].tag, "buffers") == 0);
+    assert(sites[0].allocations == 3 && sites[0].peak_bytes == 3 * 4096 && sites[0].live_bytes == 4096);
+    uint64_t worker_allocs = 0;
+    for (size_t i = 0; i < count; i++) {
+        assert(i == 0 || sites[i].peak_bytes <= sites[i - 1].peak_bytes);
+        if (sites[i].tag && strcmp(sites[i].tag, "worker") == 0) {
+            assert(sites[i].kind == BM_ALLOC_KIND_HOST && sites[i].live_count == 0);
+            worker_allocs += sites[i].allocations;
+        }
+    }
+    assert(worker_allocs == THREADS * ROUNDS);
+    free(sites);
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/bm_test_alloc_track_%d.txt", (int)getpid());
+    assert(bm_alloc_track_report(path, 3) == BM_OK);
+    FILE* f = fopen(path, "r");
+    assert(f);
+    char text[8192];
+    size_t len = fread(text, 1, sizeof(text) - 1, f);
+    text[len] = '\0';
+    fclose(f);
+    unlink(path);
+    assert(strstr(text, "top sites by peak") && strstr(text, "tag buffers"));
+    printf("sites: %zu, peak %llu bytes ✅\n", count, (unsigned long long)usage.peak_bytes);
+
+    // Третий буфер намеренно не освобождается: он попадает в отчёт об утечках
+    assert(bm_destroy_device(dev) == BM_OK);
+    assert(bm_alloc_track_usage(NULL, &all) == BM_OK);
+    assert(all.leaked_count == 1 && all.leaked_bytes == 4096 && all.live_count == 0);
+    assert(bm_alloc_track_usage(dev, &usage) == BM_OK && usage.allocations == 0);
+    printf("leak at device destroy reported ✅\n");
+
+    assert(bm_alloc_track_stop() == BM_OK);
+    void* untracked = NULL;
+    assert(bm_cpu_alloc(128, &untracked) == BM_SUCCESS);
+    assert(bm_alloc_track_usage(NULL, &all) == BM_OK && all.live_count == 0);
+    bm_cpu_free(untracked);
+
+    printf("All tests passed ✅\n");
+    return 0;
+}
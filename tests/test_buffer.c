@@ -4,16 +4,19 @@
 #include <stdio.h>
 #include <string.h>
 
+#define CHECK(cond, msg) \
+    do { if (!(cond)) { fprintf(stderr, "%s: %s\n", msg, bm_get_last_error()); assert(0); } } while (0)
+
 static void test_basic(BMDevice* dev) {
     size_t buf_size = 1024;
-    BMBuffer* buffer = bm_alloc_buffer(dev, buf_size);
-    assert(buffer && "bm_alloc_buffer failed");
+    BMBuffer* buffer = NULL;
+    assert(bm_alloc_buffer(dev, buf_size, &buffer) == BM_OK && "bm_alloc_buffer failed");
 
     const char* msg = "Burymetal test buffer!";
-    CHECK(bm_upload_data(buffer, msg) == BM_SUCCESS, "Ошибка записи данных");
+    CHECK(bm_upload_data(buffer, msg, strlen(msg) + 1) == BM_SUCCESS, "Ошибка записи данных");
 
     char out[64] = {0};
-    CHECK(bm_download_data(buffer, out) == BM_SUCCESS, "Ошибка чтения данных");
+    CHECK(bm_download_data(buffer, out, strlen(msg) + 1) == BM_SUCCESS, "Ошибка чтения данных");
 
     assert(strcmp(msg, out) == 0 && "buffer mismatch");
 
@@ -22,8 +25,8 @@ static void test_basic(BMDevice* dev) {
 
 static void test_offsets(BMDevice* dev) {
     size_t buf_size = 32;
-    BMBuffer* buffer = bm_alloc_buffer(dev, buf_size);
-    assert(buffer);
+    BMBuffer* buffer = NULL;
+    assert(bm_alloc_buffer(dev, buf_size, &buffer) == BM_OK);
 
     // CPU backend может дать прямой доступ
     if (bm_get_host_ptr(buffer)) {
@@ -41,9 +44,145 @@ static void test_offsets(BMDevice* dev) {
     bm_free_buffer(buffer);
 }
 
+static void test_regions(BMDevice* dev) {
+    size_t buf_size = 4096;
+    BMBuffer* buffer = NULL;
+    assert(bm_alloc_buffer(dev, buf_size, &buffer) == BM_OK);
+
+    char a[4] = "abc", b[4] = "def", c[4] = "ghi";
+    BMTransferRegion writes[3] = {
+        { a, 100, 4 },
+        { b, 104, 4 },   // стык в стык с предыдущим
+        { c, 3000, 4 },
+    };
+    CHECK(bm_write_buffer_regions(buffer, writes, 3) == BM_OK, "Ошибка scatter-записи");
+
+    char out[3][4] = {{0}};
+    BMTransferRegion reads[3] = {
+        { out[0], 3000, 4 },
+        { out[1], 100, 4 },
+        { out[2], 104, 4 },
+    };
+    CHECK(bm_read_buffer_regions(buffer, reads, 3) == BM_OK, "Ошибка gather-чтения");
+    assert(strcmp(out[0], "ghi") == 0 && strcmp(out[1], "abc") == 0 && strcmp(out[2], "def") == 0);
+
+    // Фрагмент за пределами буфера отклоняется целиком
+    BMTransferRegion bad = { a, buf_size - 2, 4 };
+    assert(bm_write_buffer_regions(buffer, &bad, 1) == BM_ERROR_INVALID_ARG);
+
+    bm_free_buffer(buffer);
+}
+
+static void test_wrap_host(BMDevice* dev) {
+    static _Alignas(BM_HOST_WRAP_ALIGNMENT) char host[256];
+    strcpy(host, "zero-copy");
+
+    BMBuffer* buffer = NULL;
+    CHECK(bm_buffer_wrap_host(dev, host, sizeof(host), BM_WRAP_BORROW, &buffer) == BM_OK, "Ошибка обёртки host-памяти");
+
+    // Скачивание в ту же память — без копирования, данные на месте
+    CHECK(bm_download_data(buffer, host, sizeof(host)) == BM_SUCCESS, "Ошибка чтения обёрнутого буфера");
+    assert(strcmp(host, "zero-copy") == 0);
+
+    bm_free_buffer(buffer);
+    // Память осталась у вызывающего
+    assert(strcmp(host, "zero-copy") == 0);
+
+    // Невыровненный указатель отклоняется
+    BMBuffer* bad = NULL;
+    assert(bm_buffer_wrap_host(dev, host + 1, 16, BM_WRAP_BORROW, &bad) == BM_ERROR_INVALID_ARG);
+    printf("expected error: %s\n", bm_get_last_error());
+}
+
+static void test_map(BMDevice* dev) {
+    size_t buf_size = 128;
+    BMBuffer* buffer = NULL;
+    assert(bm_alloc_buffer(dev, buf_size, &buffer) == BM_OK);
+
+    char* ptr = NULL;
+    CHECK(bm_map_buffer(buffer, 16, 8, BM_MAP_WRITE | BM_MAP_DISCARD, (void**)&ptr) == BM_OK, "Ошибка map на запись");
+    memcpy(ptr, "mapped!", 8);
+    CHECK(bm_unmap_buffer(buffer, ptr) == BM_OK, "Ошибка unmap");
+
+    char out[8] = {0};
+    CHECK(bm_read_buffer(buffer, out, 8, 16) == BM_SUCCESS, "Ошибка чтения после unmap");
+    assert(strcmp(out, "mapped!") == 0);
+
+    // Диапазон за пределами буфера отклоняется
+    assert(bm_map_buffer(buffer, buf_size - 4, 8, BM_MAP_READ, (void**)&ptr) == BM_ERROR_INVALID_ARG);
+    printf("expected error: %s\n", bm_get_last_error());
+
+    bm_free_buffer(buffer);
+}
+
+static void test_clone(BMDevice* dev) {
+    size_t buf_size = 4 * 1024 * 1024;   // mmap-блок: клон делит с ним страницы
+    BMBuffer* tmpl = NULL;
+    assert(bm_alloc_buffer(dev, buf_size, &tmpl) == BM_OK);
+    char* data = (char*)bm_get_host_ptr(tmpl);
+    for (size_t i = 0; i < buf_size; i++) data[i] = (char)(i * 13);
+
+    BMBuffer* first = NULL;
+    CHECK(bm_buffer_clone(tmpl, BM_CLONE_COW, &first) == BM_OK, "Ошибка клонирования");
+    assert(memcmp(bm_get_host_ptr(first), data, buf_size) == 0);
+
+    // Запись в клон не видна шаблону, запись в шаблон — уже сделанному клону
+    CHECK(bm_write_buffer(first, "clone", 5, 4096) == BM_OK, "Ошибка записи в клон");
+    assert(memcmp(data + 4096, "clone", 5) != 0);
+    data[0] = 42;
+    assert(((char*)bm_get_host_ptr(first))[0] != 42);
+
+    // Следующий клон получает изменённые страницы шаблона
+    BMBuffer* second = NULL;
+    CHECK(bm_buffer_clone(tmpl, BM_CLONE_COW, &second) == BM_OK, "Ошибка повторного клонирования");
+    assert(memcmp(bm_get_host_ptr(second), data, buf_size) == 0);
+
+    BMBuffer* copy = NULL;
+    CHECK(bm_buffer_clone(first, BM_CLONE_COPY, &copy) == BM_OK, "Ошибка копирования");
+    assert(memcmp(bm_get_host_ptr(copy), bm_get_host_ptr(first), buf_size) == 0);
+
+    bm_free_buffer(copy);
+    bm_free_buffer(second);
+    bm_free_buffer(first);
+    bm_free_buffer(tmpl);
+}
+
+static void touch_kernel(void* data, size_t count) {
+    ((char*)data)[0] = (char)count;
+}
+
+static void test_map_file(BMDevice* dev) {
+    const char* path = "bm_buffer_map_test.bin";
+    FILE* f = fopen(path, "wb");
+    assert(f);
+    assert(fwrite("mapped file", 1, 11, f) == 11);
+    fclose(f);
+
+    BMBuffer* buffer = NULL;
+    CHECK(bm_buffer_map_file(dev, path, 7, 0, 0, &buffer) == BM_OK, "Ошибка отображения файла");
+    char out[5] = {0};
+    CHECK(bm_read_buffer(buffer, out, 4, 0) == BM_OK, "Ошибка чтения отображения");
+    assert(strcmp(out, "file") == 0);
+
+    // Read-only отображение не отдаётся ни на запись, ни ядру
+    assert(bm_write_buffer(buffer, "x", 1, 0) == BM_ERROR_INVALID_ARG);
+    BMKernel* kernel = bm_register_kernel(dev, "touch", touch_kernel);
+    assert(kernel);
+    assert(bm_launch_kernel(kernel, buffer, 1) == BM_ERROR_INVALID_ARG);
+    printf("expected error: %s\n", bm_get_last_error());
+    bm_unregister_kernel(kernel);
+    bm_free_buffer(buffer);
+
+    // Диапазон вне файла — ошибка аргументов, отказ open — внутренняя с текстом errno
+    assert(bm_buffer_map_file(dev, path, 100, 0, 0, &buffer) == BM_ERROR_INVALID_ARG);
+    remove(path);
+    assert(bm_buffer_map_file(dev, path, 0, 0, 0, &buffer) == BM_ERROR_INTERNAL);
+    printf("expected error: %s\n", bm_get_last_error());
+}
+
 static void test_errors(BMDevice* dev) {
-    BMBuffer* bad = bm_alloc_buffer(dev, 0);
-    assert(bad == NULL);
+    BMBuffer* bad = NULL;
+    assert(bm_alloc_buffer(dev, 0, &bad) == BM_ERROR_INVALID_ARG && bad == NULL);
     printf("expected error: %s\n", bm_get_last_error());
 
     bm_write_buffer(NULL, "x", 1, 0);
@@ -53,11 +192,16 @@ static void test_errors(BMDevice* dev) {
 int main() {
     printf("=== Burymetal Buffer Tests ===\n");
 
-    BMDevice* dev = bm_create_device();
-    assert(dev);
+    BMDevice* dev = NULL;
+    assert(bm_create_device(BM_CPU, &dev) == BM_OK);
 
     test_basic(dev);
     test_offsets(dev);
+    test_regions(dev);
+    test_wrap_host(dev);
+    test_map(dev);
+    test_clone(dev);
+    test_map_file(dev);
     test_errors(dev);
 
     bm_destroy_device(dev);
@@ -15,8 +15,7 @@ int main(int argc, char** argv) {
     BMKernel* kernel = NULL;
 
     // 1. Создание устройства
-    dev = bm_create_device(BM_AUTO);
-    CHECK(dev, "Ошибка создания устройства");
+    CHECK(bm_create_device(BM_AUTO, &dev) == BM_OK, "Ошибка создания устройства");
 
     BMDeviceInfo info;
     if (bm_query_device(dev, &info) == BM_SUCCESS) {
@@ -25,13 +24,12 @@ int main(int argc, char** argv) {
 
     // 2. Выделение буфера
     size_t buf_size = 16;
-    buf = bm_alloc_buffer(dev, buf_size);
-    CHECK(buf, "Ошибка выделения буфера");
+    CHECK(bm_alloc_buffer(dev, buf_size, &buf) == BM_OK, "Ошибка выделения буфера");
 
     // 3. Подготовка данных
     unsigned char data[16];
     for (int i = 0; i < 16; i++) data[i] = (unsigned char)i;
-    CHECK(bm_upload_data(buf, data) == BM_SUCCESS, "Ошибка загрузки данных");
+    CHECK(bm_upload_data(buf, data, sizeof(data)) == BM_SUCCESS, "Ошибка загрузки данных");
 
     printf("До ядра: ");
     for (int i = 0; i < 16; i++) printf("%u ", data[i]);
@@ -39,8 +37,7 @@ int main(int argc, char** argv) {
 
     // 4. Загрузка ядра
     const char* kernel_name = (argc > 1) ? argv[1] : "double_kernel";
-    kernel = bm_load_kernel(dev, kernel_name);
-    CHECK(kernel, "Ошибка загрузки ядра");
+    CHECK(bm_load_kernel(dev, kernel_name, &kernel) == BM_OK, "Ошибка загрузки ядра");
 
     // 5. Запуск ядра
     CHECK(bm_launch_kernel(kernel, buf, buf_size) == BM_SUCCESS, "Ошибка запуска ядра");
@@ -48,7 +45,7 @@ int main(int argc, char** argv) {
 
     // 6. Скачивание результата
     unsigned char out[16] = {0};
-    CHECK(bm_download_data(buf, out) == BM_SUCCESS, "Ошибка скачивания данных");
+    CHECK(bm_download_data(buf, out, sizeof(out)) == BM_SUCCESS, "Ошибка скачивания данных");
 
     printf("После ядра: ");
     for (int i = 0; i < 16; i++) printf("%u ", out[i]);
@@ -0,0 +1,171 @@
+// test_calibrate.c
+#define _XOPEN_SOURCE 700
+#include "burymetal.h"
+#include <assert.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static char root[64];
+
+static int remove_entry(const char* path, const struct stat* st, int flag, struct FTW* ftw) {
+    (void)st; (void)flag; (void)ftw;
+    return remove(path);
+}
+
+// Единственный файл кэша в каталоге
+static void find_cache_file(const char* dir, char* name, size_t cap) {
+    DIR* d = opendir(dir);
+    assert(d);
+    int found = 0;
+    struct dirent* entry;
+    while ((entry = readdir(d))) {
+        if (strncmp(entry->d_name, "roofline-", 9) != 0) continue;
+        snprintf(name, cap, "%s", entry->d_name);
+        ++found;
+    }
+    closedir(d);
+    assert(found == 1);
+}
+
+// node < 0 — обычное устройство, иначе BM_NUMA_BIND на узле
+static BMCalibration create_calibrated_on(int node) {
+    BMDevice* dev = NULL;
+    if (node < 0) assert(bm_create_device(BM_CPU, &dev) == BM_OK);
+    else assert(bm_create_device_numa(BM_NUMA_BIND, node, &dev) == BM_OK);
+    BMDeviceInfo info;
+    assert(bm_query_device(dev, &info) == BM_OK);
+    assert(info.calibration.threads == info.compute_units);
+
+    char text[8192];
+    bm_stats_prometheus(dev, text, sizeof(text));
+    assert(strstr(text, "burymetal_roofline_peak_flops{"));
+    bm_destroy_device(dev);
+    return info.calibration;
+}
+
+static BMCalibration create_calibrated(void) { return create_calibrated_on(-1); }
+
+static int file_contains(const char* path, const char* needle) {
+    static char content[1 << 20];
+    FILE* f = fopen(path, "rb");
+    assert(f);
+    size_t n = fread(content, 1, sizeof(content), f);
+    fclose(f);
+    // Запись двоичная: ищем побайтно
+    size_t len = strlen(needle);
+    for (size_t i = 0; i + len <= n; i++)
+        if (memcmp(content + i, needle, len) == 0) return 1;
+    return 0;
+}
+
+static void user_kernel(void* data, size_t count) {
+    (void)data;
+    (void)count;
+}
+
+// Служебные запуски замера не попадают в трассировку и запись пользователя,
+// а после замера поток снова трассируется и записывается
+static void test_hidden_from_recordings(void) {
+    char trace_path[128], record_path[128];
+    snprintf(trace_path, sizeof(trace_path), "%s/trace.json", root);
+    snprintf(record_path, sizeof(record_path), "%s/calls.bmrec", root);
+    BMDevice* dev = NULL;
+    assert(bm_create_device(BM_CPU, &dev) == BM_OK);
+    static double data[8] __attribute__((aligned(4096)));
+    BMBuffer* buf = NULL;
+    assert(bm_buffer_wrap_host(dev, data, sizeof(data), BM_WRAP_BORROW, &buf) == BM_OK);
+
+    assert(bm_trace_start(trace_path) == BM_OK);
+    assert(bm_record_start(record_path) == BM_OK);
+    assert(bm_device_calibrate(dev, BM_CALIBRATION_FORCE) == BM_OK);
+    BMKernel* kernel = bm_register_kernel(dev, "user_kernel", user_kernel);
+    assert(kernel && bm_launch_kernel(kernel, buf, 1) == BM_OK);
+    assert(bm_record_stop() == BM_OK);
+    assert(bm_trace_stop() == BM_OK);
+
+    assert(!file_contains(trace_path, "bm_calibrate_noop"));
+    assert(!file_contains(record_path, "bm_calibrate_noop"));
+    assert(file_contains(trace_path, "user_kernel"));
+    assert(file_contains(record_path, "user_kernel"));
+
+    bm_unregister_kernel(kernel);
+    bm_free_buffer(buf);
+    bm_destroy_device(dev);
+    printf("calibration hidden from trace and record ✅\n");
+}
+
+int main(void) {
+    printf("=== Burymetal Calibration Tests ===\n");
+    snprintf(root, sizeof(root), "/tmp/bm_test_calibrate_%d", (int)getpid());
+    char measured_dir[128], edited_dir[128], node_dir[128];
+    snprintf(measured_dir, sizeof(measured_dir), "%s/a/burymetal", root);
+    snprintf(edited_dir, sizeof(edited_dir), "%s/b", root);
+    snprintf(node_dir, sizeof(node_dir), "%s/c", root);
+
+    // По умолчанию выключено
+    BMDevice* dev = NULL;
+    assert(bm_create_device(BM_CPU, &dev) == BM_OK);
+    BMDeviceInfo info;
+    assert(bm_query_device(dev, &info) == BM_OK && info.calibration.measured_unix == 0);
+    assert(bm_device_calibrate(dev, BM_CALIBRATION_OFF) == BM_ERROR_INVALID_ARG);
+    bm_destroy_device(dev);
+
+    // Замер: каталог кэша создаётся со всеми родителями
+    assert(bm_set_calibration(BM_CALIBRATION_FORCE, measured_dir) == BM_OK);
+    BMCalibration measured = create_calibrated();
+    assert(!measured.from_cache && measured.measured_unix > 0);
+    assert(measured.triad_gbps > 0 && measured.memcpy_gbps > 0);
+    assert(measured.launch_ns > 0 && measured.peak_gflops > 0);
+    printf("measured: triad %.1f GB/s, memcpy %.1f GB/s, launch %.0f ns, %.1f GFLOP/s, %d threads ✅\n",
+           measured.triad_gbps, measured.memcpy_gbps, measured.launch_ns, measured.peak_gflops, measured.threads);
+
+    // Второе устройство берёт результат из кэша процесса
+    assert(bm_set_calibration(BM_CALIBRATION_CACHED, measured_dir) == BM_OK);
+    BMCalibration cached = create_calibrated();
+    assert(cached.from_cache && cached.triad_gbps == measured.triad_gbps);
+
+    // Другой каталог: файл читается с диска
+    char name[256], path[512];
+    find_cache_file(measured_dir, name, sizeof(name));
+    snprintf(path, sizeof(path), "%s/%s", measured_dir, name);
+    FILE* in = fopen(path, "r");
+    assert(in);
+    assert(mkdir(edited_dir, 0755) == 0);
+    snprintf(path, sizeof(path), "%s/%s", edited_dir, name);
+    FILE* out = fopen(path, "w");
+    assert(out);
+    char line[512];
+    while (fgets(line, sizeof(line), in))
+        fputs(strncmp(line, "triad_gbps=", 11) == 0 ? "triad_gbps=12345\n" : line, out);
+    fclose(in);
+    fclose(out);
+
+    assert(bm_set_calibration(BM_CALIBRATION_CACHED, edited_dir) == BM_OK);
+    BMCalibration loaded = create_calibrated();
+    assert(loaded.from_cache && loaded.triad_gbps == 12345.0);
+    assert(loaded.measured_unix == measured.measured_unix);
+    printf("disk cache: %s ✅\n", name);
+
+    // Устройство на узле: потоки по CPU узла, узел — в ключе кэша
+    assert(bm_set_calibration(BM_CALIBRATION_FORCE, node_dir) == BM_OK);
+    BMCalibration on_node = create_calibrated_on(0);
+    assert(!on_node.from_cache && on_node.triad_gbps > 0);
+    find_cache_file(node_dir, name, sizeof(name));
+    assert(strstr(name, "-node0.txt"));
+    assert(bm_set_calibration(BM_CALIBRATION_CACHED, node_dir) == BM_OK);
+    assert(create_calibrated_on(0).from_cache);
+    // Замер узла не выдаётся устройству без узла
+    assert(!create_calibrated().from_cache);
+    printf("numa node 0: %d threads, %s ✅\n", on_node.threads, name);
+
+    assert(bm_set_calibration(BM_CALIBRATION_OFF, NULL) == BM_OK);
+    test_hidden_from_recordings();
+    nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    printf("All tests passed ✅\n");
+    return 0;
+}
@@ -0,0 +1,149 @@
+// test_copy_queue.c
+#include "burymetal.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BUFFER_BYTES  (1u * 1024u * 1024u + 333u)   // не кратно staging
+#define STAGING_BYTES (64u * 1024u)
+
+static void test_round_trip(BMDevice* dev, BMCopyQueue* queue) {
+    unsigned char* src = (unsigned char*)malloc(BUFFER_BYTES);
+    unsigned char* back = (unsigned char*)malloc(BUFFER_BYTES);
+    assert(src && back);
+    for (size_t i = 0; i < BUFFER_BYTES; i++) src[i] = (unsigned char)(i * 13 + 1);
+
+    BMBuffer* buf = NULL;
+    assert(bm_alloc_buffer(dev, BUFFER_BYTES, &buf) == BM_OK);
+
+    // Две половины со смещением, потом всё целиком обратно
+    size_t half = BUFFER_BYTES / 2;
+    BMTransfer* up[2] = {NULL, NULL};
+    assert(bm_upload_async(queue, buf, src, half, 0, &up[0]) == BM_OK);
+    assert(bm_upload_async(queue, buf, src + half, BUFFER_BYTES - half, half, &up[1]) == BM_OK);
+    assert(bm_transfer_wait(queue, up[0]) == BM_OK);
+    assert(bm_transfer_wait(queue, up[1]) == BM_OK);
+
+    BMTransfer* down = NULL;
+    assert(bm_download_async(queue, buf, back, BUFFER_BYTES, 0, &down) == BM_OK);
+    assert(bm_transfer_wait(queue, down) == BM_OK);
+    assert(memcmp(src, back, BUFFER_BYTES) == 0);
+
+    // Передачи без билета: порядок сохраняется, flush дожидается всех
+    memset(back, 0, BUFFER_BYTES);
+    assert(bm_upload_async(queue, buf, src + 1, 4096, 0, NULL) == BM_OK);
+    assert(bm_download_async(queue, buf, back, 4096, 0, NULL) == BM_OK);
+    assert(bm_copy_queue_flush(queue) == BM_OK);
+    assert(memcmp(src + 1, back, 4096) == 0);
+
+    bm_free_buffer(buf);
+    free(src);
+    free(back);
+    printf("round trip: %u bytes ✅\n", BUFFER_BYTES);
+}
+
+static void test_wrapped(BMDevice* dev, BMCopyQueue* queue) {
+    // Обёрнутая память: upload из неё же — данные уже на месте
+    static unsigned char host[8192] __attribute__((aligned(4096)));
+    for (size_t i = 0; i < sizeof(host); i++) host[i] = (unsigned char)i;
+    BMBuffer* buf = NULL;
+    assert(bm_buffer_wrap_host(dev, host, sizeof(host), BM_WRAP_BORROW, &buf) == BM_OK);
+
+    BMTransfer* t = NULL;
+    assert(bm_upload_async(queue, buf, host, sizeof(host), 0, &t) == BM_OK);
+    assert(bm_transfer_wait(queue, t) == BM_OK);
+    unsigned char back[256];
+    assert(bm_download_async(queue, buf, back, sizeof(back), 1000, &t) == BM_OK);
+    assert(bm_transfer_wait(queue, t) == BM_OK);
+    assert(memcmp(back, host + 1000, sizeof(back)) == 0);
+    bm_free_buffer(buf);
+    printf("wrapped buffer ✅\n");
+}
+
+static void test_readonly(BMDevice* dev, BMCopyQueue* queue) {
+    const char* path = "bm_copy_queue_ro.bin";
+    FILE* f = fopen(path, "wb");
+    assert(f);
+    assert(fwrite("read-only data", 1, 14, f) == 14);
+    fclose(f);
+
+    // Upload в read-only отображение отклоняется сразу, download работает
+    BMBuffer* buf = NULL;
+    assert(bm_buffer_map_file(dev, path, 0, 0, 0, &buf) == BM_OK);
+    BMTransfer* t = NULL;
+    assert(bm_upload_async(queue, buf, "x", 1, 0, &t) == BM_ERROR_INVALID_ARG);
+    printf("expected error: %s\n", bm_get_last_error());
+    char back[15] = {0};
+    assert(bm_download_async(queue, buf, back, 14, 0, &t) == BM_OK);
+    assert(bm_transfer_wait(queue, t) == BM_OK);
+    assert(strcmp(back, "read-only data") == 0);
+    bm_free_buffer(buf);
+    remove(path);
+    printf("read-only buffer ✅\n");
+}
+
+static void test_staged(BMDevice* dev) {
+    // На host-видимых backend'ах staging обходится — включаем его принудительно,
+    // staging меньше передачи и не кратен ей
+    BMCopyQueue* staged = NULL;
+    assert(bm_copy_queue_create_ex(dev, 4096, BM_COPY_QUEUE_STAGED, &staged) == BM_OK);
+    BMCopyQueue* bad = NULL;
+    assert(bm_copy_queue_create_ex(dev, 4096, 0x80u, &bad) == BM_ERROR_INVALID_ARG);
+
+    const size_t size = 3u * 4096u + 77u;
+    unsigned char* src = (unsigned char*)malloc(size);
+    unsigned char* back = (unsigned char*)calloc(1, size);
+    assert(src && back);
+    for (size_t i = 0; i < size; i++) src[i] = (unsigned char)(i * 7 + 3);
+
+    BMBuffer* buf = NULL;
+    assert(bm_alloc_buffer(dev, size + 5, &buf) == BM_OK);
+    BMTransfer* t = NULL;
+    assert(bm_upload_async(staged, buf, src, size, 5, &t) == BM_OK);
+    assert(bm_transfer_wait(staged, t) == BM_OK);
+    assert(bm_download_async(staged, buf, back, size, 5, &t) == BM_OK);
+    assert(bm_transfer_wait(staged, t) == BM_OK);
+    assert(memcmp(src, back, size) == 0);
+
+    assert(bm_copy_queue_flush(staged) == BM_OK);
+    bm_free_buffer(buf);
+    assert(bm_copy_queue_destroy(staged) == BM_OK);
+    free(src);
+    free(back);
+    printf("forced staging: %zu bytes ✅\n", size);
+}
+
+static void test_invalid(BMDevice* dev, BMCopyQueue* queue) {
+    BMBuffer* buf = NULL;
+    assert(bm_alloc_buffer(dev, 1024, &buf) == BM_OK);
+    char data[16];
+    BMTransfer* t = NULL;
+    assert(bm_upload_async(queue, buf, data, 16, 1020, &t) == BM_ERROR_INVALID_ARG);
+    assert(bm_download_async(queue, buf, data, 0, 0, &t) == BM_ERROR_INVALID_ARG);
+    assert(bm_upload_async(queue, NULL, data, 16, 0, &t) == BM_ERROR_INVALID_ARG);
+    assert(bm_transfer_wait(queue, NULL) == BM_ERROR_INVALID_ARG);
+    BMCopyQueue* bad = NULL;
+    assert(bm_copy_queue_create(dev, 0, &bad) == BM_ERROR_INVALID_ARG);
+    bm_free_buffer(buf);
+    printf("invalid arguments ✅\n");
+}
+
+int main(void) {
+    printf("=== Burymetal Copy Queue Tests ===\n");
+    BMDevice* dev = NULL;
+    assert(bm_create_device(BM_CPU, &dev) == BM_OK);
+    BMCopyQueue* queue = NULL;
+    assert(bm_copy_queue_create(dev, STAGING_BYTES, &queue) == BM_OK);
+
+    test_round_trip(dev, queue);
+    test_wrapped(dev, queue);
+    test_readonly(dev, queue);
+    test_staged(dev);
+    test_invalid(dev, queue);
+
+    assert(bm_copy_queue_destroy(queue) == BM_OK);
+    bm_destroy_device(dev);
+    printf("All tests passed ✅\n");
+    return 0;
+}
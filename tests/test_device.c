@@ -8,8 +8,8 @@ int main(void) {
     printf("=== Тест устройства Burymetal API ===\n");
 
     // --- Создание первого устройства ---
-    BMDevice* device1 = bm_create_device(BM_AUTO);
-    assert(device1 && "Ошибка: bm_create_device вернул NULL");
+    BMDevice* device1 = NULL;
+    assert(bm_create_device(BM_AUTO, &device1) == BM_OK && "Ошибка: bm_create_device");
 
     BMDeviceInfo info1;
     if (bm_query_device(device1, &info1) == BM_SUCCESS) {
@@ -20,8 +20,8 @@ int main(void) {
     }
 
     // --- Создание второго устройства ---
-    BMDevice* device2 = bm_create_device(BM_AUTO);
-    assert(device2 && "Ошибка: повторный вызов bm_create_device вернул NULL");
+    BMDevice* device2 = NULL;
+    assert(bm_create_device(BM_AUTO, &device2) == BM_OK && "Ошибка: повторный вызов bm_create_device");
 
     BMDeviceInfo info2;
     if (bm_query_device(device2, &info2) == BM_SUCCESS) {
@@ -33,8 +33,8 @@ int main(void) {
 
     // --- Проверка буфера ---
     size_t buf_size = 256;
-    BMBuffer* buf = bm_alloc_buffer(device1, buf_size);
-    assert(buf && "Ошибка: bm_alloc_buffer вернул NULL");
+    BMBuffer* buf = NULL;
+    assert(bm_alloc_buffer(device1, buf_size, &buf) == BM_OK && "Ошибка: bm_alloc_buffer");
 
     const char* msg = "Hello Burymetal!";
     bm_write_buffer(buf, msg, strlen(msg)+1, 0);
@@ -45,6 +45,15 @@ int main(void) {
 
     printf("Буфер успешно записан и прочитан ✅\n");
 
+    // --- CPU-устройство: имя — модель процессора ---
+    BMDevice* cpu = NULL;
+    assert(bm_create_device(BM_CPU, &cpu) == BM_OK && "Ошибка: bm_create_device(BM_CPU)");
+    BMDeviceInfo cpu_info;
+    assert(bm_query_device(cpu, &cpu_info) == BM_OK && "Ошибка: bm_query_device(BM_CPU)");
+    assert(cpu_info.type == BM_CPU && cpu_info.name[0] != '\0' && "Ошибка: пустое имя CPU-устройства");
+    printf("CPU-устройство: %s, CU=%d ✅\n", cpu_info.name, cpu_info.compute_units);
+    bm_destroy_device(cpu);
+
     // --- Очистка ресурсов ---
     bm_free_buffer(buf);
     bm_destroy_device(device1);
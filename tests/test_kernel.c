@@ -28,8 +28,8 @@ void double_int(void* data, size_t count) {
 void test_kernel_type(BMComputeTarget target, const char* type_name, size_t elem_size, void(*kernel_func)(void*,size_t), size_t count) {
     printf("=== Тест %s, %zu элементов, backend=%d ===\n", type_name, count, target);
 
-    BMDevice* dev = bm_create_device(target);
-    if (!dev) {
+    BMDevice* dev = NULL;
+    if (bm_create_device(target, &dev) != BM_OK) {
         printf("Пропущен backend %d: %s\n", target, bm_get_last_error());
         return;
     }
@@ -37,8 +37,8 @@ void test_kernel_type(BMComputeTarget target, const char* type_name, size_t elem
     BMKernel* kernel = bm_register_kernel(dev, type_name, kernel_func);
     assert(kernel && "Ошибка регистрации ядра");
 
-    BMBuffer* buf = bm_alloc_buffer(dev, elem_size * count);
-    assert(buf && "Ошибка выделения буфера");
+    BMBuffer* buf = NULL;
+    assert(bm_alloc_buffer(dev, elem_size * count, &buf) == BM_OK && "Ошибка выделения буфера");
 
     void* input  = malloc(elem_size * count);
     void* expect = malloc(elem_size * count);
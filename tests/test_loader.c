@@ -0,0 +1,95 @@
+// test_loader.c
+#include "burymetal.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FILE_BYTES  (3u * 1024u * 1024u + 777u)   // не кратно блоку и выравниванию
+#define LOADER_PATH "bm_loader_test.bin"
+
+static unsigned char* write_source(void) {
+    unsigned char* src = (unsigned char*)malloc(FILE_BYTES);
+    assert(src);
+    for (size_t i = 0; i < FILE_BYTES; i++) src[i] = (unsigned char)(i * 7 + 3);
+
+    FILE* f = fopen(LOADER_PATH, "wb");
+    assert(f && "не удалось создать файл");
+    assert(fwrite(src, 1, FILE_BYTES, f) == FILE_BYTES);
+    fclose(f);
+    return src;
+}
+
+static void test_load(BMDevice* dev, const unsigned char* src, int direct_io) {
+    BMLoaderConfig config = {8, 64 * 1024, direct_io};
+    BMLoader* loader = NULL;
+    assert(bm_loader_create(dev, &config, &loader) == BM_OK);
+
+    BMBuffer* buf = NULL;
+    assert(bm_alloc_buffer(dev, FILE_BYTES, &buf) == BM_OK);
+
+    // Невыровненные смещения в файле и в буфере, два запроса в одном событии
+    BMLoadRequest requests[2] = {
+        {buf, 100, LOADER_PATH, 1, FILE_BYTES - 4097},
+        {buf, 0, LOADER_PATH, 5, 100},
+    };
+    BMLoadEvent* event = NULL;
+    assert(bm_loader_submit(loader, requests, 2, &event) == BM_OK);
+    assert(bm_load_event_wait(loader, event) == BM_OK && "ошибка загрузки");
+
+    unsigned char* check = (unsigned char*)malloc(FILE_BYTES);
+    assert(check);
+    assert(bm_read_buffer(buf, check, FILE_BYTES, 0) == BM_OK);
+    assert(memcmp(check + 100, src + 1, FILE_BYTES - 4097) == 0);
+    assert(memcmp(check, src + 5, 100) == 0);
+
+    // Диапазон за концом файла — ошибка события
+    BMLoadRequest tail = {buf, 0, LOADER_PATH, FILE_BYTES - 10, 100};
+    assert(bm_loader_submit(loader, &tail, 1, &event) == BM_OK);
+    assert(bm_load_event_wait(loader, event) != BM_OK);
+    printf("loader (direct_io=%d) ✅, expected error: %s\n", direct_io, bm_get_last_error());
+
+    free(check);
+    bm_free_buffer(buf);
+    bm_loader_destroy(loader);
+}
+
+static void test_unwaited(BMDevice* dev, const unsigned char* src) {
+    BMLoader* loader = NULL;
+    assert(bm_loader_create(dev, NULL, &loader) == BM_OK);
+    BMBuffer* buf = NULL;
+    assert(bm_alloc_buffer(dev, FILE_BYTES, &buf) == BM_OK);
+
+    // События без bm_load_event_wait: destroy дожидается загрузок и освобождает их
+    BMLoadRequest request = {buf, 0, LOADER_PATH, 0, FILE_BYTES};
+    BMLoadEvent* events[3];
+    for (int i = 0; i < 3; i++) assert(bm_loader_submit(loader, &request, 1, &events[i]) == BM_OK);
+    assert(bm_load_event_wait(loader, events[1]) == BM_OK);
+    assert(bm_loader_destroy(loader) == BM_OK);
+
+    unsigned char* check = (unsigned char*)malloc(FILE_BYTES);
+    assert(check);
+    assert(bm_read_buffer(buf, check, FILE_BYTES, 0) == BM_OK);
+    assert(memcmp(check, src, FILE_BYTES) == 0);
+    free(check);
+    bm_free_buffer(buf);
+    printf("unwaited events freed by destroy ✅\n");
+}
+
+int main(void) {
+    printf("=== Burymetal Loader Tests ===\n");
+
+    BMDevice* dev = NULL;
+    assert(bm_create_device(BM_CPU, &dev) == BM_OK);
+
+    unsigned char* src = write_source();
+    test_load(dev, src, 0);
+    test_load(dev, src, 1);
+    test_unwaited(dev, src);
+
+    remove(LOADER_PATH);
+    free(src);
+    bm_destroy_device(dev);
+    printf("All tests passed ✅\n");
+    return 0;
+}
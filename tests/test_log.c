@@ -0,0 +1,180 @@
+// test_log.c
+#define _POSIX_C_SOURCE 200809L
+#include "burymetal.h"
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOG_PATH "bm_log_test.txt"
+#define BURST    20000
+
+static char* read_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    assert(f);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* text = (char*)malloc((size_t)size + 1);
+    assert(text && fread(text, 1, (size_t)size, f) == (size_t)size);
+    text[size] = '\0';
+    fclose(f);
+    return text;
+}
+
+// Номера сообщений "<tag> N" в порядке появления в файле
+static size_t collect(const char* text, const char* tag, int* out, size_t cap) {
+    size_t n = 0, len = strlen(tag);
+    for (const char* p = strstr(text, tag); p; p = strstr(p + len, tag)) {
+        assert(n < cap);
+        out[n++] = atoi(p + len);
+    }
+    return n;
+}
+
+// Строки на stderr во время пачек не нужны: вывод фонового потока — в /dev/null
+static int saved_stderr = -1;
+
+static void mute_stderr(void) {
+    fflush(stderr);
+    saved_stderr = dup(2);
+    int null_fd = open("/dev/null", O_WRONLY);
+    assert(saved_stderr >= 0 && null_fd >= 0);
+    dup2(null_fd, 2);
+    close(null_fd);
+}
+
+static void unmute_stderr(void) {
+    fflush(stderr);
+    dup2(saved_stderr, 2);
+    close(saved_stderr);
+}
+
+typedef struct {
+    const char* tag;
+    int count;
+} Burst;
+
+static void* log_burst(void* arg) {
+    const Burst* b = (const Burst*)arg;
+    for (int i = 0; i < b->count; i++) bm_log_info("%s %d", b->tag, i);
+    return NULL;
+}
+
+static void run_thread(const char* tag, int count) {
+    Burst b = {tag, count};
+    pthread_t t;
+    assert(pthread_create(&t, NULL, log_burst, &b) == 0);
+    pthread_join(t, NULL);
+}
+
+static void test_order_and_block(void) {
+    // Маленькое кольцо: без BLOCK большая часть пачки была бы отброшена
+    bm_log_set_ring_slots(8);
+    bm_log_set_overflow(BM_LOG_OVERFLOW_BLOCK);
+    BMLogStats before, after;
+    bm_log_get_stats(&before);
+    run_thread("block", BURST);
+    bm_log_flush();
+    bm_log_get_stats(&after);
+    assert(after.dropped == before.dropped);
+
+    char* text = read_file(LOG_PATH);
+    int* seen = (int*)malloc(BURST * sizeof(int));
+    assert(seen);
+    assert(collect(text, "block ", seen, BURST) == BURST);
+    for (int i = 0; i < BURST; i++) assert(seen[i] == i);
+    free(seen);
+    free(text);
+}
+
+static void test_drop_count(void) {
+    bm_log_set_ring_slots(8);
+    bm_log_set_overflow(BM_LOG_OVERFLOW_DROP);
+    BMLogStats before, after;
+    bm_log_get_stats(&before);
+    run_thread("drop", BURST);
+    bm_log_flush();
+    bm_log_get_stats(&after);
+
+    // Каждое сообщение либо записано (по порядку), либо учтено в dropped
+    char* text = read_file(LOG_PATH);
+    int* seen = (int*)malloc(BURST * sizeof(int));
+    assert(seen);
+    size_t written = collect(text, "drop ", seen, BURST);
+    for (size_t i = 1; i < written; i++) assert(seen[i] > seen[i - 1]);
+    assert(written + (after.dropped - before.dropped) == BURST);
+    assert(after.dropped > before.dropped);
+    assert(strstr(text, "отброшено"));
+    free(seen);
+    free(text);
+    printf("drop: записано %zu, отброшено %llu\n", written,
+           (unsigned long long)(after.dropped - before.dropped));
+}
+
+static void* log_quiet(void* arg) {
+    (void)arg;
+    assert(bm_log_set_thread_level(BM_LOG_LEVEL_WARN) == -1);
+    bm_log_info("quiet %d", 0);
+    bm_log_warn("quiet %d", 1);
+    assert(bm_log_set_thread_level(-1) == BM_LOG_LEVEL_WARN);
+    bm_log_info("quiet %d", 2);
+    return NULL;
+}
+
+static void test_thread_level(void) {
+    bm_log_set_overflow(BM_LOG_OVERFLOW_BLOCK);
+    // Потолок одного потока не задевает остальные
+    pthread_t t;
+    assert(pthread_create(&t, NULL, log_quiet, NULL) == 0);
+    bm_log_info("loud %d", 0);
+    pthread_join(t, NULL);
+    bm_log_flush();
+
+    char* text = read_file(LOG_PATH);
+    int seen[3];
+    assert(collect(text, "quiet ", seen, 3) == 2 && seen[0] == 1 && seen[1] == 2);
+    assert(collect(text, "loud ", seen, 3) == 1);
+    free(text);
+}
+
+static void test_thread_exit(void) {
+    bm_log_set_ring_slots(0);
+    // Поток выходит сразу после записи; без bm_log_flush строки должны
+    // появиться сами — фоновый поток просыпается на непустое кольцо
+    run_thread("exited", 3);
+    int seen[3];
+    size_t found = 0;
+    for (int attempt = 0; attempt < 200 && found < 3; attempt++) {
+        struct timespec pause = {0, 5000000L};
+        nanosleep(&pause, NULL);
+        char* text = read_file(LOG_PATH);
+        found = collect(text, "exited ", seen, 3);
+        free(text);
+    }
+    assert(found == 3 && seen[0] == 0 && seen[2] == 2);
+}
+
+int main(void) {
+    printf("=== Burymetal Log Tests ===\n");
+    remove(LOG_PATH);
+    bm_log_set_level(BM_LOG_INFO);
+    bm_log_set_file(LOG_PATH);
+
+    mute_stderr();
+    test_order_and_block();
+    test_drop_count();
+    test_thread_level();
+    test_thread_exit();
+    unmute_stderr();
+
+    bm_log_set_file(NULL);
+    bm_log_set_overflow(BM_LOG_OVERFLOW_DROP);
+    remove(LOG_PATH);
+    printf("All tests passed ✅\n");
+    return 0;
+}
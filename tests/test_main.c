@@ -43,8 +43,8 @@ int main(void) {
     bm_log_info("=== Burymetal RAII Test ===");
 
     // --- Создание устройства (автовыбор) ---
-    BMDeviceGuard dev_guard = { .device = bm_create_device(BM_AUTO) };
-    if (!dev_guard.device) {
+    BMDeviceGuard dev_guard = { .device = NULL };
+    if (bm_create_device(BM_AUTO, &dev_guard.device) != BM_OK) {
         bm_log_error("Ошибка создания устройства: %s", bm_get_last_error());
         return 1;
     }
@@ -61,15 +61,15 @@ int main(void) {
     // --- Создание буфера ---
     float input[N]  = {1,2,3,4,5,6,7,8};
     float output[N] = {0};
-    BMBufferGuard buf_guard = { .buffer = bm_alloc_buffer(dev_guard.device, sizeof(input)) };
-    if (!buf_guard.buffer) {
+    BMBufferGuard buf_guard = { .buffer = NULL };
+    if (bm_alloc_buffer(dev_guard.device, sizeof(input), &buf_guard.buffer) != BM_OK) {
         bm_log_error("Ошибка выделения буфера: %s", bm_get_last_error());
         free_device(&dev_guard);
         return 1;
     }
 
     // --- Загрузка данных в буфер ---
-    if (bm_upload_data(buf_guard.buffer, input) != BM_SUCCESS) {
+    if (bm_upload_data(buf_guard.buffer, input, sizeof(input)) != BM_SUCCESS) {
         bm_log_error("Ошибка загрузки данных: %s", bm_get_last_error());
         free_buffer(&buf_guard);
         free_device(&dev_guard);
@@ -95,7 +95,7 @@ int main(void) {
     }
 
     // --- Скачивание результата ---
-    if (bm_download_data(buf_guard.buffer, output) != BM_SUCCESS) {
+    if (bm_download_data(buf_guard.buffer, output, sizeof(output)) != BM_SUCCESS) {
         bm_log_error("Ошибка скачивания данных: %s", bm_get_last_error());
         free_kernel(&kernel_guard);
         free_buffer(&buf_guard);
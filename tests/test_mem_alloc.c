@@ -0,0 +1,156 @@
+// test_mem_alloc.c
+#include "bm_mem_alloc.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+static int is_zero(const unsigned char* p, size_t size) {
+    for (size_t i = 0; i < size; ++i)
+        if (p[i]) return 0;
+    return 1;
+}
+
+static void test_zero(size_t size) {
+    unsigned char* ptr = NULL;
+    assert(bm_cpu_alloc_ex(size, BM_ALLOC_ZERO, (void**)&ptr) == BM_SUCCESS);
+    assert(is_zero(ptr, size) && "память не обнулена");
+    memset(ptr, 0x5A, size);
+    assert(bm_cpu_free(ptr) == BM_SUCCESS);
+}
+
+static void test_uninit(size_t size) {
+    unsigned char* ptr = NULL;
+    assert(bm_cpu_alloc_ex(size, BM_ALLOC_UNINIT, (void**)&ptr) == BM_SUCCESS);
+    // Большой блок — целые страницы mmap, их bm_numa_place может привязать к узлу
+    BMMemInfo info;
+    assert(bm_mem_query(ptr, &info) == BM_SUCCESS);
+    assert((info.kind == BM_MEM_HEAP) == (size < BM_ALLOC_MMAP_THRESHOLD));
+    memset(ptr, 0xA5, size);
+    assert(ptr[size - 1] == 0xA5);
+    assert(bm_cpu_free(ptr) == BM_SUCCESS);
+}
+
+static void test_huge(void) {
+    size_t size = BM_ALLOC_HUGE_THRESHOLD * 2 + 123;
+    unsigned char* ptr = NULL;
+    assert(bm_cpu_alloc_ex(size, BM_ALLOC_UNINIT, (void**)&ptr) == BM_SUCCESS);
+
+    BMMemInfo info;
+    assert(bm_mem_query(ptr, &info) == BM_SUCCESS);
+    assert(info.kind != BM_MEM_HEAP && info.length >= size);
+    if (info.kind == BM_MEM_HUGE_THP || info.kind == BM_MEM_HUGE_TLB)
+        assert(((uintptr_t)ptr % info.page_size) == 0 && "блок не выровнен по huge-странице");
+    printf("huge alloc: kind=%d page_size=%zu\n", (int)info.kind, info.page_size);
+
+    ptr[0] = 1;
+    ptr[size - 1] = 1;
+    assert(bm_cpu_free(ptr) == BM_SUCCESS);
+
+    // С выключенными huge-страницами большой UNINIT-блок — обычные страницы mmap
+    assert(bm_mem_set_huge_pages(BM_HUGE_PAGES_OFF, 0) == BM_SUCCESS);
+    assert(bm_cpu_alloc_ex(size, BM_ALLOC_UNINIT, (void**)&ptr) == BM_SUCCESS);
+    assert(bm_mem_query(ptr, &info) == BM_SUCCESS && info.kind == BM_MEM_MAPPED);
+    assert(bm_cpu_free(ptr) == BM_SUCCESS);
+    assert(bm_mem_set_huge_pages(BM_HUGE_PAGES_THP, 0) == BM_SUCCESS);
+}
+
+static void test_map_file(void) {
+    const char* path = "test_mem_alloc.bin";
+    FILE* f = fopen(path, "wb");
+    assert(f);
+    for (int i = 0; i < 10000; ++i) fputc(i & 0xFF, f);
+    fclose(f);
+
+    // Смещение не кратно странице, длина 0 — до конца файла
+    unsigned char* ptr = NULL;
+    size_t length = 0;
+    assert(bm_mem_map_file(path, 1000, 0, BM_FILE_POPULATE, (void**)&ptr, &length) == BM_SUCCESS);
+    assert(length == 9000 && ptr[0] == (1000 & 0xFF) && ptr[8999] == (9999 & 0xFF));
+
+    BMMemInfo info;
+    assert(bm_mem_query(ptr, &info) == BM_SUCCESS && info.kind == BM_MEM_FILE);
+    assert(bm_cpu_free(ptr) == BM_SUCCESS);
+
+    // Copy-on-write: запись не попадает в файл
+    assert(bm_mem_map_file(path, 0, 16, BM_FILE_COPY_ON_WRITE, (void**)&ptr, &length) == BM_SUCCESS);
+    ptr[0] = 0xEE;
+    assert(bm_cpu_free(ptr) == BM_SUCCESS);
+    f = fopen(path, "rb");
+    assert(f && fgetc(f) == 0);
+    fclose(f);
+
+    assert(bm_mem_map_file(path, 20000, 0, 0, (void**)&ptr, &length) == BM_ERROR_INVALID_ARG);
+    printf("expected error: %s\n", bm_get_last_error());
+    assert(bm_mem_map_file("/nonexistent/bm_map", 0, 0, 0, (void**)&ptr, &length) == BM_ERROR);
+    printf("expected error: %s\n", bm_get_last_error());
+    remove(path);
+}
+
+typedef struct {
+    void* src;
+    size_t size;
+    void* clone;
+} CloneJob;
+
+static void* clone_job(void* arg) {
+    CloneJob* job = (CloneJob*)arg;
+    assert(bm_mem_clone(job->src, job->size, &job->clone) == BM_SUCCESS);
+    return NULL;
+}
+
+static void test_clone(void) {
+    size_t size = BM_ALLOC_MMAP_THRESHOLD * 8 + 4321;
+    unsigned char* src = NULL;
+    assert(bm_cpu_alloc_ex(size, BM_ALLOC_ZERO, (void**)&src) == BM_SUCCESS);
+    for (size_t i = 0; i < size; ++i) src[i] = (unsigned char)(i * 31 + 7);
+
+    // Два первых клона одновременно: блок замораживается ровно один раз
+    CloneJob jobs[2] = {{src, size, NULL}, {src, size, NULL}};
+    pthread_t threads[2];
+    for (int i = 0; i < 2; ++i) assert(pthread_create(&threads[i], NULL, clone_job, &jobs[i]) == 0);
+    for (int i = 0; i < 2; ++i) pthread_join(threads[i], NULL);
+    for (int i = 0; i < 2; ++i) assert(memcmp(jobs[i].clone, src, size) == 0);
+
+    // Запись в исходный блок после заморозки попадает в следующий клон,
+    // запись в клон не трогает источник
+    src[size / 2] ^= 0xFF;
+    unsigned char* later = NULL;
+    assert(bm_mem_clone(src, size, (void**)&later) == BM_SUCCESS);
+    assert(memcmp(later, src, size) == 0);
+    ((unsigned char*)jobs[0].clone)[0] ^= 0xFF;
+    assert(src[0] == 7 && later[0] == 7);
+
+    BMMemInfo info;
+    assert(bm_mem_query(src, &info) == BM_SUCCESS);
+    printf("clone: kind=%d\n", (int)info.kind);
+
+    for (int i = 0; i < 2; ++i) assert(bm_cpu_free(jobs[i].clone) == BM_SUCCESS);
+    assert(bm_cpu_free(later) == BM_SUCCESS);
+    assert(bm_cpu_free(src) == BM_SUCCESS);
+}
+
+static void test_errors(void) {
+    void* ptr = NULL;
+    assert(bm_cpu_alloc_ex(0, BM_ALLOC_ZERO, &ptr) == BM_ERROR);
+    assert(bm_cpu_alloc_ex(64, BM_ALLOC_ZERO | BM_ALLOC_UNINIT, &ptr) == BM_ERROR);
+    printf("expected error: %s\n", bm_get_last_error());
+}
+
+int main(void) {
+    printf("=== Burymetal Memory Alloc Tests ===\n");
+
+    // Малые блоки (calloc/malloc) и большие (mmap)
+    test_zero(100);
+    test_zero(BM_ALLOC_MMAP_THRESHOLD * 4);
+    test_uninit(100);
+    test_uninit(BM_ALLOC_MMAP_THRESHOLD * 4);
+    test_huge();
+    test_map_file();
+    test_clone();
+    test_errors();
+
+    printf("All tests passed ✅\n");
+    return 0;
+}
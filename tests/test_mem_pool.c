@@ -0,0 +1,196 @@
+// test_mem_pool.c
+#define _POSIX_C_SOURCE 200809L
+#include "bm_mem_pool.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+static void test_fixed(BMDevice* dev) {
+    BMBufferPool* pool = bm_pool_create(dev, 64, 2);
+    assert(pool && "bm_pool_create failed");
+
+    BMBuffer* a = NULL;
+    BMBuffer* b = NULL;
+    BMBuffer* c = NULL;
+    assert(bm_pool_acquire(pool, &a) == BM_SUCCESS);
+    assert(bm_pool_acquire(pool, &b) == BM_SUCCESS);
+    assert(a != b);
+
+    // Пул фиксированный: третий буфер не выдаётся, ожидание истекает
+    assert(bm_pool_acquire(pool, &c) == BM_ERROR);
+    assert(strcmp(bm_get_last_error(), "bm_pool_acquire: no free buffers") == 0);
+    assert(bm_pool_acquire_timeout(pool, &c, 20) == BM_ERROR);
+    printf("expected error: %s\n", bm_get_last_error());
+
+    assert(bm_pool_release(pool, a) == BM_SUCCESS);
+    assert(bm_pool_acquire(pool, &c) == BM_SUCCESS && c == a);
+
+    // Повторный возврат — ошибка аргументов, пул не портится
+    assert(bm_pool_release(pool, b) == BM_SUCCESS);
+    assert(bm_pool_release(pool, b) == BM_ERROR_INVALID_ARG);
+    printf("expected error: %s\n", bm_get_last_error());
+    bm_pool_release(pool, c);
+    assert(bm_pool_acquire(pool, &a) == BM_SUCCESS && bm_pool_acquire(pool, &b) == BM_SUCCESS && a != b);
+    bm_pool_release(pool, a);
+    bm_pool_release(pool, b);
+    bm_pool_destroy(pool);
+}
+
+static void test_grow_and_trim(BMDevice* dev) {
+    BMPoolConfig config;
+    memset(&config, 0, sizeof(config));
+    config.buffer_size = 128;
+    config.initial_count = 1;
+    config.grow_chunk = 2;
+    config.max_count = 4;
+    config.idle_shrink_ms = 10;
+
+    BMBufferPool* pool = bm_pool_create_ex(dev, &config);
+    assert(pool);
+
+    BMBuffer* bufs[5] = {0};
+    for (int i = 0; i < 4; ++i)
+        assert(bm_pool_acquire(pool, &bufs[i]) == BM_SUCCESS);
+    // Достигнут max_count
+    assert(bm_pool_acquire(pool, &bufs[4]) == BM_ERROR);
+
+    for (int i = 0; i < 4; ++i)
+        assert(bm_pool_release(pool, bufs[i]) == BM_SUCCESS);
+
+    sleep_ms(30);
+    // После простоя остаётся только initial_count буферов
+    assert(bm_pool_trim(pool) == 3);
+    assert(bm_pool_trim(pool) == 0);
+
+    bm_pool_destroy(pool);
+}
+
+static void test_unbounded_and_acquire_shrink(BMDevice* dev) {
+    BMPoolConfig config;
+    memset(&config, 0, sizeof(config));
+    config.buffer_size = 64;
+    config.grow_chunk = 2;          // initial_count и max_count 0 — растёт без ограничения
+    config.idle_shrink_ms = 10;
+
+    BMBufferPool* pool = bm_pool_create_ex(dev, &config);
+    assert(pool);
+
+    BMBuffer* bufs[6] = {0};
+    for (int i = 0; i < 6; ++i)
+        assert(bm_pool_acquire(pool, &bufs[i]) == BM_SUCCESS);
+    for (int i = 0; i < 6; ++i)
+        assert(bm_pool_release(pool, bufs[i]) == BM_SUCCESS);
+
+    sleep_ms(30);
+    // Сжатие при acquire: простаивающие буферы уже освобождены
+    BMBuffer* held = NULL;
+    assert(bm_pool_acquire(pool, &held) == BM_SUCCESS);
+    assert(bm_pool_trim(pool) == 0);
+
+    bm_pool_release(pool, held);
+    bm_pool_destroy(pool);
+}
+
+typedef struct {
+    BMBufferPool* pool;
+    BMBuffer* buffer;
+} ReleaseArgs;
+
+static void* release_later(void* arg) {
+    ReleaseArgs* args = (ReleaseArgs*)arg;
+    sleep_ms(20);
+    bm_pool_release(args->pool, args->buffer);
+    return NULL;
+}
+
+static void test_blocking_acquire(BMDevice* dev) {
+    BMBufferPool* pool = bm_pool_create(dev, 32, 1);
+    assert(pool);
+
+    BMBuffer* held = NULL;
+    assert(bm_pool_acquire(pool, &held) == BM_SUCCESS);
+
+    ReleaseArgs args = { pool, held };
+    pthread_t thread;
+    pthread_create(&thread, NULL, release_later, &args);
+
+    // Блокируемся до освобождения буфера другим потоком
+    BMBuffer* got = NULL;
+    assert(bm_pool_acquire_timeout(pool, &got, BM_POOL_WAIT_FOREVER) == BM_SUCCESS);
+    assert(got == held);
+
+    pthread_join(thread, NULL);
+    bm_pool_release(pool, got);
+    bm_pool_destroy(pool);
+}
+
+#define GROW_THREADS 8
+#define GROW_PER_THREAD 8
+
+typedef struct {
+    BMBufferPool* pool;
+    BMBuffer* got[GROW_PER_THREAD];
+} GrowArgs;
+
+static void* acquire_many(void* arg) {
+    GrowArgs* args = (GrowArgs*)arg;
+    for (int i = 0; i < GROW_PER_THREAD; i++)
+        assert(bm_pool_acquire_timeout(args->pool, &args->got[i], BM_POOL_WAIT_FOREVER) == BM_SUCCESS);
+    return NULL;
+}
+
+// Рост из нескольких потоков сразу: память выделяется без lock, пул ровно
+// заполняется до max_count и ни один буфер не выдаётся дважды
+static void test_concurrent_grow(BMDevice* dev) {
+    BMPoolConfig config;
+    memset(&config, 0, sizeof(config));
+    config.buffer_size = 4096;
+    config.grow_chunk = 3;
+    config.max_count = GROW_THREADS * GROW_PER_THREAD;
+    BMBufferPool* pool = bm_pool_create_ex(dev, &config);
+    assert(pool);
+
+    GrowArgs args[GROW_THREADS];
+    pthread_t threads[GROW_THREADS];
+    for (int t = 0; t < GROW_THREADS; t++) {
+        args[t].pool = pool;
+        assert(pthread_create(&threads[t], NULL, acquire_many, &args[t]) == 0);
+    }
+    for (int t = 0; t < GROW_THREADS; t++) pthread_join(threads[t], NULL);
+
+    BMBuffer* extra = NULL;
+    assert(bm_pool_acquire(pool, &extra) == BM_ERROR);
+    for (int t = 0; t < GROW_THREADS * GROW_PER_THREAD; t++)
+        for (int u = t + 1; u < GROW_THREADS * GROW_PER_THREAD; u++)
+            assert(args[t / GROW_PER_THREAD].got[t % GROW_PER_THREAD] !=
+                   args[u / GROW_PER_THREAD].got[u % GROW_PER_THREAD]);
+    for (int t = 0; t < GROW_THREADS; t++)
+        for (int i = 0; i < GROW_PER_THREAD; i++)
+            assert(bm_pool_release(pool, args[t].got[i]) == BM_SUCCESS);
+    bm_pool_destroy(pool);
+    printf("concurrent grow: %d buffers ✅\n", GROW_THREADS * GROW_PER_THREAD);
+}
+
+int main(void) {
+    printf("=== Burymetal Buffer Pool Tests ===\n");
+
+    BMDevice dev;
+    memset(&dev, 0, sizeof(dev));
+    dev.type = BM_CPU;
+
+    test_fixed(&dev);
+    test_grow_and_trim(&dev);
+    test_unbounded_and_acquire_shrink(&dev);
+    test_blocking_acquire(&dev);
+    test_concurrent_grow(&dev);
+
+    printf("All tests passed ✅\n");
+    return 0;
+}
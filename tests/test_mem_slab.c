@@ -0,0 +1,74 @@
+// test_mem_slab.c
+#include "bm_mem_slab.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THREADS 8
+#define PER_THREAD 500
+
+static BMBuffer* handles[THREADS][PER_THREAD];
+
+static void* alloc_many(void* arg) {
+    BMBuffer** out = (BMBuffer**)arg;
+    for (int i = 0; i < PER_THREAD; i++) {
+        out[i] = bm_handle_alloc_buffer();
+        assert(out[i] && out[i]->size == 0 && out[i]->flags == 0);
+        out[i]->size = (size_t)i + 1; // занят: следующий вызов не должен его выдать
+    }
+    // Половину возвращает сам поток, остальное — главный после его выхода
+    for (int i = 0; i < PER_THREAD / 2; i++) {
+        bm_handle_free_buffer(out[i]);
+        out[i] = NULL;
+    }
+    return NULL;
+}
+
+static int compare_ptr(const void* a, const void* b) {
+    const char* x = *(const char* const*)a;
+    const char* y = *(const char* const*)b;
+    return (x > y) - (x < y);
+}
+
+static void test_threads(void) {
+    pthread_t threads[THREADS];
+    for (int t = 0; t < THREADS; t++) assert(pthread_create(&threads[t], NULL, alloc_many, handles[t]) == 0);
+    for (int t = 0; t < THREADS; t++) pthread_join(threads[t], NULL);
+
+    // Живые дескрипторы всех потоков различны
+    static BMBuffer* live[THREADS * PER_THREAD];
+    size_t n = 0;
+    for (int t = 0; t < THREADS; t++)
+        for (int i = PER_THREAD / 2; i < PER_THREAD; i++) live[n++] = handles[t][i];
+    qsort(live, n, sizeof(live[0]), compare_ptr);
+    for (size_t i = 1; i < n; i++) assert(live[i] != live[i - 1]);
+
+    // Освобождение чужих дескрипторов и повторное выделение
+    for (size_t i = 0; i < n; i++) bm_handle_free_buffer(live[i]);
+    for (size_t i = 0; i < n; i++) {
+        live[i] = bm_handle_alloc_buffer();
+        assert(live[i] && live[i]->size == 0);
+    }
+    for (size_t i = 0; i < n; i++) bm_handle_free_buffer(live[i]);
+    printf("handles from %d threads: %zu live, unique ✅\n", THREADS, n);
+}
+
+static void test_kernel_and_device(void) {
+    BMKernel* kernel = bm_handle_alloc_kernel();
+    assert(kernel && kernel->cold && kernel->cold->name[0] == '\0');
+    BMDevice* device = bm_handle_alloc_device();
+    assert(device && device->type == BM_AUTO);
+    bm_handle_free_kernel(kernel);
+    bm_handle_free_device(device);
+    printf("kernel and device handles ✅\n");
+}
+
+int main(void) {
+    printf("=== Burymetal Slab Tests ===\n");
+    test_threads();
+    test_kernel_and_device();
+    printf("All tests passed ✅\n");
+    return 0;
+}
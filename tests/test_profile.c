@@ -0,0 +1,97 @@
+// test_profile.c
+#define _POSIX_C_SOURCE 200809L
+#include "burymetal.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ELEMENTS 4096
+
+static void sum_kernel(void* data, size_t count) {
+    volatile unsigned* values = (volatile unsigned*)data;
+    unsigned acc = 0;
+    for (size_t i = 0; i < count; i++) acc += values[i] * 3u;
+    values[0] = acc;
+}
+
+typedef struct {
+    BMKernel* kernel;
+    BMBuffer* buffer;
+    int launches;
+} Worker;
+
+static void* launch_many(void* arg) {
+    Worker* w = (Worker*)arg;
+    for (int i = 0; i < w->launches; i++)
+        assert(bm_launch_kernel(w->kernel, w->buffer, ELEMENTS) == BM_OK);
+    return NULL;
+}
+
+static const BMKernelProfile* find_launches(const BMKernelProfile* rows, size_t count, uint64_t launches) {
+    for (size_t i = 0; i < count; i++)
+        if (rows[i].launches == launches) return &rows[i];
+    return NULL;
+}
+
+int main(void) {
+    printf("=== Burymetal Kernel Profile Tests ===\n");
+
+    BMDevice* dev = NULL;
+    assert(bm_create_device(BM_CPU, &dev) == BM_OK);
+    BMKernel* kernel = bm_register_kernel(dev, "sum", sum_kernel);
+    assert(kernel);
+
+    static unsigned host[2][ELEMENTS] __attribute__((aligned(4096)));
+    Worker workers[2] = {{kernel, NULL, 50}, {kernel, NULL, 20}};
+    for (int i = 0; i < 2; i++)
+        assert(bm_buffer_wrap_host(dev, host[i], sizeof(host[i]), BM_WRAP_BORROW, &workers[i].buffer) == BM_OK);
+
+    // Выключено — ничего не копится
+    launch_many(&workers[1]);
+    assert(bm_profile_query(NULL, 0) == 0);
+
+    assert(bm_profile_enable(1) == BM_OK);
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, launch_many, &workers[1]) == 0);
+    launch_many(&workers[0]);
+    pthread_join(thread, NULL);
+    assert(bm_profile_enable(0) == BM_OK);
+    launch_many(&workers[0]);
+
+    // По записи на поток
+    BMKernelProfile rows[4];
+    assert(bm_profile_query(rows, 4) == 2);
+    const BMKernelProfile* main_row = find_launches(rows, 2, 50);
+    const BMKernelProfile* thread_row = find_launches(rows, 2, 20);
+    assert(main_row && thread_row && main_row->thread != thread_row->thread);
+    assert(strcmp(main_row->kernel, "sum") == 0);
+    assert(main_row->wall_sec > 0.0);
+    // Запуск, в котором группа не стояла на PMU, не считается за ноль событий
+    assert(main_row->counted_launches <= main_row->launches);
+    assert((main_row->counters == 0) == (main_row->counted_launches == 0));
+    if (main_row->counters & BM_PROFILE_INSTRUCTIONS) // хотя бы инструкция на элемент
+        assert(main_row->instructions >= main_row->counted_launches * ELEMENTS);
+    printf("counters: %s\n", main_row->counters ? "perf_event_open" : "недоступны, только время");
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/bm_test_profile_%d.txt", (int)getpid());
+    assert(bm_profile_dump(path) == BM_OK);
+    FILE* f = fopen(path, "r");
+    char line[512];
+    assert(f && fgets(line, sizeof(line), f) && strncmp(line, "kernel", 6) == 0);
+    fclose(f);
+    unlink(path);
+    bm_profile_dump(NULL);
+
+    // Сброс убирает и записи завершившегося потока
+    bm_profile_reset();
+    assert(bm_profile_query(NULL, 0) == 0);
+
+    for (int i = 0; i < 2; i++) bm_free_buffer(workers[i].buffer);
+    bm_unregister_kernel(kernel);
+    bm_destroy_device(dev);
+    printf("All tests passed ✅\n");
+    return 0;
+}
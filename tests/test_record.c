@@ -0,0 +1,203 @@
+// test_record.c
+#define _POSIX_C_SOURCE 200809L
+#include "burymetal.h"
+#include "bm_utils.h"
+#include "bm_internal.h"
+#include "bm_mem_pool.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ROUNDS 50
+
+static void touch(void* data, size_t count) {
+    unsigned char* bytes = (unsigned char*)data;
+    for (size_t i = 0; i < count; i++) bytes[i]++;
+}
+
+typedef struct {
+    BMDevice* dev;
+    BMKernel* kernel;
+    BMBufferPool* pool;
+} Shared;
+
+static void* worker(void* arg) {
+    Shared* s = (Shared*)arg;
+    char data[256] = {0};
+    for (int i = 0; i < ROUNDS; i++) {
+        BMBuffer* buf = NULL;
+        assert(bm_pool_acquire_timeout(s->pool, &buf, BM_POOL_WAIT_FOREVER) == BM_OK);
+        assert(bm_write_buffer(buf, data, sizeof(data), 0) == BM_OK);
+        assert(bm_launch_kernel(s->kernel, buf, sizeof(data)) == BM_OK);
+        assert(bm_read_buffer(buf, data, 128, 64) == BM_OK);
+        assert(bm_pool_release(s->pool, buf) == BM_OK);
+    }
+    return NULL;
+}
+
+// Обёртки, клоны, файлы, разделяемые буферы, map/unmap и scatter/gather
+static void test_buffer_ops(void) {
+    char path[64], file[64];
+    snprintf(path, sizeof(path), "/tmp/bm_test_record_ops_%d.bmrec", (int)getpid());
+    snprintf(file, sizeof(file), "/tmp/bm_test_record_file_%d.bin", (int)getpid());
+    FILE* f = fopen(file, "wb");
+    assert(f && fwrite("0123456789abcdef", 1, 16, f) == 16);
+    fclose(f);
+
+    static char host[4096] __attribute__((aligned(BM_HOST_WRAP_ALIGNMENT)));
+    char data[64] = {0};
+    BMDevice* dev = NULL;
+    assert(bm_create_device(BM_CPU, &dev) == BM_OK);
+    assert(bm_record_start(path) == BM_OK);
+
+    BMBuffer *wrapped = NULL, *clone = NULL, *mapped = NULL, *shared = NULL;
+    assert(bm_buffer_wrap_host(dev, host, sizeof(host), BM_WRAP_BORROW, &wrapped) == BM_OK);
+    assert(bm_buffer_clone(wrapped, 0, &clone) == BM_OK);
+    assert(bm_buffer_map_file(dev, file, 0, 0, 0, &mapped) == BM_OK);
+    assert(bm_buffer_create_shared(dev, NULL, 8192, &shared) == BM_OK);
+    void* ptr = NULL;
+    assert(bm_map_buffer(clone, 128, 256, BM_MAP_WRITE, &ptr) == BM_OK);
+    assert(bm_unmap_buffer(clone, ptr) == BM_OK);
+    BMTransferRegion regions[3] = {{data, 0, 16}, {data + 16, 1024, 16}, {data + 32, 2048, 32}};
+    assert(bm_write_buffer_regions(shared, regions, 3) == BM_OK);
+    assert(bm_read_buffer_regions(clone, regions, 2) == BM_OK);
+    bm_free_buffer(shared);
+    bm_free_buffer(mapped);
+    bm_free_buffer(clone);
+    bm_free_buffer(wrapped);
+    assert(bm_record_stop() == BM_OK);
+    bm_destroy_device(dev);
+
+    f = fopen(path, "rb");
+    assert(f);
+    BMRecordHeader header;
+    assert(fread(&header, sizeof(header), 1, f) == 1);
+    size_t ops[BM_RECORD_OP_COUNT] = {0};
+    BMRecordEvent ev;
+    while (fread(&ev, sizeof(ev), 1, f) == 1) {
+        assert(ev.op > 0 && ev.op < BM_RECORD_OP_COUNT && ev.result == 0);
+        ops[ev.op]++;
+        if (ev.op == BM_RECORD_WRAP_HOST)
+            assert(ev.object == (uint64_t)(uintptr_t)dev && ev.args[0] == sizeof(host) && ev.args[1] == BM_WRAP_BORROW);
+        if (ev.op == BM_RECORD_CLONE_BUFFER)
+            assert(ev.object == (uint64_t)(uintptr_t)wrapped && ev.target == (uint64_t)(uintptr_t)clone);
+        if (ev.op == BM_RECORD_MAP_FILE) assert(ev.args[0] == 16);
+        if (ev.op == BM_RECORD_CREATE_SHARED) assert(ev.args[0] == 8192 && ev.args[1] == 0);
+        if (ev.op == BM_RECORD_UNMAP_BUFFER) assert(ev.target == (uint64_t)(uintptr_t)ptr);
+        if (ev.op == BM_RECORD_WRITE_REGIONS) assert(ev.args[0] == 64 && ev.args[1] == 3);
+        if (ev.op == BM_RECORD_READ_REGIONS) assert(ev.args[0] == 32 && ev.args[1] == 2);
+        if (ev.op == BM_RECORD_MAP_BUFFER) {
+            assert(ev.target == (uint64_t)(uintptr_t)ptr && ev.args[0] == 256 && ev.args[1] == 128);
+            uint64_t flags;
+            BMRecordEvent block;
+            assert(fread(&block, sizeof(block), 1, f) == 1);
+            memcpy(&flags, &block, sizeof(flags));
+            assert(flags == BM_MAP_WRITE);
+        }
+    }
+    fclose(f);
+    unlink(path);
+    unlink(file);
+
+    // Копия через host внутри clone не записывается отдельными вызовами
+    assert(ops[BM_RECORD_ALLOC_BUFFER] == 0 && ops[BM_RECORD_WRITE_BUFFER] == 0);
+    assert(ops[BM_RECORD_WRAP_HOST] == 1 && ops[BM_RECORD_CLONE_BUFFER] == 1);
+    assert(ops[BM_RECORD_MAP_FILE] == 1 && ops[BM_RECORD_CREATE_SHARED] == 1);
+    assert(ops[BM_RECORD_MAP_BUFFER] == 1 && ops[BM_RECORD_UNMAP_BUFFER] == 1);
+    assert(ops[BM_RECORD_WRITE_REGIONS] == 1 && ops[BM_RECORD_READ_REGIONS] == 1);
+    assert(ops[BM_RECORD_FREE_BUFFER] == 4);
+    printf("record: wrap, clone, file, shared, map, regions ✅\n");
+}
+
+int main(void) {
+    printf("=== Burymetal Record Tests ===\n");
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/bm_test_record_%d.bmrec", (int)getpid());
+
+    assert(bm_record_stop() == BM_ERROR_INVALID_ARG); // не включена
+    assert(bm_record_start(path) == BM_OK);
+    assert(bm_record_start(path) == BM_ERROR_INVALID_ARG);
+
+    Shared s;
+    assert(bm_create_device(BM_CPU, &s.dev) == BM_OK);
+    s.kernel = bm_register_kernel(s.dev, "touch", touch);
+    assert(s.kernel);
+    s.pool = bm_pool_create(s.dev, 4096, 1); // один буфер на два потока — конкуренция
+    assert(s.pool);
+
+    pthread_t threads[2];
+    for (int i = 0; i < 2; i++) assert(pthread_create(&threads[i], NULL, worker, &s) == 0);
+    for (int i = 0; i < 2; i++) pthread_join(threads[i], NULL);
+
+    bm_pool_destroy(s.pool);
+    bm_unregister_kernel(s.kernel);
+    bm_destroy_device(s.dev);
+    assert(bm_record_stop() == BM_OK);
+
+    FILE* f = fopen(path, "rb");
+    assert(f);
+    BMRecordHeader header;
+    assert(fread(&header, sizeof(header), 1, f) == 1);
+    assert(memcmp(header.magic, BM_RECORD_MAGIC, sizeof(header.magic)) == 0);
+    assert(header.version == BM_RECORD_VERSION && header.event_size == sizeof(BMRecordEvent));
+
+    size_t ops[BM_RECORD_OP_COUNT] = {0};
+    uint64_t last_seq[4] = {0};
+    uint64_t pool_seq = 0, device_seq = 0, destroy_seq = 0;
+    unsigned max_thread = 0;
+    BMRecordEvent ev;
+    while (fread(&ev, sizeof(ev), 1, f) == 1) {
+        assert(ev.op > 0 && ev.op < BM_RECORD_OP_COUNT);
+        assert(ev.thread >= 1 && ev.thread <= 3);
+        // Внутри потока номера растут
+        assert(ev.seq > last_seq[ev.thread]);
+        last_seq[ev.thread] = ev.seq;
+        if (ev.thread > max_thread) max_thread = ev.thread;
+        ops[ev.op]++;
+
+        if (ev.op == BM_RECORD_CREATE_DEVICE) device_seq = ev.seq;
+        if (ev.op == BM_RECORD_POOL_CREATE) pool_seq = ev.seq;
+        if (ev.op == BM_RECORD_DESTROY_DEVICE) destroy_seq = ev.seq;
+        if (ev.op == BM_RECORD_POOL_ACQUIRE) {
+            assert(ev.object == (uint64_t)(uintptr_t)s.pool && ev.target && ev.result == 0);
+            assert(ev.seq > pool_seq);
+        }
+        if (ev.op == BM_RECORD_WRITE_BUFFER) assert(ev.args[0] == 256 && ev.args[1] == 0);
+        if (ev.op == BM_RECORD_READ_BUFFER) assert(ev.args[0] == 128 && ev.args[1] == 64);
+        if (ev.op == BM_RECORD_LAUNCH_KERNEL) assert(ev.object == (uint64_t)(uintptr_t)s.kernel && ev.args[0] == 256);
+
+        // За регистрацией и созданием пула — блок данных
+        if (ev.op == BM_RECORD_REGISTER_KERNEL || ev.op == BM_RECORD_POOL_CREATE) {
+            BMRecordEvent block;
+            assert(fread(&block, sizeof(block), 1, f) == 1);
+            if (ev.op == BM_RECORD_REGISTER_KERNEL) {
+                assert(strcmp((const char*)&block, "touch") == 0);
+            } else {
+                uint64_t params[4];
+                memcpy(params, &block, sizeof(params));
+                assert(ev.args[0] == 4096 && ev.args[1] == 1 && params[1] == 1);
+            }
+        }
+    }
+    fclose(f);
+    unlink(path);
+
+    assert(ops[BM_RECORD_CREATE_DEVICE] == 1 && ops[BM_RECORD_DESTROY_DEVICE] == 1);
+    assert(ops[BM_RECORD_REGISTER_KERNEL] == 1 && ops[BM_RECORD_UNREGISTER_KERNEL] == 1);
+    assert(ops[BM_RECORD_POOL_CREATE] == 1 && ops[BM_RECORD_POOL_DESTROY] == 1);
+    assert(ops[BM_RECORD_POOL_ACQUIRE] == 2 * ROUNDS && ops[BM_RECORD_POOL_RELEASE] == 2 * ROUNDS);
+    assert(ops[BM_RECORD_WRITE_BUFFER] == 2 * ROUNDS && ops[BM_RECORD_READ_BUFFER] == 2 * ROUNDS);
+    assert(ops[BM_RECORD_LAUNCH_KERNEL] == 2 * ROUNDS);
+    assert(max_thread == 3);
+    assert(device_seq < pool_seq && pool_seq < destroy_seq);
+    printf("record: %zu launches from 3 threads ✅\n", ops[BM_RECORD_LAUNCH_KERNEL]);
+
+    test_buffer_ops();
+
+    printf("All tests passed ✅\n");
+    return 0;
+}
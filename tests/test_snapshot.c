@@ -0,0 +1,74 @@
+// test_snapshot.c
+#include "burymetal.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SNAPSHOT_PATH "bm_snapshot_test.snap"
+#define TABLE_INTS    10007
+
+static void test_roundtrip(BMDevice* dev) {
+    static int table[TABLE_INTS];
+    for (int i = 0; i < TABLE_INTS; i++) table[i] = i * 31;
+
+    BMBuffer* weights = NULL;
+    BMBuffer* bias = NULL;
+    assert(bm_alloc_buffer(dev, sizeof(table), &weights) == BM_OK);
+    assert(bm_alloc_buffer(dev, 3, &bias) == BM_OK);
+    assert(bm_write_buffer(weights, table, sizeof(table), 0) == BM_OK);
+    assert(bm_write_buffer(bias, "xyz", 3, 0) == BM_OK);
+
+    BMSnapshotEntry entries[2] = {{"weights", weights}, {"bias", bias}};
+    assert(bm_snapshot_save(SNAPSHOT_PATH, entries, 2) == BM_OK && "ошибка сохранения");
+
+    // Повтор имени отвергается
+    BMSnapshotEntry dup[2] = {{"x", weights}, {"x", bias}};
+    assert(bm_snapshot_save(SNAPSHOT_PATH ".dup", dup, 2) != BM_OK);
+
+    BMSnapshot* snap = NULL;
+    assert(bm_snapshot_open(dev, SNAPSHOT_PATH, BM_FILE_READ_ONLY, &snap) == BM_OK && "ошибка восстановления");
+    assert(bm_snapshot_count(snap) == 2);
+
+    BMBuffer* restored = bm_snapshot_find(snap, "weights");
+    assert(restored && restored->size == sizeof(table));
+    static int check[TABLE_INTS];
+    assert(bm_read_buffer(restored, check, sizeof(check), 0) == BM_OK);
+    assert(memcmp(check, table, sizeof(table)) == 0);
+
+    // Zero-copy отображение только для чтения
+    assert(bm_write_buffer(restored, table, sizeof(int), 0) != BM_OK);
+
+    BMSnapshotEntry entry;
+    assert(bm_snapshot_entry(snap, 1, &entry) == BM_OK && strcmp(entry.name, "bias") == 0);
+    char bytes[3];
+    assert(bm_read_buffer(entry.buffer, bytes, 3, 0) == BM_OK && memcmp(bytes, "xyz", 3) == 0);
+    assert(bm_snapshot_find(snap, "missing") == NULL);
+    bm_snapshot_close(snap);
+
+    // Испорченный индекс (размер payload'а за концом файла)
+    FILE* f = fopen(SNAPSHOT_PATH, "r+b");
+    assert(f);
+    fseek(f, 64 + 15, SEEK_SET);
+    fputc(0x7f, f);
+    fclose(f);
+    assert(bm_snapshot_open(dev, SNAPSHOT_PATH, 0, &snap) != BM_OK);
+    printf("expected error: %s\n", bm_get_last_error());
+
+    remove(SNAPSHOT_PATH);
+    bm_free_buffer(weights);
+    bm_free_buffer(bias);
+    printf("snapshot roundtrip ✅\n");
+}
+
+int main(void) {
+    printf("=== Burymetal Snapshot Tests ===\n");
+
+    BMDevice* dev = NULL;
+    assert(bm_create_device(BM_CPU, &dev) == BM_OK);
+
+    test_roundtrip(dev);
+
+    bm_destroy_device(dev);
+    printf("All tests passed ✅\n");
+    return 0;
+}
@@ -0,0 +1,116 @@
+// test_stats.c
+#define _POSIX_C_SOURCE 200809L
+#include "burymetal.h"
+#include "bm_mem_pool.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static void noop(void* data, size_t count) {
+    (void)data;
+    (void)count;
+}
+
+static void* release_later(void* arg) {
+    void** ctx = (void**)arg;
+    struct timespec pause = {0, 20 * 1000000L};
+    nanosleep(&pause, NULL);
+    bm_pool_release((BMBufferPool*)ctx[0], (BMBuffer*)ctx[1]);
+    return NULL;
+}
+
+static uint64_t histogram_total(const uint64_t* buckets) {
+    uint64_t total = 0;
+    for (int i = 0; i < BM_STATS_BUCKETS; i++) total += buckets[i];
+    return total;
+}
+
+int main(void) {
+    printf("=== Burymetal Stats Tests ===\n");
+
+    BMDevice* dev = NULL;
+    assert(bm_create_device(BM_CPU, &dev) == BM_OK);
+
+    BMStats stats;
+    assert(bm_get_stats(dev, &stats) == BM_OK && stats.launches == 0 && stats.bytes_live == 0);
+
+    // Запуски и передачи
+    static unsigned char host[4096] __attribute__((aligned(4096)));
+    BMBuffer* buf = NULL;
+    assert(bm_buffer_wrap_host(dev, host, sizeof(host), BM_WRAP_BORROW, &buf) == BM_OK);
+    BMKernel* a = bm_register_kernel(dev, "alpha", noop);
+    BMKernel* b = bm_register_kernel(dev, "beta", noop);
+    for (int i = 0; i < 10; i++) assert(bm_launch_kernel(a, buf, 1) == BM_OK);
+    for (int i = 0; i < 3; i++) assert(bm_launch_kernel(b, buf, 1) == BM_OK);
+    assert(bm_write_buffer(buf, "abcd", 4, 0) == BM_OK);
+    char back[4];
+    assert(bm_read_buffer(buf, back, 4, 0) == BM_OK);
+
+    // Пул на два буфера: два попадания, промах без ожидания и промах с ожиданием
+    BMBufferPool* pool = bm_pool_create(dev, 1000, 2);
+    assert(pool);
+    BMBuffer* x = NULL;
+    BMBuffer* y = NULL;
+    BMBuffer* z = NULL;
+    assert(bm_pool_acquire(pool, &x) == BM_SUCCESS && bm_pool_acquire(pool, &y) == BM_SUCCESS);
+    assert(bm_pool_acquire(pool, &z) == BM_ERROR);
+    void* ctx[2] = {pool, x};
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, release_later, ctx) == 0);
+    assert(bm_pool_acquire_timeout(pool, &z, 5000) == BM_SUCCESS && z == x);
+    pthread_join(thread, NULL);
+
+    assert(bm_get_stats(dev, &stats) == BM_OK);
+    assert(stats.launches == 13 && histogram_total(stats.launch_latency) == 13);
+    assert(stats.bytes_uploaded == 4 && stats.bytes_downloaded == 4);
+    assert(stats.allocations == 2 && stats.bytes_live == 2000 && stats.bytes_high_water == 2000);
+    assert(stats.pool_hits == 2 && stats.pool_misses == 2);
+    assert(histogram_total(stats.pool_wait) == 1 && stats.pool_wait_ns >= 10 * 1000000ull);
+
+    bm_pool_release(pool, y);
+    bm_pool_release(pool, z);
+    bm_pool_destroy(pool);
+    assert(bm_get_stats(dev, &stats) == BM_OK);
+    assert(stats.frees == 2 && stats.bytes_live == 0 && stats.bytes_high_water == 2000);
+
+    // Текст Prometheus: длина считается и без буфера
+    size_t length = bm_stats_prometheus(dev, NULL, 0);
+    static char text[16384];
+    assert(length > 0 && length < sizeof(text));
+    assert(bm_stats_prometheus(dev, text, sizeof(text)) == length && strlen(text) == length);
+    assert(strstr(text, "burymetal_kernel_launches_total{device=\"cpu0\"} 13\n"));
+    assert(strstr(text, "burymetal_kernel_launches_by_name_total{device=\"cpu0\",kernel=\"alpha\"} 10\n"));
+    assert(strstr(text, "burymetal_kernel_launches_by_name_total{device=\"cpu0\",kernel=\"beta\"} 3\n"));
+    assert(strstr(text, "burymetal_launch_latency_seconds_count{device=\"cpu0\"} 13\n"));
+    assert(strstr(text, "burymetal_pool_wait_seconds_bucket{device=\"cpu0\",le=\"+Inf\"} 1\n"));
+    assert(strstr(text, "burymetal_live_bytes_high_water{device=\"cpu0\"} 2000\n"));
+    // Обрезка как у snprintf
+    char small[32];
+    assert(bm_stats_prometheus(dev, small, sizeof(small)) == length && strlen(small) == sizeof(small) - 1);
+    printf("prometheus: %zu bytes ✅\n", length);
+
+    // У второго устройства того же типа — своя метка
+    BMDevice* other = NULL;
+    assert(bm_create_device(BM_CPU, &other) == BM_OK);
+    assert(bm_stats_prometheus(other, text, sizeof(text)) > 0);
+    assert(strstr(text, "burymetal_kernel_launches_total{device=\"cpu1\"} 0\n"));
+    assert(!strstr(text, "device=\"cpu0\""));
+    bm_destroy_device(other);
+
+    // Заимствованная обёртка не учитывается, клон (память библиотеки) — да
+    BMBuffer* clone = NULL;
+    assert(bm_buffer_clone(buf, 0, &clone) == BM_OK);
+    assert(bm_get_stats(dev, &stats) == BM_OK && stats.allocations == 3 && stats.bytes_live == sizeof(host));
+    bm_free_buffer(clone);
+    assert(bm_get_stats(dev, &stats) == BM_OK && stats.frees == 3 && stats.bytes_live == 0);
+    printf("owned wrapped memory ✅\n");
+
+    bm_free_buffer(buf);
+    bm_unregister_kernel(a);
+    bm_unregister_kernel(b);
+    bm_destroy_device(dev);
+    printf("All tests passed ✅\n");
+    return 0;
+}
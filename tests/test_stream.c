@@ -0,0 +1,135 @@
+// test_stream.c
+#include "burymetal.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TOTAL_INTS  100003   // не кратно порции: последняя порция короткая
+#define CHUNK_INTS  4096
+
+// --- Источник: последовательность 0, 1, 2, ... ---
+typedef struct {
+    uint32_t next;
+} Source;
+
+static size_t source_read(void* user, void* dst, size_t max_bytes) {
+    Source* src = (Source*)user;
+    uint32_t* out = (uint32_t*)dst;
+    size_t n = 0;
+    while (n < max_bytes / sizeof(uint32_t) && src->next < TOTAL_INTS)
+        out[n++] = src->next++;
+    return n * sizeof(uint32_t);
+}
+
+// --- Ядро: +1 к каждому элементу ---
+static void increment(void* data, size_t count) {
+    uint32_t* arr = (uint32_t*)data;
+    for (size_t i = 0; i < count; i++) arr[i] += 1;
+}
+
+// --- Приёмник проверяет порядок и результат ---
+typedef struct {
+    uint32_t expect;
+} Sink;
+
+static int sink_write(void* user, const void* data, size_t bytes) {
+    Sink* sink = (Sink*)user;
+    const uint32_t* arr = (const uint32_t*)data;
+    for (size_t i = 0; i < bytes / sizeof(uint32_t); i++) {
+        if (arr[i] != sink->expect + 1) return 1;
+        ++sink->expect;
+    }
+    return 0;
+}
+
+static void test_pipeline(BMDevice* dev) {
+    BMKernel* kernel = bm_register_kernel(dev, "increment", increment);
+    assert(kernel && "Ошибка регистрации ядра");
+
+    Source src = {0};
+    Sink sink = {0};
+    BMStreamConfig config;
+    memset(&config, 0, sizeof(config));
+    config.fd = -1;
+    config.read = source_read;
+    config.read_user = &src;
+    config.sink = sink_write;
+    config.sink_user = &sink;
+    config.chunk_size = CHUNK_INTS * sizeof(uint32_t);
+    config.element_size = sizeof(uint32_t);
+
+    BMStreamStats stats;
+    assert(bm_stream_run(dev, kernel, &config, &stats) == BM_OK && "Ошибка конвейера");
+    assert(sink.expect == TOTAL_INTS && "не все данные дошли до sink");
+    assert(stats.bytes == (uint64_t)TOTAL_INTS * sizeof(uint32_t));
+    assert(stats.chunks == (TOTAL_INTS + CHUNK_INTS - 1) / CHUNK_INTS);
+    printf("stream: %zu порций за %.3f с (read %.3f, kernel %.3f, sink %.3f)\n",
+           stats.chunks, stats.elapsed_sec, stats.read_busy_sec, stats.kernel_busy_sec, stats.sink_busy_sec);
+
+    // Ошибка sink останавливает конвейер
+    src.next = 0;
+    sink.expect = 7;
+    assert(bm_stream_run(dev, kernel, &config, NULL) != BM_OK);
+    printf("expected error: %s\n", bm_get_last_error());
+
+    bm_unregister_kernel(kernel);
+}
+
+static void increment_bytes(void* data, size_t count) {
+    unsigned char* bytes = (unsigned char*)data;
+    for (size_t i = 0; i < count; i++) bytes[i] += 1;
+}
+
+// --- Источник с неполным последним элементом ---
+static size_t ragged_read(void* user, void* dst, size_t max_bytes) {
+    size_t* left = (size_t*)user;
+    size_t n = *left < max_bytes ? *left : max_bytes;
+    memset(dst, 0, n);
+    *left -= n;
+    return n;
+}
+
+static void test_partial_element(BMDevice* dev) {
+    BMKernel* kernel = bm_register_kernel(dev, "increment", increment);
+    assert(kernel);
+
+    // Две полные порции и хвост в 6 байт: полтора uint32_t
+    size_t left = 2 * CHUNK_INTS * sizeof(uint32_t) + 6;
+    BMStreamConfig config;
+    memset(&config, 0, sizeof(config));
+    config.fd = -1;
+    config.read = ragged_read;
+    config.read_user = &left;
+    config.chunk_size = CHUNK_INTS * sizeof(uint32_t);
+    config.element_size = sizeof(uint32_t);
+    assert(bm_stream_run(dev, kernel, &config, NULL) == BM_ERROR_INVALID_ARG);
+    printf("expected error: %s\n", bm_get_last_error());
+
+    // Без element_size count в байтах — хвост проходит целиком
+    BMKernel* byte_kernel = bm_register_kernel(dev, "increment_bytes", increment_bytes);
+    assert(byte_kernel);
+    left = 2 * CHUNK_INTS * sizeof(uint32_t) + 6;
+    config.element_size = 0;
+    BMStreamStats stats;
+    assert(bm_stream_run(dev, byte_kernel, &config, &stats) == BM_OK);
+    assert(stats.bytes == 2 * CHUNK_INTS * sizeof(uint32_t) + 6 && stats.chunks == 3);
+
+    bm_unregister_kernel(byte_kernel);
+    bm_unregister_kernel(kernel);
+    printf("partial element rejected ✅\n");
+}
+
+int main(void) {
+    printf("=== Burymetal Stream Tests ===\n");
+
+    BMDevice* dev = NULL;
+    assert(bm_create_device(BM_CPU, &dev) == BM_OK);
+
+    test_pipeline(dev);
+    test_partial_element(dev);
+
+    bm_destroy_device(dev);
+    printf("All tests passed ✅\n");
+    return 0;
+}
@@ -0,0 +1,136 @@
+// test_sysinfo.c
+#define _XOPEN_SOURCE 700
+#include "burymetal.h"
+#include "bm_mem_sysinfo.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static char root[64];
+
+// Файл внутри поддельного корня; каталоги создаются по пути
+static void put(const char* path, const char* text) {
+    char full[512];
+    snprintf(full, sizeof(full), "%s%s", root, path);
+    for (char* p = full + 1; *p; ++p) {
+        if (*p != '/') continue;
+        *p = '\0';
+        mkdir(full, 0755);
+        *p = '/';
+    }
+    FILE* f = fopen(full, "w");
+    assert(f);
+    fputs(text, f);
+    fclose(f);
+}
+
+static int remove_entry(const char* path, const struct stat* st, int flag, struct FTW* ftw) {
+    (void)st; (void)flag; (void)ftw;
+    return remove(path);
+}
+
+static void remove_tree(void) {
+    nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+static void common_tree(void) {
+    put("/sys/devices/system/cpu/online", "0-15\n");
+    put("/sys/devices/system/node/online", "0-1\n");
+    put("/proc/self/status", "Name:\ttest\nCpus_allowed:\tff\nCpus_allowed_list:\t0-5,8-9\n");
+    put("/proc/meminfo", "MemTotal:       65536000 kB\nMemFree:         1000 kB\nMemAvailable:   32768000 kB\n");
+    put("/proc/cpuinfo", "processor\t: 0\nmodel name\t: Test CPU @ 3.00GHz\nflags\t\t: fpu\n");
+    const char* cache = "/sys/devices/system/cpu/cpu0/cache/index";
+    const char* files[4][3] = {
+        {"1", "Data", "48K"}, {"1", "Instruction", "32K"}, {"2", "Unified", "2048K"}, {"3", "Unified", "105M"},
+    };
+    for (int i = 0; i < 4; i++) {
+        char path[128];
+        snprintf(path, sizeof(path), "%s%d/level", cache, i);
+        put(path, files[i][0]);
+        snprintf(path, sizeof(path), "%s%d/type", cache, i);
+        put(path, files[i][1]);
+        snprintf(path, sizeof(path), "%s%d/size", cache, i);
+        put(path, files[i][2]);
+        snprintf(path, sizeof(path), "%s%d/coherency_line_size", cache, i);
+        put(path, "64\n");
+    }
+}
+
+static void test_cgroup_v2(void) {
+    snprintf(root, sizeof(root), "/tmp/bm_test_sysinfo_v2_%d", (int)getpid());
+    common_tree();
+    // Квота задана на родителе, память — уже на листе
+    put("/proc/self/cgroup", "0::/kubepods/pod1/app\n");
+    put("/sys/fs/cgroup/cgroup.controllers", "cpu memory\n");
+    put("/sys/fs/cgroup/kubepods/cpu.max", "max 100000\n");
+    put("/sys/fs/cgroup/kubepods/pod1/cpu.max", "250000 100000\n");
+    put("/sys/fs/cgroup/kubepods/pod1/memory.max", "max\n");
+    put("/sys/fs/cgroup/kubepods/pod1/app/cpu.max", "max 100000\n");
+    put("/sys/fs/cgroup/kubepods/pod1/app/memory.max", "4294967296\n");
+    put("/sys/fs/cgroup/kubepods/pod1/app/memory.current", "1073741824\n");
+
+    BMSysInfo info;
+    assert(bm_sysinfo_load(root, &info) == BM_SUCCESS);
+    assert(info.cpus_online == 16 && info.cpus_allowed == 8);
+    assert(info.cpu_quota > 2.49 && info.cpu_quota < 2.51);
+    assert(info.cpu_budget == 3);   // 2.5 CPU — три потока, не восемь
+    assert(info.numa_nodes == 2);
+    assert(info.cache_line == 64 && info.cache_l1d == 48u << 10);
+    assert(info.cache_l2 == 2u << 20 && info.cache_l3 == 105u << 20);
+    assert(strcmp(info.cpu_model, "Test CPU @ 3.00GHz") == 0);
+    assert(info.memory_total == 4294967296ull);
+    assert(info.memory_available == 3221225472ull);
+    remove_tree();
+    printf("cgroup v2: budget %d, memory %llu ✅\n", info.cpu_budget, (unsigned long long)info.memory_total);
+}
+
+static void test_cgroup_v1(void) {
+    snprintf(root, sizeof(root), "/tmp/bm_test_sysinfo_v1_%d", (int)getpid());
+    common_tree();
+    // Гибридный режим: строка "0::" есть, но cgroup.controllers в корне нет
+    put("/proc/self/cgroup", "4:memory:/docker/abc\n2:cpu,cpuacct:/docker/abc\n0::/\n");
+    put("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", "-1\n");
+    put("/sys/fs/cgroup/cpu/cpu.cfs_period_us", "100000\n");
+    put("/sys/fs/cgroup/cpu/docker/abc/cpu.cfs_quota_us", "50000\n");
+    put("/sys/fs/cgroup/cpu/docker/abc/cpu.cfs_period_us", "100000\n");
+    put("/sys/fs/cgroup/memory/memory.limit_in_bytes", "9223372036854771712\n");
+    put("/sys/fs/cgroup/memory/docker/abc/memory.limit_in_bytes", "536870912\n");
+    put("/sys/fs/cgroup/memory/docker/abc/memory.usage_in_bytes", "600000000\n");
+
+    BMSysInfo info;
+    assert(bm_sysinfo_load(root, &info) == BM_SUCCESS);
+    assert(info.cpu_quota > 0.49 && info.cpu_quota < 0.51 && info.cpu_budget == 1);
+    assert(info.memory_total == 536870912ull && info.memory_available == 0);
+    remove_tree();
+    printf("cgroup v1: budget %d, memory %llu ✅\n", info.cpu_budget, (unsigned long long)info.memory_total);
+}
+
+static void test_query_device(void) {
+    BMDevice* dev = NULL;
+    assert(bm_create_device(BM_CPU, &dev) == BM_OK);
+    BMDeviceInfo info;
+    assert(bm_query_device(dev, &info) == BM_OK);
+    assert(info.type == BM_CPU && info.cpus_online >= 1);
+    assert(info.compute_units >= 1 && info.compute_units <= info.cpus_allowed);
+    assert(info.memory_size > 0 && info.memory_available <= info.memory_size);
+    assert(info.memory_total == (uint32_t)(info.memory_size >> 20));
+#if defined(__x86_64__)
+    assert(info.simd & BM_SIMD_SSE2);
+#endif
+    printf("CPU: %d units of %d allowed, %u MB, simd %#x ✅\n", info.compute_units, info.cpus_allowed,
+           info.memory_total, info.simd);
+    bm_destroy_device(dev);
+}
+
+int main(void) {
+    printf("=== Burymetal System Info Tests ===\n");
+    test_cgroup_v2();
+    test_cgroup_v1();
+    test_query_device();
+    printf("All tests passed ✅\n");
+    return 0;
+}
@@ -0,0 +1,97 @@
+// test_trace.c
+#define _POSIX_C_SOURCE 200809L
+#include "burymetal.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LAUNCHES 100
+
+static void touch(void* data, size_t count) {
+    unsigned char* bytes = (unsigned char*)data;
+    for (size_t i = 0; i < count; i++) bytes[i]++;
+}
+
+typedef struct {
+    BMKernel* kernel;
+    BMBuffer* buffer;
+} Worker;
+
+static void* launch_many(void* arg) {
+    Worker* w = (Worker*)arg;
+    for (int i = 0; i < LAUNCHES; i++)
+        assert(bm_launch_kernel(w->kernel, w->buffer, 64) == BM_OK);
+    return NULL;
+}
+
+static char* read_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    assert(f);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* text = (char*)malloc((size_t)size + 1);
+    assert(text && fread(text, 1, (size_t)size, f) == (size_t)size);
+    text[size] = '\0';
+    fclose(f);
+    return text;
+}
+
+static size_t count_of(const char* text, const char* needle) {
+    size_t n = 0;
+    for (const char* p = strstr(text, needle); p; p = strstr(p + 1, needle)) n++;
+    return n;
+}
+
+int main(void) {
+    printf("=== Burymetal Trace Tests ===\n");
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/bm_test_trace_%d.json", (int)getpid());
+
+    assert(bm_trace_stop() == BM_ERROR_INVALID_ARG); // не включена
+    assert(bm_trace_start(path) == BM_OK);
+    assert(bm_trace_start(path) == BM_ERROR_INVALID_ARG);
+
+    BMDevice* dev = NULL;
+    assert(bm_create_device(BM_CPU, &dev) == BM_OK);
+    BMKernel* kernel = bm_register_kernel(dev, "touch \"quoted\"", touch);
+    assert(kernel);
+
+    // Два потока — два буфера и два трека в трассе
+    static unsigned char host[2][4096] __attribute__((aligned(4096)));
+    Worker workers[2];
+    pthread_t threads[2];
+    for (int i = 0; i < 2; i++) {
+        workers[i].kernel = kernel;
+        assert(bm_buffer_wrap_host(dev, host[i], sizeof(host[i]), BM_WRAP_BORROW, &workers[i].buffer) == BM_OK);
+        assert(pthread_create(&threads[i], NULL, launch_many, &workers[i]) == 0);
+    }
+    for (int i = 0; i < 2; i++) pthread_join(threads[i], NULL);
+    assert(bm_write_buffer(workers[0].buffer, "abc", 3, 0) == BM_OK);
+
+    assert(bm_trace_stop() == BM_OK);
+    // После остановки ничего не пишется
+    assert(bm_launch_kernel(kernel, workers[0].buffer, 64) == BM_OK);
+
+    char* json = read_file(path);
+    assert(strncmp(json, "{\"traceEvents\":[", 16) == 0);
+    assert(strstr(json, "\"displayTimeUnit\":\"ns\"}"));
+    assert(count_of(json, "\"name\":\"touch \\\"quoted\\\"\",\"cat\":\"kernel\"") == 2 * LAUNCHES);
+    assert(count_of(json, "\"args\":{\"count\":64}") == 2 * LAUNCHES);
+    assert(count_of(json, "\"name\":\"bm_create_device\"") == 1);
+    assert(count_of(json, "\"name\":\"bm_write_buffer\",\"cat\":\"transfer\"") == 1);
+    assert(count_of(json, "\"name\":\"thread_name\"") >= 3);
+    printf("trace: %zu bytes of Chrome trace JSON ✅\n", strlen(json));
+    free(json);
+    unlink(path);
+
+    for (int i = 0; i < 2; i++) bm_free_buffer(workers[i].buffer);
+    bm_unregister_kernel(kernel);
+    bm_destroy_device(dev);
+    printf("All tests passed ✅\n");
+    return 0;
+}
@@ -0,0 +1,653 @@
+// bm_replay.c — повтор записи вызовов (bm_record_start) на текущей сборке
+//
+//   bm_replay [--timing real|asap] [--speed X] [--kernels lib.so] [--log-level N]
+//             [--json файл] запись.bmrec
+//
+// Вызовы каждого записанного потока повторяются в своём потоке в исходном
+// порядке. --timing real (по умолчанию) выдерживает записанные моменты
+// начала (ускоренные в --speed раз), asap — без пауз. Объекты сопоставляются
+// по «воплощениям»: адрес при записи + порядковый номер создания. Вызов ждёт,
+// пока другой поток создаст нужный объект, а уничтожение — пока выполнятся
+// все предшествующие использования. Ядра ищутся по имени в --kernels
+// (dlsym); если их нет, синтетическое ядро крутится записанное время запуска.
+// Логирование библиотеки по умолчанию — WARN; чтобы мерить и его, нужен
+// --log-level 2 (INFO) с stderr, перенаправленным в файл или /dev/null.
+// --json пишет задержки по операциям в формате bm_bench (bm_bench --compare).
+// Чего в записи нет, повтор подменяет: обёрнутая host-память — своя память
+// того же размера (всегда ADOPT), отображённый файл — bm_alloc_buffer того же
+// размера, разделяемые буферы (созданные и импортированные) — анонимный memfd,
+// scatter/gather — фрагменты равного размера подряд (записаны только объём и
+// их число).
+#define _POSIX_C_SOURCE 200809L
+
+#include "burymetal.h"
+#include "bm_utils.h"
+#include "bm_internal.h"
+#include "bm_mem_pool.h"
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum { ROLE_NONE, ROLE_USE, ROLE_CREATE, ROLE_DESTROY };
+
+// Роли полей object/target для каждой операции
+static const struct {
+    const char* name;
+    unsigned char object;
+    unsigned char target;
+} ops[BM_RECORD_OP_COUNT] = {
+    [BM_RECORD_CREATE_DEVICE]     = {"create_device", ROLE_NONE, ROLE_CREATE},
+    [BM_RECORD_DESTROY_DEVICE]    = {"destroy_device", ROLE_DESTROY, ROLE_NONE},
+    [BM_RECORD_ALLOC_BUFFER]      = {"alloc_buffer", ROLE_USE, ROLE_CREATE},
+    [BM_RECORD_FREE_BUFFER]       = {"free_buffer", ROLE_DESTROY, ROLE_USE},
+    [BM_RECORD_WRITE_BUFFER]      = {"write_buffer", ROLE_USE, ROLE_NONE},
+    [BM_RECORD_READ_BUFFER]       = {"read_buffer", ROLE_USE, ROLE_NONE},
+    [BM_RECORD_REGISTER_KERNEL]   = {"register_kernel", ROLE_USE, ROLE_CREATE},
+    [BM_RECORD_UNREGISTER_KERNEL] = {"unregister_kernel", ROLE_DESTROY, ROLE_USE},
+    [BM_RECORD_LAUNCH_KERNEL]     = {"launch_kernel", ROLE_USE, ROLE_USE},
+    [BM_RECORD_POOL_CREATE]       = {"pool_create", ROLE_USE, ROLE_CREATE},
+    [BM_RECORD_POOL_DESTROY]      = {"pool_destroy", ROLE_DESTROY, ROLE_USE},
+    [BM_RECORD_POOL_ACQUIRE]      = {"pool_acquire", ROLE_USE, ROLE_CREATE},
+    [BM_RECORD_POOL_RELEASE]      = {"pool_release", ROLE_USE, ROLE_DESTROY},
+    [BM_RECORD_WRAP_HOST]         = {"wrap_host", ROLE_USE, ROLE_CREATE},
+    [BM_RECORD_CLONE_BUFFER]      = {"clone_buffer", ROLE_USE, ROLE_CREATE},
+    [BM_RECORD_MAP_FILE]          = {"map_file", ROLE_USE, ROLE_CREATE},
+    [BM_RECORD_CREATE_SHARED]     = {"create_shared", ROLE_USE, ROLE_CREATE},
+    [BM_RECORD_IMPORT_SHARED]     = {"import_shared", ROLE_USE, ROLE_CREATE},
+    [BM_RECORD_MAP_BUFFER]        = {"map_buffer", ROLE_USE, ROLE_CREATE},
+    [BM_RECORD_UNMAP_BUFFER]      = {"unmap_buffer", ROLE_USE, ROLE_DESTROY},
+    [BM_RECORD_WRITE_REGIONS]     = {"write_regions", ROLE_USE, ROLE_NONE},
+    [BM_RECORD_READ_REGIONS]      = {"read_regions", ROLE_USE, ROLE_NONE},
+};
+
+static int op_has_data(unsigned op) {
+    return op == BM_RECORD_REGISTER_KERNEL || op == BM_RECORD_POOL_CREATE || op == BM_RECORD_MAP_BUFFER;
+}
+
+typedef struct {
+    int ready;                  // создан при повторе (или не смог создаться)
+    int failed;                 // зависимые вызовы пропускаются
+    uint64_t uses;              // использований до уничтожения (по записи)
+    uint64_t done;              // из них выполнено при повторе
+    void* handle;
+} Object;
+
+typedef struct {
+    BMRecordEvent ev;
+    BMRecordEvent data;         // блок данных (REGISTER_KERNEL, POOL_CREATE, MAP_BUFFER)
+    int64_t ids[2];             // воплощения object/target, -1 — нет
+    int skip;                   // зависит от объекта, созданного до записи
+} Call;
+
+typedef struct {
+    uint64_t* values;
+    size_t count, cap;
+} Samples;
+
+typedef struct {
+    unsigned id;
+    Call** calls;
+    size_t count, cap;
+    pthread_t tid;
+    void* scratch;
+    size_t scratch_size;
+    BMTransferRegion* regions;
+    size_t regions_cap;
+    Samples latency[BM_RECORD_OP_COUNT];
+    uint64_t recorded_ns[BM_RECORD_OP_COUNT];
+    size_t skipped, diverged;
+} Replayer;
+
+static struct {
+    int asap;
+    double speed;
+    const char* kernels;
+    const char* json;
+    int log_level;
+    const char* path;
+} opt = {0, 1.0, NULL, NULL, BM_LOG_WARN, NULL};
+
+static Object* objects = NULL;
+static size_t object_count = 0;
+static void* kernel_lib = NULL;
+static uint64_t replay_start_ns = 0;
+static int device_fallback_warned = 0;
+static size_t synthetic_kernels = 0;
+
+static _Thread_local uint64_t synthetic_budget_ns = 0;
+
+static void out_of_memory(void) {
+    fprintf(stderr, "bm_replay: не хватило памяти\n");
+    exit(2);
+}
+
+static void* xrealloc(void* p, size_t size) {
+    void* q = realloc(p, size);
+    if (!q) out_of_memory();
+    return q;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// ----------------------------------------
+// Загрузка и сопоставление объектов
+// ----------------------------------------
+// Открытая адресация: адрес при записи -> текущее воплощение (-1 — уничтожен)
+typedef struct {
+    uint64_t* keys;
+    int64_t* values;
+    size_t mask;
+} AddressMap;
+
+static int64_t* map_slot(AddressMap* map, uint64_t key) {
+    size_t i = (size_t)((key >> 4) * 0x9E3779B97F4A7C15ull) & map->mask;
+    while (map->keys[i] && map->keys[i] != key) i = (i + 1) & map->mask;
+    if (!map->keys[i]) {
+        map->keys[i] = key;
+        map->values[i] = -1;
+    }
+    return &map->values[i];
+}
+
+static int compare_seq(const void* a, const void* b) {
+    uint64_t x = ((const Call*)a)->ev.seq, y = ((const Call*)b)->ev.seq;
+    return (x > y) - (x < y);
+}
+
+static Call* load(const char* path, size_t* out_count) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "bm_replay: не удалось открыть %s\n", path);
+        exit(2);
+    }
+    BMRecordHeader header;
+    if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, BM_RECORD_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version == 0 || header.version > BM_RECORD_VERSION || header.event_size != sizeof(BMRecordEvent)) {
+        fprintf(stderr, "bm_replay: %s — не запись bm_record версий 1..%d\n", path, BM_RECORD_VERSION);
+        exit(2);
+    }
+
+    Call* calls = NULL;
+    size_t count = 0, cap = 0;
+    BMRecordEvent ev;
+    while (fread(&ev, sizeof(ev), 1, f) == 1) {
+        if (ev.op == 0 || ev.op >= BM_RECORD_OP_COUNT || ev.thread == 0) {
+            fprintf(stderr, "bm_replay: повреждённая запись (op=%u)\n", ev.op);
+            exit(2);
+        }
+        if (count == cap) calls = (Call*)xrealloc(calls, (cap = cap ? cap * 2 : 4096) * sizeof(Call));
+        Call* c = &calls[count++];
+        memset(c, 0, sizeof(*c));
+        c->ev = ev;
+        if (op_has_data(ev.op) && fread(&c->data, sizeof(c->data), 1, f) != 1) {
+            fprintf(stderr, "bm_replay: запись обрезана\n");
+            exit(2);
+        }
+    }
+    fclose(f);
+    qsort(calls, count, sizeof(Call), compare_seq);
+    *out_count = count;
+    return calls;
+}
+
+// Проход в порядке seq: каждому созданию — новое воплощение, каждой ссылке —
+// текущее воплощение адреса; заодно считаем использования до уничтожения
+static void resolve(Call* calls, size_t count) {
+    AddressMap map;
+    size_t size = 64;
+    while (size < count * 4) size <<= 1;
+    map.keys = (uint64_t*)calloc(size, sizeof(uint64_t));
+    map.values = (int64_t*)calloc(size, sizeof(int64_t));
+    map.mask = size - 1;
+    objects = (Object*)calloc(count + 1, sizeof(Object));
+    if (!map.keys || !map.values || !objects) out_of_memory();
+
+    for (size_t i = 0; i < count; i++) {
+        Call* c = &calls[i];
+        uint64_t raw[2] = {c->ev.object, c->ev.target};
+        unsigned char roles[2] = {ops[c->ev.op].object, ops[c->ev.op].target};
+        for (int f = 0; f < 2; f++) {
+            c->ids[f] = -1;
+            if (roles[f] == ROLE_NONE || !raw[f]) continue;
+            int64_t* slot = map_slot(&map, raw[f]);
+            if (roles[f] == ROLE_CREATE) {
+                // Неудачный вызов ничего не создал
+                if (c->ev.result != 0) continue;
+                c->ids[f] = (int64_t)object_count++;
+                *slot = c->ids[f];
+                continue;
+            }
+            c->ids[f] = *slot;
+            if (c->ids[f] < 0) {
+                c->skip = 1;    // объект появился до начала записи
+                continue;
+            }
+            if (roles[f] == ROLE_USE) objects[c->ids[f]].uses++;
+            else *slot = -1;
+        }
+        for (int f = 0; f < 2; f++)
+            if (c->skip && roles[f] == ROLE_CREATE && c->ids[f] >= 0) objects[c->ids[f]].failed = 1;
+    }
+    free(map.keys);
+    free(map.values);
+}
+
+// ----------------------------------------
+// Повтор
+// ----------------------------------------
+static void synthetic_kernel(void* data, size_t count) {
+    (void)data;
+    (void)count;
+    uint64_t start = now_ns();
+    while (now_ns() - start < synthetic_budget_ns) {
+    }
+}
+
+static BMKernelFunc find_kernel(const char* name, int* synthetic) {
+    *synthetic = 1;
+    if (!kernel_lib) return synthetic_kernel;
+    void* sym = dlsym(kernel_lib, name);
+    if (!sym) return synthetic_kernel;
+    BMKernelFunc func;
+    memcpy(&func, &sym, sizeof(func));
+    *synthetic = 0;
+    return func;
+}
+
+static void backoff(unsigned* spins) {
+    if (++*spins < 64) {
+        sched_yield();
+    } else {
+        struct timespec pause = {0, 20000};
+        nanosleep(&pause, NULL);
+    }
+}
+
+static void wait_ready(Object* obj) {
+    unsigned spins = 0;
+    while (!__atomic_load_n(&obj->ready, __ATOMIC_ACQUIRE)) backoff(&spins);
+}
+
+static void wait_unused(Object* obj) {
+    unsigned spins = 0;
+    while (__atomic_load_n(&obj->done, __ATOMIC_ACQUIRE) < obj->uses) backoff(&spins);
+}
+
+static void* scratch(Replayer* r, size_t size) {
+    if (size > r->scratch_size) {
+        r->scratch = xrealloc(r->scratch, size);
+        memset(r->scratch, 0x5a, size);
+        r->scratch_size = size;
+    }
+    return r->scratch;
+}
+
+// Записаны только объём и число фрагментов: равные фрагменты подряд, а тот,
+// что не помещается в остаток буфера, — снова с начала
+static BMResult replay_regions(Replayer* r, BMBuffer* buf, const BMRecordEvent* ev, int write) {
+    size_t total = (size_t)ev->args[0], count = (size_t)ev->args[1];
+    BMBufferInfo info;
+    if (bm_query_buffer(buf, &info) != BM_OK) return BM_ERROR_INVALID_ARG;
+    if (count > r->regions_cap)
+        r->regions = (BMTransferRegion*)xrealloc(r->regions, (r->regions_cap = count) * sizeof(BMTransferRegion));
+
+    char* host = (char*)scratch(r, total + 1);
+    size_t piece = count ? total / count : 0, done = 0, offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t size = i + 1 == count ? total - done : piece;
+        if (size > info.size) size = info.size;
+        if (size > info.size - offset) offset = 0;
+        r->regions[i].host = host + done;
+        r->regions[i].offset = offset;
+        r->regions[i].size = size;
+        done += size;
+        offset += size;
+    }
+    return write ? bm_write_buffer_regions(buf, r->regions, count) : bm_read_buffer_regions(buf, r->regions, count);
+}
+
+static void sample_add(Samples* s, uint64_t value) {
+    if (s->count == s->cap) s->values = (uint64_t*)xrealloc(s->values, (s->cap = s->cap ? s->cap * 2 : 256) * sizeof(uint64_t));
+    s->values[s->count++] = value;
+}
+
+// Выполнить вызов; created — созданный объект, возвращает BMResult
+static int execute(Replayer* r, const Call* c, void* obj, void* target, void** created, int* synthetic) {
+    const BMRecordEvent* ev = &c->ev;
+    BMResult res = BM_OK;
+    switch (ev->op) {
+    case BM_RECORD_CREATE_DEVICE: {
+        BMDevice* dev = NULL;
+        res = bm_create_device((BMComputeTarget)ev->args[0], &dev);
+        if (res != BM_OK && ev->args[0] != BM_CPU) {
+            if (!__atomic_exchange_n(&device_fallback_warned, 1, __ATOMIC_RELAXED))
+                fprintf(stderr, "bm_replay: устройство типа %llu недоступно, используется CPU\n",
+                        (unsigned long long)ev->args[0]);
+            res = bm_create_device(BM_CPU, &dev);
+        }
+        *created = dev;
+        break;
+    }
+    case BM_RECORD_DESTROY_DEVICE:
+        res = bm_destroy_device((BMDevice*)obj);
+        break;
+    case BM_RECORD_ALLOC_BUFFER: {
+        BMBuffer* buf = NULL;
+        res = bm_alloc_buffer((BMDevice*)obj, (size_t)ev->args[0], &buf);
+        *created = buf;
+        break;
+    }
+    case BM_RECORD_FREE_BUFFER:
+        res = bm_free_buffer((BMBuffer*)obj);
+        break;
+    case BM_RECORD_WRITE_BUFFER:
+        res = bm_write_buffer((BMBuffer*)obj, scratch(r, ev->args[0]), (size_t)ev->args[0], (size_t)ev->args[1]);
+        break;
+    case BM_RECORD_READ_BUFFER:
+        res = bm_read_buffer((BMBuffer*)obj, scratch(r, ev->args[0]), (size_t)ev->args[0], (size_t)ev->args[1]);
+        break;
+    case BM_RECORD_REGISTER_KERNEL: {
+        char name[BM_KERNEL_NAME_MAX];
+        memcpy(name, &c->data, sizeof(name));
+        name[sizeof(name) - 1] = '\0';
+        BMKernel* kernel = bm_register_kernel((BMDevice*)obj, name, find_kernel(name, synthetic));
+        if (!kernel) res = BM_ERROR_INTERNAL;
+        *created = kernel;
+        break;
+    }
+    case BM_RECORD_UNREGISTER_KERNEL:
+        bm_unregister_kernel((BMKernel*)obj);
+        break;
+    case BM_RECORD_LAUNCH_KERNEL:
+        synthetic_budget_ns = (uint64_t)((double)ev->duration_ns / opt.speed);
+        res = bm_launch_kernel((BMKernel*)obj, (BMBuffer*)target, (size_t)ev->args[0]);
+        break;
+    case BM_RECORD_POOL_CREATE: {
+        uint64_t params[4];
+        memcpy(params, &c->data, sizeof(params));
+        BMPoolConfig config = {(size_t)ev->args[0], (size_t)ev->args[1], (size_t)params[0],
+                               (size_t)params[1], (uint32_t)params[2], (unsigned)params[3]};
+        BMBufferPool* pool = bm_pool_create_ex((BMDevice*)obj, &config);
+        if (!pool) res = BM_ERROR_INTERNAL;
+        *created = pool;
+        break;
+    }
+    case BM_RECORD_POOL_DESTROY:
+        res = bm_pool_destroy((BMBufferPool*)obj) == 0 ? BM_OK : BM_ERROR_INTERNAL;
+        break;
+    case BM_RECORD_POOL_ACQUIRE: {
+        // Успешный неблокирующий acquire мог опередить release другого
+        // потока на повторе — даём ему подождать, а не расходиться с записью
+        int64_t timeout = (int64_t)ev->args[0];
+        if (ev->result == 0 && timeout == 0) timeout = 1000;
+        BMBuffer* buf = NULL;
+        res = bm_pool_acquire_timeout((BMBufferPool*)obj, &buf, timeout) == 0 ? BM_OK : BM_ERROR_TIMEOUT;
+        if (res == BM_OK && ev->result != 0) {
+            bm_pool_release((BMBufferPool*)obj, buf);
+            buf = NULL;
+        }
+        *created = buf;
+        break;
+    }
+    case BM_RECORD_POOL_RELEASE:
+        res = bm_pool_release((BMBufferPool*)obj, (BMBuffer*)target) == 0 ? BM_OK : BM_ERROR_INTERNAL;
+        break;
+    case BM_RECORD_WRAP_HOST: {
+        // Память приложения не записана — своя того же размера, её вернёт bm_free_buffer
+        void* ptr = NULL;
+        BMBuffer* buf = NULL;
+        if (posix_memalign(&ptr, BM_HOST_WRAP_ALIGNMENT, (size_t)ev->args[0]) != 0) {
+            res = BM_ERROR_NOMEM;
+        } else if ((res = bm_buffer_wrap_host((BMDevice*)obj, ptr, (size_t)ev->args[0], BM_WRAP_ADOPT, &buf)) != BM_OK) {
+            free(ptr);
+        }
+        *created = buf;
+        break;
+    }
+    case BM_RECORD_CLONE_BUFFER: {
+        BMBuffer* buf = NULL;
+        res = bm_buffer_clone((BMBuffer*)obj, (unsigned)ev->args[0], &buf);
+        *created = buf;
+        break;
+    }
+    case BM_RECORD_MAP_FILE: {
+        // Файла на повторе нет — обычный буфер того же размера
+        BMBuffer* buf = NULL;
+        res = bm_alloc_buffer((BMDevice*)obj, (size_t)ev->args[0], &buf);
+        *created = buf;
+        break;
+    }
+    case BM_RECORD_CREATE_SHARED:
+    case BM_RECORD_IMPORT_SHARED: {
+        // Имя могло быть занято, а импортированный объект жил в другом процессе
+        BMBuffer* buf = NULL;
+        res = bm_buffer_create_shared((BMDevice*)obj, NULL, (size_t)ev->args[0], &buf);
+        *created = buf;
+        break;
+    }
+    case BM_RECORD_MAP_BUFFER: {
+        uint64_t flags;
+        memcpy(&flags, &c->data, sizeof(flags));
+        void* ptr = NULL;
+        res = bm_map_buffer((BMBuffer*)obj, (size_t)ev->args[1], (size_t)ev->args[0], (unsigned)flags, &ptr);
+        *created = ptr;
+        break;
+    }
+    case BM_RECORD_UNMAP_BUFFER:
+        res = bm_unmap_buffer((BMBuffer*)obj, target);
+        break;
+    case BM_RECORD_WRITE_REGIONS:
+    case BM_RECORD_READ_REGIONS:
+        res = replay_regions(r, (BMBuffer*)obj, ev, ev->op == BM_RECORD_WRITE_REGIONS);
+        break;
+    default:
+        res = BM_ERROR_UNSUPPORTED;
+        break;
+    }
+    return (int)res;
+}
+
+static void run_call(Replayer* r, Call* c) {
+    unsigned char roles[2] = {ops[c->ev.op].object, ops[c->ev.op].target};
+    void* handles[2] = {NULL, NULL};
+    int usable = !c->skip;
+
+    // Объекты, которые вызов использует или уничтожает, должны уже существовать
+    for (int f = 0; f < 2; f++) {
+        if (c->ids[f] < 0 || roles[f] == ROLE_CREATE) continue;
+        Object* obj = &objects[c->ids[f]];
+        wait_ready(obj);
+        if (obj->failed) usable = 0;
+        handles[f] = obj->handle;
+        if (roles[f] == ROLE_DESTROY) wait_unused(obj);
+    }
+
+    if (!opt.asap) {
+        uint64_t due = replay_start_ns + (uint64_t)((double)c->ev.start_ns / opt.speed);
+        struct timespec ts = {(time_t)(due / 1000000000ull), (long)(due % 1000000000ull)};
+        if (now_ns() < due) clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+
+    void* created = NULL;
+    int synthetic = 0;
+    int result = -1;
+    if (usable) {
+        uint64_t start = now_ns();
+        result = execute(r, c, handles[0], handles[1], &created, &synthetic);
+        sample_add(&r->latency[c->ev.op], now_ns() - start);
+        r->recorded_ns[c->ev.op] += c->ev.duration_ns;
+        if ((result == 0) != (c->ev.result == 0)) r->diverged++;
+    } else {
+        r->skipped++;
+    }
+
+    for (int f = 0; f < 2; f++) {
+        if (c->ids[f] < 0) continue;
+        Object* obj = &objects[c->ids[f]];
+        if (roles[f] == ROLE_CREATE) {
+            obj->handle = created;
+            if (created && synthetic) __atomic_add_fetch(&synthetic_kernels, 1, __ATOMIC_RELAXED);
+            if (!created) obj->failed = 1;
+            __atomic_store_n(&obj->ready, 1, __ATOMIC_RELEASE);
+        } else if (roles[f] == ROLE_USE) {
+            __atomic_add_fetch(&obj->done, 1, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+static void* replay_thread(void* arg) {
+    Replayer* r = (Replayer*)arg;
+    for (size_t i = 0; i < r->count; i++) run_call(r, r->calls[i]);
+    return NULL;
+}
+
+// ----------------------------------------
+// Отчёт
+// ----------------------------------------
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const uint64_t* sorted, size_t n, double p) {
+    size_t rank = (size_t)(p / 100.0 * (double)n + 0.999999);
+    if (rank < 1) rank = 1;
+    return (double)sorted[rank - 1];
+}
+
+static void report(Replayer* replayers, size_t thread_count, uint64_t wall_ns, size_t calls) {
+    FILE* json = NULL;
+    if (opt.json && !(json = fopen(opt.json, "w"))) fprintf(stderr, "bm_replay: не удалось открыть %s\n", opt.json);
+    if (json) fprintf(json, "{\n  \"version\": 1,\n  \"source\": \"bm_replay\",\n  \"benchmarks\": [\n");
+
+    size_t skipped = 0, diverged = 0, threads = 0;
+    for (size_t t = 0; t < thread_count; t++) {
+        skipped += replayers[t].skipped;
+        diverged += replayers[t].diverged;
+        threads += replayers[t].count > 0;
+    }
+    printf("%-18s %9s %12s %12s %12s %12s\n", "op", "calls", "recorded", "mean", "p50", "p99");
+
+    int first = 1;
+    for (unsigned op = 1; op < BM_RECORD_OP_COUNT; op++) {
+        Samples all = {NULL, 0, 0};
+        uint64_t recorded = 0, sum = 0;
+        for (size_t t = 0; t < thread_count; t++) {
+            Samples* s = &replayers[t].latency[op];
+            for (size_t i = 0; i < s->count; i++) sample_add(&all, s->values[i]);
+            recorded += replayers[t].recorded_ns[op];
+        }
+        if (!all.count) continue;
+        qsort(all.values, all.count, sizeof(uint64_t), compare_u64);
+        for (size_t i = 0; i < all.count; i++) sum += all.values[i];
+        double mean = (double)sum / all.count, rec_mean = (double)recorded / all.count;
+        double p50 = percentile(all.values, all.count, 50), p99 = percentile(all.values, all.count, 99);
+        printf("%-18s %9zu %9.0f ns %9.0f ns %9.0f ns %9.0f ns\n", ops[op].name, all.count, rec_mean, mean, p50, p99);
+        if (json) {
+            fprintf(json, "%s    {\"name\": \"replay/%s\", \"threads\": 1, \"iterations\": %zu, \"samples\": %zu, "
+                          "\"min_ns\": %.1f, \"p50_ns\": %.1f, \"p90_ns\": %.1f, \"p99_ns\": %.1f, "
+                          "\"mean_ns\": %.1f, \"recorded_mean_ns\": %.1f}",
+                    first ? "" : ",\n", ops[op].name, all.count, all.count, (double)all.values[0], p50,
+                    percentile(all.values, all.count, 90), p99, mean, rec_mean);
+            first = 0;
+        }
+        free(all.values);
+    }
+    printf("\n%zu calls from %zu threads in %.3f s (%s), skipped %zu, diverged %zu, synthetic kernels %zu\n",
+           calls, threads, (double)wall_ns / 1e9, opt.asap ? "asap" : "real timing", skipped, diverged,
+           synthetic_kernels);
+    if (json) {
+        fprintf(json, "\n  ],\n  \"wall_ns\": %llu,\n  \"skipped\": %zu,\n  \"diverged\": %zu\n}\n",
+                (unsigned long long)wall_ns, skipped, diverged);
+        fclose(json);
+    }
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [--timing real|asap] [--speed X] [--kernels LIB.so] [--log-level N]\n"
+                    "          [--json FILE] TRACE.bmrec\n", argv0);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--timing") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            if (strcmp(mode, "asap") == 0) opt.asap = 1;
+            else if (strcmp(mode, "real") == 0) opt.asap = 0;
+            else usage(argv[0]);
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            opt.speed = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--kernels") == 0 && i + 1 < argc) {
+            opt.kernels = argv[++i];
+        } else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc) {
+            opt.log_level = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            opt.json = argv[++i];
+        } else if (argv[i][0] != '-' && !opt.path) {
+            opt.path = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (!opt.path || opt.speed <= 0) usage(argv[0]);
+
+    if (opt.kernels && !(kernel_lib = dlopen(opt.kernels, RTLD_NOW | RTLD_LOCAL))) {
+        fprintf(stderr, "bm_replay: %s\n", dlerror());
+        return 2;
+    }
+
+    size_t count = 0;
+    Call* calls = load(opt.path, &count);
+    resolve(calls, count);
+
+    // Потоки записи -> потоки повтора, вызовы каждого в порядке seq
+    unsigned max_thread = 0;
+    for (size_t i = 0; i < count; i++)
+        if (calls[i].ev.thread > max_thread) max_thread = calls[i].ev.thread;
+    Replayer* by_id = (Replayer*)calloc((size_t)max_thread + 1, sizeof(Replayer));
+    if (!by_id) out_of_memory();
+    for (size_t i = 0; i < count; i++) {
+        Replayer* r = &by_id[calls[i].ev.thread];
+        r->id = calls[i].ev.thread;
+        if (r->count == r->cap) r->calls = (Call**)xrealloc(r->calls, (r->cap = r->cap ? r->cap * 2 : 256) * sizeof(Call*));
+        r->calls[r->count++] = &calls[i];
+    }
+
+    bm_log_set_level(opt.log_level);
+
+    replay_start_ns = now_ns();
+    for (unsigned id = 1; id <= max_thread; id++) {
+        if (!by_id[id].count) continue;
+        if (pthread_create(&by_id[id].tid, NULL, replay_thread, &by_id[id]) != 0) {
+            fprintf(stderr, "bm_replay: не удалось создать поток\n");
+            return 2;
+        }
+    }
+    for (unsigned id = 1; id <= max_thread; id++)
+        if (by_id[id].count) pthread_join(by_id[id].tid, NULL);
+    uint64_t wall_ns = now_ns() - replay_start_ns;
+
+    report(by_id + 1, max_thread, wall_ns, count);
+
+    for (unsigned id = 1; id <= max_thread; id++) {
+        for (unsigned op = 0; op < BM_RECORD_OP_COUNT; op++) free(by_id[id].latency[op].values);
+        free(by_id[id].calls);
+        free(by_id[id].scratch);
+        free(by_id[id].regions);
+    }
+    free(by_id);
+    free(objects);
+    free(calls);
+    if (kernel_lib) dlclose(kernel_lib);
+    return 0;
+}